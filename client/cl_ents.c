@@ -38,13 +38,14 @@ FRAME PARSING
 
 /*
 =================
-CL_ParseEntityBits
+CL_ReadEntityBits
 
-Returns the entity number and the header bits
+CL_ParseEntityBits for when the header may run past the end of the
+message, every byte is bounds checked
 =================
 */
 //int	bitcounts[32];	/// just for protocol profiling
-int CL_ParseEntityBits (uint32 *bits)
+static int CL_ReadEntityBits (uint32 *bits)
 {
 	uint32		b, total;
 	uint32		number;
@@ -89,12 +90,13 @@ int CL_ParseEntityBits (uint32 *bits)
 
 /*
 ==================
-CL_ParseDelta
+CL_ReadDelta
 
-Can go from either a baseline or a previous packet_entity
+CL_ParseDelta for when the fields may run past the end of the message,
+every field is bounds checked
 ==================
 */
-void CL_ParseDelta (const entity_state_t *from, entity_state_t *to, int number, int bits)
+static void CL_ReadDelta (const entity_state_t *from, entity_state_t *to, int number, int bits)
 {
 	// set everything to the state we are delta'ing from
 	*to = *from;
@@ -181,6 +183,357 @@ void CL_ParseDelta (const entity_state_t *from, entity_state_t *to, int number,
 	//	MSG_ReadPos (&net_message, to->velocity);
 }
 
+/*
+=========================================================================
+
+DELTA DECODING FAST PATH
+
+Most entities are nowhere near the end of the message, so their size is
+worked out from the bits up front and checked once, then the fields are
+read straight out of the buffer. Fields are numbered in the order they
+are on the wire and the bits are translated a byte at a time, so
+walking the set bits from the bottom visits the fields in read order.
+
+=========================================================================
+*/
+
+enum
+{
+	DF_MODEL,
+	DF_MODEL2,
+	DF_MODEL3,
+	DF_MODEL4,
+	DF_FRAME8,
+	DF_FRAME16,
+	DF_SKIN8,
+	DF_SKIN16,
+	DF_SKIN32,
+	DF_EFFECTS8,
+	DF_EFFECTS16,
+	DF_EFFECTS32,
+	DF_RENDERFX8,
+	DF_RENDERFX16,
+	DF_RENDERFX32,
+	DF_ORIGIN1,
+	DF_ORIGIN2,
+	DF_ORIGIN3,
+	DF_ANGLE1,
+	DF_ANGLE2,
+	DF_ANGLE3,
+	DF_OLDORIGIN,
+	DF_SOUND,
+	DF_EVENT,
+	DF_SOLID16,
+	DF_SOLID32
+};
+
+#define	DF_BIT(f)	(1U << (f))
+
+static const struct
+{
+	uint32	bit;
+	int		field;
+	int		size;
+} cl_deltabits[] =
+{
+	{U_MODEL,		DF_MODEL,		1},
+	{U_MODEL2,		DF_MODEL2,		1},
+	{U_MODEL3,		DF_MODEL3,		1},
+	{U_MODEL4,		DF_MODEL4,		1},
+	{U_FRAME8,		DF_FRAME8,		1},
+	{U_FRAME16,		DF_FRAME16,		2},
+	{U_SKIN8,		DF_SKIN8,		1},
+	{U_SKIN16,		DF_SKIN16,		2},
+	{U_EFFECTS8,	DF_EFFECTS8,	1},
+	{U_EFFECTS16,	DF_EFFECTS16,	2},
+	{U_RENDERFX8,	DF_RENDERFX8,	1},
+	{U_RENDERFX16,	DF_RENDERFX16,	2},
+	{U_ORIGIN1,		DF_ORIGIN1,		2},
+	{U_ORIGIN2,		DF_ORIGIN2,		2},
+	{U_ORIGIN3,		DF_ORIGIN3,		2},
+	{U_ANGLE1,		DF_ANGLE1,		1},
+	{U_ANGLE2,		DF_ANGLE2,		1},
+	{U_ANGLE3,		DF_ANGLE3,		1},
+	{U_OLDORIGIN,	DF_OLDORIGIN,	6},
+	{U_SOUND,		DF_SOUND,		1},
+	{U_EVENT,		DF_EVENT,		1},
+	{U_SOLID,		DF_SOLID16,		2},
+};
+
+//fields and their total size for each byte of the bits
+static uint32	cl_deltafields[4][256];
+static byte		cl_deltasize[4][256];
+
+/*
+==================
+CL_InitDeltaTables
+==================
+*/
+void CL_InitDeltaTables (void)
+{
+	int		i, b, v;
+	uint32	bit;
+
+	for (b = 0; b < 4; b++)
+	{
+		for (v = 0; v < 256; v++)
+		{
+			bit = (uint32)v << (b * 8);
+
+			for (i = 0; i < sizeof(cl_deltabits) / sizeof(cl_deltabits[0]); i++)
+			{
+				if (bit & cl_deltabits[i].bit)
+				{
+					cl_deltafields[b][v] |= DF_BIT(cl_deltabits[i].field);
+					cl_deltasize[b][v] += cl_deltabits[i].size;
+				}
+			}
+		}
+	}
+}
+
+#define	DF_SHORT(p)	((int16)((p)[0] | ((p)[1] << 8)))
+#define	DF_LONG(p)	((int32)((p)[0] | ((p)[1] << 8) | ((p)[2] << 16) | ((uint32)(p)[3] << 24)))
+
+/*
+=================
+CL_ParseEntityBits
+
+Returns the entity number and the header bits
+=================
+*/
+int CL_ParseEntityBits (uint32 *bits)
+{
+	const byte	*p;
+	uint32		total;
+	uint32		number;
+
+	//four bytes of bits and a short number is as big as it gets
+	if (net_message.cursize - net_message.readcount < 6)
+		return CL_ReadEntityBits (bits);
+
+	p = net_message.data + net_message.readcount;
+
+	total = *p++;
+	if (total & U_MOREBITS1)
+		total |= *p++ << 8;
+	if (total & U_MOREBITS2)
+		total |= *p++ << 16;
+	if (total & U_MOREBITS3)
+		total |= (uint32)*p++ << 24;
+
+	if (total & U_NUMBER16)
+	{
+		number = DF_SHORT (p);
+		p += 2;
+		if (number > MAX_EDICTS)
+			Com_Error (ERR_DROP, "CL_ParseEntityBits: Bad entity number %u", number);
+	}
+	else
+	{
+		number = *p++;
+	}
+
+#ifdef _DEBUG
+	{
+		uint32	checkbits;
+		int		start;
+
+		start = net_message.readcount;
+		if (CL_ReadEntityBits (&checkbits) != number || checkbits != total || net_message.readcount != p - net_message.data)
+			Com_Error (ERR_DROP, "CL_ParseEntityBits: fast path mismatch at %d", start);
+		net_message.readcount = start;
+	}
+#endif
+
+	net_message.readcount = (int)(p - net_message.data);
+
+	*bits = total;
+
+	return number;
+}
+
+/*
+==================
+CL_ParseDelta
+
+Can go from either a baseline or a previous packet_entity
+==================
+*/
+void CL_ParseDelta (const entity_state_t *from, entity_state_t *to, int number, int bits)
+{
+	const byte	*p;
+	uint32		fields;
+	int			size, f;
+
+	fields = cl_deltafields[0][bits & 0xFF] | cl_deltafields[1][(bits >> 8) & 0xFF] |
+			cl_deltafields[2][(bits >> 16) & 0xFF] | cl_deltafields[3][((uint32)bits >> 24) & 0xFF];
+
+	size = cl_deltasize[0][bits & 0xFF] + cl_deltasize[1][(bits >> 8) & 0xFF] +
+			cl_deltasize[2][(bits >> 16) & 0xFF] + cl_deltasize[3][((uint32)bits >> 24) & 0xFF];
+
+	//both sizes set means a long
+	if ((fields & (DF_BIT(DF_SKIN8)|DF_BIT(DF_SKIN16))) == (DF_BIT(DF_SKIN8)|DF_BIT(DF_SKIN16)))
+	{
+		fields ^= DF_BIT(DF_SKIN8)|DF_BIT(DF_SKIN16)|DF_BIT(DF_SKIN32);
+		size++;
+	}
+
+	if ((fields & (DF_BIT(DF_EFFECTS8)|DF_BIT(DF_EFFECTS16))) == (DF_BIT(DF_EFFECTS8)|DF_BIT(DF_EFFECTS16)))
+	{
+		fields ^= DF_BIT(DF_EFFECTS8)|DF_BIT(DF_EFFECTS16)|DF_BIT(DF_EFFECTS32);
+		size++;
+	}
+
+	if ((fields & (DF_BIT(DF_RENDERFX8)|DF_BIT(DF_RENDERFX16))) == (DF_BIT(DF_RENDERFX8)|DF_BIT(DF_RENDERFX16)))
+	{
+		fields ^= DF_BIT(DF_RENDERFX8)|DF_BIT(DF_RENDERFX16)|DF_BIT(DF_RENDERFX32);
+		size++;
+	}
+
+	if ((fields & DF_BIT(DF_SOLID16)) && cls.protocolVersion >= MINOR_VERSION_R1Q2_32BIT_SOLID)
+	{
+		fields ^= DF_BIT(DF_SOLID16)|DF_BIT(DF_SOLID32);
+		size += 2;
+	}
+
+	if (net_message.cursize - net_message.readcount < size)
+	{
+		CL_ReadDelta (from, to, number, bits);
+		return;
+	}
+
+	// set everything to the state we are delta'ing from
+	*to = *from;
+
+	if (cls.serverProtocol != PROTOCOL_R1Q2)
+		FastVectorCopy (from->origin, to->old_origin);
+	else if (!(bits & U_OLDORIGIN) && !(from->renderfx & RF_BEAM))
+		FastVectorCopy (from->origin, to->old_origin);
+
+	to->number = number;
+	to->event = 0;
+
+	p = net_message.data + net_message.readcount;
+
+	while (fields)
+	{
+		f = Q_LowestBit (fields);
+		fields &= fields - 1;
+
+		switch (f)
+		{
+			case DF_MODEL:
+				to->modelindex = *p++;
+				break;
+			case DF_MODEL2:
+				to->modelindex2 = *p++;
+				break;
+			case DF_MODEL3:
+				to->modelindex3 = *p++;
+				break;
+			case DF_MODEL4:
+				to->modelindex4 = *p++;
+				break;
+
+			case DF_FRAME8:
+				to->frame = *p++;
+				break;
+			case DF_FRAME16:
+				to->frame = DF_SHORT (p);
+				p += 2;
+				break;
+
+			case DF_SKIN8:
+				to->skinnum = *p++;
+				break;
+			case DF_SKIN16:
+				to->skinnum = DF_SHORT (p);
+				p += 2;
+				break;
+			case DF_SKIN32:
+				to->skinnum = DF_LONG (p);
+				p += 4;
+				break;
+
+			case DF_EFFECTS8:
+				to->effects = *p++;
+				break;
+			case DF_EFFECTS16:
+				to->effects = DF_SHORT (p);
+				p += 2;
+				break;
+			case DF_EFFECTS32:
+				to->effects = DF_LONG (p);
+				p += 4;
+				break;
+
+			case DF_RENDERFX8:
+				to->renderfx = *p++;
+				break;
+			case DF_RENDERFX16:
+				to->renderfx = DF_SHORT (p);
+				p += 2;
+				break;
+			case DF_RENDERFX32:
+				to->renderfx = DF_LONG (p);
+				p += 4;
+				break;
+
+			case DF_ORIGIN1:
+			case DF_ORIGIN2:
+			case DF_ORIGIN3:
+				to->origin[f - DF_ORIGIN1] = DF_SHORT (p) * 0.125f;
+				p += 2;
+				break;
+
+			case DF_ANGLE1:
+			case DF_ANGLE2:
+			case DF_ANGLE3:
+				to->angles[f - DF_ANGLE1] = (signed char)*p++ * 1.40625f;
+				break;
+
+			case DF_OLDORIGIN:
+				to->old_origin[0] = DF_SHORT (p) * 0.125f;
+				to->old_origin[1] = DF_SHORT (p + 2) * 0.125f;
+				to->old_origin[2] = DF_SHORT (p + 4) * 0.125f;
+				p += 6;
+				break;
+
+			case DF_SOUND:
+				to->sound = *p++;
+				break;
+			case DF_EVENT:
+				to->event = *p++;
+				break;
+
+			case DF_SOLID16:
+				to->solid = DF_SHORT (p);
+				p += 2;
+				break;
+			case DF_SOLID32:
+				to->solid = DF_LONG (p);
+				p += 4;
+				break;
+		}
+	}
+
+#ifdef _DEBUG
+	{
+		entity_state_t	check;
+		int				start;
+
+		start = net_message.readcount;
+		CL_ReadDelta (from, &check, number, bits);
+		if (net_message.readcount != p - net_message.data || memcmp (&check, to, sizeof(check)))
+			Com_Error (ERR_DROP, "CL_ParseDelta: fast path mismatch on entity %d, bits 0x%x", number, bits);
+		net_message.readcount = start;
+	}
+#endif
+
+	net_message.readcount = (int)(p - net_message.data);
+}
+
 static void CL_SetEntState (centity_t *ent, entity_state_t *state)
 {
 	// some data changes will force no lerping
@@ -989,6 +1342,36 @@ static void CL_DemoDeltaPlayerstate (const frame_t *from, frame_t *to)
 			MSG_WriteShort (ps->stats[i]);
 }
 
+/*
+===================
+CL_WriteDemoFrame
+
+Writes "to" as a protocol 34 svc_frame delta compressed from "from", or
+in full if from is NULL. deltaframe is what the frame header claims it
+was compressed from.
+===================
+*/
+void CL_WriteDemoFrame (sizebuf_t *msg, const frame_t *from, frame_t *to, int deltaframe, int areabytes)
+{
+	//svc_frame header shit
+	SZ_WriteByte (msg, svc_frame);
+	SZ_WriteLong (msg, to->serverframe);
+	SZ_WriteLong (msg, deltaframe);
+	SZ_WriteByte (msg, cl.surpressCount);
+
+	//areabits
+	SZ_WriteByte (msg, areabytes);
+	SZ_Write (msg, &to->areabits, areabytes);
+
+	//delta ps
+	CL_DemoDeltaPlayerstate (from, to);
+	MSG_EndWriting (msg);
+
+	//delta pe
+	CL_DemoPacketEntities (from, to);
+	MSG_EndWriting (msg);
+}
+
 /*
 ===================
 CL_ParsePlayerstate
@@ -1252,6 +1635,10 @@ void CL_ParsePlayerUpdate (void)
 		}
 	}
 
+	//other players moved, anything predicted against them is stale
+	CL_BuildPredictionEnts ();
+	CL_InvalidatePrediction ();
+
 	//stale packet perhaps after we turned it off.
 	if (cl_player_updates->intvalue)
 		cl.player_update_time = cl.time + (100 / (cl.settings[SVSET_PLAYERUPDATES] + 1));
@@ -1274,6 +1661,7 @@ void CL_ParseFrame (int extrabits)
 	int			len;
 	int			extraflags;
 	uint32		serverframe;
+	int			lastserverframe;
 	frame_t		*old;
 
 	//cl.player_updates_received = 0;
@@ -1285,6 +1673,7 @@ void CL_ParseFrame (int extrabits)
 	//for over 19 days... how often will this legitimately happen, and do we
 	//really need the possibility of the server running same map for 13 years...
 	serverframe = MSG_ReadLong (&net_message);
+	lastserverframe = cl.frame.serverframe;
 
 	if (cls.serverProtocol != PROTOCOL_R1Q2)
 	{
@@ -1308,6 +1697,13 @@ void CL_ParseFrame (int extrabits)
 			cl.frame.deltaframe = serverframe - offset;
 	}
 
+	//demo jumped back to a keyframe, anything still in flight is from the future
+	if (cl.attractloop && cls.state == ca_active && cl.frame.deltaframe <= 0 && cl.frame.serverframe <= lastserverframe)
+	{
+		CL_ClearEffects ();
+		CL_ClearTEnts ();
+	}
+
 	if (cls.state != ca_active)
 		cl.frame.servertime = 0;
 	else
@@ -1364,7 +1760,7 @@ void CL_ParseFrame (int extrabits)
 			// is too old, so we can't reconstruct it properly.
 			Com_DPrintf ("Delta frame too old.\n");
 		}
-		else if (cl.parse_entities - old->parse_entities > MAX_PARSE_ENTITIES-128)
+		else if (cl.parse_entities - old->parse_entities > MAX_PARSE_ENTITIES-MAX_EDICTS)
 		{
 			Com_DPrintf ("Delta parse_entities too old.\n");
 		}
@@ -1408,25 +1804,25 @@ void CL_ParseFrame (int extrabits)
 
 	CL_ParsePacketEntities (old, &cl.frame);
 
+	//r1: collect solids once here rather than for every prediction trace
+	CL_BuildPredictionEnts ();
+	CL_InvalidatePrediction ();
+
 	//r1: now write protocol 34 compatible delta from our localstate for demo.
 	if (!cls.demowaiting && cls.demorecording && cls.serverProtocol != PROTOCOL_ORIGINAL)
 	{
+		static byte	fakeDemoFrame[MAX_FRAGMENTED_MSGLEN - MAX_MSGLEN];
 		sizebuf_t	fakeMsg;
-		byte		fakeDemoFrame[1300];
+		int			demodelta;
 
 		//do it
 		SZ_Init (&fakeMsg, fakeDemoFrame, sizeof(fakeDemoFrame));
 		fakeMsg.allowoverflow = true;
 
-		//svc_frame header shit
-		SZ_WriteByte (&fakeMsg, svc_frame);
-
-		SZ_WriteLong (&fakeMsg, cl.frame.serverframe);
-
 		if (!cl.demoLastFrame)
 		{
 			//no valid demo frame yet, use whatever the server gave us
-			SZ_WriteLong (&fakeMsg, cl.frame.deltaframe);
+			demodelta = cl.frame.deltaframe;
 		}
 		else
 		{
@@ -1443,7 +1839,7 @@ void CL_ParseFrame (int extrabits)
 				Com_DPrintf ("Demo delta frame too old.\n");
 				cl.demoLastFrame = NULL;
 			}
-			else if (cl.parse_entities - cl.demoLastFrame->parse_entities > MAX_PARSE_ENTITIES-128)
+			else if (cl.parse_entities - cl.demoLastFrame->parse_entities > MAX_PARSE_ENTITIES-MAX_EDICTS)
 			{
 				// or the entities in that frame are long gone
 				Com_DPrintf ("Demo delta parse_entities too old.\n");
@@ -1452,32 +1848,23 @@ void CL_ParseFrame (int extrabits)
 
 			//delta if possible, if not just write uncompressed message
 			if (cl.demoLastFrame)
-				SZ_WriteLong (&fakeMsg, cl.demoLastFrame->serverframe);
+				demodelta = cl.demoLastFrame->serverframe;
 			else
-				SZ_WriteLong (&fakeMsg, -1);
+				demodelta = -1;
 		}
 
-		SZ_WriteByte (&fakeMsg, cl.surpressCount);
-
-		//areabits
-		SZ_WriteByte (&fakeMsg, len);
-		SZ_Write (&fakeMsg, &cl.frame.areabits, len);
-
-		//delta ps
-		CL_DemoDeltaPlayerstate (cl.demoLastFrame, &cl.frame);
-		MSG_EndWriting (&fakeMsg);
-
-		//delta pe
-		CL_DemoPacketEntities (cl.demoLastFrame, &cl.frame);
-		MSG_EndWriting (&fakeMsg);
+		CL_WriteDemoFrame (&fakeMsg, cl.demoLastFrame, &cl.frame, demodelta, len);
 
-		//copy to demobuff
-		if (!fakeMsg.overflowed)
+		//copy to demobuff. if it doesn't fit the whole demo message is dropped
+		//so the next frame deltas from the last one that was really written.
+		if (fakeMsg.overflowed || fakeMsg.cursize + cl.demoBuff.cursize > cl.demoBuff.maxsize)
 		{
-			if (fakeMsg.cursize + cl.demoBuff.cursize > cl.demoBuff.maxsize)
-				Com_DPrintf ("Discarded a demoframe of %d bytes.\n", fakeMsg.cursize);
-			else
-				SZ_Write (&cl.demoBuff, fakeDemoFrame, fakeMsg.cursize);
+			Com_Printf ("WARNING: Demo frame too large (%d bytes), dropped.\n", LOG_CLIENT|LOG_WARNING, fakeMsg.cursize);
+			cl.demoBuff.overflowed = true;
+		}
+		else
+		{
+			SZ_Write (&cl.demoBuff, fakeDemoFrame, fakeMsg.cursize);
 		}
 	}
 
@@ -1584,7 +1971,7 @@ CL_AddPacketEntities
 
 ===============
 */
-static void CL_AddPacketEntities (const frame_t *frame)
+void CL_AddPacketEntities (const frame_t *frame)
 {
 	entity_t				ent;
 	const entity_state_t	*s1;
@@ -25,6 +25,8 @@ cvar_t	*cl_http_downloads;
 cvar_t	*cl_http_filelists;
 cvar_t	*cl_http_proxy;
 cvar_t	*cl_http_max_connections;
+cvar_t	*cl_http_max_streams;
+cvar_t	*cl_http_multiplex;
 
 static enum
 {
@@ -38,7 +40,14 @@ static int		handleCount = 0;
 static int		pendingCount = 0;
 static int		abortDownloads = HTTPDL_ABORT_NONE;
 static qboolean	downloading_pak = false;
+static qboolean	pakReloadPending = false;
 static qboolean	httpDown = false;
+static qboolean	multiplexing = false;	//server has answered over HTTP/2
+
+//throughput summary of the current batch
+static unsigned	batchStartTime = 0;
+static int		batchFiles = 0;
+static double	batchBytes = 0;
 /*
 ===============================
 R1Q2 HTTP Downloading Functions
@@ -52,6 +61,12 @@ latency links when small files such as textures are needed.
 Since CURL natively supports gzip content encoding, any files
 on the HTTP server should ideally be gzipped to conserve
 bandwidth.
+
+If the server speaks HTTP/2 the transfers are multiplexed over a
+single connection and cl_http_max_streams controls how many we keep
+in flight. Otherwise, including every plain http:// server, each
+transfer needs its own connection so no more than
+cl_http_max_connections run at once.
 */
 
 /*
@@ -313,6 +328,21 @@ static void CL_StartHTTPDownload (dlqueue_t *entry, dlhandle_t *dl)
 	curl_easy_setopt (dl->curl, CURLOPT_REFERER, cls.downloadReferer);
 	curl_easy_setopt (dl->curl, CURLOPT_URL, dl->URL);
 
+#ifdef CURLPIPE_MULTIPLEX
+	if (cl_http_multiplex->intvalue)
+	{
+		//wait for an existing connection to see if we can multiplex on it
+		//rather than opening a new one for every file.
+		curl_easy_setopt (dl->curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+		curl_easy_setopt (dl->curl, CURLOPT_PIPEWAIT, 1);
+	}
+	else
+	{
+		curl_easy_setopt (dl->curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+		curl_easy_setopt (dl->curl, CURLOPT_PIPEWAIT, 0);
+	}
+#endif
+
 	if (curl_multi_add_handle (multi, dl->curl) != CURLM_OK)
 	{
 		Com_Printf ("curl_multi_add_handle: error\n", LOG_ERROR|LOG_CLIENT);
@@ -320,6 +350,9 @@ static void CL_StartHTTPDownload (dlqueue_t *entry, dlhandle_t *dl)
 		return;
 	}
 
+	if (!batchStartTime)
+		batchStartTime = Sys_Milliseconds ();
+
 	handleCount++;
 	//Com_Printf ("started dl: hc = %d\n", LOG_GENERAL, handleCount);
 	Com_DPrintf  ("CL_StartHTTPDownload: Fetching %s...\n", dl->URL);
@@ -339,6 +372,48 @@ void CL_InitHTTPDownloads (void)
 	//Com_Printf ("%s initialized.\n", LOG_CLIENT, curl_version());
 }
 
+/*
+===============
+CL_HTTP_MaxStreams
+
+How many transfers to keep in flight. Until the server is known to
+multiplex, each one needs a connection of its own.
+===============
+*/
+static int CL_HTTP_MaxStreams (void)
+{
+	if (multiplexing || cl_http_max_streams->intvalue < cl_http_max_connections->intvalue)
+		return cl_http_max_streams->intvalue;
+
+	return cl_http_max_connections->intvalue;
+}
+
+/*
+===============
+CL_HTTP_ApplySettings
+
+Pushes the connection cvars to the multi handle, called when one
+changes as well as for a new server.
+===============
+*/
+void CL_HTTP_ApplySettings (void)
+{
+	if (!multi)
+		return;
+
+#if LIBCURL_VERSION_NUM >= 0x071e00
+	//extra transfers queue inside curl rather than opening more connections
+	curl_multi_setopt (multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)cl_http_max_connections->intvalue);
+#endif
+
+#ifdef CURLPIPE_MULTIPLEX
+	curl_multi_setopt (multi, CURLMOPT_PIPELINING, cl_http_multiplex->intvalue ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+
+	if (!cl_http_multiplex->intvalue)
+		multiplexing = false;
+#endif
+}
+
 /*
 ===============
 CL_SetHTTPServer
@@ -373,11 +448,19 @@ void CL_SetHTTPServer (const char *URL)
 		Com_Error (ERR_DROP, "CL_SetHTTPServer: Still have old handle");
 
 	multi = curl_multi_init ();
+	multiplexing = false;
+
+	CL_HTTP_ApplySettings ();
 	
 	memset (&cls.downloadQueue, 0, sizeof(cls.downloadQueue));
 
 	abortDownloads = HTTPDL_ABORT_NONE;
 	handleCount = pendingCount = 0;
+	downloading_pak = pakReloadPending = false;
+
+	batchStartTime = 0;
+	batchFiles = 0;
+	batchBytes = 0;
 
 	strncpy (cls.downloadServer, URL, sizeof(cls.downloadServer)-1);
 }
@@ -526,7 +609,20 @@ qboolean CL_PendingHTTPDownloads (void)
 
 /*
 ===============
-CL_ParseFileList
+CL_IsPakPath
+===============
+*/
+static qboolean CL_IsPakPath (const char *path)
+{
+	size_t	len;
+
+	len = strlen (path);
+	return len > 4 && !Q_stricmp (path + len - 4, ".pak");
+}
+
+/*
+===============
+CL_CheckAndQueueDownload
 
 Validate a path supplied by a filelist.
 ===============
@@ -627,10 +723,11 @@ static void CL_CheckAndQueueDownload (char *path)
 			{
 				//paks get bumped to the top and HTTP switches to single downloading.
 				//this prevents someone on 28k dialup trying to do both the main .pak
-				//and referenced configstrings data at once.
+				//and referenced configstrings data at once. they go behind any paks
+				//already at the top so they download in the order the filelist has.
 				if (pak)
 				{
-					dlqueue_t	*q, *last;
+					dlqueue_t	*q, *last, *insert;
 
 					last = q = &cls.downloadQueue;
 
@@ -641,8 +738,13 @@ static void CL_CheckAndQueueDownload (char *path)
 					}
 
 					last->next = NULL;
-					q->next = cls.downloadQueue.next;
-					cls.downloadQueue.next = q;
+
+					insert = &cls.downloadQueue;
+					while (insert->next && CL_IsPakPath (insert->next->quakePath))
+						insert = insert->next;
+
+					q->next = insert->next;
+					insert->next = q;
 				}
 			}
 		}
@@ -721,6 +823,43 @@ static void CL_ReVerifyHTTPQueue (void)
 	}
 }
 
+/*
+===============
+CL_FinishPakDownload
+
+A pak download ended, successfully or not. The pak search path is only
+reloaded and the queue re-verified once the last queued pak is done, so
+a filelist with several paks doesn't rescan everything for each one.
+===============
+*/
+static void CL_FinishPakDownload (qboolean success)
+{
+	dlqueue_t	*q;
+
+	downloading_pak = false;
+
+	if (success)
+		pakReloadPending = true;
+
+	if (!pakReloadPending)
+		return;
+
+	q = &cls.downloadQueue;
+
+	while (q->next)
+	{
+		q = q->next;
+		if (q->state != DLQ_STATE_DONE && CL_IsPakPath (q->quakePath))
+			return;
+	}
+
+	pakReloadPending = false;
+
+	FS_FlushCache ();
+	FS_ReloadPAKs ();
+	CL_ReVerifyHTTPQueue ();
+}
+
 /*
 ===============
 CL_HTTP_Cleanup
@@ -736,7 +875,7 @@ void CL_HTTP_Cleanup (qboolean fullShutdown)
 	if (fullShutdown && httpDown)
 		return;
 
-	for (i = 0; i < 4; i++)
+	for (i = 0; i < MAX_HTTP_HANDLES; i++)
 	{
 		dl = &cls.HTTPHandles[i];
 
@@ -818,7 +957,7 @@ static void CL_FinishHTTPDownload (void)
 		curl = msg->easy_handle;
 
 		// curl doesn't provide reverse-lookup of the void * ptr, so search for it
-		for (i = 0; i < 4; i++)
+		for (i = 0; i < MAX_HTTP_HANDLES; i++)
 		{
 			if (cls.HTTPHandles[i].curl == curl)
 			{
@@ -827,7 +966,7 @@ static void CL_FinishHTTPDownload (void)
 			}
 		}
 
-		if (i == 4)
+		if (i == MAX_HTTP_HANDLES)
 			Com_Error (ERR_DROP, "CL_FinishHTTPDownload: Handle not found");
 
 		//we mark everything as done even if it errored to prevent multiple
@@ -863,11 +1002,22 @@ static void CL_FinishHTTPDownload (void)
 			case CURLE_OK:
 			
 				curl_easy_getinfo (curl, CURLINFO_RESPONSE_CODE, &responseCode);
+
+#if LIBCURL_VERSION_NUM >= 0x073200
+				//plain http:// and HTTP/1.1 servers never get here
+				if (!multiplexing && cl_http_multiplex->intvalue)
+				{
+					long	version;
+
+					if (curl_easy_getinfo (curl, CURLINFO_HTTP_VERSION, &version) == CURLE_OK && version == CURL_HTTP_VERSION_2_0)
+						multiplexing = true;
+				}
+#endif
+
 				if (responseCode == 404)
 				{
-					i = strlen (dl->queueEntry->quakePath);
-					if (!strcmp (dl->queueEntry->quakePath + i - 4, ".pak"))
-						downloading_pak = false;
+					if (CL_IsPakPath (dl->queueEntry->quakePath))
+						CL_FinishPakDownload (false);
 
 					if (isFile)
 						remove (dl->filePath);
@@ -909,9 +1059,8 @@ static void CL_FinishHTTPDownload (void)
 				CL_CancelHTTPDownloads (true);
 				continue;
 			default:
-				i = strlen (dl->queueEntry->quakePath);
-				if (!strcmp (dl->queueEntry->quakePath + i - 4, ".pak"))
-					downloading_pak = false;
+				if (CL_IsPakPath (dl->queueEntry->quakePath))
+					CL_FinishPakDownload (false);
 				if (isFile)
 					remove (dl->filePath);
 				Com_Printf ("HTTP download failed: %s\n", LOG_CLIENT|LOG_WARNING, curl_easy_strerror (result));
@@ -928,20 +1077,17 @@ static void CL_FinishHTTPDownload (void)
 				Com_Printf ("Failed to rename %s for some odd reason...", LOG_CLIENT|LOG_ERROR, dl->filePath);
 
 			//a pak file is very special...
-			i = strlen (tempName);
-			if (!strcmp (tempName + i - 4, ".pak"))
-			{
-				FS_FlushCache ();
-				FS_ReloadPAKs ();
-				CL_ReVerifyHTTPQueue ();
-				downloading_pak = false;
-			}
+			if (CL_IsPakPath (tempName))
+				CL_FinishPakDownload (true);
 		}
 
 		//show some stats
 		curl_easy_getinfo (curl, CURLINFO_TOTAL_TIME, &timeTaken);
 		curl_easy_getinfo (curl, CURLINFO_SIZE_DOWNLOAD, &fileSize);
 
+		batchFiles++;
+		batchBytes += fileSize;
+
 		//FIXME:
 		//technically i shouldn't need to do this as curl will auto reuse the
 		//existing handle when you change the URL. however, the handleCount goes
@@ -954,6 +1100,21 @@ static void CL_FinishHTTPDownload (void)
 
 	FS_FlushCache ();
 
+	if (handleCount == 0 && !pendingCount && batchStartTime)
+	{
+		double	batchTime;
+
+		batchTime = (Sys_Milliseconds () - batchStartTime) / 1000.0;
+		if (batchTime <= 0)
+			batchTime = 0.001;
+
+		Com_Printf ("HTTP: %d files, %.f bytes in %.2f sec, %.2fkB/sec\n", LOG_CLIENT, batchFiles, batchBytes, batchTime, (batchBytes / 1024.0) / batchTime);
+
+		batchStartTime = 0;
+		batchFiles = 0;
+		batchBytes = 0;
+	}
+
 	if (handleCount == 0)
 	{
 		if (abortDownloads == HTTPDL_ABORT_SOFT)
@@ -979,7 +1140,7 @@ static dlhandle_t *CL_GetFreeDLHandle (void)
 	dlhandle_t	*dl;
 	int			i;
 
-	for (i = 0; i < 4; i++)
+	for (i = 0; i < CL_HTTP_MaxStreams (); i++)
 	{
 		dl = &cls.HTTPHandles[i];
 		if (!dl->queueEntry || dl->queueEntry->state == DLQ_STATE_DONE)
@@ -991,26 +1152,23 @@ static dlhandle_t *CL_GetFreeDLHandle (void)
 
 /*
 ===============
-CL_StartNextHTTPDownload
+CL_StartNextHTTPDownloads
 
-Start another HTTP download if possible.
+Start as many queued HTTP downloads as we have free slots for.
 ===============
 */
-static void CL_StartNextHTTPDownload (void)
+static void CL_StartNextHTTPDownloads (void)
 {
 	dlqueue_t	*q;
+	dlhandle_t	*dl;
 
 	q = &cls.downloadQueue;
 
-	while (q->next)
+	while (q->next && !downloading_pak)
 	{
 		q = q->next;
 		if (q->state == DLQ_STATE_NOT_STARTED)
 		{
-			size_t		len;
-
-			dlhandle_t	*dl;
-
 			dl = CL_GetFreeDLHandle();
 
 			if (!dl)
@@ -1019,11 +1177,8 @@ static void CL_StartNextHTTPDownload (void)
 			CL_StartHTTPDownload (q, dl);
 
 			//ugly hack for pak file single downloading
-			len = strlen (q->quakePath);
-			if (len > 4 && !Q_stricmp (q->quakePath + len - 4, ".pak"))
+			if (q->state == DLQ_STATE_RUNNING && CL_IsPakPath (q->quakePath))
 				downloading_pak = true;
-
-			break;
 		}
 	}
 }
@@ -1049,8 +1204,8 @@ void CL_RunHTTPDownloads (void)
 
 	//not enough downloads running, queue some more!
 	if (pendingCount && abortDownloads == HTTPDL_ABORT_NONE &&
-		!downloading_pak && handleCount < cl_http_max_connections->intvalue)
-		CL_StartNextHTTPDownload ();
+		!downloading_pak && handleCount < CL_HTTP_MaxStreams ())
+		CL_StartNextHTTPDownloads ();
 
 	do
 	{
@@ -1073,8 +1228,8 @@ void CL_RunHTTPDownloads (void)
 
 	//not enough downloads running, queue some more!
 	if (pendingCount && abortDownloads == HTTPDL_ABORT_NONE &&
-		!downloading_pak && handleCount < cl_http_max_connections->intvalue)
-		CL_StartNextHTTPDownload ();
+		!downloading_pak && handleCount < CL_HTTP_MaxStreams ())
+		CL_StartNextHTTPDownloads ();
 }
 
 #endif
@@ -151,6 +151,7 @@ cvar_t	*cl_nolerp;
 
 cvar_t	*cl_instantack;
 cvar_t	*cl_autorecord;
+cvar_t	*cl_demoindex;
 
 cvar_t	*cl_railtrail;
 cvar_t	*cl_test = &uninitialized_cvar;
@@ -210,6 +211,126 @@ void CL_WriteDemoMessageFull (void)
 	}
 }
 
+/*
+====================
+CL_WriteDemoIndexMessage
+
+Appends buf to the current keyframe as one length prefixed message
+====================
+*/
+static int CL_WriteDemoIndexMessage (sizebuf_t *buf)
+{
+	int		len, swlen;
+
+	len = buf->cursize;
+	if (!len)
+		return 0;
+
+	swlen = LittleLong (len);
+	fwrite (&swlen, 4, 1, cls.demoindex);
+	fwrite (buf->data, len, 1, cls.demoindex);
+	SZ_Clear (buf);
+
+	return len + 4;
+}
+
+/*
+====================
+CL_WriteDemoKeyframe
+
+Adds a snapshot of the current state to the demo index if one is due.
+The frame just written to the demo is repeated uncompressed, so the
+deltas that follow it in the demo still apply after a jump here. Every
+message is kept within what a protocol 34 client can take, if the frame
+doesn't fit the next frame is tried instead.
+====================
+*/
+static void CL_WriteDemoKeyframe (void)
+{
+	ddemokeyframe_t	key;
+	sizebuf_t		buf, frame;
+	byte			buf_data[1300];
+	byte			frame_data[1300];
+	long			start;
+	int				i, length;
+
+	//serverdata and baselines aren't part of a keyframe
+	if (cl.servercount != cls.demoindex_servercount || cl_demoindex->intvalue <= 0)
+		return;
+
+	if (cls.demoindex_next == -1)
+	{
+		cls.demoindex_start = cl.frame.servertime;
+		cls.demoindex_next = cl.frame.servertime;
+	}
+	else if (cl.frame.servertime < cls.demoindex_next)
+		return;
+
+	SZ_Init (&frame, frame_data, sizeof(frame_data));
+	frame.allowoverflow = true;
+
+	CL_WriteDemoFrame (&frame, NULL, &cl.frame, -1, sizeof(cl.frame.areabits));
+
+	if (frame.overflowed)
+	{
+		Com_DPrintf ("Delayed a demo keyframe, frame too large\n");
+		return;
+	}
+
+	cls.demoindex_next = cl.frame.servertime + cl_demoindex->intvalue * 1000;
+
+	start = ftell (cls.demoindex);
+
+	key.offset = LittleLong (ftell (cls.demofile));
+	key.time = LittleLong (cl.frame.servertime - cls.demoindex_start);
+	key.length = 0;
+	fwrite (&key, sizeof(key), 1, cls.demoindex);
+
+	SZ_Init (&buf, buf_data, sizeof(buf_data));
+	length = 0;
+
+	//empty ones too so jumping back clears anything set later. precaches
+	//are the exception, they only ever get added to during a level.
+	for (i=0 ; i<MAX_CONFIGSTRINGS ; i++)
+	{
+		if (!cl.configstrings[i][0] && i >= CS_MODELS && i < CS_LIGHTS)
+			continue;
+
+		if (buf.cursize + strlen (cl.configstrings[i]) + 64 > buf.maxsize)
+			length += CL_WriteDemoIndexMessage (&buf);
+
+		MSG_BeginWriting (svc_configstring);
+		MSG_WriteShort (i);
+		MSG_WriteString (cl.configstrings[i]);
+		MSG_EndWriting (&buf);
+	}
+
+	//layout and inventory only get sent when they change
+	if (buf.cursize + strlen (cl.layout) + 64 > buf.maxsize)
+		length += CL_WriteDemoIndexMessage (&buf);
+
+	MSG_BeginWriting (svc_layout);
+	MSG_WriteString (cl.layout);
+	MSG_EndWriting (&buf);
+
+	if (buf.cursize + MAX_ITEMS * 2 + 64 > buf.maxsize)
+		length += CL_WriteDemoIndexMessage (&buf);
+
+	MSG_BeginWriting (svc_inventory);
+	for (i=0 ; i<MAX_ITEMS ; i++)
+		MSG_WriteShort (cl.inventory[i]);
+	MSG_EndWriting (&buf);
+
+	length += CL_WriteDemoIndexMessage (&buf);
+	length += CL_WriteDemoIndexMessage (&frame);
+
+	//now we know how long it was
+	key.length = LittleLong (length);
+	fseek (cls.demoindex, start, SEEK_SET);
+	fwrite (&key, sizeof(key), 1, cls.demoindex);
+	fseek (cls.demoindex, 0, SEEK_END);
+}
+
 void CL_WriteDemoMessage (byte *buff, int len, qboolean forceFlush)
 {
 	if (!cls.demorecording || cls.serverProtocol == PROTOCOL_ORIGINAL)
@@ -249,7 +370,12 @@ void CL_WriteDemoMessage (byte *buff, int len, qboolean forceFlush)
 
 			//fixme: this is ugly
 			if (noFrameFromServerPacket == 0 && !dropped_frame)
+			{
 				cl.demoLastFrame = &cl.frames[cl.frame.serverframe & UPDATE_MASK];
+
+				if (cls.demoindex)
+					CL_WriteDemoKeyframe ();
+			}
 		}
 		SZ_Clear (&cl.demoBuff);
 	}
@@ -279,6 +405,28 @@ qboolean CL_BeginRecording (char *name)
 	// don't start saving messages until a non-delta compressed message is received
 	cls.demowaiting = true;
 
+	// protocol 34 demos are the server's own deltas, a keyframe can't be spliced in
+	if (cl_demoindex->intvalue > 0 && cls.serverProtocol != PROTOCOL_ORIGINAL)
+	{
+		char		indexname[MAX_OSPATH];
+		ddemoindex_t	header;
+
+		Com_sprintf (indexname, sizeof(indexname), "%s.idx", name);
+		cls.demoindex = fopen (indexname, "wb");
+
+		if (cls.demoindex)
+		{
+			header.ident = LittleLong (IDDEMOINDEXHEADER);
+			header.version = LittleLong (DEMOINDEX_VERSION);
+			fwrite (&header, sizeof(header), 1, cls.demoindex);
+
+			cls.demoindex_servercount = cl.servercount;
+			cls.demoindex_next = -1;
+		}
+		else
+			Com_Printf ("WARNING: Couldn't open %s for writing.\n", LOG_CLIENT, indexname);
+	}
+
 	// inform server we need to receive more data
 	if (cls.serverProtocol == PROTOCOL_R1Q2)
 	{
@@ -376,6 +524,12 @@ void CL_EndRecording(void)
 	fwrite (&len, 4, 1, cls.demofile);
 	fclose (cls.demofile);
 
+	if (cls.demoindex)
+	{
+		fclose (cls.demoindex);
+		cls.demoindex = NULL;
+	}
+
 	// inform server we are done with extra data
 	if (cls.serverProtocol == PROTOCOL_R1Q2)
 	{
@@ -712,6 +866,19 @@ NORETURN void CL_Quit_f (void)
 	Com_Quit ();
 }
 
+/*
+================
+CL_Disconnected
+
+True when the client isn't using its socket, so netchan_test can
+borrow it
+================
+*/
+qboolean CL_Disconnected (void)
+{
+	return cls.state <= ca_disconnected;
+}
+
 /*
 ================
 CL_Drop
@@ -721,6 +888,13 @@ Called after an ERR_DROP was thrown
 */
 void CL_Drop (qboolean skipdisconnect, qboolean nonerror)
 {
+	//parsebench can fail before it gets as far as connecting
+	if (cls.parsebench)
+	{
+		cls.parsebench = false;
+		skipdisconnect = true;
+	}
+
 	if (cls.state == ca_uninitialized)
 		return;
 
@@ -1188,6 +1362,13 @@ void CL_Disconnect (qboolean skipdisconnect)
 {
 	byte	final[16];
 
+	//parsebench never talked to a server
+	if (cls.parsebench)
+	{
+		cls.parsebench = false;
+		skipdisconnect = true;
+	}
+
 	if (cls.state == ca_disconnected)
 		return;
 
@@ -1721,7 +1902,9 @@ safe:
 
 		Com_DPrintf ("client_connect: new\n");
 
+		Netchan_Shutdown (&cls.netchan);
 		Netchan_Setup (NS_CLIENT, &cls.netchan, &net_from, cls.serverProtocol, cls.quakePort, 0);
+		CL_ClearZFrames ();
 
 		buff = NET_AdrToString(&cls.netchan.remote_address);
 
@@ -1744,6 +1927,18 @@ safe:
 				Com_Printf ("HTTP downloading supported by server but this client was built without USE_CURL, bad luck.\n", LOG_CLIENT);
 #endif
 			}
+			else if (!strncmp (p, "rw=", 3))
+			{
+				//r1: server wants a windowed netchan
+				if (atoi (p + 3) && cls.serverProtocol == PROTOCOL_R1Q2)
+					Netchan_EnableWindow (&cls.netchan);
+			}
+			else if (!strncmp (p, "nf=", 3))
+			{
+				//r1: server can split up packets too big for one datagram
+				if (atoi (p + 3) && cls.serverProtocol == PROTOCOL_R1Q2)
+					Netchan_EnableFragments (&cls.netchan);
+			}
 #ifdef ANTICHEAT
 			else if (!strncmp (p, "ac=", 3))
 			{
@@ -3316,6 +3511,9 @@ void _async_changed (cvar_t *var, char *oldValue, char *newValue)
 	{
 		Cvar_SetValue ("r_maxfps", cl_maxfps->value);
 	}
+
+	//null usercmds are treated differently in async mode
+	CL_InvalidatePrediction ();
 }
 
 void _railtrail_changed (cvar_t *var, char *oldValue, char *newValue)
@@ -3453,11 +3651,30 @@ void _cl_http_max_connections_changed (cvar_t *c, char *old, char *new)
 	else if (c->intvalue < 1)
 		Cvar_Set (c->name, "1");
 
+#ifdef USE_CURL
+	CL_HTTP_ApplySettings ();
+#endif
+
 	//not really needed any more, hopefully no one still uses apache...
 	//if (c->intvalue > 2)
 	//	Com_Printf ("WARNING: Changing the maximum connections higher than 2 violates the HTTP specification recommendations. Doing so may result in you being blocked from the remote system and offers no performance benefits unless you are on a very high latency link (ie, satellite)\n", LOG_GENERAL);
 }
 
+#ifdef USE_CURL
+void _cl_http_max_streams_changed (cvar_t *c, char *old, char *new)
+{
+	if (c->intvalue > MAX_HTTP_HANDLES)
+		Cvar_Set (c->name, va("%d", MAX_HTTP_HANDLES));
+	else if (c->intvalue < 1)
+		Cvar_Set (c->name, "1");
+}
+
+void _cl_http_multiplex_changed (cvar_t *c, char *old, char *new)
+{
+	CL_HTTP_ApplySettings ();
+}
+#endif
+
 void _gun_changed (cvar_t *c, char *old, char *new)
 {
 	if (cls.state >= ca_connected && cls.serverProtocol == PROTOCOL_R1Q2)
@@ -3631,6 +3848,7 @@ void CL_InitLocal (void)
 	cl_nolerp = Cvar_Get ("cl_nolerp", "0", 0);
 	cl_instantack = Cvar_Get ("cl_instantack", "0", 0);
 	cl_autorecord = Cvar_Get ("cl_autorecord", "0", 0);
+	cl_demoindex = Cvar_Get ("cl_demoindex", "10", 0);
 
 	cl_railtrail = Cvar_Get ("cl_railtrail", "0", 0);
 	cl_railtrail->changed = _railtrail_changed;
@@ -3669,6 +3887,10 @@ void CL_InitLocal (void)
 	cl_http_downloads = Cvar_Get ("cl_http_downloads", "1", 0);
 	cl_http_max_connections = Cvar_Get ("cl_http_max_connections", "4", 0);
 	cl_http_max_connections->changed = _cl_http_max_connections_changed;
+	cl_http_max_streams = Cvar_Get ("cl_http_max_streams", "8", 0);
+	cl_http_max_streams->changed = _cl_http_max_streams_changed;
+	cl_http_multiplex = Cvar_Get ("cl_http_multiplex", "1", 0);
+	cl_http_multiplex->changed = _cl_http_multiplex_changed;
 #endif
 
 	cl_proxy = Cvar_Get ("cl_proxy", "", 0);
@@ -3697,6 +3919,7 @@ void CL_InitLocal (void)
 
 	Cmd_AddCommand ("followip", CL_FollowIP_f);
 	Cmd_AddCommand ("indexstats", CL_IndexStats_f);
+	Cmd_AddCommand ("predbench", CL_PredBench_f);
 
 	//r1: allow passive connects
 	Cmd_AddCommand ("passive", CL_Passive_f);
@@ -3735,6 +3958,7 @@ void CL_InitLocal (void)
 	Cmd_AddCommand ("disconnect", CL_Disconnect_f);
 	Cmd_AddCommand ("record", CL_Record_f);
 	Cmd_AddCommand ("stop", CL_Stop_f);
+	Cmd_AddCommand ("parsebench", CL_ParseBench_f);
 
 	Cmd_AddCommand ("quit", CL_Quit_f);
 
@@ -4370,6 +4594,7 @@ void CL_Init (void)
 	CDAudio_Init ();
 #endif
 	CL_InitLocal ();
+	CL_InitDeltaTables ();
 	IN_Init ();
 
 	LE_Init ();
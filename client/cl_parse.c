@@ -501,7 +501,9 @@ qboolean CL_ParseServerData (void)
 	strncpy (cl.gamedir, str, sizeof(cl.gamedir)-1);
 
 	// set gamedir, fucking christ this is messy!
-	if ((str[0] && (!fs_gamedirvar->string || !fs_gamedirvar->string[0] || strcmp(fs_gamedirvar->string, str))) ||
+	if (cls.parsebench)
+		;	//don't switch games under the user
+	else if ((str[0] && (!fs_gamedirvar->string || !fs_gamedirvar->string[0] || strcmp(fs_gamedirvar->string, str))) ||
 		(!str[0] && (fs_gamedirvar->string || fs_gamedirvar->string[0])))
 	{
 		if (strcmp(fs_gamedirvar->string, str))
@@ -581,6 +583,9 @@ qboolean CL_ParseServerData (void)
 	{	// playing a cinematic or showing a pic, not a level
 		//SCR_PlayCinematic (str);
 		// tell the server to advance to the next map / cinematic
+		if (cls.parsebench)
+			return true;
+
 		MSG_WriteByte (clc_stringcmd);
 		MSG_Print (va("nextserver %i\n", cl.servercount));
 		MSG_EndWriting (&cls.netchan.message);
@@ -615,7 +620,27 @@ void CL_ParseBaseline (void)
 	CL_ParseDelta (&null_entity_state, es, newnum, bits);
 }
 
-void CL_ParseZPacket (void)
+#ifndef NO_ZLIB
+//r1: contents of referenced zpackets by netchan sequence, the server uses
+//whichever one we last acked as the dictionary for the next frame.
+typedef struct
+{
+	int		sequence;
+	int		length;
+	byte	data[MAX_ZFRAME];
+} clzframe_t;
+
+static clzframe_t	cl_zframes[ZFRAME_BACKUP];
+#endif
+
+void CL_ClearZFrames (void)
+{
+#ifndef NO_ZLIB
+	memset (cl_zframes, 0, sizeof(cl_zframes));
+#endif
+}
+
+void CL_ParseZPacket (int extrabits)
 {
 #ifndef NO_ZLIB
 	byte buff_in[MAX_MSGLEN];
@@ -623,8 +648,16 @@ void CL_ParseZPacket (void)
 
 	sizebuf_t sb, old;
 
-	int16 compressed_len = MSG_ReadShort (&net_message);
-	int16 uncompressed_len = MSG_ReadShort (&net_message);
+	int16 compressed_len;
+	int16 uncompressed_len;
+	int	refdelta;
+
+	refdelta = 0;
+	if (extrabits & ZPACKET_REFERENCED)
+		refdelta = MSG_ReadByte (&net_message);
+
+	compressed_len = MSG_ReadShort (&net_message);
+	uncompressed_len = MSG_ReadShort (&net_message);
 	
 	if (uncompressed_len <= 0)
 		Com_Error (ERR_DROP, "CL_ParseZPacket: uncompressed_len <= 0");
@@ -635,7 +668,48 @@ void CL_ParseZPacket (void)
 	MSG_ReadData (&net_message, buff_in, compressed_len);
 
 	SZ_Init (&sb, buff_out, uncompressed_len);
-	sb.cursize = ZLibDecompress (buff_in, compressed_len, buff_out, uncompressed_len, -15);
+
+	if (extrabits & ZPACKET_REFERENCED)
+	{
+		byte		dict[MAX_ZFRAME*2];
+		const byte	*preset;
+		clzframe_t	*ref;
+		int			dictlen, presetlen, sequence;
+
+		if (uncompressed_len > MAX_ZFRAME)
+			Com_Error (ERR_DROP, "CL_ParseZPacket: referenced uncompressed_len %d > %d", uncompressed_len, MAX_ZFRAME);
+
+		dictlen = 0;
+
+		if (extrabits & ZPACKET_PRESET)
+		{
+			preset = ZLibFrameDictionary (&presetlen);
+			memcpy (dict, preset, presetlen);
+			dictlen = presetlen;
+		}
+
+		if (refdelta)
+		{
+			sequence = cls.netchan.incoming_sequence - refdelta;
+			ref = &cl_zframes[sequence & ZFRAME_MASK];
+			if (refdelta >= ZFRAME_BACKUP || !ref->length || ref->sequence != sequence)
+				Com_Error (ERR_DROP, "CL_ParseZPacket: reference frame %d is unavailable", sequence);
+
+			memcpy (dict + dictlen, ref->data, ref->length);
+			dictlen += ref->length;
+		}
+
+		sb.cursize = ZLibDecompressStream (dict, dictlen, buff_in, compressed_len, buff_out, uncompressed_len);
+
+		ref = &cl_zframes[cls.netchan.incoming_sequence & ZFRAME_MASK];
+		ref->sequence = cls.netchan.incoming_sequence;
+		ref->length = sb.cursize;
+		memcpy (ref->data, buff_out, sb.cursize);
+	}
+	else
+	{
+		sb.cursize = ZLibDecompressStream (NULL, 0, buff_in, compressed_len, buff_out, uncompressed_len);
+	}
 
 	old = net_message;
 	net_message = sb;
@@ -1190,6 +1264,9 @@ void CL_ParsePrint (void)
 	i = MSG_ReadByte (&net_message);
 	s = MSG_ReadString (&net_message);
 
+	if (cls.parsebench)
+		return;
+
 	if (i == PRINT_CHAT)
 	{
 		if (CL_IgnoreMatch (s))
@@ -1231,6 +1308,15 @@ void CL_ParsePrint (void)
 	con.ormask = 0;
 }
 
+typedef struct
+{
+	int		count;
+	int		bytes;
+	uint64	usec;
+} svcstats_t;
+
+static svcstats_t	cl_svcstats[32];
+
 /*
 =====================
 CL_ParseServerMessage
@@ -1242,6 +1328,7 @@ qboolean CL_ParseServerMessage (void)
 	char		*s;
 	int			oldReadCount;
 	qboolean	gotFrame, ret;
+	uint64		cmdstart;
 
 //
 // if recording demos, copy the message out
@@ -1253,6 +1340,7 @@ qboolean CL_ParseServerMessage (void)
 
 	serverPacketCount++;
 	gotFrame = false;
+	cmdstart = 0;
 	ret = true;
 
 //
@@ -1292,6 +1380,9 @@ qboolean CL_ParseServerMessage (void)
 			else
 				SHOWNET(svc_strings[cmd]);
 		}
+
+		if (cls.parsebench)
+			cmdstart = Sys_Microseconds ();
 	
 	// other commands
 		switch (cmd)
@@ -1358,14 +1449,17 @@ qboolean CL_ParseServerMessage (void)
 			Com_DPrintf ("stufftext: %s\n", s);
 
 			//ugly, but necessary :(
-			if (!cl.attractloop || !strcmp(s, "precache\n"))
+			if (cls.parsebench)
+				break;
+			else if (!cl.attractloop || !strcmp(s, "precache\n"))
 				Cbuf_AddText (s);
 			else
 				Com_DPrintf ("WARNING: Demo tried to execute command '%s', ignored.\n", MakePrintable(s, 0));
 			break;
 			
 		case svc_serverdata:
-			Cbuf_Execute ();		// make sure any stuffed commands are done
+			if (!cls.parsebench)
+				Cbuf_Execute ();		// make sure any stuffed commands are done
 			if (!CL_ParseServerData ())
 				return true;
 			CL_WriteDemoMessage (net_message.data + oldReadCount, net_message.readcount - oldReadCount, false);
@@ -1382,7 +1476,9 @@ qboolean CL_ParseServerMessage (void)
 			break;
 
 		case svc_centerprint:
-			SCR_CenterPrint (MSG_ReadString (&net_message));
+			s = MSG_ReadString (&net_message);
+			if (!cls.parsebench)
+				SCR_CenterPrint (s);
 			CL_WriteDemoMessage (net_message.data + oldReadCount, net_message.readcount - oldReadCount, false);
 			break;
 
@@ -1408,7 +1504,7 @@ qboolean CL_ParseServerMessage (void)
 		// ************** r1q2 specific BEGIN ****************
 		case svc_zpacket:
 			//contents of zpackets are written to demo implicity on decompress
-			CL_ParseZPacket();
+			CL_ParseZPacket(extrabits);
 			break;
 
 		case svc_zdownload:
@@ -1449,6 +1545,13 @@ qboolean CL_ParseServerMessage (void)
 			break;
 
 		}
+
+		if (cls.parsebench)
+		{
+			cl_svcstats[cmd].count++;
+			cl_svcstats[cmd].bytes += net_message.readcount - oldReadCount;
+			cl_svcstats[cmd].usec += Sys_Microseconds () - cmdstart;
+		}
 	}
 
 	if (!gotFrame)
@@ -1461,3 +1564,146 @@ qboolean CL_ParseServerMessage (void)
 
 	return ret;
 }
+
+/*
+=====================
+CL_ParseBench_f
+
+Streams a demo through the parser and the entity interpolation as fast
+as they will go, with nothing drawn, played or printed, and reports what
+each server command cost. It replaces the client state so it only runs
+while disconnected.
+=====================
+*/
+void CL_ParseBench_f (void)
+{
+	static byte		*demo;
+	char			name[MAX_QPATH];
+	const byte		*p, *end;
+	int				i, len, msglen, passes, pass;
+	int				messages, frames, bytes, lastframe;
+	uint64			start, total, lerptime, t;
+
+	if (Cmd_Argc() < 2)
+	{
+		Com_Printf ("Purpose: Measure how fast demos parse, without drawing them.\n"
+					"Syntax : parsebench <demoname.dm2> [passes]\n"
+					"Example: parsebench demo1.dm2 10\n", LOG_CLIENT);
+		return;
+	}
+
+	if (cls.state != ca_disconnected)
+	{
+		Com_Printf ("Disconnect first, parsebench needs the client state to itself.\n", LOG_CLIENT);
+		return;
+	}
+
+	//left behind if the last run hit a bad message
+	if (demo)
+	{
+		FS_FreeFile (demo);
+		demo = NULL;
+	}
+
+	Com_sprintf (name, sizeof(name), "demos/%s", Cmd_Argv(1));
+	len = FS_LoadFile (name, (void **)&demo);
+	if (!demo)
+	{
+		Com_Printf ("Couldn't open %s\n", LOG_CLIENT, name);
+		return;
+	}
+
+	passes = 1;
+	if (Cmd_Argc() > 2)
+		passes = atoi (Cmd_Argv(2));
+	if (passes < 1)
+		passes = 1;
+
+	memset (cl_svcstats, 0, sizeof(cl_svcstats));
+	messages = frames = bytes = 0;
+	lerptime = 0;
+
+	cls.parsebench = true;
+	start = Sys_Microseconds ();
+
+	for (pass = 0; pass < passes; pass++)
+	{
+		p = demo;
+		end = demo + len;
+
+		while (end - p >= 4)
+		{
+			msglen = p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+			p += 4;
+
+			if (msglen == -1)
+				break;
+
+			if (msglen < 0 || msglen > MAX_FRAGMENTED_MSGLEN - MAX_MSGLEN || msglen > end - p)
+			{
+				Com_Printf ("%s: bad message length %d at 0x%x, stopped.\n", LOG_CLIENT, name, msglen, (int)(p - demo) - 4);
+				pass = passes;
+				break;
+			}
+
+			memcpy (net_message_buffer, p, msglen);
+			net_message.cursize = msglen;
+			net_message.readcount = 0;
+			p += msglen;
+
+			lastframe = cl.frame.serverframe;
+
+			CL_ParseServerMessage ();
+
+			messages++;
+			bytes += msglen;
+
+			//half way between the last two frames, like a client running at twice the server fps
+			if (cls.state == ca_active && cl.frame.valid && cl.frame.serverframe != lastframe)
+			{
+				t = Sys_Microseconds ();
+
+				cl.time = cl.frame.servertime - 500 / cl.settings[SVSET_FPS];
+				cl.lerpfrac = cl.playerlerp = cl.modelfrac = 0.5f;
+
+				V_ClearScene ();
+				CL_AddPacketEntities (&cl.frame);
+
+				lerptime += Sys_Microseconds () - t;
+				frames++;
+			}
+		}
+	}
+
+	total = Sys_Microseconds () - start;
+
+	FS_FreeFile (demo);
+	demo = NULL;
+
+	CL_Disconnect (true);
+	V_ClearScene ();
+
+	//the demo may not have got far enough for CL_Disconnect to do anything
+	cls.parsebench = false;
+
+	if (!total)
+		total = 1;
+
+	Com_Printf ("svc                    count      bytes        ms   usec each      %%\n", LOG_CLIENT);
+	for (i = 0; i < sizeof(cl_svcstats) / sizeof(cl_svcstats[0]); i++)
+	{
+		if (!cl_svcstats[i].count)
+			continue;
+
+		Com_Printf ("%-20s %7d %10d %9.2f %11.3f %6.1f\n", LOG_CLIENT, svc_strings[i] ? svc_strings[i] : "?",
+			cl_svcstats[i].count, cl_svcstats[i].bytes, cl_svcstats[i].usec / 1000.0,
+			(double)cl_svcstats[i].usec / cl_svcstats[i].count, cl_svcstats[i].usec * 100.0 / total);
+	}
+
+	if (frames)
+		Com_Printf ("%-20s %7d %10s %9.2f %11.3f %6.1f\n", LOG_CLIENT, "(interpolation)", frames, "",
+			lerptime / 1000.0, (double)lerptime / frames, lerptime * 100.0 / total);
+
+	Com_Printf ("%d messages, %d frames, %d bytes in %.1f ms: %.0f messages/sec, %.0f frames/sec\n", LOG_CLIENT,
+		messages, frames, bytes, total / 1000.0, messages * 1000000.0 / total, frames * 1000000.0 / total);
+}
@@ -41,6 +41,10 @@ void CL_CheckPredictionError (void)
 	// save the prediction error for interpolation
 	len = abs(delta[0]) + abs(delta[1]) + abs(delta[2]);
 
+	//anything we predicted past this command was built on a wrong state
+	if (len)
+		cl.predict_valid = false;
+
 	//r1: demos replay at 10 fps, falling could trigger this which looks like shit.
 	if (len > (!cl.attractloop ? 640 : 1280))	// 80 world units
 	{
@@ -67,53 +71,45 @@ void CL_CheckPredictionError (void)
 
 /*
 ====================
-CL_ClipMoveToEntities
+Prediction broadphase
 
+CL_ClipMoveToEntities used to walk every entity in cl.frame for every trace,
+and prediction replays many traces per command. The solid entities of the
+current frame are now collected once per CL_ParseFrame along with their
+absolute bounds, so traces can reject anything their swept box can't touch
+before doing the (expensive) transformed box trace.
 ====================
 */
-void CL_ClipMoveToEntities (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, trace_t *tr )
+typedef struct
 {
-	int			i, x, zd, zu;
-	trace_t		trace;
-	int			headnode;
-	float		*angles;
 	entity_state_t	*ent;
-	int			num;
-	cmodel_t		*cmodel;
-	vec3_t		bmins, bmaxs;
+	vec3_t			bmins, bmaxs;	// encoded bbox, unused for bmodels
+	vec3_t			absmins, absmaxs;
+} predent_t;
 
-	//XXX: this breaks world clipping somehow...
-	/*
-	vec3_t		saved_mins, saved_maxs;
+static predent_t	cl_predents[MAX_EDICTS];
+static int			cl_numpredents;
 
-	VectorCopy (mins, saved_mins);
-	VectorCopy (maxs, saved_maxs);
+//set by predbench to time the old exhaustive scan
+static qboolean		cl_pred_nocull;
 
-	if (1)
-	{
-		for (i=0 ; i<cl.frame.num_entities ; i++)
-		{
-			num = (cl.frame.parse_entities + i)&(MAX_PARSE_ENTITIES-1);
-			ent = &cl_parse_entities[num];
-			
-			if (ent->number == cl.playernum+1)
-			{
-				x = 8*(ent->solid & 31);
-				zd = 8*((ent->solid>>5) & 31);
-				zu = 8*((ent->solid>>10) & 63) - 32;
+/*
+====================
+CL_BuildPredictionEnts
 
-				bmins[0] = bmins[1] = -x;
-				bmaxs[0] = bmaxs[1] = x;
-				bmins[2] = -zd;
-				bmaxs[2] = zu;
+Called after each frame is parsed.
+====================
+*/
+void CL_BuildPredictionEnts (void)
+{
+	int				i, j, x, zd, zu;
+	int				num;
+	entity_state_t	*ent;
+	cmodel_t		*cmodel;
+	predent_t		*pent;
+	float			max, v;
 
-				VectorCopy (bmins, mins);
-				VectorCopy (bmaxs, maxs);
-
-				break;
-			}
-		}
-	}*/
+	cl_numpredents = 0;
 
 	for (i=0 ; i<cl.frame.num_entities ; i++)
 	{
@@ -126,13 +122,48 @@ void CL_ClipMoveToEntities (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end,
 		if (ent->number == cl.playernum+1)
 			continue;
 
+		pent = &cl_predents[cl_numpredents++];
+		pent->ent = ent;
+
 		if (ent->solid == 31)
 		{	// special value for bmodel
 			cmodel = cl.model_clip[ent->modelindex];
 			if (!cmodel)
+			{
+				//r1: clip model isn't loaded yet, it may be by the time we trace
+				//so never cull it.
+				VectorSet (pent->absmins, -99999, -99999, -99999);
+				VectorSet (pent->absmaxs, 99999, 99999, 99999);
 				continue;
-			headnode = cmodel->headnode;
-			angles = ent->angles;
+			}
+
+			if (ent->angles[0] || ent->angles[1] || ent->angles[2])
+			{	// expand for rotation
+				max = 0;
+				for (j=0 ; j<3 ; j++)
+				{
+					v = (float)fabs (cmodel->mins[j]);
+					if (v > max)
+						max = v;
+					v = (float)fabs (cmodel->maxs[j]);
+					if (v > max)
+						max = v;
+				}
+
+				//corner of a cube, not a face
+				max *= 1.7321f;
+
+				for (j=0 ; j<3 ; j++)
+				{
+					pent->absmins[j] = ent->origin[j] - max;
+					pent->absmaxs[j] = ent->origin[j] + max;
+				}
+			}
+			else
+			{
+				VectorAdd (ent->origin, cmodel->mins, pent->absmins);
+				VectorAdd (ent->origin, cmodel->maxs, pent->absmaxs);
+			}
 		}
 		else
 		{	
@@ -150,12 +181,85 @@ void CL_ClipMoveToEntities (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end,
 				zu = 8*((ent->solid>>10) & 63) - 32;
 			}
 
-			bmins[0] = bmins[1] = -(float)x;
-			bmaxs[0] = bmaxs[1] = (float)x;
-			bmins[2] = -(float)zd;
-			bmaxs[2] = (float)zu;
+			pent->bmins[0] = pent->bmins[1] = -(float)x;
+			pent->bmaxs[0] = pent->bmaxs[1] = (float)x;
+			pent->bmins[2] = -(float)zd;
+			pent->bmaxs[2] = (float)zu;
+
+			VectorAdd (ent->origin, pent->bmins, pent->absmins);
+			VectorAdd (ent->origin, pent->bmaxs, pent->absmaxs);
+		}
+
+		// same epsilon as SV_LinkEdict, movement is clipped slightly away from edges
+		pent->absmins[0] -= 1;
+		pent->absmins[1] -= 1;
+		pent->absmins[2] -= 1;
+		pent->absmaxs[0] += 1;
+		pent->absmaxs[1] += 1;
+		pent->absmaxs[2] += 1;
+	}
+}
+
+/*
+====================
+CL_ClipMoveToEntities
 
-			headnode = CM_HeadnodeForBox (bmins, bmaxs);
+====================
+*/
+void CL_ClipMoveToEntities (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, trace_t *tr )
+{
+	int			i, j;
+	trace_t		trace;
+	int			headnode;
+	float		*angles;
+	entity_state_t	*ent;
+	cmodel_t		*cmodel;
+	predent_t		*pent;
+	vec3_t		tracemins, tracemaxs;
+
+	// box swept by the whole move
+	for (j=0 ; j<3 ; j++)
+	{
+		if (end[j] > start[j])
+		{
+			tracemins[j] = start[j] + mins[j];
+			tracemaxs[j] = end[j] + maxs[j];
+		}
+		else
+		{
+			tracemins[j] = end[j] + mins[j];
+			tracemaxs[j] = start[j] + maxs[j];
+		}
+	}
+
+	for (i=0 ; i<cl_numpredents ; i++)
+	{
+		pent = &cl_predents[i];
+
+		if (!cl_pred_nocull)
+		{
+			if (pent->absmins[0] > tracemaxs[0]
+				|| pent->absmins[1] > tracemaxs[1]
+				|| pent->absmins[2] > tracemaxs[2]
+				|| pent->absmaxs[0] < tracemins[0]
+				|| pent->absmaxs[1] < tracemins[1]
+				|| pent->absmaxs[2] < tracemins[2])
+				continue;
+		}
+
+		ent = pent->ent;
+
+		if (ent->solid == 31)
+		{	// special value for bmodel
+			cmodel = cl.model_clip[ent->modelindex];
+			if (!cmodel)
+				continue;
+			headnode = cmodel->headnode;
+			angles = ent->angles;
+		}
+		else
+		{
+			headnode = CM_HeadnodeForBox (pent->bmins, pent->bmaxs);
 			angles = vec3_origin;	// boxes don't rotate
 		}
 
@@ -181,10 +285,6 @@ void CL_ClipMoveToEntities (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end,
 		else if (trace.startsolid)
 			tr->startsolid = true;
 	}
-
-	//restore for pmove
-	/*VectorCopy (saved_mins, mins);
-	VectorCopy (saved_maxs, maxs);*/
 }
 
 
@@ -212,20 +312,25 @@ int		EXPORT CL_PMpointcontents (vec3_t point)
 {
 	int			i;
 	entity_state_t	*ent;
-	int			num;
 	cmodel_t		*cmodel;
+	predent_t		*pent;
 	int			contents;
 
 	contents = CM_PointContents (point, 0);
 
-	for (i=0 ; i<cl.frame.num_entities ; i++)
+	for (i=0 ; i<cl_numpredents ; i++)
 	{
-		num = (cl.frame.parse_entities + i)&(MAX_PARSE_ENTITIES-1);
-		ent = &cl_parse_entities[num];
+		pent = &cl_predents[i];
+		ent = pent->ent;
 
 		if (ent->solid != 31) // special value for bmodel
 			continue;
 
+		if (point[0] < pent->absmins[0] || point[0] > pent->absmaxs[0]
+			|| point[1] < pent->absmins[1] || point[1] > pent->absmaxs[1]
+			|| point[2] < pent->absmins[2] || point[2] > pent->absmaxs[2])
+			continue;
+
 		cmodel = cl.model_clip[ent->modelindex];
 		if (!cmodel)
 			continue;
@@ -236,6 +341,54 @@ int		EXPORT CL_PMpointcontents (vec3_t point)
 	return contents;
 }
 
+/*
+=================
+CL_InitPmove
+
+Copy the last server state into a pmove for replaying commands
+=================
+*/
+static void CL_InitPmove (pmove_new_t *pm)
+{
+	// copy current state to pmove
+	//memset (pm, 0, sizeof(*pm));
+	
+	/*pm->groundentity = NULL;
+	pm->numtouch = 0;
+	pm->snapinitial = false;
+	pm->touchents = NULL;
+	VectorClear (pm->viewangles);
+	pm->viewheight = 0;
+	pm->waterlevel = 0;
+	pm->watertype = 0;*/
+
+	pm->snapinitial = false;
+	pm->trace = CL_PMTrace;
+	pm->pointcontents = CL_PMpointcontents;
+	pm->s = cl.frame.playerstate.pmove;
+
+	VectorClear (pm->viewangles);
+
+	if (cl.enhancedServer)
+	{
+		//FastVectorCopy (cl.frame.playerstate.mins, pm->mins);
+		//FastVectorCopy (cl.frame.playerstate.maxs, pm->maxs);
+	}
+	else
+	{
+		VectorSet (pm->mins, -16, -16, -24);
+		VectorSet (pm->maxs,  16,  16, 32);
+	}
+
+	if (pm->s.pm_type == PM_SPECTATOR && cls.serverProtocol == PROTOCOL_R1Q2)
+		pm->multiplier = 2;
+	else
+		pm->multiplier = 1;
+
+	pm->enhanced = cl.enhancedServer;
+	pm->strafehack = cl.strafeHack;
+}
+
 /*
 =================
 CL_PredictMovement
@@ -247,6 +400,7 @@ void CL_PredictMovement (void)
 {
 	static int	last_step_frame = 0;
 	int			ack, current;
+	int			seq;
 	int			frame;
 	int			oldframe;
 	usercmd_t	*cmd;
@@ -262,6 +416,7 @@ void CL_PredictMovement (void)
 
 	if (!cl_predict->intvalue || (cl.frame.playerstate.pmove.pm_flags & PMF_NO_PREDICTION))
 	{
+		cl.predict_valid = false;
 		cl.predicted_angles[0] = cl.viewangles[0] + SHORT2ANGLE(cl.frame.playerstate.pmove.delta_angles[0]);
 		cl.predicted_angles[1] = cl.viewangles[1] + SHORT2ANGLE(cl.frame.playerstate.pmove.delta_angles[1]);
 		cl.predicted_angles[2] = cl.viewangles[2] + SHORT2ANGLE(cl.frame.playerstate.pmove.delta_angles[2]);
@@ -280,59 +435,60 @@ void CL_PredictMovement (void)
 		return;	
 	}
 
-	// copy current state to pmove
-	//memset (&pm, 0, sizeof(pm));
-	
-	/*pm.groundentity = NULL;
-	pm.numtouch = 0;
-	pm.snapinitial = false;
-	pm.touchents = NULL;
-	VectorClear (pm.viewangles);
-	pm.viewheight = 0;
-	pm.waterlevel = 0;
-	pm.watertype = 0;*/
-
-	pm.snapinitial = false;
-	pm.trace = CL_PMTrace;
-	pm.pointcontents = CL_PMpointcontents;
-	pm.s = cl.frame.playerstate.pmove;
-
-	VectorClear (pm.viewangles);
+	CL_InitPmove (&pm);
 
 //	SCR_DebugGraph (current - ack - 1, 0);
 
-	frame = 0;
-
-	if (cl.enhancedServer)
+	//r1: commands that were already sent never change, so replaying them
+	//against the same server frame always gives the same result. carry on
+	//from the last one we simulated instead of starting over every frame.
+	if (!cl.predict_valid || cl.predict_ack != ack || cl.predict_last < ack || cl.predict_last >= current)
 	{
-		//FastVectorCopy (cl.frame.playerstate.mins, pm.mins);
-		//FastVectorCopy (cl.frame.playerstate.maxs, pm.maxs);
+		cl.predict_valid = true;
+		cl.predict_ack = ack;
+		cl.predict_last = ack;
+
+		frame = ack & (CMD_BACKUP-1);
+		cl.predicted_states[frame] = pm.s;
+		VectorClear (cl.predicted_viewangles[frame]);
 	}
 	else
 	{
-		VectorSet (pm.mins, -16, -16, -24);
-		VectorSet (pm.maxs,  16,  16, 32);
+		frame = cl.predict_last & (CMD_BACKUP-1);
+		pm.s = cl.predicted_states[frame];
+		FastVectorCopy (cl.predicted_viewangles[frame], pm.viewangles);
 	}
 
-	if (pm.s.pm_type == PM_SPECTATOR && cls.serverProtocol == PROTOCOL_R1Q2)
-		pm.multiplier = 2;
-	else
-		pm.multiplier = 1;
+	// run frames
+	for (seq = cl.predict_last + 1; seq < current; seq++)
+	{
+		frame = seq & (CMD_BACKUP-1);
+		cmd = &cl.cmds[frame];
+
+		//jec - ignore 'null' usercmd entries.
+		if (cmd->msec || !cl_async->intvalue)
+		{
+			pm.cmd = *cmd;
+
+			Pmove (&pm);
+
+			// save for debug checking
+			VectorCopy (pm.s.origin, cl.predicted_origins[frame]);
+		}
 
-	pm.enhanced = cl.enhancedServer;
-	pm.strafehack = cl.strafeHack;
+		cl.predicted_states[frame] = pm.s;
+		FastVectorCopy (pm.viewangles, cl.predicted_viewangles[frame]);
+		cl.predict_last = seq;
+	}
 
 	if (cl_async->intvalue)
 	{
-		// run frames
-		while (++ack <= current) //jec - changed '<' to '<=' cause current is our pending cmd.
-		{
-			frame = ack & (CMD_BACKUP-1);
-			cmd = &cl.cmds[frame];
-
-			if (!cmd->msec)
-				continue; //jec - ignore 'null' usercmd entries.
+		//jec - current is our pending cmd, it changes every frame so it is never cached.
+		frame = current & (CMD_BACKUP-1);
+		cmd = &cl.cmds[frame];
 
+		if (cmd->msec)
+		{
 			pm.cmd = *cmd;
 
 			Pmove (&pm);
@@ -341,6 +497,8 @@ void CL_PredictMovement (void)
 			VectorCopy (pm.s.origin, cl.predicted_origins[frame]);
 		}
 
+		ack = current + 1;
+
 		switch (cl_smoothsteps->intvalue)
 		{
 			case 3:
@@ -376,19 +534,7 @@ void CL_PredictMovement (void)
 	}
 	else
 	{
-		// run frames
-		while (++ack < current)
-		{
-			frame = ack & (CMD_BACKUP-1);
-			cmd = &cl.cmds[frame];
-
-			pm.cmd = *cmd;
-
-			Pmove (&pm);
-
-			// save for debug checking
-			VectorCopy (pm.s.origin, cl.predicted_origins[frame]);
-		}
+		ack = current;
 
 		oldframe = (ack-2) & (CMD_BACKUP-1);
 		oldz = cl.predicted_origins[oldframe][2];
@@ -407,3 +553,81 @@ void CL_PredictMovement (void)
 
 	FastVectorCopy (pm.viewangles, cl.predicted_angles);
 }
+
+/*
+=================
+CL_InvalidatePrediction
+
+Forces the next CL_PredictMovement to replay everything from the last
+acknowledged server frame.
+=================
+*/
+void CL_InvalidatePrediction (void)
+{
+	cl.predict_valid = false;
+}
+
+/*
+=================
+CL_PredBench_f
+
+Replays every backed up usercmd from the last server frame, first through
+the prediction broadphase then with it disabled, and reports the cost of
+each. Results are discarded, nothing in cl is touched.
+=================
+*/
+void CL_PredBench_f (void)
+{
+	int			i, n, pass;
+	int			seq, current;
+	int			replayed;
+	unsigned	start, msec[2];
+	usercmd_t	*cmd;
+	pmove_new_t	pm;
+
+	if (cls.state != ca_active)
+	{
+		Com_Printf ("Must be connected to run a prediction benchmark.\n", LOG_CLIENT);
+		return;
+	}
+
+	n = atoi (Cmd_Argv(1));
+	if (n <= 0)
+		n = 1000;
+
+	current = cls.netchan.outgoing_sequence;
+	replayed = 0;
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		cl_pred_nocull = (pass == 1);
+		start = Sys_Milliseconds ();
+
+		for (i = 0; i < n; i++)
+		{
+			CL_InitPmove (&pm);
+
+			//replay the full backup regardless of what is acked, that's the
+			//worst case a lossy connection can hit.
+			for (seq = current - CMD_BACKUP + 1; seq <= current; seq++)
+			{
+				cmd = &cl.cmds[seq & (CMD_BACKUP-1)];
+				if (!cmd->msec)
+					continue;
+
+				pm.cmd = *cmd;
+				Pmove (&pm);
+
+				if (!pass)
+					replayed++;
+			}
+		}
+
+		msec[pass] = Sys_Milliseconds () - start;
+	}
+
+	cl_pred_nocull = false;
+
+	Com_Printf ("%d replays, %d pmoves, %d solid entities of %d in frame\n", LOG_CLIENT, n, replayed, cl_numpredents, cl.frame.num_entities);
+	Com_Printf ("broadphase: %u msec, full scan: %u msec\n", LOG_CLIENT, msec[0], msec[1]);
+}
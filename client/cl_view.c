@@ -283,6 +283,7 @@ void CL_PrepRefresh (void)
 	
 	int			i;
 	int			maxclients;
+	int			nummodels, numpics;
 
 	float		rotate;
 	vec3_t		axis;
@@ -308,6 +309,24 @@ void CL_PrepRefresh (void)
 
 	re.BeginRegistration (mapname);
 
+	//r1: let the renderer start on the images of what's registered below
+	if (R_PrefetchRegistration_fp)
+	{
+		//deferred models load a frame at a time, much later
+		nummodels = 0;
+		if (!cl_defermodels->intvalue || cl_timedemo->intvalue)
+		{
+			while (nummodels < MAX_MODELS - 2 && cl.configstrings[CS_MODELS+2+nummodels][0])
+				nummodels++;
+		}
+
+		numpics = 0;
+		while (numpics < MAX_IMAGES - 1 && cl.configstrings[CS_IMAGES+1+numpics][0])
+			numpics++;
+
+		R_PrefetchRegistration_fp ((const char (*)[MAX_QPATH])(cl.configstrings + CS_MODELS + 2), nummodels, (const char (*)[MAX_QPATH])(cl.configstrings + CS_IMAGES + 1), numpics);
+	}
+
 	Com_Printf ("                                     \r", LOG_CLIENT);
 
 	Sys_SendKeyEvents ();
@@ -769,7 +788,7 @@ void V_RenderView(void)
 				re.DrawChar (1+(x*8), 266, 128 + frameMsg[x] );
 		}
 		
-		if (cl.parse_entities - old->parse_entities > MAX_PARSE_ENTITIES-128)
+		if (cl.parse_entities - old->parse_entities > MAX_PARSE_ENTITIES-MAX_EDICTS)
 		{
 			int x;
 			for (x=0 ; x<sizeof(parseMsg)-1; x++)
@@ -148,6 +148,7 @@ void CL_RunHTTPDownloads (void);
 qboolean CL_PendingHTTPDownloads (void);
 void CL_SetHTTPServer (const char *URL);
 void CL_HTTP_Cleanup (qboolean fullShutdown);
+void CL_HTTP_ApplySettings (void);
 
 typedef enum
 {
@@ -163,6 +164,9 @@ typedef struct dlqueue_s
 	dlq_state			state;
 } dlqueue_t;
 
+//maximum transfers in flight, see cl_http_max_streams
+#define	MAX_HTTP_HANDLES	16
+
 typedef struct dlhandle_s
 {
 	CURL		*curl;
@@ -206,6 +210,13 @@ typedef struct client_state_s
 	int			cmd_time[CMD_BACKUP];	// time sent, for calculating pings
 	int16		predicted_origins[CMD_BACKUP][3];	// for debug comparing against server
 
+	//r1: results of each replayed usercmd so sent cmds aren't simulated again
+	pmove_state_t	predicted_states[CMD_BACKUP];
+	vec3_t		predicted_viewangles[CMD_BACKUP];
+	qboolean	predict_valid;
+	int			predict_ack;		// incoming_acknowledged the states were built from
+	int			predict_last;		// last sequence in predicted_states
+
 	float		predicted_step;				// for stair up smoothing
 	unsigned	predicted_step_time;
 
@@ -279,7 +290,7 @@ typedef struct client_state_s
 	//r1: defer rendering when realtime < this
 	uint32			defer_rendering;
 
-	byte			demoFrame[1400];
+	byte			demoFrame[MAX_FRAGMENTED_MSGLEN - MAX_MSGLEN];	// what demo playback accepts
 	sizebuf_t		demoBuff;
 	frame_t			*demoLastFrame;
 
@@ -374,21 +385,28 @@ typedef struct client_static_s
 	qboolean	demorecording;
 	qboolean	demowaiting;	// don't record until a non-delta message is received
 	qboolean	passivemode;
+	qboolean	parsebench;		// CL_ParseBench_f is feeding the parser, keep quiet
 	FILE		*demofile;
 
+	FILE		*demoindex;				// keyframes for seeking, see qfiles.h
+	int			demoindex_servercount;	// keyframes stop at the first level change
+	int			demoindex_start;		// servertime of the first recorded frame
+	int			demoindex_next;			// servertime the next keyframe is due, -1 before the first
+
 	int			protocolVersion;	// R1Q2 protocol version
 
 #ifdef USE_CURL
 	dlqueue_t		downloadQueue;			//queue of paths we need
 	
-	dlhandle_t		HTTPHandles[4];			//actual download handles
-	//don't raise this!
-	//i use a hardcoded maximum of 4 simultaneous connections to avoid
-	//overloading the server. i'm all too familiar with assholes who set
-	//their IE or Firefox max connections to 16 and rape my Apache processes
-	//every time they load a page... i'd rather not have my q2 client also
-	//have the ability to do so - especially since we're possibly downloading
-	//large files.
+	dlhandle_t		HTTPHandles[MAX_HTTP_HANDLES];	//actual download handles
+	//these are transfers, not connections. curl multiplexes them over
+	//at most cl_http_max_connections connections to the server (HTTP/2)
+	//or queues them until one is free (HTTP/1.1), so a server never sees
+	//more connections from us than before. i'm all too familiar with
+	//assholes who set their IE or Firefox max connections to 16 and rape
+	//my Apache processes every time they load a page... i'd rather not
+	//have my q2 client also have the ability to do so - especially since
+	//we're possibly downloading large files.
 
 	char			downloadServer[512];	//base url prefix to download from
 	char			downloadReferer[32];	//libcurl requires a static string :(
@@ -487,6 +505,8 @@ extern	cvar_t	*cl_http_downloads;
 extern	cvar_t	*cl_http_filelists;
 extern	cvar_t	*cl_http_proxy;
 extern	cvar_t	*cl_http_max_connections;
+extern	cvar_t	*cl_http_max_streams;
+extern	cvar_t	*cl_http_multiplex;
 #endif
 
 extern	cvar_t	*cl_original_dlights;
@@ -523,7 +543,8 @@ extern	cdlight_t	cl_dlights[MAX_DLIGHTS];
 // the cl_parse_entities must be large enough to hold UPDATE_BACKUP frames of
 // entities, so that when a delta compressed message arives from the server
 // it can be un-deltad from the original 
-#define	MAX_PARSE_ENTITIES	1024
+//r1: room for several frames worth even when a fragmenting server sends every entity
+#define	MAX_PARSE_ENTITIES	4096
 extern	entity_state_t	cl_parse_entities[MAX_PARSE_ENTITIES];
 
 //=============================================================================
@@ -641,9 +662,11 @@ void CL_WidowSplash (vec3_t org);
 localent_t *Le_Alloc (void);
 void Le_Free (localent_t *lent);
 
+void CL_InitDeltaTables (void);
 int CL_ParseEntityBits (uint32 *bits);
 void CL_ParseDelta (const entity_state_t *from, entity_state_t *to, int number, int bits);
 void CL_ParseFrame (int extrabits);
+void CL_WriteDemoFrame (sizebuf_t *msg, const frame_t *from, frame_t *to, int deltaframe, int areabytes);
 
 void CL_ParseTEnt (void);
 void CL_ParseConfigString (void);
@@ -658,6 +681,7 @@ void CL_RunDLights (void);
 void CL_RunLightStyles (void);
 
 void CL_AddEntities (void);
+void CL_AddPacketEntities (const frame_t *frame);
 void CL_AddDLights (void);
 void CL_AddTEnts (void);
 void CL_AddLightStyles (void);
@@ -680,6 +704,7 @@ void VID_ReloadRefresh (void);
 // cl_main
 //
 extern	refexport_t	re;		// interface to refresh .dll
+extern	PrefetchRegistration_t	R_PrefetchRegistration_fp;	// NULL if the refresh .dll lacks it
 
 void CL_Init (void);
 
@@ -743,12 +768,14 @@ extern	int	serverPacketCount;
 extern	int noFrameFromServerPacket;
 
 qboolean CL_ParseServerMessage (void);
+void CL_ParseBench_f (void);
 void CL_LoadClientinfo (clientinfo_t *ci, char *s);
 void SHOWNET(const char *s);
 void CL_ParseClientinfo (int player);
 void CL_Download_f (void);
 void CL_Passive_f (void);
 void CL_ParsePlayerUpdate (void);
+void CL_ClearZFrames (void);
 //
 // cl_view.c
 //
@@ -756,6 +783,7 @@ extern	int			gun_frame;
 extern	struct model_s	*gun_model;
 
 void V_Init (void);
+void V_ClearScene (void);
 #ifdef CL_STEREO_SUPPORT
 void V_RenderView( float stereo_separation );
 #else
@@ -820,6 +848,9 @@ void IN_Restart_f (void);
 // cl_pred.c
 //
 void CL_PredictMovement (void);
+void CL_BuildPredictionEnts (void);
+void CL_InvalidatePrediction (void);
+void CL_PredBench_f (void);
 
 void CL_FixCvarCheats (void);
 
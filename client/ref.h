@@ -22,7 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "../qcommon/qcommon.h"
 
-#define	EXTENDED_API_VERSION	2
+#define	EXTENDED_API_VERSION	3
 
 #define	MAX_DLIGHTS		32
 #define	MAX_ENTITIES	128
@@ -201,6 +201,7 @@ typedef struct
 	int			(IMPORT *FS_FOpenFile) (const char *filename, FILE **file, handlestyle_t openHandle, qboolean *closeHandle);
 	void		(IMPORT *FS_FCloseFile) (FILE *file);
 	void		(IMPORT *FS_Read) (void *buffer, int len, FILE *f);
+	int			(IMPORT *FS_ImageExtensions) (const char *basename);
 } refimportnew_t;
 
 typedef struct
@@ -240,4 +241,9 @@ typedef struct
 typedef	refexport_t	(EXPORT *GetRefAPI_t) (refimport_t);
 typedef	void (EXPORT *GetExtraAPI_t) (refimportnew_t);
 
+// optional, found by name like GetExtraAPI. called after BeginRegistration
+// with the models and pics about to be registered so the renderer can
+// start loading their images in the background.
+typedef	void (EXPORT *PrefetchRegistration_t) (const char (*models)[MAX_QPATH], int nummodels, const char (*pics)[MAX_QPATH], int numpics);
+
 #endif // __REF_H
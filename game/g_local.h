@@ -554,6 +554,9 @@ extern	cvar_t	*flood_waitdelay;
 
 extern	cvar_t	*sv_maplist;
 
+extern	cvar_t	*g_saveformat;
+extern	cvar_t	*g_savecompress;
+
 #define world	(&g_edicts[0])
 
 // item spawnflags
@@ -765,6 +768,11 @@ void ClientBeginServerFrame (edict_t *ent);
 void player_pain (edict_t *self, edict_t *other, float kick, int damage);
 void player_die (edict_t *self, edict_t *inflictor, edict_t *attacker, int damage, vec3_t point);
 
+//
+// g_save.c
+//
+void SaveBench (const char *filename, int count);
+
 //
 // g_svcmds.c
 //
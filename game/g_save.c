@@ -202,6 +202,10 @@ void InitGame (void)
 	// dm map list
 	sv_maplist = gi.cvar ("sv_maplist", "", 0);
 
+	// savegames
+	g_saveformat = gi.cvar ("g_saveformat", "1", 0);
+	g_savecompress = gi.cvar ("g_savecompress", "0", 0);
+
 	// items
 	InitItems ();
 
@@ -391,6 +395,450 @@ void ReadField (FILE *f, field_t *field, byte *base)
 	}
 }
 
+/*
+==============================================================================
+
+BUFFERED SAVE FORMAT
+
+The original format does a pile of small fwrites / freads per edict. This
+one serializes everything into a single memory buffer which is written with
+one fwrite (and read back with one fread). Strings are pooled into a table
+after the data so the same classname / target / etc is only stored once,
+and the whole lot can be zlib compressed with g_savecompress.
+
+The struct blocks are identical to the original format apart from string
+fields, which hold a string table index (0 for NULL) instead of a length.
+==============================================================================
+*/
+
+#define	SAVE_MAGIC			(('V'<<24)+('S'<<16)+('1'<<8)+'R')	// "R1SV"
+#define	SAVE_VERSION		1
+
+#define	SAVE_COMPRESSED		1
+
+#define	SAVE_STRING_HASH	256
+
+typedef struct
+{
+	int		magic;
+	int		version;
+	int		flags;
+	int		numstrings;
+	int		stringsize;		// bytes of string table at the end of the payload
+	int		rawsize;		// data + string table, uncompressed
+	int		packedsize;		// bytes of payload following the header
+} saveheader_t;
+
+typedef struct
+{
+	byte	*data;
+	int		cursize;
+	int		maxsize;
+} savebuf_t;
+
+typedef struct
+{
+	savebuf_t	data;
+	savebuf_t	strings;
+
+	int			numstrings;
+	int			maxstrings;
+	int			*stringofs;
+	int			*stringnext;
+	int			stringhash[SAVE_STRING_HASH];
+} savewriter_t;
+
+typedef struct
+{
+	byte		*buffer;
+	byte		*data;
+	int			readcount;
+	int			cursize;
+
+	char		**strings;
+	int			numstrings;
+} savereader_t;
+
+static void *SB_GetSpace (savebuf_t *buf, int length)
+{
+	void	*data;
+
+	if (buf->cursize + length > buf->maxsize)
+	{
+		while (buf->cursize + length > buf->maxsize)
+			buf->maxsize = buf->maxsize ? buf->maxsize * 2 : 65536;
+
+		buf->data = realloc (buf->data, buf->maxsize);
+		if (!buf->data)
+			gi.error ("SB_GetSpace: couldn't allocate %d bytes", buf->maxsize);
+	}
+
+	data = buf->data + buf->cursize;
+	buf->cursize += length;
+
+	return data;
+}
+
+static void SB_Write (savebuf_t *buf, const void *data, int length)
+{
+	memcpy (SB_GetSpace (buf, length), data, length);
+}
+
+/*
+==============
+SW_Init
+
+sizehint is a guess at the size of the data so we don't keep reallocating.
+==============
+*/
+static void SW_Init (savewriter_t *w, int sizehint)
+{
+	memset (w, 0, sizeof(*w));
+	memset (w->stringhash, -1, sizeof(w->stringhash));
+
+	w->data.maxsize = sizeof(saveheader_t) + sizehint;
+	w->data.data = malloc (w->data.maxsize);
+	if (!w->data.data)
+		gi.error ("SW_Init: couldn't allocate %d bytes", w->data.maxsize);
+
+	// the header goes in front of the data once we know what's in it
+	SB_GetSpace (&w->data, sizeof(saveheader_t));
+}
+
+static void SW_Free (savewriter_t *w)
+{
+	free (w->data.data);
+	free (w->strings.data);
+	free (w->stringofs);
+	free (w->stringnext);
+}
+
+/*
+==============
+SW_AddString
+
+Returns the 1 based string table index of str, adding it if needed.
+==============
+*/
+static int SW_AddString (savewriter_t *w, const char *str)
+{
+	unsigned	hash;
+	const char	*p;
+	int			i;
+	int			len;
+
+	hash = 0;
+	for (p = str; *p; p++)
+		hash = hash * 31 + *p;
+	hash &= SAVE_STRING_HASH-1;
+
+	for (i = w->stringhash[hash]; i != -1; i = w->stringnext[i])
+	{
+		if (!strcmp ((char *)w->strings.data + w->stringofs[i], str))
+			return i + 1;
+	}
+
+	if (w->numstrings == w->maxstrings)
+	{
+		w->maxstrings = w->maxstrings ? w->maxstrings * 2 : 256;
+		w->stringofs = realloc (w->stringofs, w->maxstrings * sizeof(int));
+		w->stringnext = realloc (w->stringnext, w->maxstrings * sizeof(int));
+		if (!w->stringofs || !w->stringnext)
+			gi.error ("SW_AddString: out of memory");
+	}
+
+	len = (int)(p - str) + 1;
+
+	i = w->numstrings++;
+	w->stringofs[i] = w->strings.cursize;
+	w->stringnext[i] = w->stringhash[hash];
+	w->stringhash[hash] = i;
+
+	SB_Write (&w->strings, str, len);
+
+	return i + 1;
+}
+
+/*
+==============
+SW_WriteBlock
+
+Copies a struct into the buffer and converts the pointers in place.
+==============
+*/
+static void SW_WriteBlock (savewriter_t *w, field_t *fields, const void *base, int size)
+{
+	field_t		*field;
+	byte		*block;
+	char		*str;
+
+	block = SB_GetSpace (&w->data, size);
+	memcpy (block, base, size);
+
+	for (field = fields; field->name; field++)
+	{
+		if (field->flags & FFL_SPAWNTEMP)
+			continue;
+
+		if (field->type == F_LSTRING)
+		{
+			str = *(char **)(block + field->ofs);
+			*(int *)(block + field->ofs) = str ? SW_AddString (w, str) : 0;
+		}
+		else
+			WriteField1 (NULL, field, block);
+	}
+}
+
+/*
+==============
+SW_Finish
+
+Appends the string table, fills in the header and writes it all out.
+compress is a zlib level, 0 to store uncompressed.
+==============
+*/
+static void SW_Finish (savewriter_t *w, const char *filename, int compress)
+{
+	FILE			*f;
+	saveheader_t	*header;
+	byte			*out;
+	int				outsize;
+
+	SB_Write (&w->data, w->strings.data, w->strings.cursize);
+
+	header = (saveheader_t *)w->data.data;
+	header->magic = SAVE_MAGIC;
+	header->version = SAVE_VERSION;
+	header->flags = 0;
+	header->numstrings = w->numstrings;
+	header->stringsize = w->strings.cursize;
+	header->rawsize = w->data.cursize - sizeof(*header);
+	header->packedsize = header->rawsize;
+
+	out = w->data.data;
+	outsize = w->data.cursize;
+
+#ifndef NO_ZLIB
+	if (compress > 0)
+	{
+		uLongf	packed;
+
+		if (compress > 9)
+			compress = 9;
+
+		packed = compressBound (header->rawsize);
+		out = malloc (sizeof(*header) + packed);
+		if (!out)
+			gi.error ("SW_Finish: couldn't allocate %d bytes", (int)(sizeof(*header) + packed));
+
+		if (compress2 (out + sizeof(*header), &packed, w->data.data + sizeof(*header), header->rawsize, compress) != Z_OK)
+		{
+			free (out);
+			SW_Free (w);
+			gi.error ("SW_Finish: compression failed");
+		}
+
+		header->flags |= SAVE_COMPRESSED;
+		header->packedsize = (int)packed;
+		memcpy (out, header, sizeof(*header));
+		outsize = sizeof(*header) + (int)packed;
+	}
+#endif
+
+	f = fopen (filename, "wb");
+	if (!f || fwrite (out, outsize, 1, f) != 1)
+	{
+		if (f)
+			fclose (f);
+		if (out != w->data.data)
+			free (out);
+		SW_Free (w);
+		gi.error ("Couldn't write %s", filename);
+	}
+
+	fclose (f);
+
+	if (out != w->data.data)
+		free (out);
+	SW_Free (w);
+}
+
+static void SR_Free (savereader_t *r)
+{
+	free (r->buffer);
+	free (r->strings);
+	memset (r, 0, sizeof(*r));
+}
+
+/*
+==============
+SR_Load
+
+Reads a whole save into memory. Returns false if the file isn't in the
+buffered format, in which case the caller should use the original reader.
+==============
+*/
+static qboolean SR_Load (savereader_t *r, const char *filename)
+{
+	FILE			*f;
+	saveheader_t	header;
+	byte			*packed;
+	char			*p, *end;
+	int				i;
+
+	memset (r, 0, sizeof(*r));
+
+	f = fopen (filename, "rb");
+	if (!f)
+		gi.error ("Couldn't open %s", filename);
+
+	if (fread (&header, sizeof(header), 1, f) != 1 || header.magic != SAVE_MAGIC)
+	{
+		fclose (f);
+		return false;
+	}
+
+	if (header.version != SAVE_VERSION)
+	{
+		fclose (f);
+		gi.error ("%s: unsupported savegame version %d", filename, header.version);
+	}
+
+	if (header.rawsize < header.stringsize || header.stringsize < 0 || header.packedsize < 0 || header.numstrings < 0)
+	{
+		fclose (f);
+		gi.error ("%s: corrupt savegame header", filename);
+	}
+
+	packed = malloc (header.packedsize);
+	if (!packed || fread (packed, header.packedsize, 1, f) != 1)
+	{
+		free (packed);
+		fclose (f);
+		gi.error ("%s: failed to read savegame", filename);
+	}
+
+	fclose (f);
+
+	if (header.flags & SAVE_COMPRESSED)
+	{
+#ifndef NO_ZLIB
+		uLongf	rawsize;
+
+		rawsize = header.rawsize;
+		r->buffer = malloc (header.rawsize);
+
+		if (!r->buffer || uncompress (r->buffer, &rawsize, packed, header.packedsize) != Z_OK || rawsize != header.rawsize)
+		{
+			free (packed);
+			SR_Free (r);
+			gi.error ("%s: failed to decompress savegame", filename);
+		}
+
+		free (packed);
+#else
+		free (packed);
+		gi.error ("%s: compressed savegames are not supported", filename);
+#endif
+	}
+	else
+	{
+		if (header.packedsize != header.rawsize)
+		{
+			free (packed);
+			gi.error ("%s: corrupt savegame header", filename);
+		}
+		r->buffer = packed;
+	}
+
+	r->data = r->buffer;
+	r->cursize = header.rawsize - header.stringsize;
+	r->readcount = 0;
+
+	// index the string table
+	r->numstrings = header.numstrings;
+	r->strings = malloc ((header.numstrings + 1) * sizeof(char *));
+	if (!r->strings)
+		gi.error ("SR_Load: out of memory");
+
+	p = (char *)r->buffer + r->cursize;
+	end = p + header.stringsize;
+
+	for (i = 0; i < header.numstrings; i++)
+	{
+		r->strings[i] = p;
+		while (p < end && *p)
+			p++;
+		if (p == end)
+		{
+			SR_Free (r);
+			gi.error ("%s: corrupt savegame string table", filename);
+		}
+		p++;
+	}
+
+	return true;
+}
+
+static void SR_Read (savereader_t *r, void *data, int length)
+{
+	if (r->readcount + length > r->cursize)
+	{
+		SR_Free (r);
+		gi.error ("SR_Read: savegame is truncated");
+	}
+
+	memcpy (data, r->data + r->readcount, length);
+	r->readcount += length;
+}
+
+/*
+==============
+SR_ReadBlock
+
+All pointer variables (except function pointers) must be handled specially.
+==============
+*/
+static void SR_ReadBlock (savereader_t *r, field_t *fields, void *base, int size, int tag)
+{
+	field_t		*field;
+	int			index;
+	size_t		len;
+	char		**p;
+
+	SR_Read (r, base, size);
+
+	for (field = fields; field->name; field++)
+	{
+		if (field->flags & FFL_SPAWNTEMP)
+			continue;
+
+		if (field->type == F_LSTRING)
+		{
+			p = (char **)((byte *)base + field->ofs);
+			index = *(int *)p;
+
+			if (!index)
+				*p = NULL;
+			else
+			{
+				if (index < 0 || index > r->numstrings)
+				{
+					SR_Free (r);
+					gi.error ("SR_ReadBlock: bad string index %d", index);
+				}
+
+				len = strlen (r->strings[index-1]) + 1;
+				*p = gi.TagMalloc ((int)len, tag);
+				memcpy (*p, r->strings[index-1], len);
+			}
+		}
+		else
+			ReadField (NULL, field, (byte *)base);
+	}
+}
+
 //=========================================================
 
 /*
@@ -466,6 +914,27 @@ void WriteGame (const char *filename, qboolean autosave)
 	if (!autosave)
 		SaveClientData ();
 
+	if (g_saveformat->value)
+	{
+		savewriter_t	w;
+
+		SW_Init (&w, sizeof(str) + sizeof(game) + game.maxclients * sizeof(game.clients[0]));
+
+		memset (str, 0, sizeof(str));
+		strcpy (str, __DATE__);
+		SB_Write (&w.data, str, sizeof(str));
+
+		game.autosaved = autosave;
+		SB_Write (&w.data, &game, sizeof(game));
+		game.autosaved = false;
+
+		for (i=0 ; i<game.maxclients ; i++)
+			SW_WriteBlock (&w, clientfields, &game.clients[i], sizeof(game.clients[0]));
+
+		SW_Finish (&w, filename, (int)g_savecompress->value);
+		return;
+	}
+
 	f = fopen (filename, "wb");
 	if (!f)
 		gi.error ("Couldn't open %s", filename);
@@ -486,12 +955,34 @@ void WriteGame (const char *filename, qboolean autosave)
 
 void ReadGame (const char *filename)
 {
-	FILE	*f;
-	int		i;
-	char	str[16];
+	FILE			*f;
+	int				i;
+	char			str[16];
+	savereader_t	r;
 
 	gi.FreeTags (TAG_GAME);
 
+	if (SR_Load (&r, filename))
+	{
+		SR_Read (&r, str, sizeof(str));
+		if (strcmp (str, __DATE__))
+		{
+			SR_Free (&r);
+			gi.error ("Savegame from an older version.\n");
+		}
+
+		g_edicts =  gi.TagMalloc (game.maxentities * sizeof(g_edicts[0]), TAG_GAME);
+		globals.edicts = g_edicts;
+
+		SR_Read (&r, &game, sizeof(game));
+		game.clients = gi.TagMalloc (game.maxclients * sizeof(game.clients[0]), TAG_GAME);
+		for (i=0 ; i<game.maxclients ; i++)
+			SR_ReadBlock (&r, clientfields, &game.clients[i], sizeof(game.clients[0]), TAG_LEVEL);
+
+		SR_Free (&r);
+		return;
+	}
+
 	f = fopen (filename, "rb");
 	if (!f)
 		gi.error ("Couldn't open %s", filename);
@@ -621,11 +1112,54 @@ void ReadLevelLocals (FILE *f)
 
 /*
 =================
-WriteLevel
+WriteLevelBuffered
 
+Same layout as WriteLevel, but through a savewriter_t.
 =================
 */
-void WriteLevel (const char *filename)
+static void WriteLevelBuffered (const char *filename, int compress)
+{
+	int				i;
+	edict_t			*ent;
+	void			*base;
+	savewriter_t	w;
+
+	SW_Init (&w, sizeof(level) + globals.num_edicts * (sizeof(edict_t) + sizeof(int)) + 64);
+
+	// write out edict size for checking
+	i = sizeof(edict_t);
+	SB_Write (&w.data, &i, sizeof(i));
+
+	// write out a function pointer for checking
+	base = (void *)InitGame;
+	SB_Write (&w.data, &base, sizeof(base));
+
+	// write out level_locals_t
+	SW_WriteBlock (&w, levelfields, &level, sizeof(level));
+
+	// write out all the entities
+	for (i=0 ; i<globals.num_edicts ; i++)
+	{
+		ent = &g_edicts[i];
+		if (!ent->inuse)
+			continue;
+		SB_Write (&w.data, &i, sizeof(i));
+		SW_WriteBlock (&w, fields, ent, sizeof(*ent));
+	}
+	i = -1;
+	SB_Write (&w.data, &i, sizeof(i));
+
+	SW_Finish (&w, filename, compress);
+}
+
+/*
+=================
+WriteLevelFile
+
+Original format, written a field at a time.
+=================
+*/
+static void WriteLevelFile (const char *filename)
 {
 	int		i;
 	edict_t	*ent;
@@ -662,24 +1196,94 @@ void WriteLevel (const char *filename)
 	fclose (f);
 }
 
+/*
+=================
+WriteLevel
+
+=================
+*/
+void WriteLevel (const char *filename)
+{
+	if (g_saveformat->value)
+		WriteLevelBuffered (filename, (int)g_savecompress->value);
+	else
+		WriteLevelFile (filename);
+}
+
 
 /*
 =================
-ReadLevel
+ReadLevelBuffered
 
-SpawnEntities will allready have been called on the
-level the same way it was when the level was saved.
+Buffered format, see SR_Load.
+=================
+*/
+static void ReadLevelBuffered (savereader_t *r)
+{
+	int		entnum;
+	int		i;
+	void	*base;
+	edict_t	*ent;
 
-That is necessary to get the baselines
-set up identically.
+	// check edict size
+	SR_Read (r, &i, sizeof(i));
+	if (i != sizeof(edict_t))
+	{
+		SR_Free (r);
+		gi.error ("ReadLevel: mismatched edict size");
+	}
 
-The server will have cleared all of the world links before
-calling ReadLevel.
+	// check function pointer base address
+	SR_Read (r, &base, sizeof(base));
+#ifdef _WIN32
+	if (base != (void *)InitGame)
+	{
+		SR_Free (r);
+		gi.error ("ReadLevel: function pointers have moved");
+	}
+#else
+	gi.dprintf("Function offsets %td\n", ((byte *)base) - ((byte *)InitGame));
+#endif
 
-No clients are connected yet.
+	// load the level locals
+	SR_ReadBlock (r, levelfields, &level, sizeof(level), TAG_LEVEL);
+
+	// load all the entities
+	for (;;)
+	{
+		SR_Read (r, &entnum, sizeof(entnum));
+
+		if (entnum == -1)
+			break;
+
+		if (entnum < 0 || entnum >= game.maxentities)
+		{
+			SR_Free (r);
+			gi.error ("ReadLevel: bad entnum %d", entnum);
+		}
+
+		if (entnum >= globals.num_edicts)
+			globals.num_edicts = entnum+1;
+
+		ent = &g_edicts[entnum];
+		SR_ReadBlock (r, fields, ent, sizeof(*ent), TAG_LEVEL);
+
+		// let the server rebuild world links for this ent
+		memset (&ent->area, 0, sizeof(ent->area));
+		gi.linkentity (ent);
+	}
+
+	SR_Free (r);
+}
+
+/*
+=================
+ReadLevelFile
+
+Original format, read a field at a time.
 =================
 */
-void ReadLevel (const char *filename)
+static void ReadLevelFile (const char *filename)
 {
 	int		entnum;
 	FILE	*f;
@@ -691,14 +1295,6 @@ void ReadLevel (const char *filename)
 	if (!f)
 		gi.error ("Couldn't open %s", filename);
 
-	// free any dynamic memory allocated by loading the level
-	// base state
-	gi.FreeTags (TAG_LEVEL);
-
-	// wipe all the entities
-	memset (g_edicts, 0, game.maxentities*sizeof(g_edicts[0]));
-	globals.num_edicts = maxclients->value+1;
-
 	// check edict size
 	fread (&i, sizeof(i), 1, f);
 	if (i != sizeof(edict_t))
@@ -744,6 +1340,45 @@ void ReadLevel (const char *filename)
 	}
 
 	fclose (f);
+}
+
+/*
+=================
+ReadLevel
+
+SpawnEntities will allready have been called on the
+level the same way it was when the level was saved.
+
+That is necessary to get the baselines
+set up identically.
+
+The server will have cleared all of the world links before
+calling ReadLevel.
+
+No clients are connected yet.
+=================
+*/
+void ReadLevel (const char *filename)
+{
+	int				i;
+	edict_t			*ent;
+	savereader_t	r;
+	qboolean		buffered;
+
+	buffered = SR_Load (&r, filename);
+
+	// free any dynamic memory allocated by loading the level
+	// base state
+	gi.FreeTags (TAG_LEVEL);
+
+	// wipe all the entities
+	memset (g_edicts, 0, game.maxentities*sizeof(g_edicts[0]));
+	globals.num_edicts = maxclients->value+1;
+
+	if (buffered)
+		ReadLevelBuffered (&r);
+	else
+		ReadLevelFile (filename);
 
 	// mark all clients as unconnected
 	for (i=0 ; i<maxclients->value ; i++)
@@ -767,3 +1402,143 @@ void ReadLevel (const char *filename)
 				ent->nextthink = level.time + ent->delay;
 	}
 }
+
+//==========================================================
+
+/*
+=================
+FreeBlockStrings
+
+Frees the strings a read allocated for a scratch struct.
+=================
+*/
+static void FreeBlockStrings (field_t *fields, byte *base)
+{
+	field_t		*field;
+	char		**p;
+
+	for (field = fields; field->name; field++)
+	{
+		if (field->flags & FFL_SPAWNTEMP || field->type != F_LSTRING)
+			continue;
+
+		p = (char **)(base + field->ofs);
+		if (*p)
+			gi.TagFree (*p);
+	}
+}
+
+/*
+=================
+SaveBenchRead
+
+Reads a level save into scratch structs and throws it away, the running
+level is not touched.
+=================
+*/
+static void SaveBenchRead (const char *filename)
+{
+	FILE			*f;
+	int				i;
+	void			*base;
+	level_locals_t	templevel;
+	edict_t			tempent;
+	savereader_t	r;
+	field_t			*field;
+
+	if (SR_Load (&r, filename))
+	{
+		SR_Read (&r, &i, sizeof(i));
+		SR_Read (&r, &base, sizeof(base));
+
+		SR_ReadBlock (&r, levelfields, &templevel, sizeof(templevel), TAG_LEVEL);
+		FreeBlockStrings (levelfields, (byte *)&templevel);
+
+		for (;;)
+		{
+			SR_Read (&r, &i, sizeof(i));
+			if (i == -1)
+				break;
+
+			SR_ReadBlock (&r, fields, &tempent, sizeof(tempent), TAG_LEVEL);
+			FreeBlockStrings (fields, (byte *)&tempent);
+		}
+
+		SR_Free (&r);
+		return;
+	}
+
+	f = fopen (filename, "rb");
+	if (!f)
+		gi.error ("Couldn't open %s", filename);
+
+	fread (&i, sizeof(i), 1, f);
+	fread (&base, sizeof(base), 1, f);
+
+	fread (&templevel, sizeof(templevel), 1, f);
+	for (field=levelfields ; field->name ; field++)
+		ReadField (f, field, (byte *)&templevel);
+	FreeBlockStrings (levelfields, (byte *)&templevel);
+
+	while (fread (&i, sizeof(i), 1, f) == 1 && i != -1)
+	{
+		ReadEdict (f, &tempent);
+		FreeBlockStrings (fields, (byte *)&tempent);
+	}
+
+	fclose (f);
+}
+
+/*
+=================
+SaveBench
+
+Saves and reloads the current level count times in each format and
+reports how long it took. Uses clock() since that's what we have in here,
+so it measures CPU time of the whole process including the syscalls.
+=================
+*/
+void SaveBench (const char *filename, int count)
+{
+	int			i, format;
+	clock_t		start;
+	double		writetime, readtime;
+	int			size;
+	FILE		*f;
+	static const char	*formatnames[] = {"original", "buffered", "buffered+zlib"};
+
+	for (format = 0; format < 3; format++)
+	{
+#ifdef NO_ZLIB
+		if (format == 2)
+			break;
+#endif
+		start = clock ();
+		for (i = 0; i < count; i++)
+		{
+			if (format)
+				WriteLevelBuffered (filename, format == 2 ? 1 : 0);
+			else
+				WriteLevelFile (filename);
+		}
+		writetime = (double)(clock () - start) * 1000.0 / CLOCKS_PER_SEC;
+
+		start = clock ();
+		for (i = 0; i < count; i++)
+			SaveBenchRead (filename);
+		readtime = (double)(clock () - start) * 1000.0 / CLOCKS_PER_SEC;
+
+		size = 0;
+		f = fopen (filename, "rb");
+		if (f)
+		{
+			fseek (f, 0, SEEK_END);
+			size = (int)ftell (f);
+			fclose (f);
+		}
+
+		gi.cprintf (NULL, PRINT_HIGH, "%-14s: %7d bytes, save %.3f ms, load %.3f ms\n", formatnames[format], size, writetime / count, readtime / count);
+	}
+
+	remove (filename);
+}
@@ -270,6 +270,39 @@ void SVCmd_WriteIP_f (void)
 	fclose (f);
 }
 
+/*
+=================
+Svcmd_SaveBench_f
+
+sv savebench [count]
+=================
+*/
+void Svcmd_SaveBench_f (void)
+{
+	char	name[MAX_OSPATH];
+	int		count;
+	cvar_t	*game;
+
+	if (!globals.num_edicts || !g_edicts[0].inuse)
+	{
+		gi.cprintf (NULL, PRINT_HIGH, "No level running.\n");
+		return;
+	}
+
+	count = atoi (gi.argv(2));
+	if (count <= 0)
+		count = 10;
+
+	game = gi.cvar("game", "", 0);
+
+	if (!*game->string)
+		sprintf (name, "%s/savebench.sav", GAMEVERSION);
+	else
+		sprintf (name, "%s/savebench.sav", game->string);
+
+	SaveBench (name, count);
+}
+
 /*
 =================
 ServerCommand
@@ -294,6 +327,8 @@ void	ServerCommand (void)
 		SVCmd_ListIP_f ();
 	else if (Q_stricmp (cmd, "writeip") == 0)
 		SVCmd_WriteIP_f ();
+	else if (Q_stricmp (cmd, "savebench") == 0)
+		Svcmd_SaveBench_f ();
 	else
 		gi.cprintf (NULL, PRINT_HIGH, "Unknown server command \"%s\"\n", cmd);
 }
@@ -0,0 +1,258 @@
+/*
+** DECODEBENCH.C
+**
+** Runs gl_decodebench outside the game: links the refresh objects minus
+** gl_sdl.c, hands them a minimal refimport_t and calls GL_DecodeBench_f
+** directly. Nothing opens a window or touches GL, so it works on boxes
+** without a display.
+**
+** usage: decodebench <gamedir> [+set cvar value ...] file or directory ...
+**
+** file and directory names are relative to the gamedir, as in the game.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "../ref_gl/gl_local.h"
+
+refexport_t EXPORT GetRefAPI (refimport_t rimp);
+void R_Register (void);
+
+static char		*bench_gamedir;
+static char		**bench_argv;
+static int		bench_argc;
+static cvar_t	*bench_cvars;
+
+static void IMPORT Bench_Printf (int print_level, const char *fmt, ...)
+{
+	va_list		argptr;
+
+	if (print_level != PRINT_ALL)
+		return;
+
+	va_start (argptr, fmt);
+	vprintf (fmt, argptr);
+	va_end (argptr);
+}
+
+static void IMPORT Bench_Error (int err_level, const char *fmt, ...)
+{
+	va_list		argptr;
+
+	va_start (argptr, fmt);
+	vfprintf (stderr, fmt, argptr);
+	va_end (argptr);
+
+	fprintf (stderr, "\n");
+	exit (1);
+}
+
+static void IMPORT Bench_AddCommand (const char *name, void (*cmd)(void))
+{
+}
+
+static void IMPORT Bench_RemoveCommand (const char *name)
+{
+}
+
+static int IMPORT Bench_Argc (void)
+{
+	return bench_argc;
+}
+
+static char * IMPORT Bench_Argv (int i)
+{
+	if (i < 0 || i >= bench_argc)
+		return "";
+
+	return bench_argv[i];
+}
+
+static int IMPORT Bench_LoadFile (const char *name, void **buf)
+{
+	char	path[MAX_OSPATH];
+	FILE	*f;
+	long	len;
+
+	if (buf)
+		*buf = NULL;
+
+	Com_sprintf (path, sizeof(path), "%s/%s", bench_gamedir, name);
+
+	f = fopen (path, "rb");
+	if (!f)
+		return -1;
+
+	fseek (f, 0, SEEK_END);
+	len = ftell (f);
+	fseek (f, 0, SEEK_SET);
+
+	if (buf)
+	{
+		*buf = malloc (len + 1);
+		if (!*buf || fread (*buf, 1, len, f) != (size_t)len)
+			Bench_Error (ERR_FATAL, "Couldn't read %s", path);
+	}
+
+	fclose (f);
+	return (int)len;
+}
+
+static void IMPORT Bench_FreeFile (void *buf)
+{
+	free (buf);
+}
+
+static char * IMPORT Bench_Gamedir (void)
+{
+	return bench_gamedir;
+}
+
+static cvar_t * IMPORT Bench_CvarSet (const char *name, const char *value)
+{
+	cvar_t	*var;
+
+	for (var = bench_cvars; var; var = var->next)
+	{
+		if (!strcmp (var->name, name))
+			break;
+	}
+
+	if (!var)
+	{
+		var = calloc (1, sizeof(*var));
+		var->name = strdup (name);
+		var->next = bench_cvars;
+		bench_cvars = var;
+	}
+	else
+	{
+		free (var->string);
+	}
+
+	var->string = strdup (value);
+	var->value = (float)atof (value);
+	var->intvalue = atoi (value);
+	var->modified = true;
+
+	return var;
+}
+
+//the game's Cvar_Get, an existing cvar (from +set) keeps its value
+static cvar_t * IMPORT Bench_CvarGet (const char *name, const char *value, int flags)
+{
+	cvar_t	*var;
+
+	for (var = bench_cvars; var; var = var->next)
+	{
+		if (!strcmp (var->name, name))
+			break;
+	}
+
+	if (!var)
+		var = Bench_CvarSet (name, value);
+
+	var->flags |= flags;
+	return var;
+}
+
+static void IMPORT Bench_CvarSetValue (const char *name, float value)
+{
+	char	text[32];
+
+	Com_sprintf (text, sizeof(text), "%g", value);
+	Bench_CvarSet (name, text);
+}
+
+/*
+** nothing here ever gets as far as a window
+*/
+void *GLimp_GetProcAddress (const char *func)
+{
+	return NULL;
+}
+
+int GLimp_Init (void *hInstance, void *wndProc)
+{
+	return false;
+}
+
+void GLimp_BeginFrame (void)
+{
+}
+
+void GLimp_EndFrame (void)
+{
+}
+
+int GLimp_SetMode (unsigned int *pwidth, unsigned int *pheight, int mode, qboolean fullscreen)
+{
+	return VID_ERR_FAIL;
+}
+
+void GLimp_Shutdown (void)
+{
+}
+
+void GLimp_AppActivate (qboolean active)
+{
+}
+
+int main (int argc, char **argv)
+{
+	refimport_t	rimp;
+	int			i;
+
+	if (argc < 3)
+	{
+		fprintf (stderr, "usage: %s <gamedir> [+set cvar value ...] file or directory ...\n", argv[0]);
+		return 1;
+	}
+
+	bench_gamedir = argv[1];
+
+	//argv[0] stands in for the command name
+	bench_argv = malloc (argc * sizeof(*bench_argv));
+	bench_argv[bench_argc++] = "gl_decodebench";
+
+	for (i = 2; i < argc; i++)
+	{
+		if (!strcmp (argv[i], "+set") && i + 2 < argc)
+		{
+			Bench_CvarSet (argv[i+1], argv[i+2]);
+			i += 2;
+		}
+		else
+		{
+			bench_argv[bench_argc++] = argv[i];
+		}
+	}
+
+	memset (&rimp, 0, sizeof(rimp));
+	rimp.Sys_Error = Bench_Error;
+	rimp.Cmd_AddCommand = Bench_AddCommand;
+	rimp.Cmd_RemoveCommand = Bench_RemoveCommand;
+	rimp.Cmd_Argc = Bench_Argc;
+	rimp.Cmd_Argv = Bench_Argv;
+	rimp.Con_Printf = Bench_Printf;
+	rimp.FS_LoadFile = Bench_LoadFile;
+	rimp.FS_FreeFile = Bench_FreeFile;
+	rimp.FS_Gamedir = Bench_Gamedir;
+	rimp.Cvar_Get = Bench_CvarGet;
+	rimp.Cvar_Set = Bench_CvarSet;
+	rimp.Cvar_SetValue = Bench_CvarSetValue;
+
+	GetRefAPI (rimp);
+
+	//the cvars and gamma tables, R_Init without the GL half
+	R_Register ();
+	GL_InitImages ();
+
+	GL_DecodeBench_f ();
+
+	GL_ShutdownImages ();
+	return 0;
+}
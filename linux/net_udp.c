@@ -378,6 +378,77 @@ int NET_SendPacket (netsrc_t sock, int length, const void *data, netadr_t *to)
 	return 1;
 }
 
+/*
+====================
+NET_SendPacketv
+
+Same as NET_SendPacket but gathers the datagram from several blocks
+with sendmsg, so the caller doesn't have to copy them together first.
+====================
+*/
+int NET_SendPacketv (netsrc_t sock, const netvec_t *blocks, int numblocks, netadr_t *to)
+{
+	int		ret;
+	int		i;
+	struct sockaddr_in	addr;
+	struct iovec		iov[NET_MAX_VECS];
+	struct msghdr		hdr;
+	int		net_socket;
+
+	if (to->type == NA_IP)
+	{
+		net_socket = ip_sockets[sock];
+		if (!net_socket)
+			return 0;
+	}
+#ifndef DEDICATED_ONLY
+	else if ( to->type == NA_LOOPBACK )
+	{
+		NET_SendLoopPacketv (sock, blocks, numblocks);
+		return 1;
+	}
+#endif
+	else if (to->type == NA_BROADCAST)
+	{
+		net_socket = ip_sockets[sock];
+		if (!net_socket)
+			return 0;
+	}
+	else
+	{
+		Com_Error (ERR_FATAL, "NET_SendPacketv: bad address type");
+		return 0;
+	}
+
+	if (numblocks > NET_MAX_VECS)
+		Com_Error (ERR_FATAL, "NET_SendPacketv: %d blocks > %d", numblocks, NET_MAX_VECS);
+
+	NetadrToSockadr (to, &addr);
+
+	for (i = 0; i < numblocks; i++)
+	{
+		iov[i].iov_base = (void *)blocks[i].data;
+		iov[i].iov_len = blocks[i].length;
+	}
+
+	memset (&hdr, 0, sizeof(hdr));
+	hdr.msg_name = &addr;
+	hdr.msg_namelen = sizeof(addr);
+	hdr.msg_iov = iov;
+	hdr.msg_iovlen = numblocks;
+
+	ret = sendmsg (net_socket, &hdr, 0);
+	if (ret == -1)
+	{
+		Com_Printf ("NET_SendPacketv to %s: ERROR: %s\n", LOG_NET, NET_AdrToString(to), NET_ErrorString());
+		return 0;
+	}
+
+	net_packets_out++;
+	net_total_out += ret;
+	return 1;
+}
+
 //=============================================================================
 
 /*
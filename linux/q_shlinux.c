@@ -11,6 +11,7 @@
 #include <sys/mman.h>
 #include <sys/time.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #include "../linux/glob.h"
 
@@ -109,6 +110,66 @@ unsigned int Sys_Milliseconds (void)
 	return curtime;
 }
 
+/*
+================
+Sys_Microseconds
+================
+*/
+uint64 Sys_Microseconds (void)
+{
+	struct timeval tp;
+
+	gettimeofday(&tp, NULL);
+
+	return (uint64)tp.tv_sec * 1000000 + tp.tv_usec;
+}
+
+void Sys_Sleep (int msec)
+{
+	usleep (msec*1000);
+}
+
+typedef struct
+{
+	pthread_t		id;
+	threadfunc_t	func;
+	void			*param;
+} systhread_t;
+
+static void *Sys_ThreadStart (void *arg)
+{
+	systhread_t	*thread = arg;
+
+	thread->func (thread->param);
+	return NULL;
+}
+
+void *Sys_CreateThread (threadfunc_t func, void *param)
+{
+	systhread_t	*thread;
+
+	thread = malloc (sizeof(*thread));
+	if (!thread)
+		return NULL;
+
+	thread->func = func;
+	thread->param = param;
+
+	if (pthread_create (&thread->id, NULL, Sys_ThreadStart, thread))
+	{
+		free (thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+void Sys_WaitThread (void *thread)
+{
+	pthread_join (((systhread_t *)thread)->id, NULL);
+	free (thread);
+}
+
 void Sys_DebugBreak (void)
 {
         __asm ("int $3");
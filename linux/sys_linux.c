@@ -23,6 +23,7 @@
 #include <link.h>
 #include <sys/ucontext.h>
 #include <sys/resource.h>
+#include <pthread.h>
 
 //for old headers
 #ifndef REG_EIP
@@ -107,11 +108,6 @@ void Sys_getrusage_f (void)
 	Com_Printf ("user:", LOG_GENERAL);
 }
 
-void Sys_Sleep (int msec)
-{
-	usleep (msec*1000);
-}
-
 void Sys_SetWindowText (char *dummy)
 {
 }
@@ -18,6 +18,7 @@ qboolean reload_video = false;
 
 // Structure containing functions exported from refresh DLL
 refexport_t	re;
+PrefetchRegistration_t	R_PrefetchRegistration_fp;
 
 // Console variables that we need to access from this module
 cvar_t		*vid_gamma;
@@ -174,6 +175,7 @@ void VID_FreeReflib (void)
 	RW_IN_Commands_fp = NULL;
 	RW_IN_Move_fp = NULL;
 	RW_IN_Frame_fp = NULL;
+	R_PrefetchRegistration_fp = NULL;
 
 	memset (&re, 0, sizeof(re));
 	reflib_library = NULL;
@@ -274,6 +276,7 @@ qboolean VID_LoadRefresh( char *name )
 	rx.FS_FOpenFile = FS_FOpenFile;
 	rx.FS_FCloseFile = FS_FCloseFile;
 	rx.FS_Read = FS_Read;
+	rx.FS_ImageExtensions = FS_ImageExtensions;
 	
 	rx.APIVersion = EXTENDED_API_VERSION;
 
@@ -289,6 +292,8 @@ qboolean VID_LoadRefresh( char *name )
 		Com_DPrintf ("done.\n");
 	}
 
+	R_PrefetchRegistration_fp = (PrefetchRegistration_t) dlsym( reflib_library, "R_PrefetchRegistration" );
+
 	re = GetRefAPI( ri );
 
 	if (re.api_version != API_VERSION)
@@ -67,6 +67,8 @@ static cvar_t	*logfile_timestamp;
 static cvar_t	*logfile_timestamp_format;
 static cvar_t	*logfile_name;
 static cvar_t	*logfile_filterlevel = &uninitialized_cvar;
+static cvar_t	*logfile_async = &uninitialized_cvar;
+static cvar_t	*logfile_format = &uninitialized_cvar;
 static cvar_t	*con_filterlevel = &uninitialized_cvar;
 
 #ifndef DEDICATED_ONLY
@@ -90,11 +92,452 @@ static cvar_t	*err_fatal = &uninitialized_cvar;
 
 static FILE	*logfile;
 
+/*
+==============================================================
+
+LOGFILE
+
+With logfile_async, Com_Printf only copies each message into logring and
+a background thread does the timestamping, formatting and writing. The
+ring is single producer / single consumer: only the game thread moves
+logring_head and only the log thread moves logring_tail, so no locks are
+needed. If the ring is full the message is dropped and counted, the log
+thread notes how many were lost once it catches up.
+
+The log thread never touches cvars, Cvar_Set can free their strings under
+it. Each record carries the logfile settings and the rendered timestamp
+as they were when the message was printed.
+
+==============================================================
+*/
+
+//r1: must be a power of two
+#define	LOGRING_SIZE	1048576
+
+//logrecord_t flags
+#define	LOGRECORD_JSON		1
+#define	LOGRECORD_TIMESTAMP	2
+#define	LOGRECORD_FLUSH		4
+
+//followed by stamplength bytes of timestamp, then length bytes of message
+typedef struct
+{
+	int			level;
+	int			flags;
+	int			stamplength;
+	int			length;
+	time_t		time;
+} logrecord_t;
+
+static byte					logring[LOGRING_SIZE];
+static volatile unsigned	logring_head;
+static volatile unsigned	logring_tail;
+static volatile unsigned	logring_dropped;
+
+static void					*logthread;
+static volatile qboolean	logthread_quit;
+
+//set by whoever writes the file, the game thread closes it
+static volatile qboolean	logfile_failed;
+
+static const char *logfile_levelnames[] =
+{
+	"client", "server", "debug", "warning", "error", "game", "connect", "name",
+	"drop", "kick", "exploit", "download", "notice", "chat", "net", "gamedebug",
+	"anticheat"
+};
+
+/*
+=============
+Com_LogTimestamp
+
+strftime is only run once a second, every line in between reuses it.
+game thread only.
+=============
+*/
+static const char *Com_LogTimestamp (time_t t)
+{
+	static char		timestamp[64];
+	static time_t	timestamp_time = -1;
+
+	if (t != timestamp_time)
+	{
+		strftime (timestamp, sizeof(timestamp)-1, logfile_timestamp_format->string, localtime(&t));
+		timestamp_time = t;
+	}
+
+	return timestamp;
+}
+
+/*
+=============
+Com_LogSettings
+
+snapshot of the logfile cvars for one message, stamp is set to its
+timestamp or "" if there is none.
+=============
+*/
+static int Com_LogSettings (time_t t, const char **stamp)
+{
+	int		flags;
+
+	flags = 0;
+	*stamp = "";
+
+	if (logfile_format->intvalue == 1)
+		flags |= LOGRECORD_JSON;
+
+	if (logfile_active->intvalue & 1)
+		flags |= LOGRECORD_FLUSH;
+
+	if (logfile_timestamp->intvalue)
+	{
+		flags |= LOGRECORD_TIMESTAMP;
+		*stamp = Com_LogTimestamp (t);
+	}
+
+	return flags;
+}
+
+/*
+=============
+Com_LogWriteJSON
+
+one JSON object per complete line with the LOG_* bits of everything that
+went into it.
+=============
+*/
+static void Com_LogWriteJSON (int level, time_t t, const char *stamp, const char *line)
+{
+	char		out[MAXPRINTMSG*2+512];
+	char		*o, *end;
+	qboolean	first;
+	int			i;
+
+	o = out;
+	end = out + sizeof(out) - 8;
+
+	o += Com_sprintf (o, end - o, "{\"time\":%lu,", (unsigned long)t);
+
+	if (stamp[0])
+		o += Com_sprintf (o, end - o, "\"timestamp\":\"%s\",", stamp);
+
+	o += Com_sprintf (o, end - o, "\"level\":%d,\"flags\":[", level);
+
+	first = true;
+	for (i = 0; i < sizeof(logfile_levelnames) / sizeof(logfile_levelnames[0]); i++)
+	{
+		if (level & (1 << i))
+		{
+			o += Com_sprintf (o, end - o, first ? "\"%s\"" : ",\"%s\"", logfile_levelnames[i]);
+			first = false;
+		}
+	}
+
+	if (first)
+		o += Com_sprintf (o, end - o, "\"general\"");
+
+	o += Com_sprintf (o, end - o, "],\"msg\":\"");
+
+	for (; *line && o < end; line++)
+	{
+		switch (*line)
+		{
+			case '"':
+			case '\\':
+				*o++ = '\\';
+				*o++ = *line;
+				break;
+			case '\t':
+				*o++ = '\\';
+				*o++ = 't';
+				break;
+			case '\r':
+				break;
+			default:
+				//anything else below 0x20 is invalid raw in a JSON string
+				if ((byte)*line < 32)
+					o += sprintf (o, "\\u%04x", (byte)*line);
+				else
+					*o++ = *line;
+				break;
+		}
+	}
+
+	*o++ = '"';
+	*o++ = '}';
+	*o++ = '\n';
+
+	if (fwrite (out, o - out, 1, logfile) != 1)
+		logfile_failed = true;
+}
+
+/*
+=============
+Com_LogWrite
+
+writes one Com_Printf message to the logfile. messages don't have to
+end in a newline, so timestamps and JSON objects are only started /
+finished at line boundaries. flags and stamp come from Com_LogSettings.
+=============
+*/
+static void Com_LogWrite (int level, int flags, time_t t, const char *stamp, char *msg)
+{
+	static qboolean	insert_timestamp = true;
+	static char		jsonline[MAXPRINTMSG];
+	static int		jsonlength;
+	static int		jsonlevel;
+
+	char			*p, *line;
+
+	//r1: strip highbits and control chars
+	p = msg;
+	while (p[0])
+	{
+		p[0] &= ~128;
+		if (p[0] < 32 && !isspace(p[0]))
+			p[0] = '-';
+		p++;
+	}
+
+	if (flags & LOGRECORD_JSON)
+	{
+		for (p = msg; *p; p++)
+		{
+			if (*p == '\n')
+			{
+				jsonline[jsonlength] = 0;
+				Com_LogWriteJSON (jsonlevel | level, t, stamp, jsonline);
+				jsonlength = jsonlevel = 0;
+				continue;
+			}
+
+			if (jsonlength < sizeof(jsonline) - 1)
+				jsonline[jsonlength++] = *p;
+		}
+
+		if (jsonlength)
+			jsonlevel |= level;
+
+		return;
+	}
+
+	if (!(flags & LOGRECORD_TIMESTAMP))
+	{
+		if (fwrite (msg, strlen(msg), 1, logfile) != 1 && msg[0])
+			logfile_failed = true;
+		return;
+	}
+
+	line = msg;
+	while (*line)
+	{
+		if (insert_timestamp)
+		{
+			fprintf (logfile, "%s ", stamp);
+			insert_timestamp = false;
+		}
+
+		p = strchr (line, '\n');
+		if (!p)
+		{
+			fprintf (logfile, "%s", line);
+			break;
+		}
+
+		*p = 0;
+		if (fprintf (logfile, "%s\n", line) < 0)
+		{
+			logfile_failed = true;
+			return;
+		}
+
+		insert_timestamp = true;
+		line = p + 1;
+	}
+}
+
+static void Com_LogRingRead (unsigned offset, void *out, int length)
+{
+	int		chunk;
+
+	offset &= LOGRING_SIZE - 1;
+	chunk = LOGRING_SIZE - offset;
+
+	if (chunk >= length)
+	{
+		memcpy (out, logring + offset, length);
+	}
+	else
+	{
+		memcpy (out, logring + offset, chunk);
+		memcpy ((byte *)out + chunk, logring, length - chunk);
+	}
+}
+
+static void Com_LogRingWrite (unsigned offset, const void *in, int length)
+{
+	int		chunk;
+
+	offset &= LOGRING_SIZE - 1;
+	chunk = LOGRING_SIZE - offset;
+
+	if (chunk >= length)
+	{
+		memcpy (logring + offset, in, length);
+	}
+	else
+	{
+		memcpy (logring + offset, in, chunk);
+		memcpy (logring, (const byte *)in + chunk, length - chunk);
+	}
+}
+
+/*
+=============
+Com_LogThread
+
+drains logring into the logfile. flushing (logfile 1) happens once the
+ring is empty instead of after every line.
+=============
+*/
+static void Com_LogThread (void *param)
+{
+	char		msg[MAXPRINTMSG];
+	char		stamp[64];
+	logrecord_t	record;
+	unsigned	head, tail;
+	unsigned	dropped, dropped_reported;
+	qboolean	written, flush;
+
+	tail = logring_tail;
+	dropped_reported = logring_dropped;
+	written = flush = false;
+
+	for (;;)
+	{
+		head = logring_head;
+		Sys_MemoryBarrier ();
+
+		if (head == tail)
+		{
+			if (written)
+			{
+				if (flush)
+					fflush (logfile);
+				written = false;
+			}
+
+			if (logthread_quit)
+				break;
+
+			Sys_Sleep (1);
+			continue;
+		}
+
+		Com_LogRingRead (tail, &record, sizeof(record));
+		Com_LogRingRead (tail + sizeof(record), stamp, record.stamplength);
+		Com_LogRingRead (tail + sizeof(record) + record.stamplength, msg, record.length);
+		stamp[record.stamplength] = 0;
+		msg[record.length] = 0;
+
+		Sys_MemoryBarrier ();
+		tail += sizeof(record) + record.stamplength + record.length;
+		logring_tail = tail;
+
+		flush = (record.flags & LOGRECORD_FLUSH) ? true : false;
+
+		dropped = logring_dropped;
+		if (dropped != dropped_reported)
+		{
+			char	warning[128];
+
+			Com_sprintf (warning, sizeof(warning), "WARNING: %u lines were lost, the log could not keep up.\n", dropped - dropped_reported);
+			Com_LogWrite (LOG_GENERAL|LOG_WARNING, record.flags, record.time, stamp, warning);
+			dropped_reported = dropped;
+		}
+
+		if (!logfile_failed)
+			Com_LogWrite (record.level, record.flags, record.time, stamp, msg);
+
+		written = true;
+	}
+}
+
+/*
+=============
+Com_LogQueue
+
+hands a message to the log thread along with the current logfile
+settings, never waits for it.
+=============
+*/
+static void Com_LogQueue (int level, const char *msg)
+{
+	logrecord_t	record;
+	const char	*stamp;
+	unsigned	head, size;
+
+	record.level = level;
+	record.length = (int)strlen (msg);
+	time (&record.time);
+
+	record.flags = Com_LogSettings (record.time, &stamp);
+	record.stamplength = (int)strlen (stamp);
+
+	size = sizeof(record) + record.stamplength + record.length;
+
+	head = logring_head;
+
+	if (LOGRING_SIZE - (head - logring_tail) < size)
+	{
+		logring_dropped++;
+		return;
+	}
+
+	Com_LogRingWrite (head, &record, sizeof(record));
+	Com_LogRingWrite (head + sizeof(record), stamp, record.stamplength);
+	Com_LogRingWrite (head + sizeof(record) + record.stamplength, msg, record.length);
+
+	Sys_MemoryBarrier ();
+	logring_head = head + size;
+}
+
+static void Com_StopLogThread (void)
+{
+	if (!logthread)
+		return;
+
+	logthread_quit = true;
+	Sys_WaitThread (logthread);
+	logthread = NULL;
+	logthread_quit = false;
+}
+
+/*
+=============
+Com_CloseLogfile
+
+writes out anything still queued and closes the logfile.
+=============
+*/
+static void Com_CloseLogfile (void)
+{
+	Com_StopLogThread ();
+
+	if (logfile)
+	{
+		fclose (logfile);
+		logfile = NULL;
+	}
+}
+
 int			server_state;
 
 // host_speeds times
 unsigned int		time_before_game;
 unsigned int		time_after_game;
+unsigned int		time_status;
 unsigned int		time_before_ref;
 unsigned int		time_after_ref;
 
@@ -171,6 +614,9 @@ tagmalloc_tag_t tagmalloc_tags[] =
 	{TAGMALLOC_CMDBANS, "CMDBANS", 0},
 	{TAGMALLOC_REDBLACK, "REDBLACK", 0},
 	{TAGMALLOC_LRCON, "LRCON", 0},
+	{TAGMALLOC_CONNECTCACHE, "CONNECTCACHE", 0},
+	{TAGMALLOC_CLIENT_ZFRAMES, "CLIENT_ZFRAMES", 0},
+	{TAGMALLOC_NETCHAN, "NETCHAN", 0},
 #ifdef ANTICHEAT
 	{TAGMALLOC_ANTICHEAT, "ANTICHEAT", 0},
 #endif
@@ -270,18 +716,6 @@ void Com_Printf (const char *fmt, int level, ...)
 	if (logfile_active && logfile_active->intvalue && !(level & logfile_filterlevel->intvalue))
 	{
 		char	name[MAX_QPATH];
-		char	timestamp[64];
-		char	*p;
-
-		//r1: strip highbits and control chars
-		p = msg;
-		while (p[0])
-		{
-			p[0] &= ~128;
-			if (p[0] < 32 && !isspace(p[0]))
-				p[0] = '-';
-			p++;
-		}
 
 		if (!logfile)
 		{
@@ -307,66 +741,37 @@ void Com_Printf (const char *fmt, int level, ...)
 			}
 		}
 
-		if (logfile)
-		{
-			if (logfile_timestamp->intvalue)
-			{
-				char		*line;
-				char		*msgptr;
-
-				static qboolean	insert_timestamp = true;
-
-				time_t	tm;
-				time(&tm);
-				strftime (timestamp, sizeof(timestamp)-1, logfile_timestamp_format->string, localtime(&tm));
+		if (logfile_async->intvalue && !logthread)
+			logthread = Sys_CreateThread (Com_LogThread, NULL);
+		else if (!logfile_async->intvalue && logthread)
+			Com_StopLogThread ();
 
-				msgptr = msg;
-				line = strchr (msgptr, '\n');
-				while (line)
-				{
-					if (insert_timestamp)
-					{
-						fprintf (logfile, "%s ", timestamp);
-						insert_timestamp = false;
-					}
-					*line = 0;
-
-					if (fprintf (logfile, "%s\n", msgptr) < 0)
-					{
-						fclose (logfile);
-						logfile = NULL;
-						Cvar_ForceSet ("logfile", "0");
-						Com_Printf ("ALERT: Error writing to logfile %s, file closed.\n", LOG_GENERAL|LOG_WARNING, logfile_name->string);
-						return;
-					}
-						
-					insert_timestamp = true;
-					line++;
-					msgptr = line;
-
-					if (!*line)
-						break;
-
-					line = strchr (msgptr, '\n');
-				}
+		if (logthread)
+		{
+			Com_LogQueue (level, msg);
+		}
+		else
+		{
+			const char	*stamp;
+			time_t		t;
+			int			flags;
 
-				if (insert_timestamp)
-				{
-					fprintf (logfile, "%s ", timestamp);
-					insert_timestamp = false;
-				}
+			t = time (NULL);
+			flags = Com_LogSettings (t, &stamp);
+			Com_LogWrite (level, flags, t, stamp, msg);
 
-				fprintf (logfile, "%s", msgptr);
-			}
-			else
-			{
-				fwrite (msg, strlen(msg), 1, logfile);
-			}
+			//r1: allow logging > 2 (append) but not forcing flushing.
+			if (flags & LOGRECORD_FLUSH)
+				fflush (logfile);
 		}
 
-		//r1: allow logging > 2 (append) but not forcing flushing.
-		if (logfile_active->intvalue & 1)
-			fflush (logfile);
+		if (logfile_failed)
+		{
+			Com_CloseLogfile ();
+			logfile_failed = false;
+			Cvar_ForceSet ("logfile", "0");
+			Com_Printf ("ALERT: Error writing to logfile %s, file closed.\n", LOG_GENERAL|LOG_WARNING, logfile_name->string);
+		}
 	}
 }
 
@@ -484,6 +889,8 @@ void Com_Error (int code, const char *fmt, ...)
 		}
 	}
 
+	Com_StopLogThread ();
+
 	if (logfile)
 	{
 		fprintf (logfile, "Fatal Error\n*****************************\n"
@@ -519,11 +926,7 @@ void Com_Quit (void)
 	CL_Shutdown ();
 #endif
 
-	if (logfile)
-	{
-		fclose (logfile);
-		logfile = NULL;
-	}
+	Com_CloseLogfile ();
 
 	Sys_Quit ();
 }
@@ -2250,13 +2653,7 @@ void _z_debug_changed (cvar_t *cvar, char *o, char *n)
 void _logfile_changed (cvar_t *cvar, char *o, char *n)
 {
 	if (cvar->intvalue == 0)
-	{
-		if (logfile)
-		{
-			fclose (logfile);
-			logfile = NULL;
-		}
-	}
+		Com_CloseLogfile ();
 }
 
 void Qcommon_Init (int argc, char **argv)
@@ -2343,6 +2740,10 @@ void Qcommon_Init (int argc, char **argv)
 	logfile_timestamp_format = Cvar_Get ("logfile_timestamp_format", "[%Y-%m-%d %H:%M]", 0);
 	logfile_name = Cvar_Get ("logfile_name", "qconsole.log", 0);
 	logfile_filterlevel = Cvar_Get ("logfile_filterlevel", "0", 0);
+	logfile_async = Cvar_Get ("logfile_async", "1", 0);
+	logfile_async->help = "Write the logfile from a background thread so disk I/O never stalls a frame. Lines are dropped (and the drop noted in the log) rather than waiting if the disk can't keep up. Default 1.\n";
+	logfile_format = Cvar_Get ("logfile_format", "0", 0);
+	logfile_format->help = "Logfile format. 0 = plain text, 1 = one JSON object per line with the time, log level bits and message. Default 0.\n";
 	logfile_active->changed = _logfile_changed;
 
 	con_filterlevel = Cvar_Get ("con_filterlevel", "0", 0);
@@ -2547,7 +2948,7 @@ void Qcommon_Frame (int msec)
 	CL_Frame (msec);
 
 	if (host_speeds->intvalue) {
-		int			all, sv, gm, cl, rf;
+		int			all, sv, gm, cl, rf, st;
 
 		time_after = Sys_Milliseconds ();
 
@@ -2556,10 +2957,11 @@ void Qcommon_Frame (int msec)
 		cl = time_after - time_between;
 		gm = time_after_game - time_before_game;
 		rf = time_after_ref - time_before_ref;
-		sv -= gm;
+		st = time_status;
+		sv -= gm + st;
 		cl -= rf;
-		Com_Printf ("all:%3i sv:%3i gm:%3i cl:%3i rf:%3i\n", LOG_GENERAL,
-			all, sv, gm, cl, rf);
+		Com_Printf ("all:%3i sv:%3i gm:%3i st:%3i cl:%3i rf:%3i\n", LOG_GENERAL,
+			all, sv, gm, st, cl, rf);
 	}
 #endif
 
@@ -2642,6 +3044,156 @@ int ZLibCompressChunk(byte *in, int len_in, byte *out, int len_out, int method,
 
 	return zs.total_out;
 }
+
+//r1: persistent streams for per-frame compression. deflateInit allocates a few
+//hundred KB which dominated the cost of compressing small packets, so the
+//streams are created once and reset between chunks instead.
+static z_stream	zs_deflate;
+static int		zs_deflate_method = -2;
+static z_stream	zs_inflate;
+static qboolean	zs_inflate_ready;
+
+//r1: bytes that show up in nearly every svc_frame - full areabits, empty
+//deltas and the packetentities / playerinfo framing. changing this requires
+//a new MINOR_VERSION_R1Q2 as both ends must agree on it exactly.
+static const byte zlibFrameDictionary[] =
+{
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	svc_sound, 0x1B, 0x00, 0x00, svc_sound, 0x0B, 0x00,
+	svc_temp_entity, 0x00, svc_temp_entity, 0x01,
+	svc_muzzleflash, 0x01, 0x00, 0x00, svc_muzzleflash2,
+	0x00, 0x00, 0x00, 0x00, 0x08, 0xFF, 0xFF, 0xFF, 0xFF,
+	svc_playerinfo, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+	0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x04, 0x00,
+	svc_packetentities, 0x03, 0x01, 0x00, 0x07, 0x02, 0x00,
+	0x83, 0x80, 0x01, 0x02, 0x00, 0xFF, 0xFF, 0x00, 0x00,
+	0x00, 0x00, svc_frame, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+const byte *ZLibFrameDictionary (int *len)
+{
+	*len = sizeof(zlibFrameDictionary);
+	return zlibFrameDictionary;
+}
+
+/*
+=================
+ZLibCompressStream
+
+Raw deflate of a single chunk through the persistent stream. If a
+dictionary is given the window is primed with it first, the receiver
+must pass the exact same bytes to ZLibDecompressStream.
+=================
+*/
+int ZLibCompressStream (const byte *dict, int dictlen, byte *in, int len_in, byte *out, int len_out, int method)
+{
+	int		result;
+
+	if (zs_deflate_method == -2)
+	{
+		memset (&zs_deflate, 0, sizeof(zs_deflate));
+		result = deflateInit2 (&zs_deflate, method, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY);
+		if (result != Z_OK)
+			return -1;
+		zs_deflate_method = method;
+	}
+	else
+	{
+		result = deflateReset (&zs_deflate);
+		if (result != Z_OK)
+			return -1;
+
+		if (method != zs_deflate_method)
+		{
+			result = deflateParams (&zs_deflate, method, Z_DEFAULT_STRATEGY);
+			if (result != Z_OK)
+				return -1;
+			zs_deflate_method = method;
+		}
+	}
+
+	if (dictlen)
+	{
+		result = deflateSetDictionary (&zs_deflate, dict, dictlen);
+		if (result != Z_OK)
+			return -1;
+	}
+
+	zs_deflate.next_in = in;
+	zs_deflate.avail_in = len_in;
+
+	zs_deflate.next_out = out;
+	zs_deflate.avail_out = len_out;
+
+	result = deflate (&zs_deflate, Z_FINISH);
+	if (result != Z_STREAM_END)
+		return -1;
+
+	return zs_deflate.total_out;
+}
+
+/*
+=================
+ZLibDecompressStream
+
+Inverse of ZLibCompressStream. Errors are fatal to the connection
+just like ZLibDecompress.
+=================
+*/
+int ZLibDecompressStream (const byte *dict, int dictlen, byte *in, int inlen, byte *out, int outlen)
+{
+	int		result;
+
+	if (!zs_inflate_ready)
+	{
+		memset (&zs_inflate, 0, sizeof(zs_inflate));
+		result = inflateInit2 (&zs_inflate, -15);
+		if (result != Z_OK)
+		{
+			Com_Error (ERR_DROP, "ZLib data error! Error %d on inflateInit.\nMessage: %s", result, zs_inflate.msg);
+			return 0;
+		}
+		zs_inflate_ready = true;
+	}
+	else
+	{
+		result = inflateReset (&zs_inflate);
+		if (result != Z_OK)
+		{
+			Com_Error (ERR_DROP, "ZLib data error! Error %d on inflateReset.\nMessage: %s", result, zs_inflate.msg);
+			return 0;
+		}
+	}
+
+	if (dictlen)
+	{
+		result = inflateSetDictionary (&zs_inflate, dict, dictlen);
+		if (result != Z_OK)
+		{
+			Com_Error (ERR_DROP, "ZLib data error! Error %d on inflateSetDictionary.\nMessage: %s", result, zs_inflate.msg);
+			return 0;
+		}
+	}
+
+	zs_inflate.next_in = in;
+	zs_inflate.avail_in = inlen;
+
+	zs_inflate.next_out = out;
+	zs_inflate.avail_out = outlen;
+
+	result = inflate (&zs_inflate, Z_FINISH);
+	if (result != Z_STREAM_END)
+	{
+		Com_Error (ERR_DROP, "ZLib data error! Error %d on inflate.\nMessage: %s", result, zs_inflate.msg);
+		return 0;
+	}
+
+	return zs_inflate.total_out;
+}
 #endif
 
 void StripHighBits (char *string, int highbits)
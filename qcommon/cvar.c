@@ -269,6 +269,9 @@ static cvar_t *Cvar_Add (const char *var_name, const char *var_value, int flags)
 	if (var->flags & CVAR_USERINFO)
 		userinfo_modified = true;
 
+	if (var->flags & CVAR_SERVERINFO)
+		serverinfo_modified_count++;
+
 	//r1: fix 0 case
 	if (!var->intvalue && FLOAT_NE_ZERO(var->value))
 		var->intvalue = 1;
@@ -311,6 +314,9 @@ cvar_t * EXPORT Cvar_Get (const char *var_name, const char *var_value, int flags
 	var = Cvar_FindVar (var_name);
 	if (var)
 	{
+		if ((flags & CVAR_SERVERINFO) && !(var->flags & CVAR_SERVERINFO))
+			serverinfo_modified_count++;
+
 		var->flags |= flags;
 		return var;
 	}
@@ -418,6 +424,9 @@ static cvar_t *Cvar_Set2 (const char *var_name, const char *value, qboolean forc
 				var->value = (float)atof (var->string);
 				var->intvalue = (int)var->value;
 
+				if (var->flags & CVAR_SERVERINFO)
+					serverinfo_modified_count++;
+
 				//r1: fix 0 case
 				if (!var->intvalue && FLOAT_NE_ZERO(var->value))
 					var->intvalue = 1;
@@ -463,6 +472,9 @@ static cvar_t *Cvar_Set2 (const char *var_name, const char *value, qboolean forc
 
 	if (var->flags & CVAR_USERINFO)
 		userinfo_modified = true;	// transmit at next oportunity
+
+	if (var->flags & CVAR_SERVERINFO)
+		serverinfo_modified_count++;
 	
 	Z_Free (old_string);	// free the old value string
 
@@ -525,6 +537,9 @@ cvar_t *Cvar_FullSet (const char *var_name, const char *value, int flags)
 	if (!var->intvalue && FLOAT_NE_ZERO(var->value))
 		var->intvalue = 1;
 
+	if ((var->flags | flags) & CVAR_SERVERINFO)
+		serverinfo_modified_count++;
+
 	var->flags = flags;
 
 	return var;
@@ -580,6 +595,9 @@ void Cvar_GetLatchedVars (void)
 
 		Z_Free (old_string);
 
+		if (var->flags & CVAR_SERVERINFO)
+			serverinfo_modified_count++;
+
 		if (!strcmp(var->name, "game"))
 		{
 			FS_SetGamedir (var->string);
@@ -801,6 +819,9 @@ static void Cvar_List_f (void)
 
 qboolean userinfo_modified;
 
+//bumped whenever a serverinfo cvar changes so the server can cache status replies
+uint32	serverinfo_modified_count;
+
 
 static char *Cvar_BitInfo (int bit)
 {
@@ -84,6 +84,7 @@ cvar_t	*fs_basedir;
 cvar_t	*fs_gamedirvar;
 cvar_t	*fs_cache;
 cvar_t	*fs_noextern;
+cvar_t	*fs_imageindex;
 
 typedef struct filelink_s
 {
@@ -246,6 +247,17 @@ struct fscache_s
 
 static struct rbtree *rb;
 
+//r1: basename -> FS_EXT_* bits of the image files on the search path
+typedef struct imageindex_s
+{
+	int		extensions;
+	char	basename[1];
+} imageindex_t;
+
+static struct rbtree	*fs_imageindex_rb;
+static qboolean			fs_imageindex_dirty = true;
+static int				fs_imageindex_count;
+
 #ifdef MAGIC_BTREE
 static int _compare(const void *pa, const void *pb)
 {
@@ -326,6 +338,10 @@ void FS_FlushCache (void)
 	memset (&fscache, 0, sizeof(fscache));
 #endif
 	RB_Purge (rb);
+
+	//r1: whatever flushed the cache (download, gamedir change) may
+	//have added files, rescan before the next image lookup
+	fs_imageindex_dirty = true;
 }
 
 static void FS_Stats_f (void)
@@ -356,6 +372,11 @@ static void FS_Stats_f (void)
 	Com_Printf ("%d entries in binary search tree cache (est. height %d).\n", LOG_GENERAL, i, k);
 #endif
 
+	if (fs_imageindex_dirty)
+		Com_Printf ("Image index will be rebuilt on next use.\n", LOG_GENERAL);
+	else
+		Com_Printf ("%d basenames in image index.\n", LOG_GENERAL, fs_imageindex_count);
+
 #ifdef HASH_CACHE
 	temp = &fscache;
 	temp = temp->next;
@@ -1570,6 +1591,208 @@ char /*@null@*/ **FS_ListFiles( char *findname, int *numfiles, uint32 musthave,
 	return list;
 }
 
+/*
+=================
+FS_IndexImage
+
+Adds a file to the image index if it has one of the FS_EXT_* extensions.
+=================
+*/
+static void FS_IndexImage (const char *path)
+{
+	imageindex_t	*entry;
+	void			**data;
+	const char		*ext;
+	char			basename[MAX_QPATH];
+	int				bit;
+	size_t			len;
+
+	ext = strrchr (path, '.');
+	if (!ext || strchr (ext, '/'))
+		return;
+
+	if (!Q_stricmp (ext, ".pcx"))
+		bit = FS_EXT_PCX;
+	else if (!Q_stricmp (ext, ".wal"))
+		bit = FS_EXT_WAL;
+	else if (!Q_stricmp (ext, ".tga"))
+		bit = FS_EXT_TGA;
+	else if (!Q_stricmp (ext, ".png"))
+		bit = FS_EXT_PNG;
+	else if (!Q_stricmp (ext, ".jpg"))
+		bit = FS_EXT_JPG;
+	else
+		return;
+
+	len = ext - path;
+	if (len >= sizeof(basename))
+		return;
+
+	memcpy (basename, path, len);
+	basename[len] = 0;
+	fast_strlwr (basename);
+
+	data = rbfind (basename, fs_imageindex_rb);
+	if (data)
+	{
+		entry = *(imageindex_t **)data;
+		entry->extensions |= bit;
+		return;
+	}
+
+	entry = Z_TagMalloc (sizeof(*entry) + len, TAGMALLOC_FSCACHE);
+	entry->extensions = bit;
+	strcpy (entry->basename, basename);
+
+	data = rbsearch (entry->basename, fs_imageindex_rb);
+	*data = entry;
+
+	fs_imageindex_count++;
+}
+
+/*
+=================
+FS_IndexDirectory
+
+Recursively adds the images under dir, skip is the length of the
+search path prefix to strip from the names.
+=================
+*/
+static void FS_IndexDirectory (const char *dir, size_t skip, int depth)
+{
+	char	findname[MAX_OSPATH];
+	char	**list;
+	int		i, count;
+
+	//symlink loops
+	if (depth > 16)
+		return;
+
+	Com_sprintf (findname, sizeof(findname), "%s/*", dir);
+
+	if ((list = FS_ListFiles (findname, &count, 0, SFF_SUBDIR | SFF_HIDDEN | SFF_SYSTEM)) != NULL)
+	{
+		for (i = 0; i < count-1; i++)
+		{
+			if (strlen (list[i]) > skip)
+				FS_IndexImage (list[i] + skip);
+			free (list[i]);
+		}
+		free (list);
+	}
+
+	if ((list = FS_ListFiles (findname, &count, SFF_SUBDIR, SFF_HIDDEN | SFF_SYSTEM)) != NULL)
+	{
+		for (i = 0; i < count-1; i++)
+		{
+			FS_IndexDirectory (list[i], skip, depth + 1);
+			free (list[i]);
+		}
+		free (list);
+	}
+}
+
+/*
+=================
+FS_BuildImageIndex
+
+Scans every pak and directory on the search path for image files. Only
+pak types FS_FOpenFile can read from are indexed.
+=================
+*/
+static void FS_BuildImageIndex (void)
+{
+	searchpath_t	*search;
+	RBLIST			*rblist;
+	const void		*val;
+	void			*data;
+	unsigned		start;
+
+	start = Sys_Milliseconds ();
+
+	if (fs_imageindex_rb)
+	{
+		if ((rblist = rbopenlist (fs_imageindex_rb)))
+		{
+			while ((val = rbreadlist (rblist)))
+			{
+				data = *(void **)rbfind (val, fs_imageindex_rb);
+				rbdelete (val, fs_imageindex_rb);
+				Z_Free (data);
+			}
+			rbcloselist (rblist);
+		}
+		rbdestroy (fs_imageindex_rb);
+	}
+
+	fs_imageindex_rb = rbinit ((int (EXPORT *)(const void *, const void *))strcmp, 0);
+	if (!fs_imageindex_rb)
+		Com_Error (ERR_FATAL, "FS_BuildImageIndex: rbinit failed");
+
+	fs_imageindex_count = 0;
+
+	for (search = fs_searchpaths; search; search = search->next)
+	{
+		if (search->pack)
+		{
+			if (search->pack->type != PAK_QUAKE)
+				continue;
+
+			for (val = rblookup (RB_LUFIRST, NULL, search->pack->rb); val; val = rblookup (RB_LUNEXT, val, search->pack->rb))
+				FS_IndexImage (val);
+		}
+		else
+		{
+			FS_IndexDirectory (search->filename, strlen (search->filename) + 1, 0);
+		}
+	}
+
+	fs_imageindex_dirty = false;
+
+	Com_DPrintf ("FS_BuildImageIndex: %d basenames in %u ms\n", fs_imageindex_count, Sys_Milliseconds () - start);
+}
+
+/*
+=================
+FS_ImageExtensions
+
+Returns the FS_EXT_* bits of the image files that exist for basename
+(a path without extension), so the renderer doesn't have to probe for
+replacement textures that aren't there. Every bit is set if the answer
+isn't known, eg the index is disabled or a link covers the path.
+=================
+*/
+int EXPORT FS_ImageExtensions (const char *basename)
+{
+	filelink_t	*link;
+	void		*data;
+	char		lowered[MAX_QPATH];
+
+	if (!fs_imageindex->intvalue)
+		return FS_EXT_ALL;
+
+	if (!fs_noextern->intvalue)
+	{
+		for (link = fs_links; link; link = link->next)
+		{
+			if (!strncmp (basename, link->from, link->fromlength))
+				return FS_EXT_ALL;
+		}
+	}
+
+	if (fs_imageindex_dirty)
+		FS_BuildImageIndex ();
+
+	Q_strncpy (lowered, basename, sizeof(lowered)-1);
+	fast_strlwr (lowered);
+
+	data = rbfind (lowered, fs_imageindex_rb);
+	if (!data)
+		return 0;
+
+	return (*(imageindex_t **)data)->extensions;
+}
+
 /*
 ** FS_Dir_f
 */
@@ -1711,6 +1934,7 @@ void FS_InitFilesystem (void)
 	fs_basedir = Cvar_Get ("basedir", ".", CVAR_NOSET);
 	fs_cache = Cvar_Get ("fs_cache", "7", 0);
 	fs_noextern = Cvar_Get ("fs_noextern", "0", 0);
+	fs_imageindex = Cvar_Get ("fs_imageindex", "1", 0);
 
 	//
 	// start up with baseq2 by default
@@ -72,6 +72,28 @@ If there is no information that needs to be transfered on a given frame,
 such as during the connection stage while waiting for the client to load,
 then a packet only needs to be delivered if there is something in the
 unacknowledged reliable
+
+
+r1: windowed netchan (both ends at MINOR_VERSION_R1Q2_NETCHAN_WINDOW)
+---------------------------------------------------------------------
+The header is the same, but the reliable bit means the packet carries
+[byte count] reliable messages of [short rseq][short length][data] and
+the acknowledge bit means a [short next rseq expected][byte mask] ack
+block follows the header, mask bit n set = rseq+1+n is held already.
+Up to NETCHAN_WINDOW reliable messages may be unacknowledged at once,
+each is resent once an ack block arrives from after the packet it was
+in without the message itself being acknowledged.
+
+
+r1: fragmented packets (both ends at MINOR_VERSION_R1Q2_FRAGMENT)
+-----------------------------------------------------------------
+A packet longer than the largest datagram the other end asked for is
+split up. Every piece repeats the header with NETCHAN_FRAGMENT_BIT set
+in the sequence, then a [short offset] of where its data goes, with
+NETCHAN_FRAGMENT_MORE set on all but the last piece. The receiver puts
+the pieces back together behind the header and handles the result as
+one packet, so the reliable and unreliable parts both ride along. The
+pieces have to arrive in order, if one is lost the whole packet is.
 */
 
 cvar_t		*showpackets;
@@ -79,9 +101,13 @@ cvar_t		*showdrop;
 cvar_t		*qport;
 cvar_t		*net_maxmsglen;
 
+#ifndef DEDICATED_ONLY
+static void Netchan_Test_f (void);
+#endif
+
 netadr_t	net_from;
 sizebuf_t	net_message;
-byte		net_message_buffer[MAX_MSGLEN];
+byte		net_message_buffer[MAX_FRAGMENTED_MSGLEN];
 
 /*
 ===============
@@ -103,6 +129,10 @@ void Netchan_Init (void)
 	qport = Cvar_Get ("qport", "-1", 0);
 
 	net_maxmsglen = Cvar_Get ("net_maxmsglen", "1390", 0);
+
+#ifndef DEDICATED_ONLY
+	Cmd_AddCommand ("netchan_test", Netchan_Test_f);
+#endif
 }
 
 /*
@@ -231,23 +261,272 @@ void Netchan_Setup (netsrc_t sock, netchan_t *chan, netadr_t *adr, int protocol,
 	chan->message.allowoverflow = true;
 }
 
+/*
+==============
+Netchan_EnableWindow
+
+switches a freshly set up netchan to windowed reliable mode. both ends
+must do this, the server announces it with rw=1 in client_connect.
+==============
+*/
+void Netchan_EnableWindow (netchan_t *chan)
+{
+	qboolean	allowoverflow;
+
+	if (!chan->window)
+		chan->window = Z_TagMalloc (sizeof(netwindow_t), TAGMALLOC_NETCHAN);
+
+	memset (chan->window, 0, sizeof(netwindow_t));
+
+	//leave room for the window framing so packets stay within the negotiated size
+	if (chan->message.buffsize > MAX_USABLEMSG - NETCHAN_WINDOW_OVERHEAD)
+	{
+		allowoverflow = chan->message.allowoverflow;
+		SZ_Init (&chan->message, chan->message_buf, MAX_USABLEMSG - NETCHAN_WINDOW_OVERHEAD);
+		chan->message.allowoverflow = allowoverflow;
+	}
+	else
+	{
+		chan->message.maxsize = chan->message.buffsize -= NETCHAN_WINDOW_OVERHEAD;
+	}
+}
+
+/*
+==============
+Netchan_EnableFragments
+
+lets a freshly set up netchan split packets bigger than the negotiated
+size over several datagrams and put such packets back together. both
+ends must do this, the server announces it with nf=1 in client_connect.
+==============
+*/
+void Netchan_EnableFragments (netchan_t *chan)
+{
+	if (!chan->fragments)
+		chan->fragments = Z_TagMalloc (sizeof(netfragment_t), TAGMALLOC_NETCHAN);
+
+	chan->fragments->size = chan->message.buffsize + PACKET_HEADER;
+	if (chan->window)
+		chan->fragments->size += NETCHAN_WINDOW_OVERHEAD;
+
+	if (chan->fragments->size > MAX_MSGLEN)
+		chan->fragments->size = MAX_MSGLEN;
+
+	chan->fragments->sequence = 0;
+	chan->fragments->length = 0;
+}
+
+/*
+==============
+Netchan_Shutdown
+
+frees anything Netchan_EnableWindow / Netchan_EnableFragments allocated
+==============
+*/
+void Netchan_Shutdown (netchan_t *chan)
+{
+	if (chan->window)
+	{
+		Z_Free (chan->window);
+		chan->window = NULL;
+	}
+
+	if (chan->fragments)
+	{
+		Z_Free (chan->fragments);
+		chan->fragments = NULL;
+	}
+}
+
+/*
+==============
+Netchan_CanReliable
+
+true if chan->message will be picked up by the next transmit
+==============
+*/
+qboolean Netchan_CanReliable (netchan_t *chan)
+{
+	if (chan->window)
+		return chan->window->send_next - chan->window->send_head < NETCHAN_WINDOW;
+
+	return !chan->reliable_length;
+}
+
+/*
+==============
+Netchan_UnreliableRoom
+
+the largest unreliable message the next transmit is sure to carry with
+whatever reliable data goes out alongside it. newreliable also leaves
+room for a full chan->message being staged before then. bigger ones make
+Netchan_Transmit bail out with ERR_DROP.
+==============
+*/
+int Netchan_UnreliableRoom (const netchan_t *chan, qboolean newreliable)
+{
+	int		room;
+
+	if (chan->fragments)
+		room = MAX_FRAGMENTED_MSGLEN;
+	else if (chan->protocol == PROTOCOL_R1Q2)
+		room = MAX_MSGLEN;
+	else
+		room = 1400;
+
+	//packet header, ack block and fragment count
+	room -= 16;
+
+	if (chan->window)
+	{
+		//without fragments the reliables already make way for the unreliable part
+		if (chan->fragments)
+			room -= chan->message.buffsize + NETCHAN_WINDOW_OVERHEAD;
+	}
+	else if (chan->reliable_length)
+		room -= chan->reliable_length;
+	else if (newreliable)
+		room -= chan->message.buffsize;
+	else
+		room -= chan->message.cursize;
+
+	return room;
+}
+
+/*
+==============
+Netchan_WantsResend
+
+a windowed reliable needs (re)sending if it never went out, or if the
+other end sent an ack block after seeing the packet it was in without
+acking it. only packets with an ack block count since the block is only
+repeated for a few packets after each reliable; if all of those got lost
+it goes out again after NETCHAN_ACK_TIMEOUT.
+==============
+*/
+static qboolean Netchan_WantsResend (const netchan_t *chan, const netreliable_t *r)
+{
+	if (r->acked)
+		return false;
+
+	if (!r->sent_sequence)
+		return true;
+
+	if (chan->window->ack_sequence >= r->sent_sequence)
+		return true;
+
+	return chan->incoming_acknowledged >= r->sent_sequence && curtime - r->sent_time > NETCHAN_ACK_TIMEOUT;
+}
+
+/*
+==============
+Netchan_UpdateReliableLength
+
+for a windowed netchan, reliable_length is the size of the next reliable
+waiting to go out so callers can reserve room for it like they always have.
+==============
+*/
+static void Netchan_UpdateReliableLength (netchan_t *chan)
+{
+	netwindow_t		*w;
+	netreliable_t	*r;
+	int				rseq;
+
+	w = chan->window;
+
+	chan->reliable_length = 0;
+
+	for (rseq = w->send_head; rseq != w->send_next; rseq++)
+	{
+		r = &w->send[rseq & NETCHAN_WINDOW_MASK];
+		if (Netchan_WantsResend (chan, r))
+		{
+			chan->reliable_length = r->length;
+			break;
+		}
+	}
+}
+
 /*
 ===============
-Netchan_Transmit
+Netchan_TransmitFragments
+
+sends a packet that is too big for one datagram as several, each with a
+copy of the header. the header is the first "header" bytes of packet[0].
+===============
+*/
+static int Netchan_TransmitFragments (netchan_t *chan, const netvec_t *packet, int numpacket, int header)
+{
+	static byte		payload[MAX_FRAGMENTED_MSGLEN];
+	byte			fragment_header[16];
+	netvec_t		fragment[2];
+	int				length, offset, chunk, flags, j;
+
+	//gather everything behind the header
+	length = packet[0].length - header;
+	memcpy (payload, (const byte *)packet[0].data + header, length);
+
+	for (j = 1; j < numpacket; j++)
+	{
+		memcpy (payload + length, packet[j].data, packet[j].length);
+		length += packet[j].length;
+	}
+
+	//same header with the sequence flagged, it's little endian on the wire
+	memcpy (fragment_header, packet[0].data, header);
+	fragment_header[3] |= NETCHAN_FRAGMENT_BIT >> 24;
+
+	fragment[0].data = fragment_header;
+	fragment[0].length = header + 2;
+
+	chunk = chan->fragments->size - header - 2;
+
+	for (offset = 0; offset < length; offset += chunk)
+	{
+		flags = offset;
+		if (offset + chunk < length)
+			flags |= NETCHAN_FRAGMENT_MORE;
+
+		fragment_header[header] = flags & 0xFF;
+		fragment_header[header+1] = (flags >> 8) & 0xFF;
+
+		fragment[1].data = payload + offset;
+		fragment[1].length = (flags & NETCHAN_FRAGMENT_MORE) ? chunk : length - offset;
+
+		if (NET_SendPacketv (chan->sock, fragment, 2, &chan->remote_address) == -1)
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+===============
+Netchan_Transmitv
 
 tries to send an unreliable message to a connection, and handles the
 transmition / retransmition of the reliable messages.
 
-A 0 length will still generate a packet and deal with the reliable messages.
+The unreliable message is given as a list of blocks which are sent
+behind the header and reliable data in a single datagram, so callers
+don't need to assemble a contiguous copy first.
+
+No blocks (or empty ones) will still generate a packet and deal with
+the reliable messages.
 ================
 */
-int Netchan_Transmit (netchan_t *chan, int length, const byte *data)
+int Netchan_Transmitv (netchan_t *chan, const netvec_t *blocks, int numblocks)
 {
-	sizebuf_t	send;
-	byte		send_buf[MAX_MSGLEN];
-	qboolean	send_reliable;
-	uint32		w1, w2;
-	unsigned	i;
+	sizebuf_t		send;
+	byte			send_buf[16];
+	netvec_t		packet[NET_MAX_VECS];
+	netreliable_t	*frags[NETCHAN_WINDOW];
+	int				numpacket, numfrags;
+	int				length, maxsize, unreliable;
+	qboolean		send_reliable, send_ack;
+	uint32			w1, w2;
+	unsigned		i;
+	int				j, header, ret;
 
 	// check for message overflow (this is only for client now ?)
 	if (chan->message.overflowed)
@@ -258,37 +537,106 @@ int Netchan_Transmit (netchan_t *chan, int length, const byte *data)
 		return -2;
 	}
 
-	send_reliable =
-		(
-			(	chan->incoming_acknowledged > chan->last_reliable_sequence &&
-				chan->incoming_reliable_acknowledged != chan->reliable_sequence
-			)
-			||
-			(
-				!chan->reliable_length && chan->message.cursize
-			)
-		);
+	if (numblocks > NETCHAN_MAX_VECS)
+		Com_Error (ERR_FATAL, "Netchan_Transmitv: %d blocks > %d", numblocks, NETCHAN_MAX_VECS);
+
+	unreliable = 0;
+	for (j = 0; j < numblocks; j++)
+		unreliable += blocks[j].length;
+
+	if (chan->fragments)
+		maxsize = MAX_FRAGMENTED_MSGLEN;
+	else if (chan->protocol == PROTOCOL_R1Q2)
+		maxsize = MAX_MSGLEN;
+	else
+		maxsize = 1400;
+
+	numfrags = 0;
+	send_ack = false;
 
-	if (!chan->reliable_length && chan->message.cursize)
+	if (chan->window)
 	{
-		memcpy (chan->reliable_buf, chan->message_buf, chan->message.cursize);
-		chan->reliable_length = chan->message.cursize;
-		chan->message.cursize = 0;
-		chan->reliable_sequence ^= 1;
+		netwindow_t		*w;
+		netreliable_t	*r;
+		int				rseq, budget;
+
+		w = chan->window;
+
+		//stage the pending reliable data as a new message if the window has room
+		if (chan->message.cursize && w->send_next - w->send_head < NETCHAN_WINDOW)
+		{
+			r = &w->send[w->send_next & NETCHAN_WINDOW_MASK];
+			r->rseq = w->send_next++;
+			r->data[0] = r->rseq & 0xFF;
+			r->data[1] = (r->rseq >> 8) & 0xFF;
+			r->data[2] = chan->message.cursize & 0xFF;
+			r->data[3] = (chan->message.cursize >> 8) & 0xFF;
+			memcpy (r->data + 4, chan->message_buf, chan->message.cursize);
+			r->length = chan->message.cursize + 4;
+			r->sent_sequence = 0;
+			r->acked = false;
+			chan->message.cursize = 0;
+		}
+
+		send_ack = (w->ack_repeat > 0);
+
+		//as many reliables as fit in the size the other end asked for. if the
+		//unreliable part has to be fragmented anyway they get a full datagram
+		budget = chan->message.buffsize + NETCHAN_WINDOW_OVERHEAD - 1;
+		if (!chan->fragments || unreliable <= chan->fragments->size)
+			budget -= unreliable;
+		if (send_ack)
+			budget -= 3;
+
+		for (rseq = w->send_head; rseq != w->send_next; rseq++)
+		{
+			r = &w->send[rseq & NETCHAN_WINDOW_MASK];
+			if (!Netchan_WantsResend (chan, r))
+				continue;
+
+			//a fragmenting netchan always makes progress, it can spill over into another datagram
+			if (r->length > budget && (numfrags || !chan->fragments))
+				break;
+
+			budget -= r->length;
+			frags[numfrags++] = r;
+		}
+
+		send_reliable = (numfrags > 0);
+	}
+	else
+	{
+		send_reliable =
+			(
+				(	chan->incoming_acknowledged > chan->last_reliable_sequence &&
+					chan->incoming_reliable_acknowledged != chan->reliable_sequence
+				)
+				||
+				(
+					!chan->reliable_length && chan->message.cursize
+				)
+			);
+
+		if (!chan->reliable_length && chan->message.cursize)
+		{
+			memcpy (chan->reliable_buf, chan->message_buf, chan->message.cursize);
+			chan->reliable_length = chan->message.cursize;
+			chan->message.cursize = 0;
+			chan->reliable_sequence ^= 1;
+		}
 	}
 
 
 // write the packet header
-	if (chan->protocol == PROTOCOL_R1Q2)
-		SZ_Init (&send, send_buf, sizeof(send_buf));
-	else
-		SZ_Init (&send, send_buf, 1400);
+	SZ_Init (&send, send_buf, sizeof(send_buf));
 
 	w1 = ( chan->outgoing_sequence & ~(1<<31) ) | (send_reliable<<31);
-	w2 = ( chan->incoming_sequence & ~(1<<31) ) | (chan->incoming_reliable_sequence<<31);
 
-	chan->outgoing_sequence++;
-	chan->last_sent = curtime;
+	//r1: windowed netchans use the ack bit to flag an ack block instead
+	if (chan->window)
+		w2 = ( chan->incoming_sequence & ~(1<<31) ) | (send_ack<<31);
+	else
+		w2 = ( chan->incoming_sequence & ~(1<<31) ) | (chan->incoming_reliable_sequence<<31);
 
 	SZ_WriteLong (&send, w1);
 	SZ_WriteLong (&send, w2);
@@ -302,49 +650,112 @@ int Netchan_Transmit (netchan_t *chan, int length, const byte *data)
 			SZ_WriteByte (&send, chan->qport);
 	}
 
-// copy the reliable message to the packet first
-	if (send_reliable)
+	header = send.cursize;
+	numpacket = 1;
+
+	if (chan->window)
+	{
+		netwindow_t		*w;
+		unsigned		mask;
+
+		w = chan->window;
+
+		if (send_ack)
+		{
+			//cumulative ack and what we hold past it
+			mask = 0;
+			for (j = 0; j < NETCHAN_WINDOW - 1; j++)
+			{
+				netreliable_t	*r;
+
+				r = &w->recv[(w->recv_next + 1 + j) & NETCHAN_WINDOW_MASK];
+				if (r->length && r->rseq == w->recv_next + 1 + j)
+					mask |= 1 << j;
+			}
+			SZ_WriteShort (&send, w->recv_next & 0xFFFF);
+			SZ_WriteByte (&send, mask);
+			w->ack_repeat--;
+		}
+
+		if (send_reliable)
+		{
+			SZ_WriteByte (&send, numfrags);
+			for (j = 0; j < numfrags; j++)
+			{
+				frags[j]->sent_sequence = chan->outgoing_sequence;
+				frags[j]->sent_time = curtime;
+				packet[numpacket].data = frags[j]->data;
+				packet[numpacket].length = frags[j]->length;
+				numpacket++;
+			}
+		}
+	}
+	else if (send_reliable)
 	{
+		// copy the reliable message to the packet first
 		if (chan->reliable_length)
-			SZ_Write (&send, chan->reliable_buf, chan->reliable_length);
+		{
+			packet[numpacket].data = chan->reliable_buf;
+			packet[numpacket].length = chan->reliable_length;
+			numpacket++;
+		}
 		else
 			Com_DPrintf ("Netchan_Transmit: send_reliable with empty buffer to %s!\n", NET_AdrToString (&chan->remote_address));
-		chan->last_reliable_sequence = chan->outgoing_sequence;
+		chan->last_reliable_sequence = chan->outgoing_sequence + 1;
 	}
-	
+
+	chan->outgoing_sequence++;
+	chan->last_sent = curtime;
+
+	packet[0].data = send_buf;
+	packet[0].length = send.cursize;
+
+	length = 0;
+	for (j = 0; j < numpacket; j++)
+		length += packet[j].length;
+
 // add the unreliable part if space is available
-	if (send.maxsize - send.cursize >= length)
+	if (length + unreliable > maxsize)
 	{
-		if (length)
-		{
-			SZ_Write (&send, data, length);
-		}
+		//Com_Printf ("Netchan_Transmit: dumped unreliable to %s (max %d - cur %d >= un %d (r=%d))\n", LOG_NET, NET_AdrToString(&chan->remote_address), send.maxsize, send.cursize, length, chan->reliable_length);
+		Com_Error (ERR_DROP, "Netchan_Transmit: reliable %d + unreliable %d > maxsize %d (this should not happen!)", length, unreliable, maxsize);
 	}
-	else
+
+	for (j = 0; j < numblocks; j++)
 	{
-		//Com_Printf ("Netchan_Transmit: dumped unreliable to %s (max %d - cur %d >= un %d (r=%d))\n", LOG_NET, NET_AdrToString(&chan->remote_address), send.maxsize, send.cursize, length, chan->reliable_length);
-		Com_Error (ERR_DROP, "Netchan_Transmit: reliable %d + unreliable %d > maxsize %d (this should not happen!)", send.cursize, length, send.maxsize);
+		if (blocks[j].length)
+			packet[numpacket++] = blocks[j];
 	}
 
+	length += unreliable;
+
 // send the datagram
 	for (i = 0; i <= chan->packetdup; i++)
 	{
-		if (NET_SendPacket (chan->sock, send.cursize, send_buf, &chan->remote_address) == -1)
+		if (chan->fragments && length > chan->fragments->size)
+			ret = Netchan_TransmitFragments (chan, packet, numpacket, header);
+		else
+			ret = NET_SendPacketv (chan->sock, packet, numpacket, &chan->remote_address);
+
+		if (ret == -1)
 			return -1;
 	}
 
+	if (chan->window)
+		Netchan_UpdateReliableLength (chan);
+
 	if (showpackets->intvalue)
 	{
 		if (send_reliable)
 			Com_Printf ("send %4i : s=%i reliable=%i ack=%i rack=%i\n", LOG_NET
-				, send.cursize
+				, length
 				, chan->outgoing_sequence - 1
-				, chan->reliable_sequence
+				, chan->window ? numfrags : chan->reliable_sequence
 				, chan->incoming_sequence
 				, chan->incoming_reliable_sequence);
 		else
 			Com_Printf ("send %4i : s=%i ack=%i rack=%i\n", LOG_NET
-				, send.cursize
+				, length
 				, chan->outgoing_sequence - 1
 				, chan->incoming_sequence
 				, chan->incoming_reliable_sequence);
@@ -353,6 +764,208 @@ int Netchan_Transmit (netchan_t *chan, int length, const byte *data)
 	return 0;
 }
 
+/*
+===============
+Netchan_Transmit
+
+Netchan_Transmitv for a single contiguous unreliable message.
+================
+*/
+int Netchan_Transmit (netchan_t *chan, int length, const byte *data)
+{
+	netvec_t	block;
+
+	block.data = data;
+	block.length = length;
+
+	return Netchan_Transmitv (chan, &block, 1);
+}
+
+/*
+=================
+Netchan_ProcessWindow
+
+reads the ack block and reliable messages of a windowed netchan packet.
+reliables that are next in order are moved in front of the unreliable
+data so the parser sees the same layout as a classic netchan, anything
+that arrived early waits in the window.
+=================
+*/
+static qboolean Netchan_ProcessWindow (netchan_t *chan, sizebuf_t *msg, qboolean has_reliable, qboolean has_ack)
+{
+	static byte		payload[MAX_FRAGMENTED_MSGLEN];
+	netwindow_t		*w;
+	netreliable_t	*r;
+	int				header, count, rseq, len, diff, length, tail, i;
+	unsigned		mask;
+
+	w = chan->window;
+
+	header = msg->readcount;
+
+	chan->got_reliable = false;
+
+	if (has_ack)
+	{
+		rseq = w->send_head + (int16)((uint16)MSG_ReadShort (msg) - (uint16)w->send_head);
+		mask = MSG_ReadByte (msg);
+
+		w->ack_sequence = chan->incoming_acknowledged;
+
+		for (i = w->send_head; i != w->send_next; i++)
+		{
+			diff = i - rseq;
+			if (diff < 0 || (diff > 0 && diff < NETCHAN_WINDOW && (mask & (1 << (diff-1)))))
+				w->send[i & NETCHAN_WINDOW_MASK].acked = true;
+		}
+
+		while (w->send_head != w->send_next && w->send[w->send_head & NETCHAN_WINDOW_MASK].acked)
+		{
+			w->send[w->send_head & NETCHAN_WINDOW_MASK].length = 0;
+			w->send_head++;
+		}
+	}
+
+	if (has_reliable)
+	{
+		count = MSG_ReadByte (msg);
+		for (i = 0; i < count; i++)
+		{
+			rseq = (uint16)MSG_ReadShort (msg);
+			len = (uint16)MSG_ReadShort (msg);
+
+			if (!len || len > MAX_USABLEMSG || msg->readcount + len > msg->cursize)
+			{
+				Com_DPrintf ("%s:Bad reliable message length %d\n", NET_AdrToString (&chan->remote_address), len);
+				return false;
+			}
+
+			diff = (int16)(rseq - (uint16)w->recv_next);
+			if (diff >= 0 && diff < NETCHAN_WINDOW)
+			{
+				r = &w->recv[(w->recv_next + diff) & NETCHAN_WINDOW_MASK];
+				if (!r->length)
+				{
+					r->rseq = w->recv_next + diff;
+					r->length = len;
+					memcpy (r->data, msg->data + msg->readcount, len);
+				}
+			}
+
+			msg->readcount += len;
+		}
+
+		//ack it (again, in case it was a resend because our ack got lost)
+		w->ack_repeat = NETCHAN_ACK_REPEAT;
+		chan->got_reliable = true;
+	}
+
+	if (msg->readcount > msg->cursize)
+	{
+		Com_DPrintf ("%s:Runt windowed packet\n", NET_AdrToString (&chan->remote_address));
+		return false;
+	}
+
+	r = &w->recv[w->recv_next & NETCHAN_WINDOW_MASK];
+	if (!r->length || r->rseq != w->recv_next)
+		return true;
+
+	//reliables in order, then the unreliable part of this packet
+	tail = msg->cursize - msg->readcount;
+	length = 0;
+
+	while (r->length && r->rseq == w->recv_next)
+	{
+		if (header + length + r->length + tail > msg->maxsize)
+			break;
+
+		memcpy (payload + length, r->data, r->length);
+		length += r->length;
+
+		r->length = 0;
+		w->recv_next++;
+		r = &w->recv[w->recv_next & NETCHAN_WINDOW_MASK];
+	}
+
+	memcpy (payload + length, msg->data + msg->readcount, tail);
+	length += tail;
+
+	memcpy (msg->data + header, payload, length);
+	msg->cursize = header + length;
+	msg->readcount = header;
+
+	return true;
+}
+
+/*
+=================
+Netchan_Reassemble
+
+adds a piece of a fragmented packet, msg->readcount is just past the
+header. once the last piece is in, the whole packet is put into msg
+behind the header and true is returned.
+=================
+*/
+static qboolean Netchan_Reassemble (netchan_t *chan, sizebuf_t *msg, uint32 sequence)
+{
+	netfragment_t	*f;
+	int				header, offset, length;
+	qboolean		more;
+
+	f = chan->fragments;
+
+	offset = (uint16)MSG_ReadShort (msg);
+	more = (offset & NETCHAN_FRAGMENT_MORE) ? true : false;
+	offset &= ~NETCHAN_FRAGMENT_MORE;
+
+	if (msg->readcount > msg->cursize)
+	{
+		Com_DPrintf ("%s:Runt fragment\n", NET_AdrToString (&chan->remote_address));
+		return false;
+	}
+
+	if (sequence != f->sequence)
+	{
+		f->sequence = sequence;
+		f->length = 0;
+	}
+
+	//pieces come in order, a gap means one got lost and so did the packet
+	if (offset != f->length)
+	{
+		if (showdrop->intvalue)
+			Com_Printf ("%s:Dropped fragment at %i of %i\n", LOG_NET
+				, NET_AdrToString (&chan->remote_address)
+				, offset
+				, sequence);
+		return false;
+	}
+
+	length = msg->cursize - msg->readcount;
+	header = msg->readcount - 2;
+
+	if (f->length + length > sizeof(f->data) || header + f->length + length > msg->maxsize)
+	{
+		Com_DPrintf ("%s:Oversize fragmented packet\n", NET_AdrToString (&chan->remote_address));
+		f->length = 0;
+		return false;
+	}
+
+	memcpy (f->data + f->length, msg->data + msg->readcount, length);
+	f->length += length;
+
+	if (more)
+		return false;
+
+	memcpy (msg->data + header, f->data, f->length);
+	msg->cursize = header + f->length;
+	msg->readcount = header;
+
+	f->length = 0;
+
+	return true;
+}
+
 /*
 =================
 Netchan_Process
@@ -366,6 +979,7 @@ qboolean Netchan_Process (netchan_t *chan, sizebuf_t *msg)
 	uint32		sequence, sequence_ack;
 	int32		reliable_ack;
 	uint32		reliable_message;
+	qboolean	fragmented;
 
 	// get sequence numbers		
 	MSG_BeginReading (msg);
@@ -391,6 +1005,16 @@ qboolean Netchan_Process (netchan_t *chan, sizebuf_t *msg)
 	sequence &= ~(1<<31);
 	sequence_ack &= ~(1<<31);	
 
+	if (chan->fragments)
+	{
+		fragmented = (sequence & NETCHAN_FRAGMENT_BIT) ? true : false;
+		sequence &= ~NETCHAN_FRAGMENT_BIT;
+	}
+	else
+	{
+		fragmented = false;
+	}
+
 	if (showpackets->intvalue)
 	{
 		if (reliable_message)
@@ -422,6 +1046,10 @@ qboolean Netchan_Process (netchan_t *chan, sizebuf_t *msg)
 		return false;
 	}
 
+	//r1: nothing more to do until the whole packet is here
+	if (fragmented && !Netchan_Reassemble (chan, msg, sequence))
+		return false;
+
 //
 // dropped packets don't keep the message from being used
 //
@@ -439,6 +1067,19 @@ qboolean Netchan_Process (netchan_t *chan, sizebuf_t *msg)
 	chan->total_received++;
 	chan->total_dropped += chan->dropped;
 
+	chan->incoming_sequence = sequence;
+	chan->incoming_acknowledged = sequence_ack;
+	chan->last_received = curtime;
+
+	if (chan->window)
+	{
+		if (!Netchan_ProcessWindow (chan, msg, reliable_message, reliable_ack))
+			return false;
+
+		Netchan_UpdateReliableLength (chan);
+		return true;
+	}
+
 //
 // if the current outgoing reliable message has been acknowledged
 // clear the buffer to make way for the next
@@ -449,8 +1090,6 @@ qboolean Netchan_Process (netchan_t *chan, sizebuf_t *msg)
 //
 // if this message contains a reliable message, bump incoming_reliable_sequence 
 //
-	chan->incoming_sequence = sequence;
-	chan->incoming_acknowledged = sequence_ack;
 	chan->incoming_reliable_acknowledged = reliable_ack;
 	if (reliable_message)
 	{
@@ -461,7 +1100,206 @@ qboolean Netchan_Process (netchan_t *chan, sizebuf_t *msg)
 // the message can now be read from the current message pointer
 //
 
-	chan->last_received = curtime;
-
 	return true;
 }
+
+#ifndef DEDICATED_ONLY
+/*
+=================
+Netchan_TestRun
+
+pushes "messages" reliable messages of 100 bytes from a server netchan to a
+client netchan over the loopback (so net_sim_* apply) using simulated time.
+the server sends every 100ms like a 10fps server, the client every 10ms.
+each server packet also carries "unreliable" bytes of filler, "arrived"
+counts the packets whose filler made it. returns simulated msec until all
+reliables arrived in order, or -1.
+=================
+*/
+static int Netchan_TestRun (qboolean windowed, qboolean fragments, int messages, int unreliable, int *packets, int *arrived)
+{
+	static byte	filler[MAX_FRAGMENTED_MSGLEN - MAX_MSGLEN];
+	static byte	recv_buf[MAX_FRAGMENTED_MSGLEN];
+	netchan_t	*server, *client;
+	sizebuf_t	recv;
+	byte		data[100];
+	netadr_t	adr, from;
+	unsigned	start;
+	int			sent, received, index, msec, result, i;
+
+	server = Z_TagMalloc (sizeof(netchan_t) * 2, TAGMALLOC_NETCHAN);
+	client = server + 1;
+
+	memset (&adr, 0, sizeof(adr));
+	adr.type = NA_LOOPBACK;
+
+	Netchan_Setup (NS_SERVER, server, &adr, PROTOCOL_R1Q2, 0, 1390);
+	Netchan_Setup (NS_CLIENT, client, &adr, PROTOCOL_R1Q2, 0, 0);
+
+	if (windowed)
+	{
+		Netchan_EnableWindow (server);
+		Netchan_EnableWindow (client);
+	}
+
+	if (fragments)
+	{
+		Netchan_EnableFragments (server);
+		Netchan_EnableFragments (client);
+	}
+
+	//filler is whole 100 byte records with index -1 so the reader can skip them
+	for (i = 0; i + sizeof(data) <= unreliable; i += sizeof(data))
+	{
+		*(int *)(filler + i) = LittleLong (-1);
+		memset (filler + i + 4, 0xAA, sizeof(data) - 4);
+	}
+
+	SZ_Init (&recv, recv_buf, sizeof(recv_buf));
+
+	start = curtime;
+	sent = received = 0;
+	*packets = *arrived = 0;
+	result = -1;
+
+	for (msec = 0; msec < 600000; msec += 10)
+	{
+		curtime = start + msec;
+
+		//server takes acks and sends
+		while (NET_GetPacket (NS_SERVER, &from, &recv) > 0)
+			Netchan_Process (server, &recv);
+
+		if (!(msec % 100))
+		{
+			if (Netchan_CanReliable (server))
+			{
+				while (sent < messages && server->message.cursize + sizeof(data) <= server->message.maxsize)
+				{
+					*(int *)data = LittleLong (sent);
+					memset (data + 4, sent & 0xFF, sizeof(data) - 4);
+					SZ_Write (&server->message, data, sizeof(data));
+					sent++;
+				}
+			}
+			Netchan_Transmit (server, unreliable, filler);
+			(*packets)++;
+		}
+
+		//client checks what it got arrives complete and in order
+		while (NET_GetPacket (NS_CLIENT, &from, &recv) > 0)
+		{
+			if (!Netchan_Process (client, &recv))
+				continue;
+
+			i = 0;
+			while (recv.readcount < recv.cursize)
+			{
+				index = MSG_ReadLong (&recv);
+				MSG_ReadData (&recv, data + 4, sizeof(data) - 4);
+				if (index == -1 && data[4] == 0xAA && data[sizeof(data)-1] == 0xAA)
+				{
+					i += sizeof(data);
+					continue;
+				}
+				if (index != received || data[4] != (index & 0xFF) || data[sizeof(data)-1] != (index & 0xFF))
+				{
+					Com_Printf ("netchan_test: expected message %d, got %d!\n", LOG_GENERAL, received, index);
+					goto done;
+				}
+				received++;
+			}
+
+			if (unreliable && i == unreliable)
+				(*arrived)++;
+		}
+
+		Netchan_Transmit (client, 0, NULL);
+
+		if (received == messages)
+		{
+			result = msec;
+			break;
+		}
+	}
+
+done:
+	//drain whatever is still in flight so it doesn't leak into the next run
+	curtime = start + 1200000;
+	while (NET_GetPacket (NS_SERVER, &from, &recv) > 0);
+	while (NET_GetPacket (NS_CLIENT, &from, &recv) > 0);
+
+	Netchan_Shutdown (server);
+	Netchan_Shutdown (client);
+	Z_Free (server);
+
+	curtime = start;
+
+	return result;
+}
+
+/*
+=================
+Netchan_Test_f
+
+netchan_test [loss%] [latency] [messages] [fragmented bytes]
+=================
+*/
+static void Netchan_Test_f (void)
+{
+	char	oldloss[16], oldlatency[16];
+	int		messages, unreliable, result, packets, arrived;
+
+	if (Com_ServerState ())
+	{
+		Com_Printf ("netchan_test uses the loopback, it can't run while a local server is active.\n", LOG_GENERAL);
+		return;
+	}
+
+	//it drains the client socket too, that would eat a remote server's packets
+	if (!CL_Disconnected ())
+	{
+		Com_Printf ("netchan_test can't run while connected, disconnect first.\n", LOG_GENERAL);
+		return;
+	}
+
+	messages = 500;
+	if (Cmd_Argc() > 3)
+		messages = atoi (Cmd_Argv(3));
+
+	unreliable = 6000;
+	if (Cmd_Argc() > 4)
+		unreliable = atoi (Cmd_Argv(4));
+
+	if (unreliable < 0)
+		unreliable = 0;
+	else if (unreliable > MAX_FRAGMENTED_MSGLEN - MAX_MSGLEN)
+		unreliable = MAX_FRAGMENTED_MSGLEN - MAX_MSGLEN;
+
+	//whole filler records only
+	unreliable -= unreliable % 100;
+
+	Q_strncpy (oldloss, Cvar_VariableString ("net_sim_loss"), sizeof(oldloss)-1);
+	Q_strncpy (oldlatency, Cvar_VariableString ("net_sim_latency"), sizeof(oldlatency)-1);
+
+	Cvar_Set ("net_sim_loss", Cmd_Argc() > 1 ? Cmd_Argv(1) : "5");
+	Cvar_Set ("net_sim_latency", Cmd_Argc() > 2 ? Cmd_Argv(2) : "100");
+
+	Com_Printf ("%d reliable messages, %s%% loss, %sms latency each way:\n", LOG_GENERAL, messages, Cvar_VariableString ("net_sim_loss"), Cvar_VariableString ("net_sim_latency"));
+
+	result = Netchan_TestRun (false, false, messages, 0, &packets, &arrived);
+	Com_Printf ("classic:    %6d ms, %d server packets\n", LOG_GENERAL, result, packets);
+
+	result = Netchan_TestRun (true, false, messages, 0, &packets, &arrived);
+	Com_Printf ("windowed:   %6d ms, %d server packets\n", LOG_GENERAL, result, packets);
+
+	if (unreliable)
+	{
+		result = Netchan_TestRun (true, true, messages, unreliable, &packets, &arrived);
+		Com_Printf ("fragmented: %6d ms, %d server packets, %d with %d unreliable bytes arrived whole\n", LOG_GENERAL, result, packets, arrived, unreliable);
+	}
+
+	Cvar_Set ("net_sim_loss", oldloss);
+	Cvar_Set ("net_sim_latency", oldlatency);
+}
+#endif
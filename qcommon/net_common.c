@@ -29,6 +29,13 @@ int _true = 1;
 
 static	cvar_t	*net_ignore_icmp;
 
+#ifndef DEDICATED_ONLY
+//r1: loopback link simulation, for testing netcode without a real network
+static	cvar_t	*net_sim_loss;
+static	cvar_t	*net_sim_latency;
+static	cvar_t	*net_sim_bandwidth;
+#endif
+
 void Net_Restart_f (void);
 void Net_Stats_f (void);
 
@@ -39,6 +46,17 @@ void NET_Common_Init (void)
 {
 	net_ignore_icmp = Cvar_Get ("net_ignore_icmp", "0", 0);
 
+#ifndef DEDICATED_ONLY
+	net_sim_loss = Cvar_Get ("net_sim_loss", "0", 0);
+	net_sim_loss->help = "Percentage of loopback packets to drop, for testing the netcode.\n";
+
+	net_sim_latency = Cvar_Get ("net_sim_latency", "0", 0);
+	net_sim_latency->help = "Milliseconds to hold loopback packets before delivering them, for testing the netcode.\n";
+
+	net_sim_bandwidth = Cvar_Get ("net_sim_bandwidth", "0", 0);
+	net_sim_bandwidth->help = "Bytes per second each direction of the loopback can carry, 0 = unlimited. Packets queue up behind each other like on a congested link and are dropped once the queue is full, for testing the netcode.\n";
+#endif
+
 	Cmd_AddCommand ("net_restart", Net_Restart_f);
 	Cmd_AddCommand ("net_stats", Net_Stats_f);
 }
@@ -352,18 +370,21 @@ void Net_Restart_f (void)
 
 #ifndef DEDICATED_ONLY
 
-#define	MAX_LOOPBACK	4
+//r1: enough to hold a few hundred msec of client packets for net_sim_latency
+#define	MAX_LOOPBACK	64
 
 typedef struct
 {
-	byte	data[MAX_MSGLEN];
-	int		datalen;
+	byte		data[MAX_MSGLEN];
+	int			datalen;
+	unsigned	delivertime;
 } loopmsg_t;
 
 typedef struct
 {
 	loopmsg_t	msgs[MAX_LOOPBACK];
 	int			get, send;
+	unsigned	linkfree;		// when net_sim_bandwidth is done with what's queued
 } loopback_t;
 
 loopback_t	loopbacks[2];
@@ -382,6 +403,11 @@ qboolean	NET_GetLoopPacket (netsrc_t sock, netadr_t *net_from, sizebuf_t *net_me
 		return false;
 
 	i = loop->get & (MAX_LOOPBACK-1);
+
+	//latency is constant and the link is first in first out, so the oldest packet is always the first due
+	if ((int)(loop->msgs[i].delivertime - curtime) > 0)
+		return false;
+
 	loop->get++;
 
 	memcpy (net_message->data, loop->msgs[i].data, loop->msgs[i].datalen);
@@ -396,20 +422,61 @@ qboolean	NET_GetLoopPacket (netsrc_t sock, netadr_t *net_from, sizebuf_t *net_me
 }
 
 
-void NET_SendLoopPacket (netsrc_t sock, int length, const void *data)
+void NET_SendLoopPacketv (netsrc_t sock, const netvec_t *blocks, int numblocks)
 {
-	int		i;
+	int		i, j, length;
 	loopback_t	*loop;
 
+	if (net_sim_loss->value && random() * 100.0f < net_sim_loss->value)
+		return;
+
 	loop = &loopbacks[sock^1];
 
+	length = 0;
+	for (j = 0; j < numblocks; j++)
+		length += blocks[j].length;
+
+	if (net_sim_bandwidth->intvalue > 0)
+	{
+		//bottleneck queue is full, drop at the tail like a router would
+		if (loop->send - loop->get >= MAX_LOOPBACK)
+			return;
+
+		//nothing queued means the link is idle
+		if (loop->get == loop->send || (int)(loop->linkfree - curtime) < 0)
+			loop->linkfree = curtime;
+
+		loop->linkfree += length * 1000 / net_sim_bandwidth->intvalue;
+	}
+	else
+	{
+		loop->linkfree = curtime;
+	}
+
 	i = loop->send & (MAX_LOOPBACK-1);
 	loop->send++;
 
-	memcpy (loop->msgs[i].data, data, length);
+	loop->msgs[i].delivertime = loop->linkfree + net_sim_latency->intvalue;
+
+	length = 0;
+	for (j = 0; j < numblocks; j++)
+	{
+		memcpy (loop->msgs[i].data + length, blocks[j].data, blocks[j].length);
+		length += blocks[j].length;
+	}
 	loop->msgs[i].datalen = length;
 }
 
+void NET_SendLoopPacket (netsrc_t sock, int length, const void *data)
+{
+	netvec_t	block;
+
+	block.data = data;
+	block.length = length;
+
+	NET_SendLoopPacketv (sock, &block, 1);
+}
+
 #endif
 
 int NET_Client_Sleep (int msec)
@@ -302,11 +302,26 @@ PROTOCOL
 #define	PROTOCOL_ORIGINAL	34
 #define	PROTOCOL_R1Q2		35
 
-#define	MINOR_VERSION_R1Q2				1905
+#define	MINOR_VERSION_R1Q2				1908
 
 //minimum versions for some features
 #define MINOR_VERSION_R1Q2_UCMD_UPDATES	1904
 #define	MINOR_VERSION_R1Q2_32BIT_SOLID	1905
+#define	MINOR_VERSION_R1Q2_ZSTREAM		1906
+#define	MINOR_VERSION_R1Q2_NETCHAN_WINDOW	1907
+#define	MINOR_VERSION_R1Q2_FRAGMENT		1908
+
+//r1: svc_zpacket extrabits for MINOR_VERSION_R1Q2_ZSTREAM. a referenced zpacket
+//carries a [byte] distance back to the netchan sequence whose zpacket contents
+//form the deflate dictionary (0 = none), the preset bit primes the window with
+//ZLibFrameDictionary first. the receiver keeps every referenced zpacket it
+//inflates for ZFRAME_BACKUP sequences.
+#define	ZPACKET_REFERENCED				0x20
+#define	ZPACKET_PRESET					0x40
+
+#define	ZFRAME_BACKUP					16
+#define	ZFRAME_MASK						(ZFRAME_BACKUP-1)
+#define	MAX_ZFRAME						4096
 
 //=========================================
 
@@ -571,6 +586,9 @@ void Cbuf_Execute (void);
 #ifndef NO_ZLIB
 int ZLibCompressChunk(byte *in, int len_in, byte *out, int len_out, int method, int wbits);
 int ZLibDecompress (byte *in, int inlen, byte /*@out@*/*out, int outlen, int wbits);
+int ZLibCompressStream (const byte *dict, int dictlen, byte *in, int len_in, byte *out, int len_out, int method);
+int ZLibDecompressStream (const byte *dict, int dictlen, byte *in, int inlen, byte /*@out@*/*out, int outlen);
+const byte *ZLibFrameDictionary (int *len);
 #endif
 /*
 
@@ -702,6 +720,7 @@ char	*Cvar_Serverinfo (void);
 // returns an info string containing all the CVAR_SERVERINFO cvars
 
 extern	qboolean	userinfo_modified;
+extern	uint32		serverinfo_modified_count;
 // this is set each time a CVAR_USERINFO variable is changed
 // so that the client knows to send it to the server
 
@@ -721,6 +740,7 @@ NET
 #define	MAX_MSGLEN		4096		// udp fragmentation isn't so bad these days
 #define	PACKET_HEADER	10			// two ints and a short
 #define	MAX_USABLEMSG	MAX_MSGLEN - PACKET_HEADER
+#define	MAX_FRAGMENTED_MSGLEN	32768	// largest packet a fragmenting netchan puts back together
 
 typedef enum {NA_LOOPBACK, NA_BROADCAST, NA_IP} netadrtype_t;
 
@@ -742,7 +762,17 @@ void		NET_Shutdown (void);
 int			NET_Config (int openFlags);
 
 int			NET_GetPacket (netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message);
+//r1: one piece of a datagram for gathered sends
+typedef struct netvec_s
+{
+	const void	*data;
+	int			length;
+} netvec_t;
+
+#define	NET_MAX_VECS	16
+
 int			NET_SendPacket (netsrc_t sock, int length, const void *data, netadr_t *to);
+int			NET_SendPacketv (netsrc_t sock, const netvec_t *blocks, int numblocks, netadr_t *to);
 
 #define NET_IsLocalAddress(x) \
 	((x)->ip[0] == 127)
@@ -815,26 +845,85 @@ typedef struct
 	unsigned	total_dropped;
 	unsigned	total_received;
 	unsigned	packetdup;
+
+	//r1: sliding reliable window, NULL for a classic one-at-a-time netchan
+	struct netwindow_s	*window;
+
+	//r1: reassembly of fragmented packets, NULL if the other end can't do it
+	struct netfragment_s	*fragments;
 } netchan_t;
 
+//r1: windowed reliable netchan (MINOR_VERSION_R1Q2_NETCHAN_WINDOW). each packet may
+//carry several reliable messages, each with its own 16 bit sequence. the receiver
+//returns a cumulative ack plus a bitmask of what it holds beyond that.
+#define	NETCHAN_WINDOW				8
+#define	NETCHAN_WINDOW_MASK			(NETCHAN_WINDOW-1)
+#define	NETCHAN_WINDOW_OVERHEAD		8		// ack block, fragment count and one fragment header
+#define	NETCHAN_ACK_REPEAT			4		// packets an ack block is repeated in after a reliable arrives
+#define	NETCHAN_ACK_TIMEOUT			1000	// msec before a reliable is resent if every ack block for it got lost
+
+typedef struct
+{
+	int			rseq;
+	int			length;			// 0 = free slot
+	int			sent_sequence;	// outgoing_sequence it last went out in, 0 = not yet
+	unsigned	sent_time;
+	qboolean	acked;
+	byte		data[4 + MAX_USABLEMSG];	// sending side keeps the [short rseq][short length] header in front
+} netreliable_t;
+
+typedef struct netwindow_s
+{
+	int				send_head;		// oldest unacknowledged rseq
+	int				send_next;		// rseq of the next new message
+	int				ack_sequence;	// our newest packet the other end had seen when it last sent an ack block
+	netreliable_t	send[NETCHAN_WINDOW];
+
+	int				recv_next;		// next rseq to hand to the parser
+	int				ack_repeat;		// packets that should still carry our ack block
+	netreliable_t	recv[NETCHAN_WINDOW];
+} netwindow_t;
+
+//r1: fragmenting netchan (MINOR_VERSION_R1Q2_FRAGMENT). a packet bigger than one
+//datagram goes out as several with the same sequence and bit 30 of it set. each
+//has a [short offset] after the header (NETCHAN_FRAGMENT_MORE set on all but the
+//last) followed by its slice of everything that would have come after the header.
+#define	NETCHAN_FRAGMENT_BIT		(1<<30)
+#define	NETCHAN_FRAGMENT_MORE		0x8000
+
+typedef struct netfragment_s
+{
+	int			size;			// largest datagram we send whole
+	int			sequence;		// packet being put back together
+	int			length;
+	byte		data[MAX_FRAGMENTED_MSGLEN];
+} netfragment_t;
+
 extern	netadr_t	net_from;
 extern	sizebuf_t	net_message;
-extern	byte		net_message_buffer[MAX_MSGLEN];
+extern	byte		net_message_buffer[MAX_FRAGMENTED_MSGLEN];
 
 
 void Netchan_Init (void);
 void Netchan_Setup (netsrc_t sock, netchan_t *chan, netadr_t *adr, int protocol, int qport, unsigned msglen);
 
+void Netchan_EnableWindow (netchan_t *chan);
+void Netchan_EnableFragments (netchan_t *chan);
+void Netchan_Shutdown (netchan_t *chan);
+qboolean Netchan_CanReliable (netchan_t *chan);
+int Netchan_UnreliableRoom (const netchan_t *chan, qboolean newreliable);
+
 qboolean Netchan_NeedReliable (netchan_t *chan);
 int	 Netchan_Transmit (netchan_t *chan, int length, const byte /*@null@*/*data);
+//the header and up to NETCHAN_WINDOW reliable messages take the other netvecs
+#define	NETCHAN_MAX_VECS	(NET_MAX_VECS-1-NETCHAN_WINDOW)
+int	 Netchan_Transmitv (netchan_t *chan, const netvec_t *blocks, int numblocks);
 void Netchan_OutOfBand (int net_socket, netadr_t *adr, int length, const byte *data);
 void Netchan_OutOfBandPrint (int net_socket, netadr_t *adr, const char *format, ...);
 void Netchan_OutOfBandProxy (int net_socket, netadr_t *adr, int length, const byte *data);
 void Netchan_OutOfBandProxyPrint (int net_socket, netadr_t *adr, const char *format, ...);
 qboolean Netchan_Process (netchan_t *chan, sizebuf_t *msg);
 
-//qboolean Netchan_CanReliable (netchan_t *chan);
-
 
 /*
 ==============================================================
@@ -977,6 +1066,16 @@ void	EXPORT FS_Read (void *buffer, int len, FILE *f);
 
 void	EXPORT FS_FreeFile (void *buffer);
 
+//r1: image formats FS_ImageExtensions reports for a basename
+#define	FS_EXT_PCX	0x01
+#define	FS_EXT_WAL	0x02
+#define	FS_EXT_TGA	0x04
+#define	FS_EXT_PNG	0x08
+#define	FS_EXT_JPG	0x10
+#define	FS_EXT_ALL	0x1F
+
+int		EXPORT FS_ImageExtensions (const char *basename);
+
 void	FS_CreatePath (char *path);
 
 int		Sys_FileLength (const char *path);
@@ -1043,6 +1142,7 @@ extern	cvar_t	*dbg_unload;
 // host_speeds times
 extern	unsigned int		time_before_game;
 extern	unsigned int		time_after_game;
+extern	unsigned int		time_status;
 extern	unsigned int		time_before_ref;
 extern	unsigned int		time_after_ref;
 
@@ -1088,6 +1188,9 @@ enum tagmalloc_tags_e
 	TAGMALLOC_CMDBANS,
 	TAGMALLOC_REDBLACK,
 	TAGMALLOC_LRCON,
+	TAGMALLOC_CONNECTCACHE,
+	TAGMALLOC_CLIENT_ZFRAMES,
+	TAGMALLOC_NETCHAN,
 #ifdef ANTICHEAT
 	TAGMALLOC_ANTICHEAT,
 #endif
@@ -1178,6 +1281,42 @@ void	Sys_SetWindowText(char *buff);
 void	Sys_ProcessTimes_f (void);
 void	Sys_Spinstats_f (void);
 
+//r1: for benchmarks, only the difference between two calls means anything
+uint64	Sys_Microseconds (void);
+
+//r1: background threads for work that mustn't stall frames. returns NULL
+//if a thread couldn't be started, callers should then do the work inline.
+typedef void (*threadfunc_t)(void *param);
+void	*Sys_CreateThread (threadfunc_t func, void *param);
+void	Sys_WaitThread (void *thread);
+
+//r1: orders memory accesses around data shared with such a thread.
+//Sys_CompareExchange stores exchange in *dest if it holds comparand and
+//returns the previous value either way.
+#if defined(__GNUC__)
+#define	Sys_MemoryBarrier()	__sync_synchronize()
+#define	Sys_CompareExchange(dest,exchange,comparand)	__sync_val_compare_and_swap((dest),(comparand),(exchange))
+#elif defined(_MSC_VER)
+#include <intrin.h>
+//r1: a real fence, not just _ReadWriteBarrier. lives in q_shwin.c as
+//MemoryBarrier needs windows.h.
+void	Sys_MemoryBarrier (void);
+#define	Sys_CompareExchange(dest,exchange,comparand)	_InterlockedCompareExchange((volatile long *)(dest),(exchange),(comparand))
+#endif
+
+//r1: index of the lowest set bit, x must not be 0
+#if defined(__GNUC__)
+#define	Q_LowestBit(x)	__builtin_ctz(x)
+#elif defined(_MSC_VER)
+static __inline int Q_LowestBit (unsigned long x)
+{
+	unsigned long	index;
+
+	_BitScanForward (&index, x);
+	return (int)index;
+}
+#endif
+
 /*
 ==============================================================
 
@@ -1188,6 +1327,7 @@ CLIENT / SERVER SYSTEMS
 
 void CL_Init (void);
 void CL_Drop (qboolean skipdisconnect, qboolean nonerror);
+qboolean CL_Disconnected (void);
 void CL_Shutdown (void);
 void CL_Frame (int msec);
 void Con_Print (const char *text);
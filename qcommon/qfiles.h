@@ -478,6 +478,37 @@ typedef struct
 	int32		firstareaportal;
 } PACKED_STRUCT darea_t;
 
+/*
+========================================================================
+
+.DM2.IDX demo index file format
+
+Written next to a demo while it is recorded. Each keyframe carries a
+full snapshot of the client's state as ordinary demo messages, so
+playback can jump to it without parsing what came before.
+
+========================================================================
+*/
+
+#define IDDEMOINDEXHEADER	(('I'<<24)+('D'<<16)+('1'<<8)+'R')
+		// little-endian "R1DI"
+#define DEMOINDEX_VERSION	1
+
+typedef struct
+{
+	int32		ident;
+	int32		version;
+} PACKED_STRUCT ddemoindex_t;
+
+// followed by length bytes of [int32 length][message] pairs, the same
+// framing as the demo itself
+typedef struct
+{
+	int32		offset;		// demo file position of the first message after the keyframe
+	int32		time;		// milliseconds since the first recorded frame
+	int32		length;
+} PACKED_STRUCT ddemokeyframe_t;
+
 #ifdef _WIN32
 #pragma pack (pop)
 #endif
@@ -21,6 +21,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "gl_local.h"
 #include <png.h>
 #include <jpeglib.h>
+#include <setjmp.h>
+#include <sys/stat.h>
 
 image_t		gltextures[MAX_GLTEXTURES];
 int			numgltextures = 0;
@@ -40,6 +42,8 @@ vec4_t		d_8to24float[256];
 
 qboolean GL_Upload8 (byte *data, int width, int height,  qboolean mipmap, image_t *image);
 qboolean GL_Upload32 (unsigned *data, int width, int height,  qboolean mipmap, int bpp, image_t *image);
+static byte *GL_BuildMipChain (unsigned *data, int width, int height, imagetype_t type);
+void R_FloodFillSkin (byte *skin, int skinwidth, int skinheight);
 
 const char	*current_texture_filename;
 
@@ -654,16 +658,28 @@ abortload:
 typedef struct {
     byte *Buffer;
     size_t Pos;
+    size_t Length;
 } TPngFileBuffer;
 
 void EXPORT PngReadFunc(png_struct *Png, png_bytep buf, png_size_t size)
 {
     TPngFileBuffer *PngFileBuffer=(TPngFileBuffer*)png_get_io_ptr(Png);
+    if (PngFileBuffer->Pos + size > PngFileBuffer->Length)
+        png_error (Png, "read past end of file");
     memcpy(buf,PngFileBuffer->Buffer+PngFileBuffer->Pos,size);
     PngFileBuffer->Pos+=size;
 }
 
-void LoadPNG (const char *name, byte **pic, int *width, int *height)
+/*
+==============
+DecodePNG
+
+Decodes a PNG file already in memory to RGBA. Runs on the decode threads
+so it must not touch the filesystem or console, returns an error string
+(NULL on success) for the caller to report instead.
+==============
+*/
+static const char *DecodePNG (byte *buffer, int length, byte **pic, int *width, int *height)
 {
 	unsigned int	i, rowbytes;
 	png_structp		png_ptr;
@@ -674,51 +690,48 @@ void LoadPNG (const char *name, byte **pic, int *width, int *height)
 	png_uint_32		img_width, img_height;
 	png_byte		img_color_type, img_bit_depth;
 
-	TPngFileBuffer	PngFileBuffer = {NULL,0};
+	TPngFileBuffer	PngFileBuffer = {NULL,0,0};
 
 	*pic = NULL;
 
-	ri.FS_LoadFile (name, (void *)&PngFileBuffer.Buffer);
-
-    if (!PngFileBuffer.Buffer)
-		return;
-
-	if ((png_check_sig(PngFileBuffer.Buffer, 8)) == 0)
-	{
-		ri.FS_FreeFile (PngFileBuffer.Buffer); 
-		ri.Con_Printf (PRINT_ALL, "Not a PNG file: %s\n", name);
-		return;
-    }
+	if (length < 8 || (png_check_sig(buffer, 8)) == 0)
+		return "Not a PNG file";
 
+	PngFileBuffer.Buffer = buffer;
 	PngFileBuffer.Pos=0;
+	PngFileBuffer.Length = length;
 
     png_ptr = png_create_read_struct (PNG_LIBPNG_VER_STRING, NULL,  NULL, NULL);
 
     if (!png_ptr)
-	{
-		ri.FS_FreeFile (PngFileBuffer.Buffer);
-		ri.Con_Printf (PRINT_ALL, "Bad PNG file: %s\n", name);
-		return;
-	}
+		return "Bad PNG file";
 
     info_ptr = png_create_info_struct(png_ptr);
     if (!info_ptr)
 	{
         png_destroy_read_struct(&png_ptr, (png_infopp)NULL, (png_infopp)NULL);
-		ri.FS_FreeFile (PngFileBuffer.Buffer);
-		ri.Con_Printf (PRINT_ALL, "Bad PNG file: %s\n", name);
-		return;
+		return "Bad PNG file";
     }
     
 	end_info = png_create_info_struct(png_ptr);
     if (!end_info)
 	{
         png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
-		ri.FS_FreeFile (PngFileBuffer.Buffer);
-		ri.Con_Printf (PRINT_ALL, "Bad PNG file: %s\n", name);
-		return;
+		return "Bad PNG file";
     }
 
+	//r1: libpng longjmps here on corrupt data, default handler would take down the whole process
+	if (setjmp (png_jmpbuf(png_ptr)))
+	{
+		png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
+		if (*pic)
+		{
+			free (*pic);
+			*pic = NULL;
+		}
+		return "Bad PNG file";
+	}
+
 	png_set_read_fn (png_ptr,(png_voidp)&PngFileBuffer,(png_rw_ptr)PngReadFunc);
 
 	png_read_info(png_ptr, info_ptr);
@@ -731,9 +744,7 @@ void LoadPNG (const char *name, byte **pic, int *width, int *height)
 	if (img_height > MAX_TEXTURE_DIMENSIONS)
 	{
         png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
-		ri.FS_FreeFile (PngFileBuffer.Buffer);
-		ri.Con_Printf (PRINT_ALL, "Oversized PNG file: %s\n", name);
-		return;
+		return "Oversized PNG file";
 	}
 
 	if (img_color_type == PNG_COLOR_TYPE_PALETTE)
@@ -768,6 +779,11 @@ void LoadPNG (const char *name, byte **pic, int *width, int *height)
 	rowbytes = png_get_rowbytes(png_ptr, info_ptr);
 
 	*pic = malloc (img_height * rowbytes);
+	if (!*pic)
+	{
+		png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
+		return "Not enough memory for PNG file";
+	}
 
 	for (i = 0; i < img_height; i++)
 		row_pointers[i] = *pic + i*rowbytes;
@@ -780,7 +796,7 @@ void LoadPNG (const char *name, byte **pic, int *width, int *height)
 	png_read_end(png_ptr, end_info);
 	png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
 
-	ri.FS_FreeFile (PngFileBuffer.Buffer);
+	return NULL;
 }
 
 /*
@@ -1185,29 +1201,27 @@ typedef struct _TargaHeader {
 	unsigned char	pixel_size, attributes;
 } TargaHeader;
 
-void LoadTGA (const char *name, byte **pic, int *width, int *height)
+/*
+==============
+DecodeTGA
+
+Decodes a TGA file already in memory to RGBA, see DecodePNG.
+==============
+*/
+static const char *DecodeTGA (byte *buffer, int length, byte **pic, int *width, int *height)
 {
 	unsigned	rows, numPixels;
 	byte		*pixbuf;
 	int			row, column, columns;
 	byte		*buf_p;
-	byte		*buffer;
 	TargaHeader	targa_header;
 	byte		*targa_rgba;
-	int			length;
 	int			pixel_size;
 
 	*pic = NULL;
 
-	//
-	// load the file
-	//
-	length = ri.FS_LoadFile (name, (void **)&buffer);
-	if (!buffer)
-		return;
-
 	if (length < 18)
-		ri.Sys_Error (ERR_DROP, "LoadTGA: %s has an invalid file size", name);
+		return "invalid file size";
 
 	buf_p = buffer;
 
@@ -1237,19 +1251,13 @@ void LoadTGA (const char *name, byte **pic, int *width, int *height)
 	if (targa_header.image_type!=2 
 		&& targa_header.image_type!=10
 		&& targa_header.image_type != 3 ) 
-	{
-		ri.Sys_Error (ERR_DROP, "LoadTGA (%s): Only type 2 (RGB), 3 (gray), and 10 (RGB) TGA images supported", name);
-	}
+		return "Only type 2 (RGB), 3 (gray), and 10 (RGB) TGA images supported";
 
 	if ( targa_header.colormap_type != 0 )
-	{
-		ri.Sys_Error (ERR_DROP, "LoadTGA (%s): colormaps not supported", name);
-	}
+		return "colormaps not supported";
 
 	if ( ( targa_header.pixel_size != 32 && targa_header.pixel_size != 24 ) && targa_header.image_type != 3 )
-	{
-		ri.Sys_Error (ERR_DROP, "LoadTGA (%s): Only 32 or 24 bit images supported (no colormaps)", name);
-	}
+		return "Only 32 or 24 bit images supported (no colormaps)";
 
 	columns = targa_header.width;
 	rows = targa_header.height;
@@ -1262,12 +1270,11 @@ void LoadTGA (const char *name, byte **pic, int *width, int *height)
 		*height = rows;
 
 	if (!columns || !rows || numPixels > 0x7FFFFFFF || numPixels / columns / 4 != rows)
-	{
-		ri.Sys_Error (ERR_DROP, "LoadTGA (%s): Invalid image size", name);
-	}
+		return "Invalid image size";
 
 	targa_rgba = malloc (numPixels);
-	*pic = targa_rgba;
+	if (!targa_rgba)
+		return "not enough memory";
 
 	if (targa_header.id_length != 0)
 		buf_p += targa_header.id_length;  // skip TARGA image comment
@@ -1282,7 +1289,7 @@ void LoadTGA (const char *name, byte **pic, int *width, int *height)
 		{
 			case 24:
 				if (buf_p - buffer + (3 * columns * rows) > length)
-					ri.Sys_Error (ERR_DROP, "LoadTGA: (%s): Pointer passed end of file - corrupt TGA file", name);
+					goto corrupt;
 
 				for(row=rows-1; row>=0; row--) 
 				{
@@ -1304,7 +1311,7 @@ void LoadTGA (const char *name, byte **pic, int *width, int *height)
 
 			case 32:
 				if (buf_p - buffer + (4 * columns * rows) > length)
-					ri.Sys_Error (ERR_DROP, "LoadTGA: (%s): Pointer passed end of file - corrupt TGA file", name);
+					goto corrupt;
 
 				for(row=rows-1; row>=0; row--) 
 				{
@@ -1327,7 +1334,7 @@ void LoadTGA (const char *name, byte **pic, int *width, int *height)
 
 			case 8:
 				if (buf_p - buffer + (1 * columns * rows) > length)
-					ri.Sys_Error (ERR_DROP, "LoadTGA: (%s): Pointer passed end of file - corrupt TGA file", name);
+					goto corrupt;
 
 				for(row=rows-1; row>=0; row--) 
 				{
@@ -1364,6 +1371,8 @@ void LoadTGA (const char *name, byte **pic, int *width, int *height)
 			pixbuf = targa_rgba + row*columns*4;
 			for (column = 0; column < columns;)
 			{
+				if (buf_p - buffer + 1 > length)
+					goto corrupt;
 				packetHeader = *buf_p++;
 				packetSize = 1 + (packetHeader & 0x7f);
 				if (packetHeader & 0x80)
@@ -1373,7 +1382,7 @@ void LoadTGA (const char *name, byte **pic, int *width, int *height)
 					{
 						case 24:
 							if (buf_p - buffer + (3) > length)
-								ri.Sys_Error (ERR_DROP, "LoadTGA: (%s): Pointer passed end of file - corrupt TGA file", name);
+								goto corrupt;
 							blue = *buf_p++;
 							green = *buf_p++;
 							red = *buf_p++;
@@ -1381,7 +1390,7 @@ void LoadTGA (const char *name, byte **pic, int *width, int *height)
 							break;
 						case 32:
 							if (buf_p - buffer + (4) > length)
-								ri.Sys_Error (ERR_DROP, "LoadTGA: (%s): Pointer passed end of file - corrupt TGA file", name);
+								goto corrupt;
 							blue = *buf_p++;
 							green = *buf_p++;
 							red = *buf_p++;
@@ -1419,7 +1428,7 @@ void LoadTGA (const char *name, byte **pic, int *width, int *height)
 					{
 						case 24:
 							if (buf_p - buffer + (3 * packetSize) > length)
-								ri.Sys_Error (ERR_DROP, "LoadTGA: (%s): Pointer passed end of file - corrupt TGA file", name);
+								goto corrupt;
 
 							for(j = 0; j < packetSize; j++)
 							{
@@ -1447,7 +1456,7 @@ void LoadTGA (const char *name, byte **pic, int *width, int *height)
 
 						case 32:
 							if (buf_p - buffer + (4 * packetSize) > length)
-								ri.Sys_Error (ERR_DROP, "LoadTGA: (%s): Pointer passed end of file - corrupt TGA file", name);
+								goto corrupt;
 
 							for(j = 0; j < packetSize; j++)
 							{	
@@ -1488,8 +1497,10 @@ breakOut:;
 		byte *temp;
 		temp = malloc (numPixels);
 		if (!temp)
-			ri.Sys_Error (ERR_FATAL, "LoadTGA: not enough memory");
-		ri.Con_Printf (PRINT_DEVELOPER, "LoadTGA: Bottom-to-top TGA file (slow): %s\n", name);
+		{
+			free (targa_rgba);
+			return "not enough memory";
+		}
 		memcpy (temp, targa_rgba, numPixels);
 		for (row = 0; row < rows; row++)
 		{
@@ -1498,7 +1509,12 @@ breakOut:;
 		free (temp);
 	}
 
-	ri.FS_FreeFile (buffer);
+	*pic = targa_rgba;
+	return NULL;
+
+corrupt:
+	free (targa_rgba);
+	return "Pointer passed end of file - corrupt TGA file";
 }
 #endif
 /*
@@ -1514,20 +1530,34 @@ void EXPORT jpg_null(j_decompress_ptr cinfo)
 {
 }
 
+//r1: truncated file, feed the decoder a fake EOI marker like the stdio source manager
+//does. this runs on the decode threads so no console output here.
 boolean EXPORT jpg_fill_input_buffer(j_decompress_ptr cinfo)
 {
-    ri.Con_Printf(PRINT_ALL, "Premature end of JPEG data\n");
+	static const JOCTET	jpg_eoi[2] = {0xFF, JPEG_EOI};
+
+	cinfo->src->next_input_byte = jpg_eoi;
+	cinfo->src->bytes_in_buffer = 2;
     return 1;
 }
 
 void EXPORT jpg_skip_input_data(j_decompress_ptr cinfo, long num_bytes)
 {
-        
+	if (num_bytes <= 0)
+		return;
+
+	if ((size_t)num_bytes > cinfo->src->bytes_in_buffer)
+	{
+		jpg_fill_input_buffer (cinfo);
+		return;
+	}
+
     cinfo->src->next_input_byte += (size_t) num_bytes;
     cinfo->src->bytes_in_buffer -= (size_t) num_bytes;
 }
 
-void jpeg_mem_src (j_decompress_ptr cinfo, byte *mem, int len)
+//r1: renamed, newer libjpeg exports its own jpeg_mem_src with a different signature
+static void jpg_mem_src (j_decompress_ptr cinfo, byte *mem, int len)
 {
     cinfo->src = (struct jpeg_source_mgr *)(*cinfo->mem->alloc_small)((j_common_ptr) cinfo, JPOOL_PERMANENT, sizeof(struct jpeg_source_mgr));
     cinfo->src->init_source = jpg_null;
@@ -1539,55 +1569,78 @@ void jpeg_mem_src (j_decompress_ptr cinfo, byte *mem, int len)
     cinfo->src->next_input_byte = mem;
 }
 
+typedef struct
+{
+	struct jpeg_error_mgr	pub;
+	jmp_buf					jmpbuf;
+	byte					*rgbadata;		// freed if libjpeg bails out
+	byte					*scanline;
+} jpgerror_t;
+
+//r1: the default calls exit(), which would take down the whole process
+//from a decoder thread over one corrupt file
+static void EXPORT jpg_error_exit (j_common_ptr cinfo)
+{
+	longjmp (((jpgerror_t *)cinfo->err)->jmpbuf, 1);
+}
+
+static void EXPORT jpg_output_message (j_common_ptr cinfo)
+{
+}
+
 /*
 ==============
-LoadJPG
+DecodeJPG
+
+Decodes a JPEG file already in memory to RGBA, see DecodePNG.
 ==============
 */
-void LoadJPG (const char *filename, byte **pic, int *width, int *height)
+static const char *DecodeJPG (byte *rawdata, int rawsize, byte **pic, int *width, int *height)
 {
 	struct jpeg_decompress_struct	cinfo;
-	struct jpeg_error_mgr			jerr;
-	byte							*rawdata, *rgbadata, *scanline, *p, *q;
-	unsigned int					rawsize, i;
+	jpgerror_t						jerr;
+	byte							*p, *q;
+	unsigned int					i;
 
 	*pic = NULL;
 
-	// Load JPEG file into memory
-	rawsize = ri.FS_LoadFile(filename, (void **)&rawdata);
-
-	if (!rawdata)
-		return;	
-
 	if (rawsize < 10 || rawdata[6] != 'J' || rawdata[7] != 'F' || rawdata[8] != 'I' || rawdata[9] != 'F')
-	{ 
-		ri.Con_Printf (PRINT_ALL, "Invalid JPEG header: %s\n", filename); 
-		ri.FS_FreeFile(rawdata); 
-		return; 
-	} 
+		return "Invalid JPEG header";
+
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = jpg_error_exit;
+	jerr.pub.output_message = jpg_output_message;
+	jerr.rgbadata = NULL;
+	jerr.scanline = NULL;
 
-	cinfo.err = jpeg_std_error(&jerr);
 	jpeg_create_decompress(&cinfo);
-	jpeg_mem_src(&cinfo, rawdata, rawsize);
+
+	if (setjmp (jerr.jmpbuf))
+	{
+		jpeg_destroy_decompress (&cinfo);
+		if (jerr.rgbadata)
+			free (jerr.rgbadata);
+		if (jerr.scanline)
+			free (jerr.scanline);
+		return "Bad JPEG file";
+	}
+
+	jpg_mem_src(&cinfo, rawdata, rawsize);
 	jpeg_read_header(&cinfo, true);
 	jpeg_start_decompress(&cinfo);
 
 	if(cinfo.output_components != 3 && cinfo.output_components != 4)
 	{
-		ri.Con_Printf(PRINT_ALL, "Invalid JPEG colour components\n");
 		jpeg_destroy_decompress(&cinfo);
-		ri.FS_FreeFile(rawdata);
-		return;
+		return "Invalid JPEG colour components";
 	}
 
 	// Allocate Memory for decompressed image
-	rgbadata = malloc(cinfo.output_width * cinfo.output_height * 4);
-	if(!rgbadata)
+	jerr.rgbadata = malloc(cinfo.output_width * cinfo.output_height * 4);
+	if(!jerr.rgbadata)
 	{
-		ri.Con_Printf(PRINT_ALL, "Insufficient memory for JPEG buffer\n");
 		jpeg_destroy_decompress(&cinfo);
-		ri.FS_FreeFile(rawdata);
-		return;
+		return "Insufficient memory for JPEG buffer";
 	}
 
 	// Pass sizes to output
@@ -1595,22 +1648,20 @@ void LoadJPG (const char *filename, byte **pic, int *width, int *height)
 	*height = cinfo.output_height;
 
 	// Allocate Scanline buffer
-	scanline = malloc (cinfo.output_width * 3);
-	if (!scanline)
+	jerr.scanline = malloc (cinfo.output_width * cinfo.output_components);
+	if (!jerr.scanline)
 	{
-		ri.Con_Printf (PRINT_ALL, "Insufficient memory for JPEG scanline buffer\n");
-		free (rgbadata);
+		free (jerr.rgbadata);
 		jpeg_destroy_decompress (&cinfo);
-		ri.FS_FreeFile (rawdata);
-		return;
+		return "Insufficient memory for JPEG scanline buffer";
 	}
 
 	// Read Scanlines, and expand from RGB to RGBA
-	q = rgbadata;
+	q = jerr.rgbadata;
 	while (cinfo.output_scanline < cinfo.output_height)
 	{
-		p = scanline;
-		jpeg_read_scanlines(&cinfo, &scanline, 1);
+		p = jerr.scanline;
+		jpeg_read_scanlines(&cinfo, &jerr.scanline, 1);
 
 		for (i = 0; i < cinfo.output_width; i++)
 		{
@@ -1618,186 +1669,1177 @@ void LoadJPG (const char *filename, byte **pic, int *width, int *height)
 			q[1] = p[1];
 			q[2] = p[2];
 			q[3] = 255;
-			p += 3;
+			p += cinfo.output_components;
 			q += 4;
 		}
 	}
 
-	free (scanline);
 	jpeg_finish_decompress (&cinfo);
 	jpeg_destroy_decompress (&cinfo);
 
-	*pic = rgbadata;
-}
+	free (jerr.scanline);
 
+	*pic = jerr.rgbadata;
+	return NULL;
+}
 
-/*typedef struct _TargaHeader {
-	unsigned char 	id_length, colormap_type, image_type;
-	unsigned short	colormap_index, colormap_length;
-	unsigned char	colormap_size;
-	unsigned short	x_origin, y_origin, width, height;
-	unsigned char	pixel_size, attributes;
-} TargaHeader;
+/*
+=========================================================
 
-typedef struct targaHeader_s {
-	byte			idLength;
-	byte			colorMapType;
-	byte			imageType;
+TEXTURE CACHE
 
-	unsigned short	colorMapIndex;
-	unsigned short	colorMapLength;
-	byte			colorMapSize;
+Mipmapped tga/png/jpg images are saved to <gamedir>/texcache after
+resampling, light scaling and mipmapping, so the next load of the same
+file with the same settings hands the finished chain straight to GL and
+skips decoding entirely. Files are named after a hash of the source file
+and of everything that changes the result, so a stale entry is simply
+never found. gl_texcache_maxmb bounds the directory, once it grows past
+that the files written longest ago are deleted at the end of the map
+load.
 
-	unsigned short	xOrigin;
-	unsigned short	yOrigin;
-	unsigned short	width;
-	unsigned short	height;
+=========================================================
+*/
 
-	byte			pixelSize;
+#define	TEXCACHE_VERSION	2
 
-	byte			attributes;
-} targaHeader_t;*/
+typedef struct
+{
+	char	magic[4];
+	int		version;
+	uint64	key;
+	int		sourcelen;
+	int		width;			// of the source image
+	int		height;
+	int		has_alpha;		// what GL_Upload32 decided, picks the format on a hit
+	int		levels;			// each is width, height, then RGBA data
+} texcachehdr_t;
 
-/*
-=============
-LoadTGA
-=============
-*/
-/*void LoadTGA (char *name, byte **pic, int *width, int *height)
+typedef struct
 {
-	int				i, columns, rows, row_inc, row, col;
-	byte			*buf_p, *buffer, *pixbuf, *targa_rgba;
-	int				length, samples, readpixelcount, pixelcount;
-	byte			palette[256][4], red, green, blue, alpha;
-	qboolean		compressed;
-	targaHeader_t	targa_header;
+	uint64	key;			// 0 if the image being loaded isn't cached
+	int		sourcelen;
+	byte	*file;			// the whole cache file on a hit
+	qboolean	built;		// file came from GL_BuildMipChain, not the disk
+} texcache_t;
 
-	*pic = NULL;
+static texcache_t	upload_cache;
+static char			texcache_dir[MAX_OSPATH];
 
-	//
-	// load the file
-	//
+int		texcache_hits;
+int		texcache_misses;
 
-	length = ri.FS_LoadFile (name, (void **)&buffer);
-	if (!buffer || (length <= 0))
-		return;
+static uint64 GL_HashBytes (uint64 hash, const void *data, size_t len)
+{
+	const byte	*p = data;
+	uint64		word;
 
-	buf_p = buffer;
-	targa_header.idLength = *buf_p++;
-	targa_header.colorMapType = *buf_p++;
-	targa_header.imageType = *buf_p++;
+	//FNV-1a a word at a time, hashing bytewise took longer than decoding
+	//a TGA. the extra shift mixes the high bits back into the low ones.
+	while (len >= sizeof(word))
+	{
+		memcpy (&word, p, sizeof(word));
+		hash ^= word;
+		hash *= 1099511628211ULL;
+		hash ^= hash >> 29;
+		p += sizeof(word);
+		len -= sizeof(word);
+	}
 
-	targa_header.colorMapIndex = buf_p[0] + buf_p[1] * 256;
-	buf_p+=2;
-	targa_header.colorMapLength = buf_p[0] + buf_p[1] * 256;
-	buf_p+=2;
-	targa_header.colorMapSize = *buf_p++;
-	targa_header.xOrigin = LittleShort (*((short *)buf_p));
-	buf_p+=2;
-	targa_header.yOrigin = LittleShort (*((short *)buf_p));
-	buf_p+=2;
-	targa_header.width = LittleShort (*((short *)buf_p));
-	buf_p+=2;
-	targa_header.height = LittleShort (*((short *)buf_p));
-	buf_p+=2;
-	targa_header.pixelSize = *buf_p++;
-	targa_header.attributes = *buf_p++;
+	while (len--)
+	{
+		hash ^= *p++;
+		hash *= 1099511628211ULL;
+	}
 
-	if (targa_header.idLength != 0)
-		buf_p += targa_header.idLength;  // skip TARGA image comment
+	return hash;
+}
 
-	if ((targa_header.imageType == 1) || (targa_header.imageType == 9))
-	{
-		// uncompressed colormapped image
-		if (targa_header.pixelSize != 8)
-		{
-			ri.FS_FreeFile (buffer);
-			ri.Sys_Error (ERR_DROP, "LoadTGA: (%s) Only 8 bit images supported for type 1 and 9\n", name);
-		}
+/*
+===============
+GL_TexCacheSettings
 
-		if( targa_header.colorMapLength != 256 )
-		{
-			ri.FS_FreeFile (buffer);
-			ri.Sys_Error (ERR_DROP, "LoadTGA: (%s) Only 8 bit colormaps are supported for type 1 and 9\n", name);
-		}
+Seed for the cache key of an image of this type, covering everything
+GL_Upload32 does to it. Returns 0 if the type isn't cached. Main thread
+only.
+===============
+*/
+static uint64 GL_TexCacheSettings (imagetype_t type)
+{
+	char	dir[MAX_OSPATH];
+	int		settings[8];
+	float	filter[2];
+	uint64	hash;
+
+	if (FLOAT_EQ_ZERO(gl_texcache->value))
+		return 0;
+
+	//only types that get mipmapped, see GL_LoadPic
+	if (type == it_pic || type == it_sky)
+		return 0;
+
+	Com_sprintf (dir, sizeof(dir), "%s/texcache", ri.FS_Gamedir());
+	if (strcmp (dir, texcache_dir))
+		strcpy (texcache_dir, dir);
+
+	settings[0] = TEXCACHE_VERSION;
+	settings[1] = type;
+	settings[2] = gl_config.r1gl_GL_ARB_texture_non_power_of_two;
+	settings[3] = FLOAT_NE_ZERO(gl_round_down->value);
+	settings[4] = (int)gl_picmip->value;
+	settings[5] = MAX_TEXTURE_DIMENSIONS;
+	settings[6] = (int)gl_texture_lighting_mode->value;
+	settings[7] = FLOAT_NE_ZERO(gl_linear_mipmaps->value);
+
+	filter[0] = gl_contrast->value;
+	filter[1] = gl_saturation->value;
+
+	hash = GL_HashBytes (14695981039346656037ULL, settings, sizeof(settings));
+	hash = GL_HashBytes (hash, filter, sizeof(filter));
+	hash = GL_HashBytes (hash, gammatable, sizeof(gammatable));
+	hash = GL_HashBytes (hash, intensitytable, sizeof(intensitytable));
+
+	return hash;
+}
 
-		if( targa_header.colorMapIndex )
-		{
-			ri.FS_FreeFile (buffer);
-			ri.Sys_Error (ERR_DROP, "LoadTGA: (%s) colorMapIndex is not supported for type 1 and 9", name);
-		}
+static void GL_TexCachePath (char *path, int size, uint64 key)
+{
+	Com_sprintf (path, size, "%s/%08x%08x.tex", texcache_dir, (unsigned int)(key >> 32), (unsigned int)key);
+}
 
-		if (targa_header.colorMapSize == 24)
-		{
-			for (i=0 ; i<targa_header.colorMapLength ; i++)
-			{
-				palette[i][0] = *buf_p++;
-				palette[i][1] = *buf_p++;
-				palette[i][2] = *buf_p++;
-				palette[i][3] = 255;
-			}
-		}
-		else if (targa_header.colorMapSize == 32)
-		{
-			for (i=0 ; i<targa_header.colorMapLength ; i++)
-			{
-				palette[i][0] = *buf_p++;
-				palette[i][1] = *buf_p++;
-				palette[i][2] = *buf_p++;
-				palette[i][3] = *buf_p++;
-			}
-		}
-		else
-		{
-			ri.FS_FreeFile (buffer);
-			ri.Sys_Error (ERR_DROP, "LoadTGA: (%s) Only 24 and 32 bit colormaps are supported for type 1 and 9", name);
-		}
-	}
-	else if ((targa_header.imageType == 2) || (targa_header.imageType == 10))
-	{
-		// uncompressed or RLE compressed RGB
-		if ((targa_header.pixelSize != 32) && (targa_header.pixelSize != 24))
-		{
-			ri.FS_FreeFile (buffer);
-			ri.Sys_Error (ERR_DROP, "LoadTGA: (%s) Only 32 or 24 bit images supported for type 2 and 10", name);
-		}
-	}
-	else if ((targa_header.imageType == 3) || (targa_header.imageType == 11))
-	{
-		// uncompressed greyscale
-		if (targa_header.pixelSize != 8 )
-		{
-			ri.FS_FreeFile (buffer);
-			ri.Sys_Error (ERR_DROP, "LoadTGA: (%s) Only 8 bit images supported for type 3 and 11", name);
-		}
-	}
+/*
+===============
+GL_TexCacheRead
 
-	columns = targa_header.width;
-	if (width)
-		*width = columns;
+Returns the cache file for key, or NULL if there isn't a valid one.
+Safe to call from the decoder threads.
+===============
+*/
+static byte *GL_TexCacheRead (uint64 key, int sourcelen)
+{
+	texcachehdr_t	*hdr;
+	FILE			*f;
+	char			path[MAX_OSPATH];
+	byte			*file, *p;
+	long			len;
+	int				i, w, h;
 
-	rows = targa_header.height;
-	if (height)
-		*height = rows;
+	GL_TexCachePath (path, sizeof(path), key);
 
-	targa_rgba = malloc (columns * rows * 4);
-	*pic = targa_rgba;
+	f = fopen (path, "rb");
+	if (!f)
+		return NULL;
 
-	// if bit 5 of attributes isn't set, the image has been stored from bottom to top
-	if (targa_header.attributes & 0x20)
+	fseek (f, 0, SEEK_END);
+	len = ftell (f);
+	fseek (f, 0, SEEK_SET);
+
+	if (len < (long)sizeof(*hdr) || !(file = malloc (len)))
 	{
-		pixbuf = targa_rgba;
-		row_inc = 0;
+		fclose (f);
+		return NULL;
 	}
-	else
+
+	if (fread (file, len, 1, f) != 1)
 	{
-		pixbuf = targa_rgba + (rows - 1) * columns * 4;
-		row_inc = -columns * 4 * 2;
+		fclose (f);
+		free (file);
+		return NULL;
 	}
 
-	compressed = ((targa_header.imageType == 9) || (targa_header.imageType == 10) || (targa_header.imageType == 11));
+	fclose (f);
 
-	for (row=col=0, samples=3 ; row<rows ; )
+	hdr = (texcachehdr_t *)file;
+	if (memcmp (hdr->magic, "R1TC", 4) || hdr->version != TEXCACHE_VERSION || hdr->key != key || hdr->sourcelen != sourcelen || hdr->levels < 1)
+		goto invalid;
+
+	//truncated write
+	p = file + sizeof(*hdr);
+	for (i = 0; i < hdr->levels; i++)
+	{
+		if (p + 2 * sizeof(int) > file + len)
+			goto invalid;
+
+		w = ((int *)p)[0];
+		h = ((int *)p)[1];
+
+		if (w < 1 || h < 1 || w > MAX_TEXTURE_DIMENSIONS || h > MAX_TEXTURE_DIMENSIONS)
+			goto invalid;
+
+		p += 2 * sizeof(int) + w * h * 4;
+		if (p > file + len)
+			goto invalid;
+	}
+
+	return file;
+
+invalid:
+	free (file);
+	return NULL;
+}
+
+/*
+===============
+GL_TexCacheWrite
+
+Saves a mip chain from GL_BuildMipChain, filling in the rest of its
+header.
+===============
+*/
+static void GL_TexCacheWrite (const texcache_t *cache, byte *file)
+{
+	texcachehdr_t	*hdr;
+	FILE			*f;
+	char			path[MAX_OSPATH];
+	byte			*p;
+	int				i;
+
+	Com_sprintf (path, sizeof(path), "%s/", texcache_dir);
+	FS_CreatePath (path);
+
+	GL_TexCachePath (path, sizeof(path), cache->key);
+
+	f = fopen (path, "wb");
+	if (!f)
+	{
+		ri.Con_Printf (PRINT_DEVELOPER, "GL_TexCacheWrite: couldn't open %s\n", path);
+		return;
+	}
+
+	hdr = (texcachehdr_t *)file;
+	memcpy (hdr->magic, "R1TC", 4);
+	hdr->version = TEXCACHE_VERSION;
+	hdr->key = cache->key;
+	hdr->sourcelen = cache->sourcelen;
+
+	p = file + sizeof(*hdr);
+	for (i = 0; i < hdr->levels; i++)
+		p += 2 * sizeof(int) + ((int *)p)[0] * ((int *)p)[1] * 4;
+
+	if (fwrite (file, p - file, 1, f) != 1)
+	{
+		fclose (f);
+		remove (path);
+		return;
+	}
+
+	fclose (f);
+}
+
+/*
+===============
+GL_TexCacheAppend
+
+Adds a mip level to a chain being built by GL_BuildMipChain. Returns
+the new length, or -1 if it doesn't fit in size bytes.
+===============
+*/
+static int GL_TexCacheAppend (byte *chain, int length, int size, const unsigned *data, int width, int height)
+{
+	if (length + 2 * (int)sizeof(int) + width * height * 4 > size)
+		return -1;
+
+	((int *)(chain + length))[0] = width;
+	((int *)(chain + length))[1] = height;
+
+	memcpy (chain + length + 2 * sizeof(int), data, width * height * 4);
+
+	return length + 2 * sizeof(int) + width * height * 4;
+}
+
+typedef struct
+{
+	time_t	time;
+	long	size;
+	char	name[32];
+} texcachefile_t;
+
+static int GL_TexCacheFileCompare (const void *a, const void *b)
+{
+	time_t	ta = ((const texcachefile_t *)a)->time;
+	time_t	tb = ((const texcachefile_t *)b)->time;
+
+	return ta < tb ? -1 : ta > tb;
+}
+
+/*
+===============
+GL_TexCacheTrim
+
+Deletes the oldest cache files until the directory is below
+gl_texcache_maxmb. Age is when a file was written, hits don't refresh
+it. Main thread only, the decoder threads must be idle.
+===============
+*/
+void GL_TexCacheTrim (void)
+{
+	texcachefile_t	*files, *newfiles;
+	struct stat		st;
+	char			path[MAX_OSPATH];
+	char			*found, *name;
+	int				count, size, removed, i;
+	double			total, limit;
+
+	if (!texcache_dir[0] || gl_texcache_maxmb->value <= 0)
+		return;
+
+	limit = gl_texcache_maxmb->value * 1048576.0;
+
+	files = NULL;
+	count = size = 0;
+	total = 0;
+
+	Com_sprintf (path, sizeof(path), "%s/*.tex", texcache_dir);
+	for (found = Sys_FindFirst (path, 0, SFF_SUBDIR); found; found = Sys_FindNext (0, SFF_SUBDIR))
+	{
+		if (stat (found, &st))
+			continue;
+
+		name = strrchr (found, '/');
+		name = name ? name + 1 : found;
+
+		if (strlen (name) >= sizeof(files[0].name))
+			continue;
+
+		if (count == size)
+		{
+			size = size ? size * 2 : 256;
+			newfiles = realloc (files, size * sizeof(*files));
+			if (!newfiles)
+				break;
+			files = newfiles;
+		}
+
+		files[count].time = st.st_mtime;
+		files[count].size = (long)st.st_size;
+		strcpy (files[count].name, name);
+
+		total += st.st_size;
+		count++;
+	}
+	Sys_FindClose ();
+
+	removed = 0;
+
+	if (total > limit)
+	{
+		qsort (files, count, sizeof(*files), GL_TexCacheFileCompare);
+
+		for (i = 0; i < count && total > limit; i++)
+		{
+			Com_sprintf (path, sizeof(path), "%s/%s", texcache_dir, files[i].name);
+			if (remove (path))
+				continue;
+
+			total -= files[i].size;
+			removed++;
+		}
+	}
+
+	free (files);
+
+	if (removed)
+		ri.Con_Printf (PRINT_DEVELOPER, "GL_TexCacheTrim: removed %d files, %.1f MB left\n", removed, total / 1048576.0);
+}
+
+/*
+===============
+GL_TexCacheUpload
+
+Uploads every level of a cache file to the bound texture and returns
+the size of the first.
+===============
+*/
+static void GL_TexCacheUpload (const byte *file, int comp, int *width, int *height)
+{
+	const texcachehdr_t	*hdr;
+	const byte			*p;
+	int					i, w, h;
+
+	hdr = (const texcachehdr_t *)file;
+	p = file + sizeof(*hdr);
+
+	for (i = 0; i < hdr->levels; i++)
+	{
+		w = ((const int *)p)[0];
+		h = ((const int *)p)[1];
+
+		if (!i)
+		{
+			*width = w;
+			*height = h;
+		}
+
+		qglTexImage2D (GL_TEXTURE_2D, i, comp, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, p + 2 * sizeof(int));
+		GL_CheckForError ();
+
+		p += 2 * sizeof(int) + w * h * 4;
+	}
+}
+
+/*
+=========================================================
+
+PARALLEL DECODING
+
+Mod_LoadTexinfo knows every texture a map needs before it asks for any
+of them, and R_PrefetchRegistration gets the models and pics the client
+is about to register. They queue the files up front and decoder threads
+turn them into finished mip chains while the main thread uploads the
+ones already done. Decoding, resampling and mipmapping run on the
+threads, reading files and anything touching GL or the console stays on
+the main thread. The cvars GL_BuildMipChain reads don't change during
+registration. The main thread reads at most DECODE_AHEAD files per
+thread ahead of what it has consumed to keep the memory held by finished
+but not yet uploaded images bounded.
+
+=========================================================
+*/
+
+#define	MAX_DECODE_THREADS	8
+#define	DECODE_AHEAD		4
+
+enum
+{
+	IMG_TGA,
+	IMG_PNG,
+	IMG_JPG
+};
+
+enum
+{
+	DECODE_PENDING,		// not read yet
+	DECODE_QUEUED,		// file in memory, waiting for a thread
+	DECODE_WORKING,		// claimed by a thread (or the main thread)
+	DECODE_DONE,		// pic or cachefile, and error are valid
+	DECODE_TAKEN		// handed to GL_FindImage, nothing left to free
+};
+
+typedef struct
+{
+	char			name[MAX_QPATH];
+	int				format;
+	imagetype_t		type;
+	byte			*raw;
+	int				rawlen;
+	byte			*pic;
+	int				width;
+	int				height;
+	const char		*error;
+	uint64			settings;		// texture cache seed, 0 if not cached
+	uint64			key;
+	byte			*cachefile;		// read from the texture cache or built here
+	qboolean		built;
+	volatile int	state;
+} decodejob_t;
+
+typedef const char *(*imagedecoder_t)(byte *buffer, int length, byte **pic, int *width, int *height);
+
+static const imagedecoder_t	image_decoders[] = {DecodeTGA, DecodePNG, DecodeJPG};
+
+static decodejob_t	*decode_jobs;
+static int			decode_numjobs;
+static int			decode_maxjobs;
+static volatile int	decode_published;
+static int			decode_taken;
+static int			decode_cursor;
+static volatile int	decode_quit;
+
+static void			*decode_threads[MAX_DECODE_THREADS];
+static int			decode_numthreads;
+static int			decode_wantthreads;
+
+static int GL_ImageFormat (const char *name)
+{
+	size_t	len;
+
+	len = strlen (name);
+	if (len < 4)
+		return -1;
+
+	if (!strcmp (name + len - 4, ".tga"))
+		return IMG_TGA;
+	else if (!strcmp (name + len - 4, ".png"))
+		return IMG_PNG;
+	else if (!strcmp (name + len - 4, ".jpg"))
+		return IMG_JPG;
+
+	return -1;
+}
+
+static void GL_DecodeJob (decodejob_t *job)
+{
+	if (job->settings)
+	{
+		job->key = GL_HashBytes (job->settings, job->raw, job->rawlen);
+		job->cachefile = GL_TexCacheRead (job->key, job->rawlen);
+	}
+
+	if (!job->cachefile)
+	{
+		job->error = image_decoders[job->format] (job->raw, job->rawlen, &job->pic, &job->width, &job->height);
+
+		//GL_LoadPic does this to skins it didn't get from the cache
+		if (job->pic && job->type == it_skin)
+			R_FloodFillSkin (job->pic, job->width, job->height);
+
+		//on failure GL_Upload32 gets the pic and tries again
+		if (job->pic && (job->cachefile = GL_BuildMipChain ((unsigned *)job->pic, job->width, job->height, job->type)))
+		{
+			job->built = true;
+			free (job->pic);
+			job->pic = NULL;
+		}
+	}
+
+	Sys_MemoryBarrier ();
+	job->state = DECODE_DONE;
+}
+
+static void GL_DecodeThread (void *param)
+{
+	int			i, published;
+
+	while (!decode_quit)
+	{
+		published = decode_published;
+		Sys_MemoryBarrier ();
+
+		for (i = 0; i < published; i++)
+		{
+			if (decode_jobs[i].state == DECODE_QUEUED && Sys_CompareExchange (&decode_jobs[i].state, DECODE_WORKING, DECODE_QUEUED) == DECODE_QUEUED)
+				break;
+		}
+
+		if (i == published)
+		{
+			Sys_Sleep (1);
+			continue;
+		}
+
+		Sys_MemoryBarrier ();
+		GL_DecodeJob (decode_jobs + i);
+	}
+}
+
+/*
+===============
+GL_ReadDecodeJob
+
+Main thread only, loads the file for a job so a thread can pick it up.
+===============
+*/
+static void GL_ReadDecodeJob (decodejob_t *job)
+{
+	job->rawlen = ri.FS_LoadFile (job->name, (void **)&job->raw);
+	Sys_MemoryBarrier ();
+
+	if (!job->raw)
+		job->state = DECODE_DONE;
+	else
+		job->state = DECODE_QUEUED;
+}
+
+static void GL_PublishDecodeJobs (void)
+{
+	decodejob_t	*job;
+
+	while (decode_published < decode_numjobs && decode_published - decode_taken < decode_numthreads * DECODE_AHEAD)
+	{
+		job = decode_jobs + decode_published;
+		if (job->state == DECODE_PENDING)
+			GL_ReadDecodeJob (job);
+
+		Sys_MemoryBarrier ();
+		decode_published++;
+	}
+}
+
+/*
+===============
+GL_BeginPrefetch
+
+Returns false if decoding threads are disabled, in which case there's
+no point in queueing anything.
+===============
+*/
+qboolean GL_BeginPrefetch (void)
+{
+	GL_EndPrefetch ();
+
+	decode_wantthreads = (int)gl_decode_threads->value;
+	if (decode_wantthreads <= 0)
+		return false;
+
+	if (decode_wantthreads > MAX_DECODE_THREADS)
+		decode_wantthreads = MAX_DECODE_THREADS;
+
+	return true;
+}
+
+/*
+===============
+GL_PrefetchImage
+
+Queues a tga/png/jpg file for decoding if it exists, checking the
+texture cache first for types that use it. Returns true if it was queued
+(or already was), so callers can stop at the first format of a texture
+that is present like GL_FindImage does.
+===============
+*/
+qboolean GL_PrefetchImage (const char *name, imagetype_t type)
+{
+	decodejob_t	*job;
+	int			i, format;
+
+	format = GL_ImageFormat (name);
+	if (format == -1)
+		return false;
+
+	for (i = 0; i < decode_numjobs; i++)
+	{
+		if (!strcmp (decode_jobs[i].name, name))
+			return true;
+	}
+
+	if (ri.FS_LoadFile (name, NULL) == -1)
+		return false;
+
+	if (decode_numjobs == decode_maxjobs)
+	{
+		decode_maxjobs = decode_maxjobs ? decode_maxjobs * 2 : 256;
+		decode_jobs = realloc (decode_jobs, decode_maxjobs * sizeof(*decode_jobs));
+		if (!decode_jobs)
+			ri.Sys_Error (ERR_FATAL, "GL_PrefetchImage: out of memory");
+	}
+
+	job = decode_jobs + decode_numjobs++;
+	memset (job, 0, sizeof(*job));
+
+	Q_strncpy (job->name, name, sizeof(job->name)-1);
+	job->format = format;
+	job->type = type;
+	job->settings = GL_TexCacheSettings (type);
+	job->state = DECODE_PENDING;
+
+	return true;
+}
+
+/*
+===============
+GL_StartPrefetch
+
+Starts the decoder threads on everything queued so far. If no threads
+can be started the main thread ends up decoding each image itself when
+it is asked for, exactly as if nothing had been queued.
+===============
+*/
+void GL_StartPrefetch (void)
+{
+	int		i;
+
+	//one image doesn't need a thread
+	if (decode_wantthreads > decode_numjobs - 1)
+		decode_wantthreads = decode_numjobs - 1;
+
+	decode_quit = 0;
+
+	for (i = 0; i < decode_wantthreads; i++)
+	{
+		decode_threads[decode_numthreads] = Sys_CreateThread (GL_DecodeThread, NULL);
+		if (decode_threads[decode_numthreads])
+			decode_numthreads++;
+	}
+
+	GL_PublishDecodeJobs ();
+}
+
+/*
+===============
+GL_EndPrefetch
+
+Stops the decoder threads and frees whatever was queued but never asked
+for (eg a texture whose wal is missing).
+===============
+*/
+void GL_EndPrefetch (void)
+{
+	decodejob_t	*job;
+	int			i;
+
+	decode_quit = 1;
+	Sys_MemoryBarrier ();
+
+	for (i = 0; i < decode_numthreads; i++)
+		Sys_WaitThread (decode_threads[i]);
+
+	decode_numthreads = 0;
+
+	for (i = 0, job = decode_jobs; i < decode_numjobs; i++, job++)
+	{
+		if (job->raw)
+			ri.FS_FreeFile (job->raw);
+
+		if (job->pic)
+			free (job->pic);
+
+		if (job->cachefile)
+			free (job->cachefile);
+	}
+
+	free (decode_jobs);
+	decode_jobs = NULL;
+	decode_numjobs = decode_maxjobs = 0;
+	decode_published = decode_taken = decode_cursor = 0;
+}
+
+/*
+===============
+GL_TakeDecoded
+
+If name was prefetched as type, waits for it to finish (or does the job
+here if no thread got to it yet) and hands over the result, usually a
+mip chain in *cache. Returns false if the image wasn't queued and needs
+loading the normal way.
+===============
+*/
+static qboolean GL_TakeDecoded (const char *name, imagetype_t type, byte **pic, int *width, int *height, const char **error, texcache_t *cache)
+{
+	decodejob_t	*job;
+	int			i, j;
+
+	//requests mostly come in the order they were queued
+	for (i = 0, j = decode_cursor; i < decode_numjobs; i++, j = (j + 1) % decode_numjobs)
+	{
+		if (decode_jobs[j].type == type && !strcmp (decode_jobs[j].name, name))
+			break;
+	}
+
+	if (i == decode_numjobs)
+		return false;
+
+	job = decode_jobs + j;
+
+	if (job->state == DECODE_TAKEN)
+		return false;
+
+	//not read ahead yet. threads never look past decode_published so
+	//this one is ours alone.
+	if (job->state == DECODE_PENDING)
+		GL_ReadDecodeJob (job);
+
+	//no thread has started on it, quicker to do it here than to wait
+	if (job->state == DECODE_QUEUED && Sys_CompareExchange (&job->state, DECODE_WORKING, DECODE_QUEUED) == DECODE_QUEUED)
+		GL_DecodeJob (job);
+
+	while (job->state != DECODE_DONE)
+		Sys_Sleep (0);
+
+	Sys_MemoryBarrier ();
+
+	*pic = job->pic;
+	*width = job->width;
+	*height = job->height;
+	*error = job->error;
+
+	if (cache)
+	{
+		cache->key = job->key;
+		cache->sourcelen = job->rawlen;
+		cache->file = job->cachefile;
+		cache->built = job->built;
+	}
+	else if (job->cachefile)
+	{
+		free (job->cachefile);
+	}
+
+	if (job->raw)
+		ri.FS_FreeFile (job->raw);
+
+	job->raw = NULL;
+	job->pic = NULL;
+	job->cachefile = NULL;
+	job->state = DECODE_TAKEN;
+
+	decode_cursor = (j + 1) % decode_numjobs;
+	decode_taken++;
+	GL_PublishDecodeJobs ();
+
+	return true;
+}
+
+/*
+==============
+LoadImage32
+
+Loads a tga/png/jpg to RGBA, from the decoder threads if it was
+prefetched. If a decoder thread or the texture cache has the finished
+mip chain, *pic is that instead and GL_Upload32 recognises it through
+upload_cache. Broken TGAs are fatal to the map load as they always were, the other
+formats just print a warning and come back NULL.
+==============
+*/
+static void LoadImage32 (const char *name, int format, imagetype_t type, byte **pic, int *width, int *height)
+{
+	const char	*error;
+	byte		*buffer;
+	int			length;
+	uint64		settings;
+
+	*pic = NULL;
+
+	upload_cache.key = 0;
+	upload_cache.file = NULL;
+	upload_cache.built = false;
+
+	if (!GL_TakeDecoded (name, type, pic, width, height, &error, &upload_cache))
+	{
+		length = ri.FS_LoadFile (name, (void **)&buffer);
+		if (!buffer)
+			return;
+
+		settings = GL_TexCacheSettings (type);
+		if (settings)
+		{
+			upload_cache.key = GL_HashBytes (settings, buffer, length);
+			upload_cache.sourcelen = length;
+			upload_cache.file = GL_TexCacheRead (upload_cache.key, length);
+		}
+
+		if (upload_cache.file)
+			error = NULL;
+		else
+			error = image_decoders[format] (buffer, length, pic, width, height);
+
+		ri.FS_FreeFile (buffer);
+	}
+
+	if (upload_cache.file)
+	{
+		if (!upload_cache.built)
+			texcache_hits++;
+		else if (upload_cache.key)
+			texcache_misses++;
+
+		*pic = upload_cache.file;
+		*width = ((texcachehdr_t *)upload_cache.file)->width;
+		*height = ((texcachehdr_t *)upload_cache.file)->height;
+		return;
+	}
+
+	if (upload_cache.key)
+		texcache_misses++;
+
+	if (error)
+	{
+		upload_cache.key = 0;
+
+		if (format == IMG_TGA)
+			ri.Sys_Error (ERR_DROP, "LoadTGA (%s): %s", name, error);
+
+		ri.Con_Printf (PRINT_ALL, "%s: %s\n", error, name);
+	}
+}
+
+/*
+===============
+GL_DecodeBenchQueue
+
+Queues one gl_decodebench argument, a tga/png/jpg file anywhere in the
+search path or a directory under the gamedir. Directories are listed on
+disk, so ones that only exist inside a pak are not found.
+===============
+*/
+static void GL_DecodeBenchQueue (const char *arg)
+{
+	char	path[MAX_OSPATH];
+	char	*found;
+	size_t	len;
+
+	if (GL_ImageFormat (arg) != -1)
+	{
+		if (!GL_PrefetchImage (arg, it_wall))
+			ri.Con_Printf (PRINT_ALL, "%s not found.\n", arg);
+		return;
+	}
+
+	Com_sprintf (path, sizeof(path), "%s/%s/*", ri.FS_Gamedir(), arg);
+	len = strlen (ri.FS_Gamedir()) + 1;
+
+	for (found = Sys_FindFirst (path, 0, SFF_SUBDIR); found; found = Sys_FindNext (0, SFF_SUBDIR))
+	{
+		if (strlen (found + len) < MAX_QPATH)
+			GL_PrefetchImage (found + len, it_wall);
+	}
+	Sys_FindClose ();
+}
+
+/*
+===============
+GL_DecodeBench_f
+
+Decodes and mipmaps the tga/png/jpg files given on the command line, or
+every such texture of the current map if there are none, once on the
+main thread and once through the decoder threads. Nothing is uploaded,
+it prints how long each took. Makes no GL calls, linux/decodebench.c
+runs it without a renderer.
+===============
+*/
+void GL_DecodeBench_f (void)
+{
+	char		(*names)[MAX_QPATH];
+	const char	*error;
+	byte		*buffer, *pic;
+	int			i, count, length, width, height;
+	int			serial, threaded, threads;
+	unsigned	start;
+
+	if (ri.Cmd_Argc () < 2 && !r_worldmodel)
+	{
+		ri.Con_Printf (PRINT_ALL, "Usage: gl_decodebench [file or directory ...], with no arguments the textures of the current map\n");
+		return;
+	}
+
+	if (!GL_BeginPrefetch ())
+	{
+		ri.Con_Printf (PRINT_ALL, "gl_decode_threads is 0.\n");
+		return;
+	}
+
+	if (ri.Cmd_Argc () > 1)
+	{
+		for (i = 1; i < ri.Cmd_Argc (); i++)
+			GL_DecodeBenchQueue (ri.Cmd_Argv (i));
+	}
+	else
+	{
+		for (i = 0; i < r_worldmodel->numtexinfo; i++)
+			GL_PrefetchImage (r_worldmodel->texinfo[i].image->name, it_wall);
+	}
+
+	count = decode_numjobs;
+	if (!count)
+	{
+		GL_EndPrefetch ();
+		ri.Con_Printf (PRINT_ALL, "No tga/png/jpg images to decode.\n");
+		return;
+	}
+
+	names = malloc (count * sizeof(*names));
+	for (i = 0; i < count; i++)
+	{
+		strcpy (names[i], decode_jobs[i].name);
+
+		//time the work, not the texture cache
+		decode_jobs[i].settings = 0;
+
+		//untimed read so both runs start with the files cached
+		length = ri.FS_LoadFile (names[i], (void **)&buffer);
+		if (buffer)
+			ri.FS_FreeFile (buffer);
+	}
+
+	start = Sys_Milliseconds ();
+	for (i = 0; i < count; i++)
+	{
+		length = ri.FS_LoadFile (names[i], (void **)&buffer);
+		if (!buffer)
+			continue;
+
+		image_decoders[GL_ImageFormat (names[i])] (buffer, length, &pic, &width, &height);
+		if (pic)
+		{
+			free (GL_BuildMipChain ((unsigned *)pic, width, height, it_wall));
+			free (pic);
+		}
+
+		ri.FS_FreeFile (buffer);
+	}
+	serial = Sys_Milliseconds () - start;
+
+	start = Sys_Milliseconds ();
+	GL_StartPrefetch ();
+	threads = decode_numthreads;
+	for (i = 0; i < count; i++)
+	{
+		if (GL_TakeDecoded (names[i], it_wall, &pic, &width, &height, &error, NULL) && pic)
+			free (pic);
+	}
+	GL_EndPrefetch ();
+	threaded = Sys_Milliseconds () - start;
+
+	free (names);
+
+	ri.Con_Printf (PRINT_ALL, "%d images: %d ms on the main thread, %d ms with %d decoder thread%s\n", count, serial, threaded, threads, threads == 1 ? "" : "s");
+}
+
+/*typedef struct _TargaHeader {
+	unsigned char 	id_length, colormap_type, image_type;
+	unsigned short	colormap_index, colormap_length;
+	unsigned char	colormap_size;
+	unsigned short	x_origin, y_origin, width, height;
+	unsigned char	pixel_size, attributes;
+} TargaHeader;
+
+typedef struct targaHeader_s {
+	byte			idLength;
+	byte			colorMapType;
+	byte			imageType;
+
+	unsigned short	colorMapIndex;
+	unsigned short	colorMapLength;
+	byte			colorMapSize;
+
+	unsigned short	xOrigin;
+	unsigned short	yOrigin;
+	unsigned short	width;
+	unsigned short	height;
+
+	byte			pixelSize;
+
+	byte			attributes;
+} targaHeader_t;*/
+
+/*
+=============
+LoadTGA
+=============
+*/
+/*void LoadTGA (char *name, byte **pic, int *width, int *height)
+{
+	int				i, columns, rows, row_inc, row, col;
+	byte			*buf_p, *buffer, *pixbuf, *targa_rgba;
+	int				length, samples, readpixelcount, pixelcount;
+	byte			palette[256][4], red, green, blue, alpha;
+	qboolean		compressed;
+	targaHeader_t	targa_header;
+
+	*pic = NULL;
+
+	//
+	// load the file
+	//
+
+	length = ri.FS_LoadFile (name, (void **)&buffer);
+	if (!buffer || (length <= 0))
+		return;
+
+	buf_p = buffer;
+	targa_header.idLength = *buf_p++;
+	targa_header.colorMapType = *buf_p++;
+	targa_header.imageType = *buf_p++;
+
+	targa_header.colorMapIndex = buf_p[0] + buf_p[1] * 256;
+	buf_p+=2;
+	targa_header.colorMapLength = buf_p[0] + buf_p[1] * 256;
+	buf_p+=2;
+	targa_header.colorMapSize = *buf_p++;
+	targa_header.xOrigin = LittleShort (*((short *)buf_p));
+	buf_p+=2;
+	targa_header.yOrigin = LittleShort (*((short *)buf_p));
+	buf_p+=2;
+	targa_header.width = LittleShort (*((short *)buf_p));
+	buf_p+=2;
+	targa_header.height = LittleShort (*((short *)buf_p));
+	buf_p+=2;
+	targa_header.pixelSize = *buf_p++;
+	targa_header.attributes = *buf_p++;
+
+	if (targa_header.idLength != 0)
+		buf_p += targa_header.idLength;  // skip TARGA image comment
+
+	if ((targa_header.imageType == 1) || (targa_header.imageType == 9))
+	{
+		// uncompressed colormapped image
+		if (targa_header.pixelSize != 8)
+		{
+			ri.FS_FreeFile (buffer);
+			ri.Sys_Error (ERR_DROP, "LoadTGA: (%s) Only 8 bit images supported for type 1 and 9\n", name);
+		}
+
+		if( targa_header.colorMapLength != 256 )
+		{
+			ri.FS_FreeFile (buffer);
+			ri.Sys_Error (ERR_DROP, "LoadTGA: (%s) Only 8 bit colormaps are supported for type 1 and 9\n", name);
+		}
+
+		if( targa_header.colorMapIndex )
+		{
+			ri.FS_FreeFile (buffer);
+			ri.Sys_Error (ERR_DROP, "LoadTGA: (%s) colorMapIndex is not supported for type 1 and 9", name);
+		}
+
+		if (targa_header.colorMapSize == 24)
+		{
+			for (i=0 ; i<targa_header.colorMapLength ; i++)
+			{
+				palette[i][0] = *buf_p++;
+				palette[i][1] = *buf_p++;
+				palette[i][2] = *buf_p++;
+				palette[i][3] = 255;
+			}
+		}
+		else if (targa_header.colorMapSize == 32)
+		{
+			for (i=0 ; i<targa_header.colorMapLength ; i++)
+			{
+				palette[i][0] = *buf_p++;
+				palette[i][1] = *buf_p++;
+				palette[i][2] = *buf_p++;
+				palette[i][3] = *buf_p++;
+			}
+		}
+		else
+		{
+			ri.FS_FreeFile (buffer);
+			ri.Sys_Error (ERR_DROP, "LoadTGA: (%s) Only 24 and 32 bit colormaps are supported for type 1 and 9", name);
+		}
+	}
+	else if ((targa_header.imageType == 2) || (targa_header.imageType == 10))
+	{
+		// uncompressed or RLE compressed RGB
+		if ((targa_header.pixelSize != 32) && (targa_header.pixelSize != 24))
+		{
+			ri.FS_FreeFile (buffer);
+			ri.Sys_Error (ERR_DROP, "LoadTGA: (%s) Only 32 or 24 bit images supported for type 2 and 10", name);
+		}
+	}
+	else if ((targa_header.imageType == 3) || (targa_header.imageType == 11))
+	{
+		// uncompressed greyscale
+		if (targa_header.pixelSize != 8 )
+		{
+			ri.FS_FreeFile (buffer);
+			ri.Sys_Error (ERR_DROP, "LoadTGA: (%s) Only 8 bit images supported for type 3 and 11", name);
+		}
+	}
+
+	columns = targa_header.width;
+	if (width)
+		*width = columns;
+
+	rows = targa_header.height;
+	if (height)
+		*height = rows;
+
+	targa_rgba = malloc (columns * rows * 4);
+	*pic = targa_rgba;
+
+	// if bit 5 of attributes isn't set, the image has been stored from bottom to top
+	if (targa_header.attributes & 0x20)
+	{
+		pixbuf = targa_rgba;
+		row_inc = 0;
+	}
+	else
+	{
+		pixbuf = targa_rgba + (rows - 1) * columns * 4;
+		row_inc = -columns * 4 * 2;
+	}
+
+	compressed = ((targa_header.imageType == 9) || (targa_header.imageType == 10) || (targa_header.imageType == 11));
+
+	for (row=col=0, samples=3 ; row<rows ; )
 	{
 		pixelcount = 0x10000;
 		readpixelcount = 0x10000;
@@ -2136,46 +3178,172 @@ void R_FloodFillSkin( byte *skin, int skinwidth, int skinheight )
 
 /*
 ================
-GL_ResampleTexture
+GL_ResampleSteps
+
+Byte offsets into a source row of the two pixels averaged for each
+output column. Uses buffer if it holds them, otherwise mallocs.
 ================
 */
-void GL_ResampleTexture (unsigned *in, int inwidth, int inheight, unsigned *out,  int outwidth, int outheight)
+static unsigned *GL_ResampleSteps (unsigned *buffer, int bufsize, int inwidth, int outwidth)
 {
-	int		i, j;
-	unsigned	*inrow, *inrow2;
+	int			i;
+	unsigned	*steps;
 	unsigned	frac, fracstep;
-	unsigned	p1[1024], p2[1024];
-	//byte		noalpha[4] = {255,255,255,255};
-	byte		*pix1, *pix2, *pix3, *pix4;
+
+	if (outwidth * 2 > bufsize)
+	{
+		steps = malloc (outwidth * 2 * sizeof(*steps));
+		if (!steps)
+			ri.Sys_Error (ERR_DROP, "GL_ResampleTexture: out of memory");
+	}
+	else
+	{
+		steps = buffer;
+	}
 
 	fracstep = inwidth*0x10000/outwidth;
 
 	frac = fracstep>>2;
 	for (i=0 ; i<outwidth ; i++)
 	{
-		p1[i] = 4*(frac>>16);
+		steps[i] = 4*(frac>>16);
 		frac += fracstep;
 	}
 
 	frac = 3*(fracstep>>2);
 	for (i=0 ; i<outwidth ; i++)
 	{
-		p2[i] = 4*(frac>>16);
+		steps[outwidth+i] = 4*(frac>>16);
 		frac += fracstep;
 	}
 
+	return steps;
+}
+
+/*
+================
+GL_ResampleTexture_C
+
+Reference version of the SSE2 path, they must give identical results.
+================
+*/
+static void GL_ResampleTexture_C (const unsigned *in, int inwidth, int inheight, unsigned *out,  int outwidth, int outheight)
+{
+	int			i, j;
+	const unsigned	*inrow, *inrow2;
+	unsigned	buffer[2048];
+	unsigned	*p1, *p2;
+	const byte	*pix1, *pix2, *pix3, *pix4;
+
+	p1 = GL_ResampleSteps (buffer, sizeof(buffer) / sizeof(buffer[0]), inwidth, outwidth);
+	p2 = p1 + outwidth;
+
 	for (i=0 ; i<outheight ; i++, out += outwidth)
 	{
 		inrow = in + inwidth*(int)((i+0.25f)*inheight/outheight);
 		inrow2 = in + inwidth*(int)((i+0.75f)*inheight/outheight);
 
-		frac = fracstep >> 1;
 		for (j=0 ; j<outwidth ; j++)
 		{
-			pix1 = (byte *)inrow + p1[j];
-			pix2 = (byte *)inrow + p2[j];
-			pix3 = (byte *)inrow2 + p1[j];
-			pix4 = (byte *)inrow2 + p2[j];
+			pix1 = (const byte *)inrow + p1[j];
+			pix2 = (const byte *)inrow + p2[j];
+			pix3 = (const byte *)inrow2 + p1[j];
+			pix4 = (const byte *)inrow2 + p2[j];
+
+			((byte *)(out+j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0])>>2;
+			((byte *)(out+j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1])>>2;
+			((byte *)(out+j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2])>>2;
+			((byte *)(out+j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3])>>2;
+		}
+	}
+
+	if (p1 != buffer)
+		free (p1);
+}
+
+#ifdef R_SSE2
+#define	PIXEL_AT(row,offset)	(*(const int *)((const byte *)(row) + (offset)))
+
+/*
+================
+GL_ResampleTexture_SSE2
+
+Averages four pixels at a time in 16 bit lanes. Halving a texture (the
+usual case, high res replacements over MAX_TEXTURE_DIMENSIONS) reads
+the source rows straight, anything else gathers the pixels through the
+same step tables as the C version.
+================
+*/
+static void GL_ResampleTexture_SSE2 (const unsigned *in, int inwidth, int inheight, unsigned *out,  int outwidth, int outheight)
+{
+	int			i, j;
+	const unsigned	*inrow, *inrow2;
+	unsigned	buffer[2048];
+	unsigned	*p1, *p2;
+	const byte	*pix1, *pix2, *pix3, *pix4;
+	qboolean	halve;
+	__m128i		zero, a, b, c, d, lo, hi;
+
+	p1 = GL_ResampleSteps (buffer, sizeof(buffer) / sizeof(buffer[0]), inwidth, outwidth);
+	p2 = p1 + outwidth;
+
+	//the steps then pick pixels 2j and 2j+1
+	halve = (inwidth == outwidth * 2);
+
+	zero = _mm_setzero_si128 ();
+
+	for (i=0 ; i<outheight ; i++, out += outwidth)
+	{
+		inrow = in + inwidth*(int)((i+0.25f)*inheight/outheight);
+		inrow2 = in + inwidth*(int)((i+0.75f)*inheight/outheight);
+
+		j = 0;
+
+		if (halve)
+		{
+			for ( ; j + 4 <= outwidth; j += 4)
+			{
+				a = _mm_loadu_si128 ((const __m128i *)(inrow + j * 2));
+				b = _mm_loadu_si128 ((const __m128i *)(inrow2 + j * 2));
+				c = _mm_loadu_si128 ((const __m128i *)(inrow + j * 2 + 4));
+				d = _mm_loadu_si128 ((const __m128i *)(inrow2 + j * 2 + 4));
+
+				//rows summed, pixels 0,1 in lo and 2,3 in hi
+				lo = _mm_add_epi16 (_mm_unpacklo_epi8 (a, zero), _mm_unpacklo_epi8 (b, zero));
+				hi = _mm_add_epi16 (_mm_unpackhi_epi8 (a, zero), _mm_unpackhi_epi8 (b, zero));
+				a = _mm_add_epi16 (_mm_unpacklo_epi64 (lo, hi), _mm_unpackhi_epi64 (lo, hi));
+
+				lo = _mm_add_epi16 (_mm_unpacklo_epi8 (c, zero), _mm_unpacklo_epi8 (d, zero));
+				hi = _mm_add_epi16 (_mm_unpackhi_epi8 (c, zero), _mm_unpackhi_epi8 (d, zero));
+				c = _mm_add_epi16 (_mm_unpacklo_epi64 (lo, hi), _mm_unpackhi_epi64 (lo, hi));
+
+				_mm_storeu_si128 ((__m128i *)(out + j), _mm_packus_epi16 (_mm_srli_epi16 (a, 2), _mm_srli_epi16 (c, 2)));
+			}
+		}
+		else
+		{
+			for ( ; j + 4 <= outwidth; j += 4)
+			{
+				a = _mm_set_epi32 (PIXEL_AT(inrow, p1[j+3]), PIXEL_AT(inrow, p1[j+2]), PIXEL_AT(inrow, p1[j+1]), PIXEL_AT(inrow, p1[j]));
+				b = _mm_set_epi32 (PIXEL_AT(inrow, p2[j+3]), PIXEL_AT(inrow, p2[j+2]), PIXEL_AT(inrow, p2[j+1]), PIXEL_AT(inrow, p2[j]));
+				c = _mm_set_epi32 (PIXEL_AT(inrow2, p1[j+3]), PIXEL_AT(inrow2, p1[j+2]), PIXEL_AT(inrow2, p1[j+1]), PIXEL_AT(inrow2, p1[j]));
+				d = _mm_set_epi32 (PIXEL_AT(inrow2, p2[j+3]), PIXEL_AT(inrow2, p2[j+2]), PIXEL_AT(inrow2, p2[j+1]), PIXEL_AT(inrow2, p2[j]));
+
+				lo = _mm_add_epi16 (_mm_add_epi16 (_mm_unpacklo_epi8 (a, zero), _mm_unpacklo_epi8 (b, zero)),
+									_mm_add_epi16 (_mm_unpacklo_epi8 (c, zero), _mm_unpacklo_epi8 (d, zero)));
+				hi = _mm_add_epi16 (_mm_add_epi16 (_mm_unpackhi_epi8 (a, zero), _mm_unpackhi_epi8 (b, zero)),
+									_mm_add_epi16 (_mm_unpackhi_epi8 (c, zero), _mm_unpackhi_epi8 (d, zero)));
+
+				_mm_storeu_si128 ((__m128i *)(out + j), _mm_packus_epi16 (_mm_srli_epi16 (lo, 2), _mm_srli_epi16 (hi, 2)));
+			}
+		}
+
+		for ( ; j<outwidth ; j++)
+		{
+			pix1 = (const byte *)inrow + p1[j];
+			pix2 = (const byte *)inrow + p2[j];
+			pix3 = (const byte *)inrow2 + p1[j];
+			pix4 = (const byte *)inrow2 + p2[j];
 
 			((byte *)(out+j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0])>>2;
 			((byte *)(out+j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1])>>2;
@@ -2183,6 +3351,24 @@ void GL_ResampleTexture (unsigned *in, int inwidth, int inheight, unsigned *out,
 			((byte *)(out+j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3])>>2;
 		}
 	}
+
+	if (p1 != buffer)
+		free (p1);
+}
+#endif
+
+/*
+================
+GL_ResampleTexture
+================
+*/
+void GL_ResampleTexture (unsigned *in, int inwidth, int inheight, unsigned *out,  int outwidth, int outheight)
+{
+#ifdef R_SSE2
+	GL_ResampleTexture_SSE2 (in, inwidth, inheight, out, outwidth, outheight);
+#else
+	GL_ResampleTexture_C (in, inwidth, inheight, out, outwidth, outheight);
+#endif
 }
 
 void GL_ResampleTexture24(unsigned *in, int inwidth, int inheight, unsigned *out,  int outwidth, int outheight)
@@ -2324,95 +3510,248 @@ lighting range
 ================
 */
 void GL_LightScaleTexture (unsigned *in, int inwidth, int inheight, qboolean only_gamma)
+{
+	const byte	*table;
+	int			i, c;
+	byte		*p;
+
+	table = only_gamma ? gammatable : gammaintensitytable;
+
+	//r1: gamma 1 and intensity 1 do nothing, don't bother. there's no
+	//SSE2 version of the rest, it has no byte table lookup.
+	for (i = 0; i < 256; i++)
+	{
+		if (table[i] != i)
+			break;
+	}
+
+	if (i == 256)
+		return;
+
+	p = (byte *)in;
+
+	c = inwidth*inheight;
+	for (i=0 ; i<c ; i++, p+=4)
+	{
+		p[0] = table[p[0]];
+		p[1] = table[p[1]];
+		p[2] = table[p[2]];
+	}
+}
+
+void GL_LightScaleTexture24 (unsigned *in, int inwidth, int inheight, qboolean only_gamma)
 {
 	if ( only_gamma )
 	{
 		int		i, c;
 		byte	*p;
 
-		p = (byte *)in;
+		p = (byte *)in;
+
+		c = inwidth*inheight;
+		for (i=0 ; i<c ; i++, p+=3)
+		{
+			p[0] = gammatable[p[0]];
+			p[1] = gammatable[p[1]];
+			p[2] = gammatable[p[2]];
+		}
+	}
+	else
+	{
+		int		i, c;
+		byte	*p;
+
+		p = (byte *)in;
+
+		c = inwidth*inheight;
+		for (i=0 ; i<c ; i++, p+=3)
+		{
+			p[0] = gammaintensitytable[p[0]];
+			p[1] = gammaintensitytable[p[1]];
+			p[2] = gammaintensitytable[p[2]];
+		}
+	}
+}
+
+/*
+================
+GL_MipMapLinear_C
+
+Reference version of the SSE2 path, they must give identical results.
+Wraps around the edges by masking, so only right for power of two
+sizes, which is all it was ever used with.
+================
+*/
+static void GL_MipMapLinear_C (const unsigned *in, int inWidth, int inHeight, unsigned *out)
+{
+	int			i, j, k;
+	byte		*outpix;
+	int			inWidthMask, inHeightMask;
+	int			total;
+	int			outWidth, outHeight;
+
+	outWidth = inWidth >> 1;
+	outHeight = inHeight >> 1;
+
+	inWidthMask = inWidth - 1;
+	inHeightMask = inHeight - 1;
+
+	for ( i = 0 ; i < outHeight ; i++ )
+	{
+		for ( j = 0 ; j < outWidth ; j++ )
+		{
+			outpix = (byte *) ( out + i * outWidth + j );
+			for ( k = 0 ; k < 4 ; k++ )
+			{
+				total = 
+					1 * ((const byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
+					2 * ((const byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
+					2 * ((const byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
+					1 * ((const byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
+
+					2 * ((const byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
+					4 * ((const byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
+					4 * ((const byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
+					2 * ((const byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
+
+					2 * ((const byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
+					4 * ((const byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
+					4 * ((const byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
+					2 * ((const byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
+
+					1 * ((const byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
+					2 * ((const byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
+					2 * ((const byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
+					1 * ((const byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k];
+				outpix[k] = total / 36;
+			}
+		}
+	}
+}
+
+#ifdef R_SSE2
+/*
+================
+GL_MipMapLinear_SSE2
+
+The 1 2 2 1 filter is separable, so each output row first sums its four
+source rows into 16 bit columns (at most 6*255), then each output pixel
+sums four of those (at most 36*255). total / 36 is exactly
+(total * 58255) >> 21 over that range, which mulhi can do.
+================
+*/
+static void GL_MipMapLinear_SSE2 (const unsigned *in, int inWidth, int inHeight, unsigned *out)
+{
+	int				i, j, x;
+	int				outWidth, outHeight;
+	unsigned short	buffer[(MAX_TEXTURE_DIMENSIONS + 2) * 4];
+	unsigned short	*cols, *c;
+	const byte		*r0, *r1, *r2, *r3;
+	__m128i			zero, scale, a0, a1, a2, a3, l0, l1, l2, sum;
+
+	outWidth = inWidth >> 1;
+	outHeight = inHeight >> 1;
 
-		c = inwidth*inheight;
-		for (i=0 ; i<c ; i++, p+=4)
-		{
-			p[0] = gammatable[p[0]];
-			p[1] = gammatable[p[1]];
-			p[2] = gammatable[p[2]];
-		}
+	if (!outWidth || !outHeight)
+		return;
+
+	//columns -1 to inWidth, wrapped
+	if (inWidth > MAX_TEXTURE_DIMENSIONS)
+	{
+		cols = malloc ((inWidth + 2) * 4 * sizeof(*cols));
+		if (!cols)
+			ri.Sys_Error (ERR_DROP, "GL_MipMapLinear: Out of memory");
 	}
 	else
 	{
-		int		i, c;
-		byte	*p;
+		cols = buffer;
+	}
 
-		p = (byte *)in;
+	zero = _mm_setzero_si128 ();
+	scale = _mm_set1_epi16 ((short)58255);
 
-		c = inwidth*inheight;
+	for (i = 0; i < outHeight; i++, out += outWidth)
+	{
+		r0 = (const byte *)(in + ((i*2-1) & (inHeight-1)) * inWidth);
+		r1 = (const byte *)(in + (i*2) * inWidth);
+		r2 = (const byte *)(in + (i*2+1) * inWidth);
+		r3 = (const byte *)(in + ((i*2+2) & (inHeight-1)) * inWidth);
 
-		for (i=0 ; i<c ; i++, p+=4)
+		c = cols + 4;
+		for (x = 0; x + 4 <= inWidth; x += 4, c += 16)
 		{
-			p[0] = gammaintensitytable[p[0]];
-			p[1] = gammaintensitytable[p[1]];
-			p[2] = gammaintensitytable[p[2]];
+			a0 = _mm_loadu_si128 ((const __m128i *)(r0 + x * 4));
+			a1 = _mm_loadu_si128 ((const __m128i *)(r1 + x * 4));
+			a2 = _mm_loadu_si128 ((const __m128i *)(r2 + x * 4));
+			a3 = _mm_loadu_si128 ((const __m128i *)(r3 + x * 4));
+
+			sum = _mm_add_epi16 (_mm_add_epi16 (_mm_unpacklo_epi8 (a0, zero), _mm_unpacklo_epi8 (a3, zero)),
+								 _mm_slli_epi16 (_mm_add_epi16 (_mm_unpacklo_epi8 (a1, zero), _mm_unpacklo_epi8 (a2, zero)), 1));
+			_mm_storeu_si128 ((__m128i *)c, sum);
+
+			sum = _mm_add_epi16 (_mm_add_epi16 (_mm_unpackhi_epi8 (a0, zero), _mm_unpackhi_epi8 (a3, zero)),
+								 _mm_slli_epi16 (_mm_add_epi16 (_mm_unpackhi_epi8 (a1, zero), _mm_unpackhi_epi8 (a2, zero)), 1));
+			_mm_storeu_si128 ((__m128i *)(c + 8), sum);
 		}
-	}
-}
 
-void GL_LightScaleTexture24 (unsigned *in, int inwidth, int inheight, qboolean only_gamma)
-{
-	if ( only_gamma )
-	{
-		int		i, c;
-		byte	*p;
-
-		p = (byte *)in;
+		for (x *= 4; x < inWidth * 4; x++)
+			cols[4 + x] = r0[x] + 2 * r1[x] + 2 * r2[x] + r3[x];
 
-		c = inwidth*inheight;
-		for (i=0 ; i<c ; i++, p+=3)
+		for (x = 0; x < 4; x++)
 		{
-			p[0] = gammatable[p[0]];
-			p[1] = gammatable[p[1]];
-			p[2] = gammatable[p[2]];
+			cols[x] = cols[inWidth * 4 + x];
+			cols[(inWidth + 1) * 4 + x] = cols[4 + x];
 		}
-	}
-	else
-	{
-		int		i, c;
-		byte	*p;
 
-		p = (byte *)in;
+		//two output pixels at a time, each from source columns 2j-1 .. 2j+2
+		for (j = 0; j + 2 <= outWidth; j += 2)
+		{
+			l0 = _mm_loadu_si128 ((const __m128i *)(cols + j * 8));
+			l1 = _mm_loadu_si128 ((const __m128i *)(cols + j * 8 + 8));
+			l2 = _mm_loadu_si128 ((const __m128i *)(cols + j * 8 + 16));
 
-		c = inwidth*inheight;
-		for (i=0 ; i<c ; i++, p+=3)
+			sum = _mm_add_epi16 (_mm_add_epi16 (_mm_unpacklo_epi64 (l0, l1), _mm_unpackhi_epi64 (l1, l2)),
+								 _mm_slli_epi16 (_mm_add_epi16 (_mm_unpackhi_epi64 (l0, l1), _mm_unpacklo_epi64 (l1, l2)), 1));
+			sum = _mm_srli_epi16 (_mm_mulhi_epu16 (sum, scale), 5);
+
+			_mm_storel_epi64 ((__m128i *)(out + j), _mm_packus_epi16 (sum, zero));
+		}
+
+		for ( ; j < outWidth; j++)
 		{
-			p[0] = gammaintensitytable[p[0]];
-			p[1] = gammaintensitytable[p[1]];
-			p[2] = gammaintensitytable[p[2]];
+			c = cols + j * 8;
+			for (x = 0; x < 4; x++)
+				((byte *)(out + j))[x] = (c[x] + 2 * c[4 + x] + 2 * c[8 + x] + c[12 + x]) / 36;
 		}
 	}
+
+	if (cols != buffer)
+		free (cols);
 }
+#endif
 
 /*
 ================
 R_MipMap2
 
 Operates in place, quartering the size of the texture
-Proper linear filter
+Proper linear filter. The result goes through temp if given, otherwise
+through a buffer picked here (main thread only).
 ================
 */
-static void GL_MipMapLinear (unsigned *in, int inWidth, int inHeight)
+static void GL_MipMapLinear (unsigned *in, int inWidth, int inHeight, unsigned *temp)
 {
-	int			i, j, k;
-	byte		*outpix;
-	int			inWidthMask, inHeightMask;
-	int			total;
 	int			outWidth, outHeight;
-	unsigned	*temp;
+	unsigned	*buffer;
 
 	outWidth = inWidth >> 1;
 	outHeight = inHeight >> 1;
 
-	if (r_registering)
+	if (temp)
+	{
+		buffer = temp;
+	}
+	else if (r_registering && outWidth * outHeight <= MAX_TEXTURE_DIMENSIONS * MAX_TEXTURE_DIMENSIONS)
 	{
 		if (!mipmap_buffer)
 			mipmap_buffer = malloc (MAX_TEXTURE_DIMENSIONS * MAX_TEXTURE_DIMENSIONS * sizeof(int));
@@ -2420,71 +3759,46 @@ static void GL_MipMapLinear (unsigned *in, int inWidth, int inHeight)
 		if (!mipmap_buffer)
 			ri.Sys_Error (ERR_DROP, "GL_MipMapLinear: Out of memory");
 
-		temp = mipmap_buffer;
+		buffer = mipmap_buffer;
 	}
 	else
 	{
-		temp = malloc (outWidth * outHeight * sizeof(int));
-		if (!temp)
+		buffer = malloc (outWidth * outHeight * sizeof(int));
+		if (!buffer)
 			ri.Sys_Error (ERR_DROP, "GL_MipMapLinear: Out of memory");
 	}
 
-	inWidthMask = inWidth - 1;
-	inHeightMask = inHeight - 1;
-
-	for ( i = 0 ; i < outHeight ; i++ )
-	{
-		for ( j = 0 ; j < outWidth ; j++ )
-		{
-			outpix = (byte *) ( temp + i * outWidth + j );
-			for ( k = 0 ; k < 4 ; k++ )
-			{
-				total = 
-					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					2 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					2 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					4 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+1)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k] +
-
-					1 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2)&inWidthMask) ])[k] +
-					2 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+1)&inWidthMask) ])[k] +
-					1 * ((byte *)&in[ ((i*2+2)&inHeightMask)*inWidth + ((j*2+2)&inWidthMask) ])[k];
-				outpix[k] = total / 36;
-			}
-		}
-	}
+#ifdef R_SSE2
+	//the SSE2 path wraps at the edges properly, which only matches the
+	//C version's masking for powers of two
+	if (!(inWidth & (inWidth - 1)) && !(inHeight & (inHeight - 1)))
+		GL_MipMapLinear_SSE2 (in, inWidth, inHeight, buffer);
+	else
+#endif
+		GL_MipMapLinear_C (in, inWidth, inHeight, buffer);
 
-	memcpy (in, temp, outWidth * outHeight * 4);
+	memcpy (in, buffer, outWidth * outHeight * 4);
 
-	if (temp != mipmap_buffer)
-		free (temp);
+	if (buffer != mipmap_buffer && buffer != temp)
+		free (buffer);
 }
 
 /*
 ================
 GL_MipMap
 
-Operates in place, quartering the size of the texture
+Operates in place, quartering the size of the texture. temp is passed
+on to GL_MipMapLinear.
 ================
 */
-void GL_MipMap (byte *in, int width, int height)
+void GL_MipMap (byte *in, int width, int height, unsigned *temp)
 {
 	int		i, j;
 	byte	*out;
 
 	if (FLOAT_NE_ZERO(gl_linear_mipmaps->value))
 	{
-		GL_MipMapLinear ((unsigned int *)in, width, height);
+		GL_MipMapLinear ((unsigned int *)in, width, height, temp);
 		return;
 	}
 
@@ -2503,53 +3817,308 @@ void GL_MipMap (byte *in, int width, int height)
 	}
 }
 
-int		upload_width, upload_height;
+/*
+===============
+GL_ImageBench_f
 
-qboolean GL_Upload32 (unsigned *data, int width, int height, qboolean mipmap, int bpp, image_t *image)
+Runs the texture processing kernels over a random image (2048x2048 by
+default, the size of a typical high res replacement) through both the
+C and the SSE2 versions, checks they agree byte for byte and prints how
+long each took.
+===============
+*/
+#ifdef R_SSE2
+#define	IMAGEBENCH_PASSES	4
+
+static void GL_ImageBenchResult (const char *name, unsigned c, unsigned simd, const void *out1, const void *out2, int size)
 {
-	int			samples;
-	unsigned	*scaled = NULL;
-	int			scaled_width, scaled_height;
-	int			i, c;
-	//byte		*scan;
-	int comp;
+	ri.Con_Printf (PRINT_ALL, "%-20s %5u ms C, %5u ms SSE2, %s\n", name, c, simd, memcmp (out1, out2, size) ? "MISMATCH" : "identical");
+}
+#endif
+
+void GL_ImageBench_f (void)
+{
+#ifdef R_SSE2
+	unsigned	*src, *out1, *out2;
+	unsigned	start, c, simd, seed;
+	int			i, pass, size, outsize;
 
+	size = ri.Cmd_Argc () > 1 ? atoi (ri.Cmd_Argv (1)) : 2048;
+
+	if (size < 4 || size > 8192 || (size & (size - 1)))
+	{
+		ri.Con_Printf (PRINT_ALL, "Usage: gl_imagebench [power of two size, 4 to 8192]\n");
+		return;
+	}
+
+	src = malloc (size * size * sizeof(*src));
+	out1 = malloc (size * size * sizeof(*out1));
+	out2 = malloc (size * size * sizeof(*out2));
+
+	if (!src || !out1 || !out2)
+	{
+		ri.Con_Printf (PRINT_ALL, "gl_imagebench: out of memory\n");
+		free (src);
+		free (out1);
+		free (out2);
+		return;
+	}
+
+	seed = 0x1337;
+	for (i = 0; i < size * size; i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		src[i] = seed;
+	}
+
+	ri.Con_Printf (PRINT_ALL, "%dx%d, %d passes each:\n", size, size, IMAGEBENCH_PASSES);
+
+	//halving takes the direct path, 3/4 the gathering one
+	outsize = size / 2;
+	start = Sys_Milliseconds ();
+	for (pass = 0; pass < IMAGEBENCH_PASSES; pass++)
+		GL_ResampleTexture_C (src, size, size, out1, outsize, outsize);
+	c = Sys_Milliseconds () - start;
+
+	start = Sys_Milliseconds ();
+	for (pass = 0; pass < IMAGEBENCH_PASSES; pass++)
+		GL_ResampleTexture_SSE2 (src, size, size, out2, outsize, outsize);
+	simd = Sys_Milliseconds () - start;
+	GL_ImageBenchResult ("resample 1/2", c, simd, out1, out2, outsize * outsize * 4);
+
+	outsize = size / 4 * 3;
+	start = Sys_Milliseconds ();
+	for (pass = 0; pass < IMAGEBENCH_PASSES; pass++)
+		GL_ResampleTexture_C (src, size, size, out1, outsize, outsize);
+	c = Sys_Milliseconds () - start;
+
+	start = Sys_Milliseconds ();
+	for (pass = 0; pass < IMAGEBENCH_PASSES; pass++)
+		GL_ResampleTexture_SSE2 (src, size, size, out2, outsize, outsize);
+	simd = Sys_Milliseconds () - start;
+	GL_ImageBenchResult ("resample 3/4", c, simd, out1, out2, outsize * outsize * 4);
+
+	outsize = size / 2;
+	start = Sys_Milliseconds ();
+	for (pass = 0; pass < IMAGEBENCH_PASSES; pass++)
+		GL_MipMapLinear_C (src, size, size, out1);
+	c = Sys_Milliseconds () - start;
+
+	start = Sys_Milliseconds ();
+	for (pass = 0; pass < IMAGEBENCH_PASSES; pass++)
+		GL_MipMapLinear_SSE2 (src, size, size, out2);
+	simd = Sys_Milliseconds () - start;
+	GL_ImageBenchResult ("linear mipmap", c, simd, out1, out2, outsize * outsize * 4);
+
+	free (src);
+	free (out1);
+	free (out2);
+#else
+	ri.Con_Printf (PRINT_ALL, "This build has no SSE2 texture code.\n");
+#endif
+}
+
+/*
+===============
+GL_UploadSize
+
+The size an image is uploaded at before mipmapping.
+===============
+*/
+static void GL_UploadSize (int width, int height, qboolean mipmap, int *scaled_width, int *scaled_height)
+{
 	if (gl_config.r1gl_GL_ARB_texture_non_power_of_two)
 	{
-		scaled_width = width;
-		scaled_height = height;
+		*scaled_width = width;
+		*scaled_height = height;
 	}
 	else
 	{
-		for (scaled_width = 1 ; scaled_width < width ; scaled_width<<=1)
+		for (*scaled_width = 1 ; *scaled_width < width ; *scaled_width<<=1)
 			;
-		if (FLOAT_NE_ZERO(gl_round_down->value) && scaled_width > width && mipmap)
-			scaled_width >>= 1;
-		for (scaled_height = 1 ; scaled_height < height ; scaled_height<<=1)
+		if (FLOAT_NE_ZERO(gl_round_down->value) && *scaled_width > width && mipmap)
+			*scaled_width >>= 1;
+		for (*scaled_height = 1 ; *scaled_height < height ; *scaled_height<<=1)
 			;
-		if (FLOAT_NE_ZERO(gl_round_down->value) && scaled_height > height && mipmap)
-			scaled_height >>= 1;
+		if (FLOAT_NE_ZERO(gl_round_down->value) && *scaled_height > height && mipmap)
+			*scaled_height >>= 1;
 	}
 
 	// let people sample down the world textures for speed
 	if (mipmap)
 	{
-		scaled_width >>= (int)gl_picmip->value;
-		scaled_height >>= (int)gl_picmip->value;
+		*scaled_width >>= (int)gl_picmip->value;
+		*scaled_height >>= (int)gl_picmip->value;
 	}
 
 	// don't ever bother with >256 textures
-	if (scaled_width > MAX_TEXTURE_DIMENSIONS)
-		scaled_width = MAX_TEXTURE_DIMENSIONS;
+	if (*scaled_width > MAX_TEXTURE_DIMENSIONS)
+		*scaled_width = MAX_TEXTURE_DIMENSIONS;
+
+	if (*scaled_height > MAX_TEXTURE_DIMENSIONS)
+		*scaled_height = MAX_TEXTURE_DIMENSIONS;
+
+	if (*scaled_width < 1)
+		*scaled_width = 1;
+
+	if (*scaled_height < 1)
+		*scaled_height = 1;
+}
+
+/*
+===============
+GL_BuildMipChain
+
+Does everything GL_Upload32 does to a 32 bit image before handing it to
+GL: resampling, light scaling or filtering and the mip levels, which
+come back in the texture cache file layout ready for GL_TexCacheUpload.
+key and sourcelen are left for GL_TexCacheWrite. Returns NULL if out of
+memory. Uses no GL and no shared buffers, so the decoder threads run it
+as well.
+===============
+*/
+static byte *GL_BuildMipChain (unsigned *data, int width, int height, imagetype_t type)
+{
+	texcachehdr_t	*hdr;
+	qboolean		mipmap;
+	byte			*file;
+	unsigned		*level, *temp;
+	int				scaled_width, scaled_height, w, h;
+	int				levels, size, length;
+
+	//see GL_LoadPic
+	mipmap = (type != it_pic && type != it_sky) ? true : false;
+
+	GL_UploadSize (width, height, mipmap, &scaled_width, &scaled_height);
+
+	w = scaled_width;
+	h = scaled_height;
+	levels = 1;
+	size = sizeof(*hdr) + 2 * sizeof(int) + w * h * 4;
+
+	while (mipmap && (w > 1 || h > 1))
+	{
+		w = w > 1 ? w >> 1 : 1;
+		h = h > 1 ? h >> 1 : 1;
+		levels++;
+		size += 2 * sizeof(int) + w * h * 4;
+	}
+
+	file = malloc (size);
+	if (!file)
+		return NULL;
+
+	//level 0 is built in place, the others in the work buffer as the
+	//filters only go in place
+	level = (unsigned *)(file + sizeof(*hdr) + 2 * sizeof(int));
+	((int *)(file + sizeof(*hdr)))[0] = scaled_width;
+	((int *)(file + sizeof(*hdr)))[1] = scaled_height;
+
+	if (scaled_width == width && scaled_height == height)
+		memcpy (level, data, width * height * 4);
+	else
+		GL_ResampleTexture (data, width, height, level, scaled_width, scaled_height);
+
+	//pics uploaded as they are don't get light scaled
+	if ((mipmap || scaled_width != width || scaled_height != height) && (type != it_pic || FLOAT_NE_ZERO(vid_gamma_pics->value)))
+	{
+		if (FLOAT_EQ_ZERO(gl_texture_lighting_mode->value))
+			GL_LightScaleTexture (level, scaled_width, scaled_height, !mipmap);
+		else
+			R_FilterTexture (level, scaled_width, scaled_height, type);
+	}
+
+	length = 2 * sizeof(int) + scaled_width * scaled_height * 4;
+
+	if (levels > 1)
+	{
+		w = scaled_width;
+		h = scaled_height;
+
+		//the box filter reads past the end of odd width images, zeroed
+		//slack keeps that inside the buffer and the result repeatable
+		temp = calloc (w * h * 2 + (w >> 1) * (h >> 1), 4);
+		if (!temp)
+		{
+			free (file);
+			return NULL;
+		}
+
+		memcpy (temp, level, w * h * 4);
+
+		while (w > 1 || h > 1)
+		{
+			GL_MipMap ((byte *)temp, w, h, temp + w * h * 2);
+
+			w = w > 1 ? w >> 1 : 1;
+			h = h > 1 ? h >> 1 : 1;
+
+			length = GL_TexCacheAppend (file + sizeof(*hdr), length, size - sizeof(*hdr), temp, w, h);
+		}
+
+		free (temp);
+	}
+
+	hdr = (texcachehdr_t *)file;
+	hdr->width = width;
+	hdr->height = height;
+	hdr->has_alpha = true;
+	hdr->levels = levels;
+
+	return file;
+}
+
+int		upload_width, upload_height;
+
+qboolean GL_Upload32 (unsigned *data, int width, int height, qboolean mipmap, int bpp, image_t *image)
+{
+	int			samples;
+	unsigned	*scaled = NULL;
+	int			scaled_width, scaled_height;
+	int			i, c;
+	//byte		*scan;
+	int comp;
+	byte		*chain;
+
+	//32 bit images go through GL_BuildMipChain, which a decoder thread
+	//may have done already or an earlier map load left in the texture
+	//cache. only the uploads are left.
+	if (image && bpp == 32)
+	{
+		if (upload_cache.file && (byte *)data == upload_cache.file)
+		{
+			chain = upload_cache.file;
+		}
+		else
+		{
+			chain = GL_BuildMipChain (data, width, height, image->type);
+			if (!chain)
+				ri.Sys_Error (ERR_DROP, "GL_Upload32: %s: out of memory", current_texture_filename);
+		}
+
+		if (((texcachehdr_t *)chain)->has_alpha)
+		{
+			samples = gl_alpha_format;
+			comp = gl_tex_alpha_format;
+		}
+		else
+		{
+			samples = gl_solid_format;
+			comp = gl_tex_solid_format;
+		}
+
+		GL_TexCacheUpload (chain, comp, &upload_width, &upload_height);
 
-	if (scaled_height > MAX_TEXTURE_DIMENSIONS)
-		scaled_height = MAX_TEXTURE_DIMENSIONS;
+		if (upload_cache.key && (chain != upload_cache.file || upload_cache.built))
+			GL_TexCacheWrite (&upload_cache, chain);
 
-	if (scaled_width < 1)
-		scaled_width = 1;
+		if (chain != upload_cache.file)
+			free (chain);
 
-	if (scaled_height < 1)
-		scaled_height = 1;
+		goto done;
+	}
+
+	GL_UploadSize (width, height, mipmap, &scaled_width, &scaled_height);
 
 	upload_width = scaled_width;
 	upload_height = scaled_height;
@@ -2660,7 +4229,7 @@ qboolean GL_Upload32 (unsigned *data, int width, int height, qboolean mipmap, in
 		miplevel = 0;
 		while (scaled_width > 1 || scaled_height > 1)
 		{
-			GL_MipMap ((byte *)scaled, scaled_width, scaled_height);
+			GL_MipMap ((byte *)scaled, scaled_width, scaled_height, NULL);
 
 			if (gl_config.r1gl_GL_ARB_texture_non_power_of_two)
 			{
@@ -2838,7 +4407,7 @@ image_t *GL_LoadPic (const char *name, byte *pic, int width, int height, imagety
 	image->type = type;
 	//image->scrap = false;
 
-	if (type == it_skin)// && bits == 8)
+	if (type == it_skin && pic != upload_cache.file)// && bits == 8)
 		R_FloodFillSkin(pic, width, height);
 
 	// load little pics into the scrap
@@ -3015,6 +4584,54 @@ image_t	*GL_FindImageBase (const char *basename, imagetype_t type)
 	return NULL;
 }
 
+static int	image_probes;
+static int	image_probes_skipped;
+
+/*
+===============
+GL_ImageExtensions
+
+FS_EXT_* bits of the image files that exist for name, with or without
+its extension. Everything is assumed to exist if the engine can't say.
+===============
+*/
+int GL_ImageExtensions (const char *name)
+{
+	char	basename[MAX_QPATH];
+	char	*ext;
+
+	if (!rx.FS_ImageExtensions)
+		return FS_EXT_ALL;
+
+	Q_strncpy (basename, name, sizeof(basename)-1);
+
+	ext = strrchr (basename, '.');
+	if (ext && !strchr (ext, '/'))
+		*ext = 0;
+
+	return rx.FS_ImageExtensions (basename);
+}
+
+/*
+===============
+GL_ProbeImage
+
+Whether a format is worth trying to load for an image, counting the
+filesystem lookups the index saved for imagelist.
+===============
+*/
+qboolean GL_ProbeImage (int extensions, int ext)
+{
+	if (extensions & ext)
+	{
+		image_probes++;
+		return true;
+	}
+
+	image_probes_skipped++;
+	return false;
+}
+
 /*
 ===============
 GL_FindImage
@@ -3030,6 +4647,7 @@ image_t	*GL_FindImage (const char *name, const char *basename, imagetype_t type)
 	byte	*palette;
 	size_t	len;
 	int		width, height, bpp;
+	int		extensions;
 	unsigned long hash;
 
 	hash = hashify(basename) % IMAGES_HASH_SIZE;
@@ -3084,38 +4702,41 @@ image_t	*GL_FindImage (const char *name, const char *basename, imagetype_t type)
 			}
 		}
 
-		if (load_tga_pics)
+		extensions = GL_ImageExtensions (name);
+
+		if (load_tga_pics && GL_ProbeImage (extensions, FS_EXT_TGA))
 		{
 			//png_name[len-3] = 't';
 			//png_name[len-2] = 'g';
 			//png_name[len-1] = 'a';
 			*(int *)(png_name + (len-3)) = '\0agt';
 			current_texture_filename = png_name;
-			LoadTGA (png_name, &pic, &width, &height);
+			LoadImage32 (png_name, IMG_TGA, type, &pic, &width, &height);
 		}
 		if (!pic)
 		{
-			if (load_png_pics)
+			if (load_png_pics && GL_ProbeImage (extensions, FS_EXT_PNG))
 			{
 				//png_name[len-3] = 'p';
 				//png_name[len-2] = 'n';
 				//png_name[len-1] = 'g';
 				*(int *)(png_name + (len-3)) = '\0gnp';
-				LoadPNG (png_name, &pic, &width, &height);
+				LoadImage32 (png_name, IMG_PNG, type, &pic, &width, &height);
 			}
 			if (!pic)
 			{
-				if (load_jpg_pics)
+				if (load_jpg_pics && GL_ProbeImage (extensions, FS_EXT_JPG))
 				{
 					//png_name[len-3] = 'j';
 					//png_name[len-2] = 'p';
 					*(int *)(png_name + (len-3)) = '\0gpj';
-					LoadJPG (png_name, &pic, &width, &height);
+					LoadImage32 (png_name, IMG_JPG, type, &pic, &width, &height);
 				}
 				if (!pic)
 				{
 					current_texture_filename = name;
-					LoadPCX (name, &pic, &palette, &width, &height);
+					if (GL_ProbeImage (extensions, FS_EXT_PCX))
+						LoadPCX (name, &pic, &palette, &width, &height);
 					if (!pic)
 						return NULL;
 					bpp = 8;
@@ -3138,7 +4759,7 @@ image_t	*GL_FindImage (const char *name, const char *basename, imagetype_t type)
 	}
 	else if (!strcmp(name+len-4, ".png"))
 	{
-		LoadPNG (name, &pic, &width, &height);
+		LoadImage32 (name, IMG_PNG, type, &pic, &width, &height);
 		if (!pic)
 			return NULL; // ri.Sys_Error (ERR_DROP, "GL_FindImage: can't load %s", name);
 		image = GL_LoadPic (name, pic, width, height, type, 32);
@@ -3151,14 +4772,14 @@ image_t	*GL_FindImage (const char *name, const char *basename, imagetype_t type)
 	}
 	else if (!strcmp(name+len-4, ".jpg"))
 	{
-		LoadJPG (name, &pic, &width, &height);
+		LoadImage32 (name, IMG_JPG, type, &pic, &width, &height);
 		if (!pic)
 			return NULL;
 		image = GL_LoadPic (name, pic, width, height, type, 32);
 	}
 	else if (!strcmp(name+len-4, ".tga"))
 	{
-		LoadTGA (name, &pic, &width, &height);
+		LoadImage32 (name, IMG_TGA, type, &pic, &width, &height);
 		if (!pic)
 			return NULL;
 		image = GL_LoadPic (name, pic, width, height, type, 32);
@@ -3166,6 +4787,9 @@ image_t	*GL_FindImage (const char *name, const char *basename, imagetype_t type)
 	else
 		return NULL;	//	ri.Sys_Error (ERR_DROP, "GL_FindImage: bad extension on: %s", name);
 
+	upload_cache.key = 0;
+	upload_cache.file = NULL;
+
 	//newitem = rbsearch (name, rb);
 	//*newitem = image;
 
@@ -3183,6 +4807,61 @@ image_t	*GL_FindImage (const char *name, const char *basename, imagetype_t type)
 	return image;
 }
 
+/*
+===============
+GL_PrefetchFindImage
+
+Queues the file GL_FindImage would decode for name, the first tga/png/jpg
+replacement of a pcx or the image itself, unless it is loaded already.
+===============
+*/
+void GL_PrefetchFindImage (const char *name, const char *basename, imagetype_t type)
+{
+	image_t	*imghash;
+	char	replacement[MAX_QPATH];
+	size_t	len;
+	int		extensions;
+
+	for (imghash = images_hash[hashify(basename) % IMAGES_HASH_SIZE]; imghash; imghash = imghash->hash_next)
+	{
+		if (imghash->type == type && !strcmp(imghash->name, name))
+			return;
+	}
+
+	len = strlen (name);
+	if (len < 5 || len >= sizeof(replacement))
+		return;
+
+	if (strcmp (name + len - 4, ".pcx"))
+	{
+		GL_PrefetchImage (name, type);
+		return;
+	}
+
+	extensions = GL_ImageExtensions (name);
+	strcpy (replacement, name);
+
+	if (load_tga_pics && (extensions & FS_EXT_TGA))
+	{
+		strcpy (replacement + len - 3, "tga");
+		if (GL_PrefetchImage (replacement, type))
+			return;
+	}
+
+	if (load_png_pics && (extensions & FS_EXT_PNG))
+	{
+		strcpy (replacement + len - 3, "png");
+		if (GL_PrefetchImage (replacement, type))
+			return;
+	}
+
+	if (load_jpg_pics && (extensions & FS_EXT_JPG))
+	{
+		strcpy (replacement + len - 3, "jpg");
+		GL_PrefetchImage (replacement, type);
+	}
+}
+
 
 
 /*
@@ -3263,6 +4942,12 @@ void	GL_ImageList_f (void)
 	*/
 
 	ri.Con_Printf (PRINT_ALL, "Total texel count (not counting mipmaps): %i (%.2f MB)\n", texels, (texels * sizeof(int)) / 1024.0f / 1024.0f);
+
+	if (rx.FS_ImageExtensions)
+		ri.Con_Printf (PRINT_ALL, "Image file probes: %d made, %d skipped by the filesystem index\n", image_probes, image_probes_skipped);
+
+	if (FLOAT_NE_ZERO(gl_texcache->value))
+		ri.Con_Printf (PRINT_ALL, "Texture cache: %d hits, %d misses\n", texcache_hits, texcache_misses);
 }
 
 /*
@@ -3487,6 +5172,8 @@ void	GL_ShutdownImages (void)
 	int		i;
 	image_t	*image;
 
+	GL_EndPrefetch ();
+
 #ifdef RB_IMAGE_CACHE
 	DestroyImageCache ();
 #endif
@@ -110,6 +110,19 @@ DYNAMIC LIGHTS
 =============================================================================
 */
 
+#define LIGHTBENCH_FRAMES	8192
+#define LIGHTBENCH_PASSES	4
+
+typedef struct
+{
+	int			num_dlights;
+	dlight_t	dlights[MAX_DLIGHTS];
+} lightbenchframe_t;
+
+//dlights captured by "gl_lightbench start" for replaying
+static lightbenchframe_t	*lightbench_frames;
+static int					lightbench_numframes;
+
 /*
 =============
 R_MarkLights
@@ -175,6 +188,13 @@ void R_PushDlights (void)
 	int		i;
 	dlight_t	*l;
 
+	if (lightbench_frames && lightbench_numframes < LIGHTBENCH_FRAMES)
+	{
+		lightbench_frames[lightbench_numframes].num_dlights = r_newrefdef.num_dlights;
+		memcpy (lightbench_frames[lightbench_numframes].dlights, r_newrefdef.dlights, r_newrefdef.num_dlights * sizeof(dlight_t));
+		lightbench_numframes++;
+	}
+
 	if (FLOAT_NE_ZERO(gl_flashblend->value))
 		return;
 
@@ -397,12 +417,157 @@ static float s_blocklights[34*34*BLOCKLIGHT_SIZE];
 
 #define INTEGER_DLIGHTS		1
 
+/*
+===============
+R_DlightSpan
+
+Texels [*first, *last) along one lightmap axis that lie within radius
+of center (both in luxels), clipped to [0, count).
+===============
+*/
+static void R_DlightSpan (int center, int radius, int count, int *first, int *last)
+{
+	int		lo, hi;
+
+	lo = center - radius;
+	hi = center + radius;
+
+	*first = lo < 0 ? 0 : lo >> 4;
+	*last = hi < 0 ? 0 : (hi >> 4) + 1;
+
+	if (*last > count)
+		*last = count;
+}
+
+/*
+===============
+R_DlightRect
+
+Bounds, in lightmap texels, of the part of surf that dl can brighten.
+Returns false if the light doesn't reach the surface at all.
+===============
+*/
+static qboolean R_DlightRect (msurface_t *surf, dlight_t *dl, lmrect_t *rect)
+{
+	int			smax, tmax;
+	mtexinfo_t	*tex;
+
+#ifdef INTEGER_DLIGHTS
+	int			first, last;
+	int			fdist, frad, fminlight;
+	int			local[2];
+	vec3_t		impact;
+
+	if (FLOAT_NE_ZERO (gl_dlight_falloff->value))
+		frad = Q_ftol(dl->intensity * 1.10f);
+	else
+		frad = Q_ftol(dl->intensity);
+
+	fdist = (int)(DotProduct (dl->origin, surf->plane->normal) -
+			surf->plane->dist);
+
+	frad -= abs(fdist);
+
+	if (frad < DLIGHT_CUTOFF)
+		return false;
+
+	fminlight = frad - DLIGHT_CUTOFF;
+#endif
+
+	smax = (surf->extents[0]>>4)+1;
+	tmax = (surf->extents[1]>>4)+1;
+	tex = surf->texinfo;
+
+#ifdef INTEGER_DLIGHTS
+	impact[0] = dl->origin[0] - surf->plane->normal[0]*fdist;
+	impact[1] = dl->origin[1] - surf->plane->normal[1]*fdist;
+	impact[2] = dl->origin[2] - surf->plane->normal[2]*fdist;
+
+	local[0] = (int)(DotProduct (impact, tex->vecs[0]) + tex->vecs[0][3] - surf->texturemins[0]);
+	local[1] = (int)(DotProduct (impact, tex->vecs[1]) + tex->vecs[1][3] - surf->texturemins[1]);
+
+	//a texel is lit only if its distance along both axes is under fminlight
+	R_DlightSpan (local[0], fminlight, smax, &first, &last);
+	rect->left = first;
+	rect->right = last;
+
+	R_DlightSpan (local[1], fminlight, tmax, &first, &last);
+	rect->top = first;
+	rect->bottom = last;
+#else
+	//the float falloff isn't bounded, assume the whole surface
+	rect->left = rect->top = 0;
+	rect->right = smax;
+	rect->bottom = tmax;
+#endif
+
+	return !LMRECT_EMPTY (rect);
+}
+
+/*
+===============
+R_UnionLightRect
+===============
+*/
+void R_UnionLightRect (lmrect_t *rect, const lmrect_t *add)
+{
+	if (LMRECT_EMPTY (add))
+		return;
+
+	if (LMRECT_EMPTY (rect))
+	{
+		*rect = *add;
+		return;
+	}
+
+	if (add->left < rect->left)
+		rect->left = add->left;
+	if (add->top < rect->top)
+		rect->top = add->top;
+	if (add->right > rect->right)
+		rect->right = add->right;
+	if (add->bottom > rect->bottom)
+		rect->bottom = add->bottom;
+}
+
+/*
+===============
+R_SurfaceDlightRect
+
+Texels of surf lit by any dynamic light this frame. Returns false
+(with an empty rect) if there are none.
+===============
+*/
+qboolean R_SurfaceDlightRect (msurface_t *surf, lmrect_t *rect)
+{
+	int			lnum;
+	lmrect_t	lit;
+
+	rect->left = rect->top = rect->right = rect->bottom = 0;
+
+	if (surf->dlightframe != r_framecount)
+		return false;
+
+	for (lnum=0 ; lnum<r_newrefdef.num_dlights ; lnum++)
+	{
+		if ( !(surf->dlightbits & (1<<lnum) ) )
+			continue;
+
+		if (R_DlightRect (surf, &r_newrefdef.dlights[lnum], &lit))
+			R_UnionLightRect (rect, &lit);
+	}
+
+	return !LMRECT_EMPTY (rect);
+}
+
 /*
 ===============
 R_AddDynamicLights
+
+Only texels inside rect are touched.
 ===============
 */
-void R_AddDynamicLights (msurface_t *surf)
+void R_AddDynamicLights (msurface_t *surf, const lmrect_t *rect)
 {
 	int			lnum;
 	int			sd, td;
@@ -421,13 +586,13 @@ void R_AddDynamicLights (msurface_t *surf)
 
 	int			s, t;
 	int			i;
-	int			smax, tmax;
+	int			smax;
+	int			s0, s1, t0, t1;
 	mtexinfo_t	*tex;
 	dlight_t	*dl;
 	//float		*pfBL;
 
 	smax = (surf->extents[0]>>4)+1;
-	tmax = (surf->extents[1]>>4)+1;
 	tex = surf->texinfo;
 
 	for (lnum=0 ; lnum<r_newrefdef.num_dlights ; lnum++)
@@ -475,9 +640,23 @@ void R_AddDynamicLights (msurface_t *surf)
 		local[0] = (int)(DotProduct (impact, tex->vecs[0]) + tex->vecs[0][3] - surf->texturemins[0]);
 		local[1] = (int)(DotProduct (impact, tex->vecs[1]) + tex->vecs[1][3] - surf->texturemins[1]);
 
+#ifdef INTEGER_DLIGHTS
+		R_DlightSpan (local[0], fminlight, rect->right, &s0, &s1);
+		R_DlightSpan (local[1], fminlight, rect->bottom, &t0, &t1);
+
+		if (s0 < rect->left)
+			s0 = rect->left;
+		if (t0 < rect->top)
+			t0 = rect->top;
+#else
+		s0 = rect->left;
+		s1 = rect->right;
+		t0 = rect->top;
+		t1 = rect->bottom;
+#endif
+
 		//pfBL = s_blocklights;
-		i = 0;
-		for (t = 0, ftacc = 0 ; t<tmax ; ftacc += 16, t++)
+		for (t = t0, ftacc = t0 * 16 ; t<t1 ; ftacc += 16, t++)
 		{
 			td = abs(local[1] - ftacc);
 			//if ( td < 0 )
@@ -485,11 +664,12 @@ void R_AddDynamicLights (msurface_t *surf)
 			//td = abs(td);
 
 			//for ( s=0, fsacc = 0 ; s<smax ; fsacc += 16, pfBL += 3, s++)
-			s = 0;
-			fsacc = 0;
+			i = (t * smax + s0) * BLOCKLIGHT_SIZE;
+			s = s0;
+			fsacc = s0 * 16;
 			for (;;)
 			{
-				if (s++ == smax)
+				if (s++ >= s1)
 					break;
 #ifdef INTEGER_DLIGHTS
 				sd = abs(local[0] - fsacc);
@@ -552,19 +732,21 @@ void R_SetCacheState( msurface_t *surf )
 
 /*
 ===============
-R_BuildLightMap
+R_BuildLightMapRect
 
-Combine and scale multiple lightmaps into the floating format in blocklights
+Combine and scale multiple lightmaps into the floating format in blocklights,
+only for the texels inside rect; dest points at the rect's top left texel.
 ===============
 */
-void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
+void R_BuildLightMapRect (msurface_t *surf, const lmrect_t *rect, byte *dest, int stride)
 {
 	int			smax, tmax;
 	//int			r, g, b, a, max;
 	int			max;
 	int			colors[4];
 	int			i, j, size;
-	byte		*lightmap;
+	int			width;
+	byte		*lightmap, *lm;
 	float		scale[4];
 	int			nummaps;
 	float		*bl;
@@ -580,13 +762,19 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 	if (size > (sizeof(s_blocklights)>>4) )
 		ri.Sys_Error (ERR_DROP, "R_BuildLightMap: Bad s_blocklights size %d", size);
 
+	width = rect->right - rect->left;
+
 // set to full bright if no light data
 	if (!surf->samples)
 	{
 //		int maps;
 
-		for (i=0 ; i<size*BLOCKLIGHT_SIZE ; i++)
-			s_blocklights[i] = 255;
+		for (i=rect->top ; i<rect->bottom ; i++)
+		{
+			bl = s_blocklights + (i*smax + rect->left)*BLOCKLIGHT_SIZE;
+			for (j=0 ; j<width*BLOCKLIGHT_SIZE ; j++)
+				bl[j] = 255;
+		}
 		/*for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ;
 			 maps++)
 		{
@@ -610,30 +798,34 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 		for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ;
 			 maps++)
 		{
-			bl = s_blocklights;
-
 			scale[0] = gl_modulate->value*r_newrefdef.lightstyles[surf->styles[maps]].rgb[0];
 			scale[1] = gl_modulate->value*r_newrefdef.lightstyles[surf->styles[maps]].rgb[1];
 			scale[2] = gl_modulate->value*r_newrefdef.lightstyles[surf->styles[maps]].rgb[2];
 
-			if ( scale[0] == 1.0F &&
-				 scale[1] == 1.0F &&
-				 scale[2] == 1.0F )
+			for (i=rect->top ; i<rect->bottom ; i++)
 			{
-				for (i=0 ; i<size; i++, bl+=3)
+				bl = s_blocklights + (i*smax + rect->left)*BLOCKLIGHT_SIZE;
+				lm = lightmap + (i*smax + rect->left)*3;
+
+				if ( scale[0] == 1.0F &&
+					 scale[1] == 1.0F &&
+					 scale[2] == 1.0F )
 				{
-					bl[0] = lightmap[i*3+0];
-					bl[1] = lightmap[i*3+1];
-					bl[2] = lightmap[i*3+2];
+					for (j=0 ; j<width; j++, bl+=BLOCKLIGHT_SIZE, lm+=3)
+					{
+						bl[0] = lm[0];
+						bl[1] = lm[1];
+						bl[2] = lm[2];
+					}
 				}
-			}
-			else
-			{
-				for (i=0 ; i<size; i++, bl+=3)
+				else
 				{
-					bl[0] = lightmap[i*3+0] * scale[0];
-					bl[1] = lightmap[i*3+1] * scale[1];
-					bl[2] = lightmap[i*3+2] * scale[2];
+					for (j=0 ; j<width; j++, bl+=BLOCKLIGHT_SIZE, lm+=3)
+					{
+						bl[0] = lm[0] * scale[0];
+						bl[1] = lm[1] * scale[1];
+						bl[2] = lm[2] * scale[2];
+					}
 				}
 			}
 			lightmap += size*3;		// skip to next lightmap
@@ -643,35 +835,40 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 	{
 		int maps;
 
-		memset( s_blocklights, 0, sizeof( s_blocklights[0] ) * size * BLOCKLIGHT_SIZE );
+		for (i=rect->top ; i<rect->bottom ; i++)
+			memset( s_blocklights + (i*smax + rect->left)*BLOCKLIGHT_SIZE, 0, sizeof( s_blocklights[0] ) * width * BLOCKLIGHT_SIZE );
 
 		for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ;
 			 maps++)
 		{
-			bl = s_blocklights;
-
 			scale[0] = gl_modulate->value*r_newrefdef.lightstyles[surf->styles[maps]].rgb[0];
 			scale[1] = gl_modulate->value*r_newrefdef.lightstyles[surf->styles[maps]].rgb[1];
 			scale[2] = gl_modulate->value*r_newrefdef.lightstyles[surf->styles[maps]].rgb[2];
 
-			if ( scale[0] == 1.0F &&
-				 scale[1] == 1.0F &&
-				 scale[2] == 1.0F )
+			for (i=rect->top ; i<rect->bottom ; i++)
 			{
-				for (i=0 ; i<size ; i++, bl+=3 )
+				bl = s_blocklights + (i*smax + rect->left)*BLOCKLIGHT_SIZE;
+				lm = lightmap + (i*smax + rect->left)*3;
+
+				if ( scale[0] == 1.0F &&
+					 scale[1] == 1.0F &&
+					 scale[2] == 1.0F )
 				{
-					bl[0] += lightmap[i*3+0];
-					bl[1] += lightmap[i*3+1];
-					bl[2] += lightmap[i*3+2];
+					for (j=0 ; j<width ; j++, bl+=BLOCKLIGHT_SIZE, lm+=3)
+					{
+						bl[0] += lm[0];
+						bl[1] += lm[1];
+						bl[2] += lm[2];
+					}
 				}
-			}
-			else
-			{
-				for (i=0 ; i<size ; i++, bl+=3)
+				else
 				{
-					bl[0] += lightmap[i*3+0] * scale[0];
-					bl[1] += lightmap[i*3+1] * scale[1];
-					bl[2] += lightmap[i*3+2] * scale[2];
+					for (j=0 ; j<width ; j++, bl+=BLOCKLIGHT_SIZE, lm+=3)
+					{
+						bl[0] += lm[0] * scale[0];
+						bl[1] += lm[1] * scale[1];
+						bl[2] += lm[2] * scale[2];
+					}
 				}
 			}
 			lightmap += size*3;		// skip to next lightmap
@@ -680,18 +877,19 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 
 // add all the dynamic lights
 	if (surf->dlightframe == r_framecount)
-		R_AddDynamicLights (surf);
+		R_AddDynamicLights (surf, rect);
 
 // put into texture format
 store:
-	stride -= (smax<<2);
-	bl = s_blocklights;
+	stride -= (width<<2);
 
 	//monolightmap = gl_monolightmap->string[0];
 
-	for (i=0 ; i<tmax ; i++, dest += stride)
+	for (i=rect->top ; i<rect->bottom ; i++, dest += stride)
 	{
-		for (j=0 ; j<smax ; j++)
+		bl = s_blocklights + (i*smax + rect->left)*BLOCKLIGHT_SIZE;
+
+		for (j=0 ; j<width ; j++)
 		{
 			Q_fastfloats (bl, colors);
 
@@ -771,3 +969,256 @@ store:
 	}
 }
 
+/*
+===============
+R_BuildLightMap
+===============
+*/
+void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
+{
+	lmrect_t	rect;
+
+	rect.left = rect.top = 0;
+	rect.right = (surf->extents[0]>>4)+1;
+	rect.bottom = (surf->extents[1]>>4)+1;
+
+	R_BuildLightMapRect (surf, &rect, dest, stride);
+}
+
+/*
+===============
+R_LightBenchFrame
+
+Marks the world surfaces lit by one recorded frame's dlights, the way
+R_PushDlights and R_SetupFrame would.
+===============
+*/
+static void R_LightBenchFrame (lightbenchframe_t *frame)
+{
+	int		i;
+
+	r_newrefdef.num_dlights = frame->num_dlights;
+	r_newrefdef.dlights = frame->dlights;
+
+	r_dlightframecount = r_framecount + 1;
+	for (i=0 ; i<frame->num_dlights ; i++)
+		R_MarkLights (&frame->dlights[i], 1<<i, r_worldmodel->nodes);
+
+	r_framecount++;
+}
+
+/*
+===============
+R_LightBenchRun
+
+Replays recorded dlights over the world, building lightmaps the old way
+(every dlit surface in full) and through dirty rects, checking that the
+incrementally maintained copy matches a full rebuild every frame.
+===============
+*/
+static void R_LightBenchRun (lightbenchframe_t *frames, int numframes)
+{
+	static unsigned	temp[34*34];
+	msurface_t	*surf;
+	lmrect_t	*prev, lit, update;
+	byte		*shadow;
+	int			*offset;
+	int			numsurfaces, total;
+	int			i, j, f, pass, smax, tmax;
+	int			fulltexels, recttexels, mismatches;
+	unsigned	start, scan, full, rect;
+	dlight_t	*saved_dlights;
+	int			saved_num_dlights;
+
+	numsurfaces = r_worldmodel->numsurfaces;
+
+	offset = malloc (numsurfaces * sizeof(*offset));
+	prev = calloc (numsurfaces, sizeof(*prev));
+
+	total = 0;
+	for (i=0, surf=r_worldmodel->surfaces ; i<numsurfaces ; i++, surf++)
+	{
+		offset[i] = total;
+		if (!( surf->texinfo->flags & (SURF_SKY|SURF_TRANS33|SURF_TRANS66|SURF_WARP) ))
+			total += ((surf->extents[0]>>4)+1) * ((surf->extents[1]>>4)+1);
+	}
+
+	shadow = malloc (total * 4);
+
+	saved_dlights = r_newrefdef.dlights;
+	saved_num_dlights = r_newrefdef.num_dlights;
+
+	//skip past any marks left by the last rendered frame
+	r_framecount += 2;
+
+	for (i=0, surf=r_worldmodel->surfaces ; i<numsurfaces ; i++, surf++)
+	{
+		if (!( surf->texinfo->flags & (SURF_SKY|SURF_TRANS33|SURF_TRANS66|SURF_WARP) ))
+			R_BuildLightMap (surf, shadow + offset[i] * 4, ((surf->extents[0]>>4)+1) * 4);
+	}
+
+	fulltexels = recttexels = mismatches = 0;
+
+	for (f=0 ; f<numframes ; f++)
+	{
+		R_LightBenchFrame (frames + f);
+
+		for (i=0, surf=r_worldmodel->surfaces ; i<numsurfaces ; i++, surf++)
+		{
+			if ( surf->texinfo->flags & (SURF_SKY|SURF_TRANS33|SURF_TRANS66|SURF_WARP) )
+				continue;
+
+			smax = (surf->extents[0]>>4)+1;
+			tmax = (surf->extents[1]>>4)+1;
+
+			R_SurfaceDlightRect (surf, &lit);
+			update = prev[i];
+			R_UnionLightRect (&update, &lit);
+			prev[i] = lit;
+
+			if (!LMRECT_EMPTY (&update))
+			{
+				R_BuildLightMapRect (surf, &update, shadow + (offset[i] + update.top * smax + update.left) * 4, smax * 4);
+				recttexels += (update.right - update.left) * (update.bottom - update.top);
+			}
+
+			if (surf->dlightframe == r_framecount)
+			{
+				R_BuildLightMap (surf, (byte *)temp, smax * 4);
+				fulltexels += smax * tmax;
+
+				for (j=0 ; j<smax*tmax ; j++)
+				{
+					if (temp[j] != ((unsigned *)shadow)[offset[i] + j])
+						mismatches++;
+				}
+			}
+		}
+	}
+
+	//marking and walking the surfaces alone, to take out of both timings
+	start = Sys_Milliseconds ();
+	for (pass=0 ; pass<LIGHTBENCH_PASSES ; pass++)
+	{
+		for (f=0 ; f<numframes ; f++)
+		{
+			R_LightBenchFrame (frames + f);
+
+			for (i=0, surf=r_worldmodel->surfaces ; i<numsurfaces ; i++, surf++)
+			{
+				if ( surf->texinfo->flags & (SURF_SKY|SURF_TRANS33|SURF_TRANS66|SURF_WARP) )
+					continue;
+
+				if (surf->dlightframe == r_framecount)
+					temp[0] = i;
+			}
+		}
+	}
+	scan = Sys_Milliseconds () - start;
+
+	start = Sys_Milliseconds ();
+	for (pass=0 ; pass<LIGHTBENCH_PASSES ; pass++)
+	{
+		for (f=0 ; f<numframes ; f++)
+		{
+			R_LightBenchFrame (frames + f);
+
+			for (i=0, surf=r_worldmodel->surfaces ; i<numsurfaces ; i++, surf++)
+			{
+				if ( surf->texinfo->flags & (SURF_SKY|SURF_TRANS33|SURF_TRANS66|SURF_WARP) )
+					continue;
+
+				if (surf->dlightframe == r_framecount)
+					R_BuildLightMap (surf, (byte *)temp, ((surf->extents[0]>>4)+1) * 4);
+			}
+		}
+	}
+	full = Sys_Milliseconds () - start;
+
+	start = Sys_Milliseconds ();
+	for (pass=0 ; pass<LIGHTBENCH_PASSES ; pass++)
+	{
+		for (f=0 ; f<numframes ; f++)
+		{
+			R_LightBenchFrame (frames + f);
+
+			for (i=0, surf=r_worldmodel->surfaces ; i<numsurfaces ; i++, surf++)
+			{
+				if ( surf->texinfo->flags & (SURF_SKY|SURF_TRANS33|SURF_TRANS66|SURF_WARP) )
+					continue;
+
+				if (surf->dlightframe != r_framecount && LMRECT_EMPTY (&prev[i]))
+					continue;
+
+				smax = (surf->extents[0]>>4)+1;
+
+				R_SurfaceDlightRect (surf, &lit);
+				update = prev[i];
+				R_UnionLightRect (&update, &lit);
+				prev[i] = lit;
+
+				if (!LMRECT_EMPTY (&update))
+					R_BuildLightMapRect (surf, &update, shadow + (offset[i] + update.top * smax + update.left) * 4, smax * 4);
+			}
+		}
+	}
+	rect = Sys_Milliseconds () - start;
+
+	r_newrefdef.dlights = saved_dlights;
+	r_newrefdef.num_dlights = saved_num_dlights;
+
+	ri.Con_Printf (PRINT_ALL, "%d frames, %d passes: %u ms marking, %u ms full (%d texels), %u ms dirty rects (%d texels), %d texels differ\n",
+		numframes, LIGHTBENCH_PASSES, scan, full - scan, fulltexels, rect - scan, recttexels, mismatches);
+
+	free (shadow);
+	free (prev);
+	free (offset);
+}
+
+/*
+===============
+GL_LightBench_f
+
+gl_lightbench start, play a demo, gl_lightbench stop
+===============
+*/
+void GL_LightBench_f (void)
+{
+	lightbenchframe_t	*frames;
+	int					numframes;
+
+	if (ri.Cmd_Argc () == 2 && !Q_stricmp (ri.Cmd_Argv (1), "start"))
+	{
+		if (!lightbench_frames)
+			lightbench_frames = malloc (LIGHTBENCH_FRAMES * sizeof(*lightbench_frames));
+
+		lightbench_numframes = 0;
+		ri.Con_Printf (PRINT_ALL, "gl_lightbench: recording dynamic lights, play a demo then use 'gl_lightbench stop'\n");
+		return;
+	}
+
+	if (ri.Cmd_Argc () != 2 || Q_stricmp (ri.Cmd_Argv (1), "stop"))
+	{
+		ri.Con_Printf (PRINT_ALL, "Usage: gl_lightbench <start|stop>\n");
+		return;
+	}
+
+	if (!lightbench_frames)
+	{
+		ri.Con_Printf (PRINT_ALL, "gl_lightbench: not recording\n");
+		return;
+	}
+
+	frames = lightbench_frames;
+	numframes = lightbench_numframes;
+	lightbench_frames = NULL;
+
+	if (!r_worldmodel || !numframes)
+		ri.Con_Printf (PRINT_ALL, "gl_lightbench: nothing recorded\n");
+	else if (!r_worldmodel->lightdata)
+		ri.Con_Printf (PRINT_ALL, "gl_lightbench: map has no lightmaps\n");
+	else
+		R_LightBenchRun (frames, numframes);
+
+	free (frames);
+}
@@ -28,6 +28,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <GL/glu.h>
 #include <math.h>
 
+//x86-64 always has SSE2, 32 bit builds need to ask for it
+#if defined SSE2 || defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define	R_SSE2
+#include <emmintrin.h>
+#endif
+
 #ifndef __linux__
 #ifndef GL_COLOR_INDEX8_EXT
 #define GL_COLOR_INDEX8_EXT GL_COLOR_INDEX
@@ -299,6 +305,9 @@ extern	cvar_t	*vid_fullscreen;
 extern	cvar_t	*vid_gamma;
 
 extern	cvar_t	*gl_jpg_quality;
+extern	cvar_t	*gl_decode_threads;
+extern	cvar_t	*gl_texcache;
+extern	cvar_t	*gl_texcache_maxmb;
 extern	cvar_t	*gl_coloredlightmaps;
 
 extern	cvar_t	*intensity;
@@ -337,6 +346,7 @@ void GL_SelectTexture( GLenum );
 
 void R_LightPoint (vec3_t p, vec3_t color);
 void R_PushDlights (void);
+void GL_LightBench_f (void);
 unsigned int hashify (const char *S);
 //====================================================================
 
@@ -356,6 +366,9 @@ void	EXPORT R_Shutdown( void );
 void R_RenderView (refdef_t *fd);
 void GL_ScreenShot_f (void);
 void R_DrawAliasModel (entity_t *e);
+aliasvert_t *R_UnpackAliasFrames (const byte *frames, int framesize, int numframes, int numverts);
+void GL_LerpVerts (int nverts, const aliasvert_t *v, const aliasvert_t *ov, float *lerp, const float move[3], const float frontv[3], const float backv[3], qboolean shell);
+void GL_LerpBench_f (void);
 void R_DrawBrushModel (entity_t *e);
 void R_DrawSpriteModel (entity_t *e);
 void R_DrawBeam( entity_t *e );
@@ -410,7 +423,19 @@ struct image_s * EXPORT R_RegisterSkin (char *name);
 void LoadPCX (const char *filename, byte **pic, byte **palette, int *width, int *height);
 image_t *GL_LoadPic (const char *name, byte *pic, int width, int height, imagetype_t type, int bits);
 image_t	*GL_FindImage (const char *name, const char *basename, imagetype_t type);
+qboolean	GL_BeginPrefetch (void);
+qboolean	GL_PrefetchImage (const char *name, imagetype_t type);
+void	GL_PrefetchFindImage (const char *name, const char *basename, imagetype_t type);
+void	GL_StartPrefetch (void);
+void	GL_EndPrefetch (void);
+void	GL_DecodeBench_f (void);
+void	GL_ImageBench_f (void);
+void	GL_TexCacheTrim (void);
+extern	int		texcache_hits;
+extern	int		texcache_misses;
 image_t	*GL_FindImageBase (const char *basename, imagetype_t type);
+int		GL_ImageExtensions (const char *name);
+qboolean	GL_ProbeImage (int extensions, int ext);
 void	GL_TextureMode( char *string );
 void	GL_ImageList_f (void);
 void	GL_Version_f (void);
@@ -44,6 +44,10 @@ float	r_avertexnormals[NUMVERTEXNORMALS][3] = {
 #endif
 
 static	vec4_t	s_lerped[MAX_VERTS];
+
+//r_avertexnormals padded to 4 floats for GL_LerpVerts, with a zero
+//normal at the end for broken lightnormalindexes
+static	vec4_t	r_lerpnormals[NUMVERTEXNORMALS+1];
 //static	vec3_t	lerped[MAX_VERTS];
 
 vec3_t	shadevector;
@@ -57,16 +61,136 @@ const float	r_avertexnormal_dots[SHADEDOT_QUANT][256] =
 
 const float	*shadedots = r_avertexnormal_dots[0];
 
-void GL_LerpVerts( int nverts, dtrivertx_t *v, dtrivertx_t *ov, dtrivertx_t *verts, float *lerp, float move[3], float frontv[3], float backv[3] )
+/*
+=============
+R_UnpackAliasFrames
+
+Converts every vertex of every frame to floats once at load time, so
+GL_LerpVerts has nothing left to do but multiply and add. Returns
+numframes * numverts aliasverts of 16 bytes each, 4 times the size of
+the dtrivertx_t frames (a 198 frame, 500 vertex player model takes
+1.5 MB). Normals stay indexes into r_lerpnormals.
+=============
+*/
+aliasvert_t *R_UnpackAliasFrames (const byte *frames, int framesize, int numframes, int numverts)
+{
+	const daliasframe_t	*frame;
+	aliasvert_t			*out, *unpacked;
+	int					i, j;
+
+	for (i = 0; i < NUMVERTEXNORMALS; i++)
+		VectorCopy (r_avertexnormals[i], r_lerpnormals[i]);
+
+	unpacked = out = malloc (numframes * numverts * sizeof(*unpacked));
+	if (!unpacked)
+		ri.Sys_Error (ERR_DROP, "R_UnpackAliasFrames: out of memory");
+
+	for (i = 0; i < numframes; i++)
+	{
+		frame = (const daliasframe_t *)(frames + i * framesize);
+
+		for (j = 0; j < numverts; j++, out++)
+		{
+			out->xyz[0] = frame->verts[j].v[0];
+			out->xyz[1] = frame->verts[j].v[1];
+			out->xyz[2] = frame->verts[j].v[2];
+
+			//r1: don't read past the table on broken models
+			if (frame->verts[j].lightnormalindex < NUMVERTEXNORMALS)
+				out->normal = frame->verts[j].lightnormalindex;
+			else
+				out->normal = NUMVERTEXNORMALS;
+		}
+	}
+
+	return unpacked;
+}
+
+/*
+=============
+GL_LerpVerts
+
+Interpolates between two unpacked frames, writing 4 floats per vertex
+to lerp. shell pushes each vertex out along its normal for the shell
+effects. Gives the same results as GL_LerpVertsPacked, the additions
+happen in the same order.
+=============
+*/
+void GL_LerpVerts (int nverts, const aliasvert_t *v, const aliasvert_t *ov, float *lerp, const float move[3], const float frontv[3], const float backv[3], qboolean shell)
+{
+	int		i;
+#ifdef R_SSE2
+	__m128	m, f, b, s, p, xyz;
+
+	m = _mm_set_ps (0, move[2], move[1], move[0]);
+	f = _mm_set_ps (0, frontv[2], frontv[1], frontv[0]);
+	b = _mm_set_ps (0, backv[2], backv[1], backv[0]);
+
+	//the 4th float of an aliasvert is the normal index, keep it out of the math
+	xyz = _mm_castsi128_ps (_mm_set_epi32 (0, -1, -1, -1));
+
+	if (shell)
+	{
+		s = _mm_set1_ps (POWERSUIT_SCALE);
+
+		for (i = 0; i < nverts; i++, lerp += 4)
+		{
+			p = _mm_add_ps (_mm_add_ps (m, _mm_mul_ps (_mm_and_ps (_mm_loadu_ps (ov[i].xyz), xyz), b)), _mm_mul_ps (_mm_and_ps (_mm_loadu_ps (v[i].xyz), xyz), f));
+			_mm_storeu_ps (lerp, _mm_add_ps (p, _mm_mul_ps (_mm_loadu_ps (r_lerpnormals[v[i].normal]), s)));
+		}
+	}
+	else
+	{
+		for (i = 0; i < nverts; i++, lerp += 4)
+		{
+			p = _mm_add_ps (_mm_add_ps (m, _mm_mul_ps (_mm_and_ps (_mm_loadu_ps (ov[i].xyz), xyz), b)), _mm_mul_ps (_mm_and_ps (_mm_loadu_ps (v[i].xyz), xyz), f));
+			_mm_storeu_ps (lerp, p);
+		}
+	}
+#else
+	const float	*normal;
+
+	if (shell)
+	{
+		for (i = 0; i < nverts; i++, v++, ov++, lerp += 4)
+		{
+			normal = r_lerpnormals[v->normal];
+
+			lerp[0] = move[0] + ov->xyz[0]*backv[0] + v->xyz[0]*frontv[0] + normal[0] * POWERSUIT_SCALE;
+			lerp[1] = move[1] + ov->xyz[1]*backv[1] + v->xyz[1]*frontv[1] + normal[1] * POWERSUIT_SCALE;
+			lerp[2] = move[2] + ov->xyz[2]*backv[2] + v->xyz[2]*frontv[2] + normal[2] * POWERSUIT_SCALE;
+		}
+	}
+	else
+	{
+		for (i = 0; i < nverts; i++, v++, ov++, lerp += 4)
+		{
+			lerp[0] = move[0] + ov->xyz[0]*backv[0] + v->xyz[0]*frontv[0];
+			lerp[1] = move[1] + ov->xyz[1]*backv[1] + v->xyz[1]*frontv[1];
+			lerp[2] = move[2] + ov->xyz[2]*backv[2] + v->xyz[2]*frontv[2];
+		}
+	}
+#endif
+}
+
+/*
+=============
+GL_LerpVertsPacked
+
+The original lerp straight from the dtrivertx_t frames, only kept as
+the reference for gl_lerpbench.
+=============
+*/
+static void GL_LerpVertsPacked (int nverts, const dtrivertx_t *v, const dtrivertx_t *ov, float *lerp, const float move[3], const float frontv[3], const float backv[3], qboolean shell)
 {
 	int i;
 
 	//PMM -- added RF_SHELL_DOUBLE, RF_SHELL_HALF_DAM
-	if ( currententity->flags & ( RF_SHELL_RED | RF_SHELL_GREEN | RF_SHELL_BLUE | RF_SHELL_DOUBLE | RF_SHELL_HALF_DAM) )
+	if (shell)
 	{
 		for (i=0 ; i < nverts; i++, v++, ov++, lerp+=4 )
 		{
-			float *normal = r_avertexnormals[verts[i].lightnormalindex];
+			float *normal = r_avertexnormals[v->lightnormalindex];
 
 			lerp[0] = move[0] + ov->v[0]*backv[0] + v->v[0]*frontv[0] + normal[0] * POWERSUIT_SCALE;
 			lerp[1] = move[1] + ov->v[1]*backv[1] + v->v[1]*frontv[1] + normal[1] * POWERSUIT_SCALE;
@@ -82,7 +206,119 @@ void GL_LerpVerts( int nverts, dtrivertx_t *v, dtrivertx_t *ov, dtrivertx_t *ver
 			lerp[2] = move[2] + ov->v[2]*backv[2] + v->v[2]*frontv[2];
 		}
 	}
+}
+
+/*
+=============
+GL_LerpBench_f
+
+Lerps every frame of the stock player models into the next, at half
+way and with and without the shell offset, with both the old and new
+code. Reads the md2s directly so it needs no GL and no map.
+=============
+*/
+#define	LERPBENCH_PASSES	20
+
+typedef struct
+{
+	const dtrivertx_t	*verts, *oldverts;
+	vec3_t				move, frontv, backv;
+} lerpbench_t;
+
+void GL_LerpBench_f (void)
+{
+	static const char	*models[] = {"players/male/tris.md2", "players/female/tris.md2", "players/cyborg/tris.md2"};
+	static vec4_t		lerped[MAX_VERTS];
+	const dmdl_t		*hdr;
+	const daliasframe_t	*frame, *oldframe;
+	aliasvert_t			*unpacked;
+	lerpbench_t			*steps;
+	byte				*buffer;
+	unsigned			start, packed, simd;
+	int					i, j, m, pass, shell, numframes, numverts, framesize, next, mismatches;
+
+	for (m = 0; m < sizeof(models) / sizeof(models[0]); m++)
+	{
+		ri.FS_LoadFile (models[m], (void **)&buffer);
+		if (!buffer)
+		{
+			ri.Con_Printf (PRINT_ALL, "%s: not found\n", models[m]);
+			continue;
+		}
+
+		hdr = (const dmdl_t *)buffer;
+		numframes = LittleLong (hdr->num_frames);
+		numverts = LittleLong (hdr->num_xyz);
+		framesize = LittleLong (hdr->framesize);
+
+		if (LittleLong (hdr->ident) != IDALIASHEADER || numverts <= 0 || numverts > MAX_VERTS || numframes <= 0 ||
+			LittleLong (hdr->ofs_frames) + numframes * framesize > LittleLong (hdr->ofs_end))
+		{
+			ri.Con_Printf (PRINT_ALL, "%s: not a valid md2\n", models[m]);
+			ri.FS_FreeFile (buffer);
+			continue;
+		}
 
+		unpacked = R_UnpackAliasFrames (buffer + LittleLong (hdr->ofs_frames), framesize, numframes, numverts);
+
+		//every frame into the next, half way
+		steps = malloc (numframes * sizeof(*steps));
+		for (i = 0; i < numframes; i++)
+		{
+			frame = (const daliasframe_t *)(buffer + LittleLong (hdr->ofs_frames) + ((i + 1) % numframes) * framesize);
+			oldframe = (const daliasframe_t *)(buffer + LittleLong (hdr->ofs_frames) + i * framesize);
+
+			steps[i].verts = frame->verts;
+			steps[i].oldverts = oldframe->verts;
+
+			for (j = 0; j < 3; j++)
+			{
+				steps[i].move[j] = 0.5f * LittleFloat (oldframe->translate[j]) + 0.5f * LittleFloat (frame->translate[j]);
+				steps[i].frontv[j] = 0.5f * LittleFloat (frame->scale[j]);
+				steps[i].backv[j] = 0.5f * LittleFloat (oldframe->scale[j]);
+			}
+		}
+
+		mismatches = 0;
+		for (shell = 0; shell < 2; shell++)
+		{
+			for (i = 0; i < numframes; i++)
+			{
+				next = (i + 1) % numframes;
+				GL_LerpVertsPacked (numverts, steps[i].verts, steps[i].oldverts, s_lerped[0], steps[i].move, steps[i].frontv, steps[i].backv, shell);
+				GL_LerpVerts (numverts, unpacked + next * numverts, unpacked + i * numverts, lerped[0], steps[i].move, steps[i].frontv, steps[i].backv, shell);
+
+				for (j = 0; j < numverts; j++)
+				{
+					if (memcmp (s_lerped[j], lerped[j], sizeof(float) * 3))
+						mismatches++;
+				}
+			}
+		}
+
+		start = Sys_Milliseconds ();
+		for (pass = 0; pass < LERPBENCH_PASSES; pass++)
+		{
+			for (i = 0; i < numframes; i++)
+				GL_LerpVertsPacked (numverts, steps[i].verts, steps[i].oldverts, s_lerped[0], steps[i].move, steps[i].frontv, steps[i].backv, pass & 1);
+		}
+		packed = Sys_Milliseconds () - start;
+
+		start = Sys_Milliseconds ();
+		for (pass = 0; pass < LERPBENCH_PASSES; pass++)
+		{
+			for (i = 0; i < numframes; i++)
+				GL_LerpVerts (numverts, unpacked + ((i + 1) % numframes) * numverts, unpacked + i * numverts, lerped[0], steps[i].move, steps[i].frontv, steps[i].backv, pass & 1);
+		}
+		simd = Sys_Milliseconds () - start;
+
+		ri.Con_Printf (PRINT_ALL, "%s: %d frames of %d verts, %d passes: %u ms packed, %u ms unpacked, %d verts differ\n",
+			models[m], numframes, numverts, LERPBENCH_PASSES, packed, simd, mismatches);
+
+		free (steps);
+		free (unpacked);
+		ri.FS_FreeFile (buffer);
+	}
 }
 
 /*============================
@@ -165,7 +401,7 @@ void GL_DrawAliasFrameLerp (dmdl_t *paliashdr, float backlerp)
 {
 	float 	l;
 	daliasframe_t	*frame, *oldframe;
-	dtrivertx_t	*v, *ov, *verts;
+	dtrivertx_t	*verts;
 	int		*order;
 	int		count;
 	float	frontlerp;
@@ -178,11 +414,10 @@ void GL_DrawAliasFrameLerp (dmdl_t *paliashdr, float backlerp)
 
 	frame = (daliasframe_t *)((byte *)paliashdr + paliashdr->ofs_frames 
 		+ currententity->frame * paliashdr->framesize);
-	verts = v = frame->verts;
+	verts = frame->verts;
 
 	oldframe = (daliasframe_t *)((byte *)paliashdr + paliashdr->ofs_frames 
 		+ currententity->oldframe * paliashdr->framesize);
-	ov = oldframe->verts;
 
 	order = (int *)((byte *)paliashdr + paliashdr->ofs_glcmds);
 
@@ -223,7 +458,10 @@ void GL_DrawAliasFrameLerp (dmdl_t *paliashdr, float backlerp)
 
 	lerp = s_lerped[0];
 
-	GL_LerpVerts( paliashdr->num_xyz, v, ov, verts, lerp, move, frontv, backv );
+	//PMM -- added RF_SHELL_DOUBLE, RF_SHELL_HALF_DAM
+	GL_LerpVerts (paliashdr->num_xyz, currentmodel->aliasverts + currententity->frame * paliashdr->num_xyz,
+		currentmodel->aliasverts + currententity->oldframe * paliashdr->num_xyz, lerp, move, frontv, backv,
+		(currententity->flags & (RF_SHELL_RED | RF_SHELL_GREEN | RF_SHELL_BLUE | RF_SHELL_DOUBLE | RF_SHELL_HALF_DAM)) ? true : false);
 
 	//TODO: use this somehow
 	/*qglEnableClientState (GL_VERTEX_ARRAY);
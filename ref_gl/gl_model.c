@@ -622,6 +622,7 @@ void Mod_LoadTexinfo (lump_t *l)
 	int 	i, count;
 	char	name[MAX_QPATH];
 	int		next;
+	int		extensions;
 	size_t	length;
 
 	in = (void *)(mod_base + l->fileofs);
@@ -635,6 +636,44 @@ void Mod_LoadTexinfo (lump_t *l)
 	loadmodel->texinfo = out;
 	loadmodel->numtexinfo = count;
 
+	//r1: queue the replacement textures so they decode in the background
+	//while the loop below uploads them, same format order as below.
+	if (GL_BeginPrefetch ())
+	{
+		for (i = 0; i < count; i++)
+		{
+			fast_strlwr (in[i].texture);
+
+			if (GL_FindImageBase (in[i].texture, it_wall))
+				continue;
+
+			Com_sprintf (name, sizeof(name), "textures/%s", in[i].texture);
+			extensions = GL_ImageExtensions (name);
+
+			if (load_tga_wals && (extensions & FS_EXT_TGA))
+			{
+				Com_sprintf (name, sizeof(name), "textures/%s.tga", in[i].texture);
+				if (GL_PrefetchImage (name, it_wall))
+					continue;
+			}
+
+			if (load_png_wals && (extensions & FS_EXT_PNG))
+			{
+				Com_sprintf (name, sizeof(name), "textures/%s.png", in[i].texture);
+				if (GL_PrefetchImage (name, it_wall))
+					continue;
+			}
+
+			if (load_jpg_wals && (extensions & FS_EXT_JPG))
+			{
+				Com_sprintf (name, sizeof(name), "textures/%s.jpg", in[i].texture);
+				GL_PrefetchImage (name, it_wall);
+			}
+		}
+
+		GL_StartPrefetch ();
+	}
+
 	for ( i=0 ; i<count ; i++, in++, out++)
 	{
 #if Q_BIGENDIAN
@@ -667,8 +706,10 @@ void Mod_LoadTexinfo (lump_t *l)
 			continue;
 
 		Com_sprintf (name, sizeof(name), "textures/%s.wal", in->texture);
+
+		extensions = GL_ImageExtensions (name);
 		
-		if (!GetWalInfo (name, &global_hax_texture_x, &global_hax_texture_y))
+		if (!GL_ProbeImage (extensions, FS_EXT_WAL) || !GetWalInfo (name, &global_hax_texture_x, &global_hax_texture_y))
 		{
 			ri.Con_Printf (PRINT_ALL, "Couldn't load %s\n", name);
 			out->image = r_notexture;
@@ -677,7 +718,7 @@ void Mod_LoadTexinfo (lump_t *l)
 
 		length = strlen(name);
 
-		if (load_tga_wals)
+		if (load_tga_wals && GL_ProbeImage (extensions, FS_EXT_TGA))
 		{
 			//Com_sprintf (name, sizeof(name), "textures/%s.tga", in->texture);
 			memcpy (name + length-3, "tga", 3);
@@ -690,7 +731,7 @@ void Mod_LoadTexinfo (lump_t *l)
 
 		if (!out->image)
 		{
-			if (load_png_wals)
+			if (load_png_wals && GL_ProbeImage (extensions, FS_EXT_PNG))
 			{
 				memcpy (name + length-3, "png", 3);
 				//Com_sprintf (name, sizeof(name), "textures/%s.png", in->texture);
@@ -699,7 +740,7 @@ void Mod_LoadTexinfo (lump_t *l)
 
 			if (!out->image)
 			{
-				if (load_jpg_wals)
+				if (load_jpg_wals && GL_ProbeImage (extensions, FS_EXT_JPG))
 				{
 					memcpy (name + length-3, "jpg", 3);
 					//Com_sprintf (name, sizeof(name), "textures/%s.jpg", in->texture);
@@ -726,6 +767,8 @@ void Mod_LoadTexinfo (lump_t *l)
 		global_hax_texture_x = global_hax_texture_y = 0;
 	}
 
+	GL_EndPrefetch ();
+
 	// count animation frames
 	for (i=0 ; i<count ; i++)
 	{
@@ -835,8 +878,7 @@ void Mod_LoadFaces (lump_t *l)
 
 		out->texturechain = NULL;
 		out->lightmapchain = NULL;
-		out->dlight_s = 0;
-		out->dlight_t = 0;
+		memset (&out->dlight_rect, 0, sizeof(out->dlight_rect));
 		out->dlightframe = 0;
 		out->dlightbits = 0;
 
@@ -1401,6 +1443,8 @@ void Mod_LoadAliasModel (model_t *mod, void *buffer)
 #endif
 	}
 
+	mod->aliasverts = R_UnpackAliasFrames ((byte *)pheader + pheader->ofs_frames, pheader->framesize, pheader->num_frames, pheader->num_xyz);
+
 	mod->type = mod_alias;
 
 	//
@@ -1501,12 +1545,16 @@ R_BeginRegistration
 Specifies the model that will be used as the world
 @@@@@@@@@@@@@@@@@@@@@
 */
+static unsigned	registration_start;
+
 void EXPORT R_BeginRegistration (char *model)
 {
 	char	fullname[MAX_QPATH];
 	cvar_t	*flushmap;
 
 	r_registering = true;
+	registration_start = Sys_Milliseconds ();
+	texcache_hits = texcache_misses = 0;
 
 #ifdef RB_IMAGE_CACHE
 	EmptyImageCache();
@@ -1586,6 +1634,106 @@ struct model_s * EXPORT R_RegisterModel (char *name)
 	return mod;
 }
 
+/*
+@@@@@@@@@@@@@@@@@@@@@
+R_PrefetchRegistration
+
+Looked up by name like GetExtraAPI. Clients that find it pass the models
+and pics they are about to register right after BeginRegistration, the
+skins of models not loaded yet and the pics are queued for the decoder
+threads in the order they will be asked for.
+@@@@@@@@@@@@@@@@@@@@@
+*/
+void EXPORT R_PrefetchRegistration (const char (*models)[MAX_QPATH], int nummodels, const char (*pics)[MAX_QPATH], int numpics)
+{
+	char		name[MAX_QPATH];
+	char		skin[MAX_SKINNAME];
+	model_t		*modelhash;
+	dmdl_t		*pinmodel;
+	dsprite_t	*sprin;
+	byte		*buf;
+	int			i, j, len, count, ofs;
+
+	if (!GL_BeginPrefetch ())
+		return;
+
+	for (i = 0; i < nummodels; i++)
+	{
+		//inline models have no skins, # are player weapons
+		if (models[i][0] == '*' || models[i][0] == '#' || !models[i][0])
+			continue;
+
+		Q_strncpy (name, models[i], sizeof(name)-1);
+		fast_strlwr (name);
+
+		for (modelhash = models_hash[hashify (name) % MODEL_HASH_SIZE]; modelhash; modelhash = modelhash->hash_next)
+		{
+			if (!strcmp (modelhash->name, name))
+				break;
+		}
+
+		if (modelhash)
+			continue;
+
+		len = ri.FS_LoadFile (name, (void **)&buf);
+		if (!buf)
+			continue;
+
+		if (len >= (int)sizeof(*pinmodel) && LittleLong (*(int *)buf) == IDALIASHEADER)
+		{
+			pinmodel = (dmdl_t *)buf;
+			count = LittleLong (pinmodel->num_skins);
+			ofs = LittleLong (pinmodel->ofs_skins);
+
+			if (count > 0 && count <= MAX_MD2SKINS && ofs > 0 && ofs + count * MAX_SKINNAME <= len)
+			{
+				for (j = 0; j < count; j++)
+				{
+					Q_strncpy (skin, (char *)buf + ofs + j * MAX_SKINNAME, sizeof(skin)-1);
+					fast_strlwr (skin);
+					GL_PrefetchFindImage (skin, skin, it_skin);
+				}
+			}
+		}
+		else if (len >= (int)sizeof(*sprin) && LittleLong (*(int *)buf) == IDSPRITEHEADER)
+		{
+			sprin = (dsprite_t *)buf;
+			count = LittleLong (sprin->numframes);
+
+			if (count > 0 && count <= MAX_MD2SKINS && (int)(sizeof(*sprin) + (count - 1) * sizeof(sprin->frames[0])) <= len)
+			{
+				for (j = 0; j < count; j++)
+				{
+					Q_strncpy (skin, sprin->frames[j].name, sizeof(skin)-1);
+					fast_strlwr (skin);
+					GL_PrefetchFindImage (skin, skin, it_sprite);
+				}
+			}
+		}
+
+		ri.FS_FreeFile (buf);
+	}
+
+	//same names as Draw_FindPic
+	for (i = 0; i < numpics; i++)
+	{
+		Q_strncpy (skin, pics[i], sizeof(skin)-1);
+		fast_strlwr (skin);
+
+		if (skin[0] != '/' && skin[0] != '\\')
+		{
+			Com_sprintf (name, sizeof(name), "pics/%s.pcx", skin);
+			GL_PrefetchFindImage (name, skin, it_pic);
+		}
+		else
+		{
+			GL_PrefetchFindImage (skin + 1, skin + 1, it_pic);
+		}
+	}
+
+	GL_StartPrefetch ();
+}
+
 
 /*
 @@@@@@@@@@@@@@@@@@@@@
@@ -1609,8 +1757,17 @@ void EXPORT R_EndRegistration (void)
 		}
 	}
 
+	//stop the decoder threads, anything registered later loads inline
+	GL_EndPrefetch ();
+
 	GL_FreeUnusedImages ();
 	r_registering = false;
+
+	//misses are what write new cache files
+	if (texcache_misses)
+		GL_TexCacheTrim ();
+
+	ri.Con_Printf (PRINT_DEVELOPER, "Registration took %u ms, texture cache %d hits, %d misses\n", Sys_Milliseconds () - registration_start, texcache_hits, texcache_misses);
 }
 
 
@@ -1645,6 +1802,10 @@ void Mod_Free (model_t *mod)
 	}
 
 	Hunk_Free (mod->extradata);
+
+	if (mod->aliasverts)
+		free (mod->aliasverts);
+
 	memset (mod, 0, sizeof(*mod));
 }
 
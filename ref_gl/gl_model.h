@@ -92,6 +92,13 @@ typedef struct glpoly_s
 	float	verts[4][VERTEXSIZE];	// variable sized (xyz s1t1 s2t2)
 } glpoly_t;
 
+typedef struct
+{
+	short		left, top, right, bottom;	// lightmap texels, right/bottom exclusive
+} lmrect_t;
+
+#define LMRECT_EMPTY(r)	((r)->right <= (r)->left || (r)->bottom <= (r)->top)
+
 typedef struct msurface_s
 {
 	int			visframe;		// should be drawn when node is crossed
@@ -106,7 +113,7 @@ typedef struct msurface_s
 	short		extents[2];
 
 	int			light_s, light_t;	// gl lightmap coordinates
-	int			dlight_s, dlight_t; // gl lightmap coordinates for dynamic lightmaps
+	lmrect_t	dlight_rect;		// texels still holding dynamic light in the lightmap texture
 
 	glpoly_t	*polys;				// multiple if warped
 	struct	msurface_s	*texturechain;
@@ -163,6 +170,18 @@ typedef struct mleaf_s
 } mleaf_t;
 
 
+//===================================================================
+
+//
+// Alias model frames unpacked for GL_LerpVerts
+//
+
+typedef struct
+{
+	float		xyz[3];			// dtrivertx_t v[] as floats, still unscaled
+	int			normal;			// lightnormalindex, NUMVERTEXNORMALS if it was broken
+} aliasvert_t;
+
 //===================================================================
 
 //
@@ -237,6 +256,7 @@ typedef struct model_s
 
 	// for alias models and skins
 	image_t		*skins[MAX_MD2SKINS];
+	aliasvert_t	*aliasverts;		// num_frames * num_xyz, malloced
 
 	int			extradatasize;
 	void		*extradata;
@@ -180,6 +180,9 @@ cvar_t	*gl_texturealphamode;
 cvar_t	*gl_texturesolidmode;
 cvar_t	*gl_lockpvs;
 cvar_t	*gl_jpg_quality;
+cvar_t	*gl_decode_threads;
+cvar_t	*gl_texcache;
+cvar_t	*gl_texcache_maxmb;
 cvar_t	*gl_coloredlightmaps;
 
 //cvar_t	*gl_3dlabs_broken;
@@ -1447,6 +1450,9 @@ void R_Register( void )
 	//gl_saturatelighting = ri.Cvar_Get( "gl_saturatelighting", "0", 0 );
 
 	gl_jpg_quality = ri.Cvar_Get ("gl_jpg_quality", "90", 0);
+	gl_decode_threads = ri.Cvar_Get ("gl_decode_threads", "4", 0);
+	gl_texcache = ri.Cvar_Get ("gl_texcache", "1", 0);
+	gl_texcache_maxmb = ri.Cvar_Get ("gl_texcache_maxmb", "256", 0);
 	gl_coloredlightmaps = ri.Cvar_Get ("gl_coloredlightmaps", "1", 0);
 	usingmodifiedlightmaps = (gl_coloredlightmaps->value != 1.0f);
 
@@ -1479,6 +1485,10 @@ void R_Register( void )
 	ri.Cmd_AddCommand( "modellist", Mod_Modellist_f );
 	ri.Cmd_AddCommand( "gl_strings", GL_Strings_f );
 	ri.Cmd_AddCommand( "hash_stats", Cmd_HashStats_f );
+	ri.Cmd_AddCommand( "gl_decodebench", GL_DecodeBench_f );
+	ri.Cmd_AddCommand( "gl_imagebench", GL_ImageBench_f );
+	ri.Cmd_AddCommand( "gl_lerpbench", GL_LerpBench_f );
+	ri.Cmd_AddCommand( "gl_lightbench", GL_LightBench_f );
 	
 
 #ifdef R1GL_RELEASE
@@ -1963,6 +1973,10 @@ void EXPORT R_Shutdown (void)
 	ri.Cmd_RemoveCommand ("imagelist");
 	ri.Cmd_RemoveCommand ("gl_strings");
 	ri.Cmd_RemoveCommand ("hash_stats");
+	ri.Cmd_RemoveCommand ("gl_decodebench");
+	ri.Cmd_RemoveCommand ("gl_imagebench");
+	ri.Cmd_RemoveCommand ("gl_lerpbench");
+	ri.Cmd_RemoveCommand ("gl_lightbench");
 
 #ifdef R1GL_RELEASE
 	ri.Cmd_RemoveCommand ("r1gl_version");
@@ -58,11 +58,14 @@ typedef struct
 static gllightmapstate_t gl_lms;
 
 
-static void		LM_UploadBlock( qboolean dynamic );
+static void		LM_UploadBlock (void);
 static qboolean	LM_AllocBlock (int w, int h, int *x, int *y);
 
 extern void R_SetCacheState( msurface_t *surf );
 extern void R_BuildLightMap (msurface_t *surf, byte *dest, int stride);
+extern void R_BuildLightMapRect (msurface_t *surf, const lmrect_t *rect, byte *dest, int stride);
+extern qboolean R_SurfaceDlightRect (msurface_t *surf, lmrect_t *rect);
+extern void R_UnionLightRect (lmrect_t *rect, const lmrect_t *add);
 
 /*
 =============================================================
@@ -316,7 +319,7 @@ int usingmodifiedlightmaps;
 void R_BlendLightmaps (void)
 {
 	int			i;
-	msurface_t	*surf, *newdrawsurf = 0;
+	msurface_t	*surf;
 
 	// don't bother if we're set to fullbright
 	if (FLOAT_NE_ZERO(r_fullbright->value))
@@ -347,7 +350,8 @@ void R_BlendLightmaps (void)
 		c_visible_lightmaps = 0;
 
 	/*
-	** render static lightmaps first
+	** dynamic light has already been written into each surface's own
+	** lightmap texture by R_UpdateSurfaceLightmap
 	*/
 	for ( i = 1; i < MAX_LIGHTMAPS; i++ )
 	{
@@ -366,87 +370,84 @@ void R_BlendLightmaps (void)
 	}
 
 	/*
-	** render dynamic lightmaps
+	** restore state
 	*/
-	if ( FLOAT_NE_ZERO(gl_dynamic->value) )
-	{
-		memset( gl_lms.allocated, 0, sizeof(gl_lms.allocated));
+	qglDisable (GL_BLEND);
+	qglBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	qglDepthMask( 1 );
+}
 
-		GL_Bind( gl_state.lightmap_textures+0 );
+/*
+================
+R_UpdateSurfaceLightmap
 
-		if (currentmodel == r_worldmodel)
-			c_visible_lightmaps++;
+Brings the part of surf's lightmap texture that is out of date back in
+line: all of it when one of its lightstyles changed value, otherwise
+just the texels dynamic lights reach this frame plus the ones they
+reached when it was last drawn, which go back to static light.
+================
+*/
+static void R_UpdateSurfaceLightmap (msurface_t *surf, qboolean multitexture)
+{
+	int			maps;
+	int			dlightbits;
+	qboolean	dynamic;
+	lmrect_t	lit, update;
+	unsigned	temp[34*34];
 
-		newdrawsurf = gl_lms.lightmap_surfaces[0];
+	if ( surf->texinfo->flags & (SURF_SKY|SURF_TRANS33|SURF_TRANS66|SURF_WARP ) )
+		return;
 
-		for ( surf = gl_lms.lightmap_surfaces[0]; surf != 0; surf = surf->lightmapchain )
-		{
-			int		smax, tmax;
-			byte	*base;
+	dynamic = FLOAT_NE_ZERO (gl_dynamic->value);
 
-			smax = (surf->extents[0]>>4)+1;
-			tmax = (surf->extents[1]>>4)+1;
+	update.left = update.top = update.right = update.bottom = 0;
 
-			if ( LM_AllocBlock( smax, tmax, &surf->dlight_s, &surf->dlight_t ) )
+	if ( dynamic )
+	{
+		for ( maps = 0; maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++ )
+		{
+			if ( r_newrefdef.lightstyles[surf->styles[maps]].white != surf->cached_light[maps] )
 			{
-				base = gl_lms.lightmap_buffer;
-				base += ( surf->dlight_t * BLOCK_WIDTH + surf->dlight_s ) * LIGHTMAP_BYTES;
-
-				R_BuildLightMap (surf, base, BLOCK_WIDTH*LIGHTMAP_BYTES);
+				update.right = (surf->extents[0]>>4)+1;
+				update.bottom = (surf->extents[1]>>4)+1;
+				R_SetCacheState( surf );
+				break;
 			}
-			else
-			{
-				msurface_t *drawsurf;
-
-				// upload what we have so far
-				LM_UploadBlock( true );
+		}
 
-				// draw all surfaces that use this lightmap
-				for ( drawsurf = newdrawsurf; drawsurf != surf; drawsurf = drawsurf->lightmapchain )
-				{
-					if ( drawsurf->polys )
-						DrawGLPolyChain( drawsurf->polys, 
-							              ( drawsurf->light_s - drawsurf->dlight_s ) * 0.0078125f, 
-										( drawsurf->light_t - drawsurf->dlight_t ) * 0.0078125f );
-				}
+		R_SurfaceDlightRect (surf, &lit);
+	}
+	else
+	{
+		lit.left = lit.top = lit.right = lit.bottom = 0;
+	}
 
-				newdrawsurf = drawsurf;
+	R_UnionLightRect (&update, &lit);
+	R_UnionLightRect (&update, &surf->dlight_rect);
+	surf->dlight_rect = lit;
 
-				// clear the block
-				memset(gl_lms.allocated, 0, sizeof(gl_lms.allocated));
-				
-				// try uploading the block now
-				if ( !LM_AllocBlock( smax, tmax, &surf->dlight_s, &surf->dlight_t ) )
-				{
-					ri.Sys_Error( ERR_FATAL, "Consecutive calls to LM_AllocBlock(%d,%d) failed (dynamic)\n", smax, tmax );
-				}
+	if (LMRECT_EMPTY (&update))
+		return;
 
-				base = gl_lms.lightmap_buffer;
-				base += ( surf->dlight_t * BLOCK_WIDTH + surf->dlight_s ) * LIGHTMAP_BYTES;
+	// with gl_dynamic off only put back the static light
+	dlightbits = surf->dlightbits;
+	if ( !dynamic )
+		surf->dlightbits = 0;
 
-				R_BuildLightMap (surf, base, BLOCK_WIDTH*LIGHTMAP_BYTES);
-			}
-		}
+	R_BuildLightMapRect (surf, &update, (void *)temp, (update.right - update.left) * LIGHTMAP_BYTES);
 
-		/*
-		** draw remainder of dynamic lightmaps that haven't been uploaded yet
-		*/
-		if ( newdrawsurf )
-			LM_UploadBlock( true );
+	surf->dlightbits = dlightbits;
 
-		for ( surf = newdrawsurf; surf != 0; surf = surf->lightmapchain )
-		{
-			if ( surf->polys )
-				DrawGLPolyChain( surf->polys, ( surf->light_s - surf->dlight_s ) * ( 0.0078125f ), ( surf->light_t - surf->dlight_t ) * ( 0.0078125f ) );
-		}
-	}
+	if ( multitexture )
+		GL_MBind( GL_TEXTURE1, gl_state.lightmap_textures + surf->lightmaptexturenum );
+	else
+		GL_Bind( gl_state.lightmap_textures + surf->lightmaptexturenum );
 
-	/*
-	** restore state
-	*/
-	qglDisable (GL_BLEND);
-	qglBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	qglDepthMask( 1 );
+	qglTexSubImage2D( GL_TEXTURE_2D, 0,
+					  surf->light_s + update.left, surf->light_t + update.top,
+					  update.right - update.left, update.bottom - update.top,
+					  GL_LIGHTMAP_FORMAT,
+					  GL_UNSIGNED_BYTE, temp );
 }
 
 #define GL_COMBINE_ARB						0x8570
@@ -459,9 +460,7 @@ R_RenderBrushPoly
 */
 void R_RenderBrushPoly (msurface_t *fa)
 {
-	int			maps;
 	image_t		*image;
-	qboolean is_dynamic = false;
 
 	c_brush_polys++;
 
@@ -523,63 +522,10 @@ void R_RenderBrushPoly (msurface_t *fa)
 //PGM
 //======
 
-	/*
-	** check for lightmap modification
-	*/
-	for ( maps = 0; maps < MAXLIGHTMAPS && fa->styles[maps] != 255; maps++ )
-	{
-		if ( r_newrefdef.lightstyles[fa->styles[maps]].white != fa->cached_light[maps] )
-			goto dynamic;
-	}
-
-	// dynamic this frame or dynamic previously
-	if ( ( fa->dlightframe == r_framecount ) )
-	{
-dynamic:
-		if ( FLOAT_NE_ZERO (gl_dynamic->value) )
-		{
-			if (!( fa->texinfo->flags & (SURF_SKY|SURF_TRANS33|SURF_TRANS66|SURF_WARP ) ) )
-			{
-				is_dynamic = true;
-			}
-		}
-	}
+	R_UpdateSurfaceLightmap (fa, false);
 
-	if ( is_dynamic )
-	{
-		if ( ( fa->styles[maps] >= 32 || fa->styles[maps] == 0 ) && ( fa->dlightframe != r_framecount ) )
-		{
-			unsigned	temp[34*34];
-			int			smax, tmax;
-
-			smax = (fa->extents[0]>>4)+1;
-			tmax = (fa->extents[1]>>4)+1;
-
-			R_BuildLightMap( fa, (void *)temp, smax*4 );
-			R_SetCacheState( fa );
-
-			GL_Bind( gl_state.lightmap_textures + fa->lightmaptexturenum );
-
-			qglTexSubImage2D( GL_TEXTURE_2D, 0,
-							  fa->light_s, fa->light_t, 
-							  smax, tmax, 
-							  GL_LIGHTMAP_FORMAT, 
-							  GL_UNSIGNED_BYTE, temp );
-
-			fa->lightmapchain = gl_lms.lightmap_surfaces[fa->lightmaptexturenum];
-			gl_lms.lightmap_surfaces[fa->lightmaptexturenum] = fa;
-		}
-		else
-		{
-			fa->lightmapchain = gl_lms.lightmap_surfaces[0];
-			gl_lms.lightmap_surfaces[0] = fa;
-		}
-	}
-	else
-	{
-		fa->lightmapchain = gl_lms.lightmap_surfaces[fa->lightmaptexturenum];
-		gl_lms.lightmap_surfaces[fa->lightmaptexturenum] = fa;
-	}
+	fa->lightmapchain = gl_lms.lightmap_surfaces[fa->lightmaptexturenum];
+	gl_lms.lightmap_surfaces[fa->lightmaptexturenum] = fa;
 }
 
 
@@ -711,178 +657,64 @@ void DrawTextureChains (void)
 static void GL_RenderLightmappedPoly( msurface_t *surf )
 {
 	int		i, nv = surf->polys->numverts;
-	int		map;
 	float	*v;
 	image_t *image = R_TextureAnimation( surf->texinfo );
-	qboolean is_dynamic = false;
 	unsigned lmtex = surf->lightmaptexturenum;
 	glpoly_t *p;
 
-	for ( map = 0; map < MAXLIGHTMAPS && surf->styles[map] != 255; map++ )
-	{
-		if ( r_newrefdef.lightstyles[surf->styles[map]].white != surf->cached_light[map] )
-			goto dynamic;
-	}
-
-	// dynamic this frame or dynamic previously
-	if ( ( surf->dlightframe == r_framecount ) )
-	{
-dynamic:
-		if ( FLOAT_NE_ZERO (gl_dynamic->value) )
-		{
-			if ( !(surf->texinfo->flags & (SURF_SKY|SURF_TRANS33|SURF_TRANS66|SURF_WARP ) ) )
-			{
-				is_dynamic = true;
-			}
-		}
-	}
-
-	if ( is_dynamic )
-	{
-		unsigned	temp[128*128];
-		int			smax, tmax;
-
-		if ( ( surf->styles[map] >= 32 || surf->styles[map] == 0 ) && ( surf->dlightframe != r_framecount ) )
-		{
-			smax = (surf->extents[0]>>4)+1;
-			tmax = (surf->extents[1]>>4)+1;
+	R_UpdateSurfaceLightmap (surf, true);
 
-			R_BuildLightMap( surf, (void *)temp, smax*4 );
-			R_SetCacheState( surf );
-
-			GL_MBind( GL_TEXTURE1, gl_state.lightmap_textures + surf->lightmaptexturenum );
-
-			lmtex = surf->lightmaptexturenum;
-
-			qglTexSubImage2D( GL_TEXTURE_2D, 0,
-							  surf->light_s, surf->light_t, 
-							  smax, tmax, 
-							  GL_LIGHTMAP_FORMAT, 
-							  GL_UNSIGNED_BYTE, temp );
-
-		}
-		else
-		{
-			smax = (surf->extents[0]>>4)+1;
-			tmax = (surf->extents[1]>>4)+1;
-
-			R_BuildLightMap( surf, (void *)temp, smax*4 );
-
-			GL_MBind( GL_TEXTURE1, gl_state.lightmap_textures + 0 );
-
-			lmtex = 0;
-
-			qglTexSubImage2D( GL_TEXTURE_2D, 0,
-							  surf->light_s, surf->light_t, 
-							  smax, tmax, 
-							  GL_LIGHTMAP_FORMAT, 
-							  GL_UNSIGNED_BYTE, temp );
-
-		}
-
-		c_brush_polys++;
+	c_brush_polys++;
 
-		GL_MBind( GL_TEXTURE0, image->texnum );
-		GL_MBind( GL_TEXTURE1, gl_state.lightmap_textures + lmtex );
+	GL_MBind( GL_TEXTURE0, image->texnum );
+	GL_MBind( GL_TEXTURE1, gl_state.lightmap_textures + lmtex );
 
 //==========
 //PGM
-		if (surf->texinfo->flags & SURF_FLOWING)
-		{
-			float scroll;
-		
-			scroll = -64 * ( (r_newrefdef.time / 40.0f) - (int)(r_newrefdef.time / 40.0f) );
-			if(FLOAT_EQ_ZERO(scroll))
-				scroll = -64.0;
+	if (surf->texinfo->flags & SURF_FLOWING)
+	{
+		float scroll;
+	
+		scroll = -64 * ( (r_newrefdef.time / 40.0f) - (int)(r_newrefdef.time / 40.0f) );
+		if(FLOAT_EQ_ZERO(scroll))
+			scroll = -64.0;
 
-			for ( p = surf->polys; p; p = p->chain )
-			{
-				v = p->verts[0];
-				qglBegin (GL_POLYGON);
-				for (i=0 ; i< nv; i++, v+= VERTEXSIZE)
-				{
-					qglMTexCoord2fSGIS( GL_TEXTURE0, (v[3]+scroll), v[4]);
-					qglMTexCoord2fvSGIS ( GL_TEXTURE1, &v[5]);
-					//qglMTexCoord2fSGIS( GL_TEXTURE1, v[5], v[6]);
-					qglVertex3fv (v);
-				}
-				qglEnd ();
-			}
-		}
-		else
+		for ( p = surf->polys; p; p = p->chain )
 		{
-			for ( p = surf->polys; p; p = p->chain )
+			v = p->verts[0];
+			qglBegin (GL_POLYGON);
+			for (i=0 ; i< nv; i++, v+= VERTEXSIZE)
 			{
-				v = p->verts[0];
-				qglBegin (GL_POLYGON);
-				for (i=0 ; i< nv; i++, v+= VERTEXSIZE)
-				{
-					qglMTexCoord2fvSGIS ( GL_TEXTURE0, &v[3]);
-					qglMTexCoord2fvSGIS ( GL_TEXTURE1, &v[5]);
-					//qglMTexCoord2fSGIS( GL_TEXTURE0, v[3], v[4]);
-					//qglMTexCoord2fSGIS( GL_TEXTURE1, v[5], v[6]);
-					qglVertex3fv (v);
-				}
-				qglEnd ();
+				qglMTexCoord2fSGIS( GL_TEXTURE0, (v[3]+scroll), v[4]);
+				qglMTexCoord2fSGIS( GL_TEXTURE1, v[5], v[6]);
+				qglVertex3fv (v);
 			}
+			qglEnd ();
 		}
-//PGM
-//==========
 	}
 	else
 	{
-		c_brush_polys++;
-
-		GL_MBind( GL_TEXTURE0, image->texnum );
-		GL_MBind( GL_TEXTURE1, gl_state.lightmap_textures + lmtex );
-
-//==========
 //PGM
-		if (surf->texinfo->flags & SURF_FLOWING)
+//==========
+		for ( p = surf->polys; p; p = p->chain )
 		{
-			float scroll;
-		
-			scroll = -64 * ( (r_newrefdef.time / 40.0f) - (int)(r_newrefdef.time / 40.0f) );
-			if(FLOAT_EQ_ZERO(scroll))
-				scroll = -64.0;
-
-			for ( p = surf->polys; p; p = p->chain )
+			v = p->verts[0];
+			qglBegin (GL_POLYGON);
+			for (i=0 ; i< nv; i++, v+= VERTEXSIZE)
 			{
-				v = p->verts[0];
-				qglBegin (GL_POLYGON);
-				for (i=0 ; i< nv; i++, v+= VERTEXSIZE)
-				{
-					qglMTexCoord2fSGIS( GL_TEXTURE0, (v[3]+scroll), v[4]);
-					qglMTexCoord2fSGIS( GL_TEXTURE1, v[5], v[6]);
-					qglVertex3fv (v);
-				}
-				qglEnd ();
+				qglMTexCoord2fvSGIS ( GL_TEXTURE0, &v[3]);
+				qglMTexCoord2fvSGIS ( GL_TEXTURE1, &v[5]);
+				//qglMTexCoord2fSGIS( GL_TEXTURE0, v[3], v[4]);
+				//qglMTexCoord2fSGIS( GL_TEXTURE1, v[5], v[6]);
+				qglVertex3fv (v);
 			}
+			qglEnd ();
 		}
-		else
-		{
-//PGM
-//==========
-			for ( p = surf->polys; p; p = p->chain )
-			{
-				v = p->verts[0];
-				qglBegin (GL_POLYGON);
-				for (i=0 ; i< nv; i++, v+= VERTEXSIZE)
-				{
-					qglMTexCoord2fvSGIS ( GL_TEXTURE0, &v[3]);
-					qglMTexCoord2fvSGIS ( GL_TEXTURE1, &v[5]);
-					//qglMTexCoord2fSGIS( GL_TEXTURE0, v[3], v[4]);
-					//qglMTexCoord2fSGIS( GL_TEXTURE1, v[5], v[6]);
-					qglVertex3fv (v);
-				}
-				qglEnd ();
-			}
 //==========
 //PGM
-		}
+	}
 //PGM
 //==========
-	}
 }
 
 /*
@@ -1430,55 +1262,22 @@ void R_MarkLeaves (void)
 =============================================================================
 */
 
-static void LM_UploadBlock( qboolean dynamic )
+static void LM_UploadBlock (void)
 {
-	int texture;
-	int height = 0;
-
-	if ( dynamic )
-	{
-		texture = 0;
-	}
-	else
-	{
-		texture = gl_lms.current_lightmap_texture;
-	}
-
-	GL_Bind( gl_state.lightmap_textures + texture );
+	GL_Bind( gl_state.lightmap_textures + gl_lms.current_lightmap_texture );
 	qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	if ( dynamic )
-	{
-		int i;
-
-		for ( i = 0; i < BLOCK_WIDTH; i++ )
-		{
-			if ( gl_lms.allocated[i] > height )
-				height = gl_lms.allocated[i];
-		}
-
-		qglTexSubImage2D( GL_TEXTURE_2D, 
-						  0,
-						  0, 0,
-						  BLOCK_WIDTH, height,
-						  GL_LIGHTMAP_FORMAT,
-						  GL_UNSIGNED_BYTE,
-						  gl_lms.lightmap_buffer );
-	}
-	else
-	{
-		qglTexImage2D( GL_TEXTURE_2D, 
-					   0, 
-					   gl_lms.internal_format,
-					   BLOCK_WIDTH, BLOCK_HEIGHT, 
-					   0, 
-					   GL_LIGHTMAP_FORMAT, 
-					   GL_UNSIGNED_BYTE, 
-					   gl_lms.lightmap_buffer );
-		if ( ++gl_lms.current_lightmap_texture == MAX_LIGHTMAPS )
-			ri.Sys_Error( ERR_DROP, "LM_UploadBlock() - MAX_LIGHTMAPS exceeded\n" );
-	}
+	qglTexImage2D( GL_TEXTURE_2D, 
+				   0, 
+				   gl_lms.internal_format,
+				   BLOCK_WIDTH, BLOCK_HEIGHT, 
+				   0, 
+				   GL_LIGHTMAP_FORMAT, 
+				   GL_UNSIGNED_BYTE, 
+				   gl_lms.lightmap_buffer );
+	if ( ++gl_lms.current_lightmap_texture == MAX_LIGHTMAPS )
+		ri.Sys_Error( ERR_DROP, "LM_UploadBlock() - MAX_LIGHTMAPS exceeded\n" );
 }
 
 // returns a texture number and the position inside it
@@ -1616,7 +1415,7 @@ void GL_CreateSurfaceLightmap (msurface_t *surf)
 
 	if ( !LM_AllocBlock( smax, tmax, &surf->light_s, &surf->light_t ) )
 	{
-		LM_UploadBlock( false );
+		LM_UploadBlock ();
 		memset(gl_lms.allocated, 0, sizeof(gl_lms.allocated));
 		if ( !LM_AllocBlock( smax, tmax, &surf->light_s, &surf->light_t ) )
 		{
@@ -1644,7 +1443,6 @@ void GL_BeginBuildingLightmaps (void)
 {
 	static lightstyle_t	lightstyles[MAX_LIGHTSTYLES];
 	int				i;
-	unsigned		dummy[128*128];
 
 	memset( gl_lms.allocated, 0, sizeof(gl_lms.allocated) );
 
@@ -1710,21 +1508,6 @@ void GL_BeginBuildingLightmaps (void)
 		gl_lms.internal_format = gl_tex_solid_format;
 	}*/
 	gl_lms.internal_format = gl_tex_solid_format;
-
-	/*
-	** initialize the dynamic lightmap texture
-	*/
-	GL_Bind( gl_state.lightmap_textures + 0 );
-	qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	qglTexImage2D( GL_TEXTURE_2D, 
-				   0, 
-				   gl_lms.internal_format,
-				   BLOCK_WIDTH, BLOCK_HEIGHT, 
-				   0, 
-				   GL_LIGHTMAP_FORMAT, 
-				   GL_UNSIGNED_BYTE, 
-				   dummy );
 }
 
 /*
@@ -1734,7 +1517,7 @@ GL_EndBuildingLightmaps
 */
 void GL_EndBuildingLightmaps (void)
 {
-	LM_UploadBlock( false );
+	LM_UploadBlock ();
 	GL_EnableMultitexture( false );
 }
 
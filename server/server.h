@@ -47,6 +47,7 @@ typedef struct bannedcommands_s
 } bannedcommands_t;
 
 extern bannedcommands_t bannedcommands;
+extern struct rbtree	*bannedcommands_index;
 
 typedef struct ratelimit_s
 {
@@ -104,6 +105,10 @@ typedef struct
 
 	// demo server information
 	FILE		*demofile;
+	long		demostart;		// offset of the demo in its (pak) file
+	byte		*demoindex;		// keyframes from the .idx next to the demo
+	int			demoindexlen;
+	const ddemokeyframe_t	*demoseek;	// jump here on the next frame
 	uint32		randomframe;
 } server_t;
 
@@ -137,6 +142,23 @@ typedef struct
 #define	LATENCY_COUNTS	64
 #define	RATE_MESSAGES	10
 
+//r1: delay based rate control, the rate a client gets follows how much its frame
+//acks are delayed beyond the lowest latency seen lately (ie queueing on its link)
+#define	RATECONTROL_MIN		1000		// never squeeze a client below this
+#define	RATECONTROL_WINDOW	10000		// msec a base latency sample is trusted for
+
+typedef struct
+{
+	int			rate;				// bytes per RATE_MESSAGES frames we let the client have
+	int			used;				// bytes sent in the last RATE_MESSAGES frames
+	int			latency;			// smoothed frame ack latency
+	int			window_min;			// lowest latency in this window
+	int			last_min;			// and in the one before
+	unsigned	window_start;
+	unsigned	last_decrease;
+	int			zlevel;				// zlib level for this client's frames
+} ratecontrol_t;
+
 //#define MAX_DELTA_SAMPLES 30
 
 typedef struct
@@ -148,6 +170,20 @@ typedef struct
 	vec3_t	origin_saved;
 } pmovestatus_t;
 
+//r1: how late player updates go out, 0, 1, 2-3, 4-7, 8-15, 16-31 and 32+ msec
+#define	PLAYERUPDATE_BUCKETS	7
+
+//r1: player updates due within this many msec are sent in the same pass
+#define	PLAYERUPDATE_SLACK		2
+
+//r1: uncompressed contents of a referenced svc_zpacket, by netchan sequence
+typedef struct zframe_s
+{
+	int				sequence;
+	int				length;
+	byte			data[MAX_ZFRAME];
+} zframe_t;
+
 typedef struct client_s
 {
 	serverclient_state_t	state;
@@ -166,6 +202,7 @@ typedef struct client_s
 	int				message_size[RATE_MESSAGES];	// used to rate drop packets
 	int				rate;
 	int				surpressCount;		// number of messages rate supressed
+	ratecontrol_t	ratecontrol;
 
 	edict_t			*edict;				// EDICT_NUM(clientnum+1)
 	char			name[16];			// extracted from userinfo, high bits masked
@@ -210,6 +247,9 @@ typedef struct client_s
 	//r1: client-specific last deltas (kind of like dynamic baselines)
 	entity_state_t	*lastlines;
 
+	//r1: frames sent as referenced zpackets, dictionaries for later frames
+	zframe_t		*zframes;
+
 	//r1: misc flags
 	uint32			notes;
 
@@ -263,6 +303,8 @@ typedef struct client_s
 	unsigned					min_ping, avg_ping_count, avg_ping_time, max_ping;
 	unsigned					last_incoming_sequence;
 	unsigned					player_updates_sent;
+	unsigned					player_update_base;		// svs.realtime the last frame went out
+	unsigned					player_update_latency[PLAYERUPDATE_BUCKETS];
 
 	pmovestatus_t				current_move;
 
@@ -280,18 +322,6 @@ typedef struct client_s
 
 //=============================================================================
 
-// MAX_CHALLENGES is made large to prevent a denial
-// of service attack that could cycle all of them
-// out before legitimate users connected
-#define	MAX_CHALLENGES	1024
-
-typedef struct
-{
-	netadr_t	adr;
-	int32		challenge;
-	uint32	 	time;
-} challenge_t;
-
 //extra struct for server-private entity information
 typedef struct
 {
@@ -317,8 +347,6 @@ typedef struct
 
 	int			last_heartbeat;
 
-	challenge_t	challenges[MAX_CHALLENGES];	// to prevent invalid IPs from connecting
-
 	// serverrecord values
 	FILE		*demofile;
 	sizebuf_t	demo_multicast;
@@ -335,6 +363,13 @@ typedef struct
 	unsigned long		r1q2OptimizedBytes;
 	unsigned long		r1q2CustomBytes;
 	unsigned long		r1q2AttnBytes;
+	unsigned long		statusReplies;
+	unsigned long		statusRebuilds;
+	unsigned long		zstreamFrames;
+	unsigned long		zstreamReferenced;
+	unsigned long		zstreamBytesIn;
+	unsigned long		zstreamBytesOut;
+	double				zstreamTime;
 #endif
 
 	sventity_t			entities[MAX_EDICTS];
@@ -482,6 +517,14 @@ extern cvar_t	*sv_deny_q2ace;
 
 extern cvar_t	*sv_gamedebug;
 extern cvar_t	*sv_packetentities_hack;
+extern cvar_t	*sv_zstream;
+extern cvar_t	*sv_zstream_minsize;
+extern cvar_t	*sv_zstream_dictionary;
+extern cvar_t	*sv_netchan_window;
+extern cvar_t	*sv_netchan_fragment;
+extern cvar_t	*sv_ratecontrol;
+extern cvar_t	*sv_ratecontrol_target;
+extern cvar_t	*sv_ratecontrol_max;
 
 extern cvar_t	*sv_optimize_deltas;
 
@@ -539,6 +582,10 @@ void SV_FlushRedirect (int sv_redirected, char *outputbuf);
 //void SV_DemoCompleted (void);
 void SV_SendClientMessages (void);
 
+void SV_LoadDemoIndex (const char *name);
+const ddemokeyframe_t *SV_NextDemoKeyframe (const ddemokeyframe_t *key);
+int SV_DemoTime (void);
+
 void EXPORT SV_Multicast (vec3_t /*@null@*/origin, multicast_t to);
 void EXPORT SV_StartSound (vec3_t origin, edict_t *entity, int channel,
 					int soundindex, float volume,
@@ -555,6 +602,10 @@ void SV_AddMessage (client_t *cl, qboolean reliable);
 
 void SV_WriteReliableMessages (client_t *client, int buffSize);
 
+int SV_ClientRate (client_t *cl);
+void SV_RateControlSample (ratecontrol_t *rc, int latency, unsigned now);
+qboolean SV_RateExceeded (ratecontrol_t *rc, const int *message_size, int rate);
+
 void SV_ClearMessageList (client_t *client);
 
 //
@@ -562,6 +613,8 @@ void SV_ClearMessageList (client_t *client);
 //
 void SV_Nextserver (void);
 void SV_ExecuteClientMessage (client_t *cl);
+void SV_InvalidateConnectCache (void);
+void SV_FreeConnectCache (void);
 
 //
 // sv_ccmds.c
@@ -671,6 +724,29 @@ struct netblock_s
 #define	BLACKHOLE_SILENT	0
 #define	BLACKHOLE_MESSAGE	1
 
+//r1: prefix trie for matching the above
+typedef struct iptrie_node_s iptrie_node_t;
+
+struct iptrie_node_s
+{
+	iptrie_node_t	*child[2];
+	uint32			prefix;		// host order
+	int				bits;
+	void			*value;		// NULL if only joining two subtrees
+};
+
+typedef struct iptrie_s
+{
+	int				tag;
+	int				count;
+	iptrie_node_t	*root;
+} iptrie_t;
+
+void IPTrie_Insert (iptrie_t *t, uint32 network_ip, uint32 network_mask, void *value);
+qboolean IPTrie_Remove (iptrie_t *t, uint32 network_ip, uint32 network_mask, const void *value);
+void *IPTrie_Match (const iptrie_t *t, uint32 network_ip);
+void IPTrie_Clear (iptrie_t *t);
+
 #define CVARBAN_KICK		1
 #define CVARBAN_BLACKHOLE	2
 #define	CVARBAN_LOGONLY		3
@@ -679,27 +755,42 @@ struct netblock_s
 #define	CVARBAN_EXEC		6
 
 extern blackhole_t blackholes;
+extern iptrie_t blackhole_trie;
 #ifdef ANTICHEAT
 extern netblock_t anticheat_exceptions;
 #endif
 
 typedef struct banmatch_s banmatch_t;
 
+#define	BANMATCH_EXISTS		0
+#define	BANMATCH_GREATER	1
+#define	BANMATCH_LESS		2
+#define	BANMATCH_EQUAL		3
+#define	BANMATCH_CONTAINS	4
+#define	BANMATCH_STRING		5
+
 struct banmatch_s
 {
 	banmatch_t	*next;
 	char		*matchvalue;
 	char		*message;
 	int			blockmethod;
+
+	//matchvalue parsed once when the ban is added
+	int			op;
+	qboolean	want;
+	float		number;
+	const char	*value;
 };
 
 typedef struct varban_s varban_t;
 
 struct varban_s
 {
-	varban_t	*next;
-	char		*varname;
-	banmatch_t	match;
+	varban_t		*next;
+	char			*varname;
+	banmatch_t		match;
+	struct rbtree	*index;		//list head only, varname -> varban_t
 };
 
 extern	varban_t	cvarbans;
@@ -717,6 +808,7 @@ qboolean StringIsNumeric (const char *s);
 uint32 CalcMask (int32 bits);
 
 extern netblock_t	blackhole_exceptions;
+extern iptrie_t		whitehole_trie;
 
 #ifdef ANTICHEAT
 void SV_AntiCheat_WaitForInitialConnect (void);
@@ -779,6 +871,8 @@ enum
 
 extern netblock_t	anticheat_exceptions;
 extern netblock_t	anticheat_requirements;
+extern iptrie_t		anticheat_exception_trie;
+extern iptrie_t		anticheat_requirement_trie;
 
 extern char anticheat_hashlist_name[256];
 
@@ -787,7 +881,7 @@ extern const char *anticheat_client_names[];
 #endif
 
 void SV_ClientBegin (client_t *cl);
-void SV_SendPlayerUpdates (int msec_to_next_frame);
+int SV_SendPlayerUpdates (void);
 
 extern cvar_t	*g_features;
 
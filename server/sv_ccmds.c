@@ -18,6 +18,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 #include "server.h"
+#include "../qcommon/redblack.h"
 
 /*
 ===============================================================================
@@ -597,6 +598,80 @@ static void SV_DemoMap_f (void)
 	SV_Map (true, Cmd_Argv(1), false );
 }
 
+/*
+==================
+SV_DemoSeek_f
+
+Jumps demo playback to the keyframe at or before the given time
+==================
+*/
+static void SV_DemoSeek_f (void)
+{
+	const ddemokeyframe_t	*key, *best;
+	const char				*s, *p;
+	int						now, count, target;
+	qboolean				relative;
+
+	if (sv.state != ss_demo || !sv.demofile)
+	{
+		Com_Printf ("Not playing a demo.\n", LOG_GENERAL);
+		return;
+	}
+
+	if (!sv.demoindex)
+	{
+		Com_Printf ("No index for demos/%s, record it with cl_demoindex set to seek.\n", LOG_GENERAL, sv.name);
+		return;
+	}
+
+	now = SV_DemoTime ();
+
+	if (Cmd_Argc() != 2)
+	{
+		count = 0;
+		best = NULL;
+		for (key = SV_NextDemoKeyframe (NULL); key; key = SV_NextDemoKeyframe (key))
+		{
+			best = key;
+			count++;
+		}
+
+		Com_Printf ("Purpose: Jump to a point in the demo being played.\n"
+					"Syntax : demoseek <[+|-]seconds|minutes:seconds>\n"
+					"Example: demoseek 2:30\n"
+					"At %d:%02d, %d keyframes up to %d:%02d.\n", LOG_GENERAL,
+					now / 60000, (now / 1000) % 60, count, LittleLong (best->time) / 60000, (LittleLong (best->time) / 1000) % 60);
+		return;
+	}
+
+	s = Cmd_Argv(1);
+
+	relative = (s[0] == '+' || s[0] == '-');
+
+	p = strchr (s, ':');
+	if (p)
+		target = (int)(atof (s + relative) * 60000 + atof (p + 1) * 1000);
+	else
+		target = (int)(atof (s + relative) * 1000);
+
+	if (s[0] == '+')
+		target = now + target;
+	else if (s[0] == '-')
+		target = now - target;
+
+	best = SV_NextDemoKeyframe (NULL);
+	for (key = best; key; key = SV_NextDemoKeyframe (key))
+	{
+		if (LittleLong (key->time) > target)
+			break;
+		best = key;
+	}
+
+	sv.demoseek = best;
+
+	Com_Printf ("Seeking to %d:%02d.\n", LOG_GENERAL, LittleLong (best->time) / 60000, (LittleLong (best->time) / 1000) % 60);
+}
+
 /*
 ==================
 SV_GameMap_f
@@ -991,11 +1066,11 @@ static void SV_ListUserinfoBans_f (void)
 	ShowVarBans (&userinfobans);
 }
 
-static qboolean DeleteVarBan (varban_t *bans, char *match)
+static qboolean DeleteVarBan (varban_t *list, char *match)
 {
-	varban_t	*last;
+	varban_t	*bans, *last;
 
-	last = bans;
+	last = bans = list;
 
 	while (bans->next)
 	{
@@ -1013,6 +1088,7 @@ static qboolean DeleteVarBan (varban_t *bans, char *match)
 			}
 		
 			last->next = bans->next;
+			rbdelete (bans->varname, list->index);
 			Z_Free (bans->varname);
 			Z_Free (bans);
 			return true;
@@ -1063,8 +1139,70 @@ static void SV_DelUserinfoBan_f (void)
     	Com_Printf ("userinfoban '%s' not found.\n", LOG_GENERAL, match);
 }
 
+/*
+===============
+CompileBanMatch
+
+parses the modifiers off a ban's matchvalue so VarBanMatch doesn't have to
+redo it for every result it checks.
+===============
+*/
+static void CompileBanMatch (banmatch_t *match)
+{
+	const char	*matchvalue;
+
+	matchvalue = match->matchvalue;
+
+	match->want = true;
+
+	if (matchvalue[0] == '!')
+	{
+		match->want = false;
+		matchvalue++;
+	}
+
+	match->value = matchvalue;
+	match->number = 0;
+
+	if (matchvalue[0] == '*')
+	{
+		match->op = BANMATCH_EXISTS;
+		return;
+	}
+
+	match->op = BANMATCH_STRING;
+
+	//single characters are compared as is
+	if (!matchvalue[1])
+		return;
+
+	switch (matchvalue[0])
+	{
+		case '>':
+			match->op = BANMATCH_GREATER;
+			break;
+		case '<':
+			match->op = BANMATCH_LESS;
+			break;
+		case '=':
+			match->op = BANMATCH_EQUAL;
+			break;
+		case '~':
+			match->op = BANMATCH_CONTAINS;
+			break;
+		case '#':
+			break;
+		default:
+			return;
+	}
+
+	match->value = matchvalue + 1;
+	match->number = (float)atof (match->value);
+}
+
 static qboolean AddVarBan (varban_t *list, char *cvar, char *blocktype, char *iffound)
 {
+	void		**data;
 	banmatch_t	*match = NULL;
 	varban_t	*bans = list;
 	int			blockmethod;
@@ -1150,6 +1288,12 @@ static qboolean AddVarBan (varban_t *list, char *cvar, char *blocktype, char *if
 		bans->next = NULL;
 		bans->varname = CopyString (cvar, TAGMALLOC_CVARBANS);
 
+		if (!list->index)
+			list->index = rbinit ((int (EXPORT *)(const void *, const void *))Q_stricmp, 0);
+
+		data = rbsearch (bans->varname, list->index);
+		*data = bans;
+
 		match = &bans->match;
 	}
 
@@ -1161,6 +1305,8 @@ static qboolean AddVarBan (varban_t *list, char *cvar, char *blocktype, char *if
 	match->message = CopyString (Cmd_Args2 (4), TAGMALLOC_CVARBANS);
 	match->blockmethod = blockmethod;
 
+	CompileBanMatch (match);
+
 	return true;
 }
 
@@ -1304,6 +1450,7 @@ static void SV_AddCommandBan_f (void)
 	int16				logmethod;
 	int16				method;
 	bannedcommands_t	*x;
+	void				**data;
 
 	if (Cmd_Argc() < 2)
 	{
@@ -1353,6 +1500,12 @@ static void SV_AddCommandBan_f (void)
 	x->logmethod = logmethod;
 	x->next = NULL;
 
+	if (!bannedcommands_index)
+		bannedcommands_index = rbinit ((int (EXPORT *)(const void *, const void *))strcmp, 0);
+
+	data = rbsearch (x->name, bannedcommands_index);
+	*data = x;
+
 	if (sv.state)
 		Com_Printf ("Command '%s' is blocked from use with %s.\n", LOG_GENERAL, x->name, cmdbanmethodnames[x->kickmethod]);
 }
@@ -1396,6 +1549,7 @@ static void SV_DelCommandBan_f (void)
 			// just copy the next over, don't care if it's null
 			last->next = temp->next;
 
+			rbdelete (temp->name, bannedcommands_index);
 			Z_Free (temp->name);
 			Z_Free (temp);
 
@@ -1527,7 +1681,7 @@ static void SV_Addhole_f (void)
 	Blackhole (&adr, false, mask, method, "%s", Cmd_Args2(3));
 }
 
-static qboolean ValidateAndAddToNetBlockList (char *ip, netblock_t *list, int tag)
+static qboolean ValidateAndAddToNetBlockList (char *ip, netblock_t *list, iptrie_t *trie, int tag)
 {
 	int			mask;
 	netadr_t	from;
@@ -1547,10 +1701,12 @@ static qboolean ValidateAndAddToNetBlockList (char *ip, netblock_t *list, int ta
 	n->mask = NET_htonl (CalcMask(mask));
 	n->next = NULL;
 
+	IPTrie_Insert (trie, n->ip, n->mask, n);
+
 	return true;
 }
 
-static qboolean ValidateAndRemoveFromNetBlockList (char *ip, netblock_t *list)
+static qboolean ValidateAndRemoveFromNetBlockList (char *ip, netblock_t *list, iptrie_t *trie)
 {
 	int			mask;
 	netadr_t	from;
@@ -1572,9 +1728,24 @@ static qboolean ValidateAndRemoveFromNetBlockList (char *ip, netblock_t *list)
 		if (n->ip == network_ip && n->mask == network_mask)
 		{
 			last->next = n->next;
+
+			//if there's another entry for the same block it takes over
+			if (IPTrie_Remove (trie, n->ip, n->mask, n))
+			{
+				for (last = list->next; last; last = last->next)
+				{
+					if (last->mask == n->mask && (last->ip & last->mask) == (n->ip & n->mask))
+					{
+						IPTrie_Insert (trie, last->ip, last->mask, last);
+						break;
+					}
+				}
+			}
+
 			Z_Free (n);
 			return 0;
 		}
+		last = n;
 	}
 
 	return -2;
@@ -1590,7 +1761,7 @@ static void SV_AddWhiteHole_f (void)
 		return;
 	}
 
-	if (ValidateAndAddToNetBlockList (Cmd_Argv(1), &blackhole_exceptions, TAGMALLOC_BLACKHOLE))
+	if (ValidateAndAddToNetBlockList (Cmd_Argv(1), &blackhole_exceptions, &whitehole_trie, TAGMALLOC_BLACKHOLE))
 	{
 		if (sv.state)
 			Com_Printf ("Blackhole exception added.\n", LOG_GENERAL);
@@ -1609,7 +1780,7 @@ static void SV_DelWhiteHole_f (void)
 		return;
 	}
 
-	ret = ValidateAndRemoveFromNetBlockList (Cmd_Argv(1), &blackhole_exceptions);
+	ret = ValidateAndRemoveFromNetBlockList (Cmd_Argv(1), &blackhole_exceptions, &whitehole_trie);
 
 	if (sv.state)
 	{
@@ -1625,6 +1796,290 @@ static void SV_ListWhiteHoles_f (void)
 	DumpNetBlockList (&blackhole_exceptions);
 }
 
+/*
+==================
+SV_FloodBench_f
+
+Matches a stream of spoofed source addresses against a set of random
+blackholes, once by walking a list like we used to and once with the trie.
+Half the addresses fall inside a blackhole.
+==================
+*/
+static void SV_FloodBench_f (void)
+{
+	int				i, j;
+	int				numpackets, numholes;
+	int				listhits, triehits;
+	unsigned int	start, listtime, trietime;
+	uint32			seed, ip;
+	blackhole_t		*holes;
+	iptrie_t		trie;
+
+	numpackets = Cmd_Argc() > 1 ? atoi (Cmd_Argv(1)) : 1000000;
+	numholes = Cmd_Argc() > 2 ? atoi (Cmd_Argv(2)) : 5000;
+
+	if (numpackets <= 0 || numholes <= 0)
+	{
+		Com_Printf ("Purpose: Benchmark blackhole matching against a packet flood.\n"
+					"Syntax : floodbench [packets] [blackholes]\n"
+					"Example: floodbench 1000000 5000\n", LOG_GENERAL);
+		return;
+	}
+
+	holes = Z_TagMalloc (sizeof(*holes) * numholes, TAGMALLOC_BLACKHOLE);
+	memset (holes, 0, sizeof(*holes) * numholes);
+
+	trie.tag = TAGMALLOC_BLACKHOLE;
+	trie.count = 0;
+	trie.root = NULL;
+
+	//a mix of /16 to /32 blocks, mostly /32 like the automatic ones
+	seed = 0x1234567;
+	for (i = 0; i < numholes; i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		holes[i].ip = seed;
+		holes[i].mask = NET_htonl (CalcMask ((seed >> 28) < 12 ? 32 : 16 + (seed & 15)));
+		holes[i].next = (i < numholes - 1) ? &holes[i+1] : NULL;
+		IPTrie_Insert (&trie, holes[i].ip, holes[i].mask, &holes[i]);
+	}
+
+	listhits = triehits = 0;
+
+	seed = 0x7654321;
+	start = Sys_Milliseconds ();
+	for (i = 0; i < numpackets; i++)
+	{
+		blackhole_t	*hole;
+
+		seed = seed * 1664525 + 1013904223;
+		ip = (seed & 1) ? holes[(seed >> 8) % numholes].ip : seed;
+
+		for (hole = holes; hole; hole = hole->next)
+		{
+			if ((ip & hole->mask) == (hole->ip & hole->mask))
+			{
+				listhits++;
+				break;
+			}
+		}
+	}
+	listtime = Sys_Milliseconds () - start;
+
+	seed = 0x7654321;
+	start = Sys_Milliseconds ();
+	for (i = 0; i < numpackets; i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		ip = (seed & 1) ? holes[(seed >> 8) % numholes].ip : seed;
+
+		if (IPTrie_Match (&trie, ip))
+			triehits++;
+	}
+	trietime = Sys_Milliseconds () - start;
+
+	j = trie.count;
+
+	IPTrie_Clear (&trie);
+	Z_Free (holes);
+
+	Com_Printf ("%d packets against %d blackholes (%d unique blocks):\n", LOG_GENERAL, numpackets, numholes, j);
+	Com_Printf ("list: %u ms, %d blocked, %.0f packets/sec\n", LOG_GENERAL, listtime, listhits, listtime ? numpackets / (listtime / 1000.0) : 0.0);
+	Com_Printf ("trie: %u ms, %d blocked, %.0f packets/sec\n", LOG_GENERAL, trietime, triehits, trietime ? numpackets / (trietime / 1000.0) : 0.0);
+
+	if (listhits != triehits)
+		Com_Printf ("WARNING: list and trie disagree!\n", LOG_GENERAL);
+}
+
+#ifndef DEDICATED_ONLY
+typedef struct
+{
+	int		sent, skipped;
+	int		bytes;				// arrived at the client
+	int		latency, maxlatency;
+	int		samples;
+	int		rate;
+} ratetest_t;
+
+/*
+==================
+SV_RateTestRun
+
+sends framesize byte frames at 10fps from a server netchan to a client
+netchan over the loopback for "seconds" of simulated time, dropping frames
+like SV_RateDrop does. the client answers every 10ms and the ack latency
+of each frame is measured. with control, the rate comes from the rate
+control instead of staying at "declared", which still caps it.
+==================
+*/
+static void SV_RateTestRun (qboolean control, int seconds, int framesize, int declared, ratetest_t *result)
+{
+	static byte		filler[MAX_USABLEMSG];
+	netchan_t		*server, *client;
+	sizebuf_t		recv;
+	byte			recv_buf[MAX_MSGLEN];
+	netadr_t		adr, from;
+	ratecontrol_t	rc;
+	int				message_size[RATE_MESSAGES];
+	unsigned		senttime[64];
+	unsigned		start, now;
+	int				msec, frame, acked, latency, rate;
+
+	server = Z_TagMalloc (sizeof(netchan_t) * 2, TAGMALLOC_NETCHAN);
+	client = server + 1;
+
+	memset (&adr, 0, sizeof(adr));
+	adr.type = NA_LOOPBACK;
+
+	Netchan_Setup (NS_SERVER, server, &adr, PROTOCOL_R1Q2, 0, 1390);
+	Netchan_Setup (NS_CLIENT, client, &adr, PROTOCOL_R1Q2, 0, 0);
+
+	SZ_Init (&recv, recv_buf, sizeof(recv_buf));
+
+	memset (&rc, 0, sizeof(rc));
+	memset (message_size, 0, sizeof(message_size));
+	memset (result, 0, sizeof(*result));
+
+	rc.rate = declared;
+	frame = acked = 0;
+	start = curtime;
+
+	for (msec = 0; msec < seconds * 1000; msec += 5)
+	{
+		now = curtime = start + msec;
+
+		//acks come back
+		while (NET_GetPacket (NS_SERVER, &from, &recv) > 0)
+		{
+			if (!Netchan_Process (server, &recv) || server->incoming_acknowledged <= acked)
+				continue;
+
+			acked = server->incoming_acknowledged;
+			latency = now - senttime[acked & 63];
+
+			if (control)
+				SV_RateControlSample (&rc, latency, now);
+
+			result->latency += latency;
+			result->samples++;
+			if (latency > result->maxlatency)
+				result->maxlatency = latency;
+		}
+
+		if (!(msec % 100))
+		{
+			if (control && rc.rate > declared)
+				rc.rate = declared;
+
+			rate = control ? rc.rate : declared;
+
+			if (SV_RateExceeded (&rc, message_size, rate))
+			{
+				message_size[frame % RATE_MESSAGES] = 0;
+				result->skipped++;
+			}
+			else
+			{
+				senttime[server->outgoing_sequence & 63] = now;
+				Netchan_Transmit (server, framesize, filler);
+				message_size[frame % RATE_MESSAGES] = framesize;
+				result->sent++;
+			}
+			frame++;
+		}
+
+		while (NET_GetPacket (NS_CLIENT, &from, &recv) > 0)
+		{
+			if (Netchan_Process (client, &recv))
+				result->bytes += recv.cursize - recv.readcount;
+		}
+
+		if (!(msec % 10))
+			Netchan_Transmit (client, 0, NULL);
+	}
+
+	//drain whatever is still in flight so it doesn't leak into the next run
+	curtime = start + seconds * 1000 + 600000;
+	while (NET_GetPacket (NS_SERVER, &from, &recv) > 0);
+	while (NET_GetPacket (NS_CLIENT, &from, &recv) > 0);
+
+	Netchan_Shutdown (server);
+	Netchan_Shutdown (client);
+	Z_Free (server);
+
+	curtime = start;
+
+	if (result->samples)
+		result->latency /= result->samples;
+
+	result->rate = control ? rc.rate : declared;
+}
+
+/*
+==================
+SV_RateTest_f
+
+Runs a stream of frames over a loopback link limited with net_sim_bandwidth
+once held to the rate userinfo and once with sv_ratecontrol.
+==================
+*/
+static void SV_RateTest_f (void)
+{
+	char		oldloss[16], oldlatency[16], oldbandwidth[16];
+	int			bandwidth, latency, declared, framesize, seconds, i;
+	ratetest_t	result;
+
+	bandwidth = Cmd_Argc() > 1 ? atoi (Cmd_Argv(1)) : 4000;
+	latency = Cmd_Argc() > 2 ? atoi (Cmd_Argv(2)) : 50;
+	declared = Cmd_Argc() > 3 ? atoi (Cmd_Argv(3)) : 15000;
+	framesize = Cmd_Argc() > 4 ? atoi (Cmd_Argv(4)) : 800;
+	seconds = Cmd_Argc() > 5 ? atoi (Cmd_Argv(5)) : 30;
+
+	if (bandwidth <= 0 || latency < 0 || declared < 100 || framesize <= 0 || framesize > 1390 || seconds <= 0)
+	{
+		Com_Printf ("Purpose: Simulate a client on a congested link with and without sv_ratecontrol.\n"
+					"Syntax : ratetest [link bytes/sec] [latency] [rate userinfo] [frame bytes] [seconds]\n"
+					"Example: ratetest 4000 50 15000 800 30\n", LOG_GENERAL);
+		return;
+	}
+
+	if (Com_ServerState ())
+	{
+		Com_Printf ("ratetest uses the loopback, it can't run while a local server is active.\n", LOG_GENERAL);
+		return;
+	}
+
+	//it drains the client socket and changes net_sim_*, both would hit a live connection
+	if (!CL_Disconnected ())
+	{
+		Com_Printf ("ratetest can't run while connected, disconnect first.\n", LOG_GENERAL);
+		return;
+	}
+
+	Q_strncpy (oldloss, Cvar_VariableString ("net_sim_loss"), sizeof(oldloss)-1);
+	Q_strncpy (oldlatency, Cvar_VariableString ("net_sim_latency"), sizeof(oldlatency)-1);
+	Q_strncpy (oldbandwidth, Cvar_VariableString ("net_sim_bandwidth"), sizeof(oldbandwidth)-1);
+
+	Cvar_Set ("net_sim_loss", "0");
+	Cvar_Set ("net_sim_latency", va("%d", latency));
+	Cvar_Set ("net_sim_bandwidth", va("%d", bandwidth));
+
+	Com_Printf ("%d sec of %d byte frames at 10fps, %d bytes/sec link, %dms latency each way, rate %d:\n", LOG_GENERAL, seconds, framesize, bandwidth, latency, declared);
+
+	for (i = 0; i < 2; i++)
+	{
+		SV_RateTestRun (i, seconds, framesize, declared, &result);
+		Com_Printf ("%s %d sent, %d skipped, %d bytes/sec arrived, latency avg %d max %d ms, rate %d\n", LOG_GENERAL,
+			i ? "sv_ratecontrol:" : "rate userinfo: ",
+			result.sent, result.skipped, result.bytes / seconds, result.latency, result.maxlatency, result.rate);
+	}
+
+	Cvar_Set ("net_sim_loss", oldloss);
+	Cvar_Set ("net_sim_latency", oldlatency);
+	Cvar_Set ("net_sim_bandwidth", oldbandwidth);
+}
+#endif
+
 #ifdef ANTICHEAT
 static void SV_AddACException_f (void)
 {
@@ -1636,7 +2091,7 @@ static void SV_AddACException_f (void)
 		return;
 	}
 
-	if (ValidateAndAddToNetBlockList (Cmd_Argv(1), &anticheat_exceptions, TAGMALLOC_ANTICHEAT))
+	if (ValidateAndAddToNetBlockList (Cmd_Argv(1), &anticheat_exceptions, &anticheat_exception_trie, TAGMALLOC_ANTICHEAT))
 	{
 		if (sv.state)
 			Com_Printf ("Anticheat exception added.\n", LOG_GENERAL);
@@ -1655,7 +2110,7 @@ static void SV_DelACException_f (void)
 		return;
 	}
 
-	ret = ValidateAndRemoveFromNetBlockList (Cmd_Argv(1), &anticheat_exceptions);
+	ret = ValidateAndRemoveFromNetBlockList (Cmd_Argv(1), &anticheat_exceptions, &anticheat_exception_trie);
 
 	if (sv.state)
 	{
@@ -1681,7 +2136,7 @@ static void SV_AddACRequirement_f (void)
 		return;
 	}
 
-	if (ValidateAndAddToNetBlockList (Cmd_Argv(1), &anticheat_requirements, TAGMALLOC_ANTICHEAT))
+	if (ValidateAndAddToNetBlockList (Cmd_Argv(1), &anticheat_requirements, &anticheat_requirement_trie, TAGMALLOC_ANTICHEAT))
 	{
 		if (sv.state)
 			Com_Printf ("Anticheat requirement added.\n", LOG_GENERAL);
@@ -1700,7 +2155,7 @@ static void SV_DelACRequirement_f (void)
 		return;
 	}
 
-	ret = ValidateAndRemoveFromNetBlockList (Cmd_Argv(1), &anticheat_requirements);
+	ret = ValidateAndRemoveFromNetBlockList (Cmd_Argv(1), &anticheat_requirements, &anticheat_requirement_trie);
 
 	if (sv.state)
 	{
@@ -2107,7 +2562,7 @@ SV_Status_f
 */
 static void SV_Status_f (void)
 {
-	int			i;//, j, l;
+	int			i, j;
 	client_t	*cl;
 	char		*s;
 	int			ping;
@@ -2140,6 +2595,11 @@ static void SV_Status_f (void)
 		Com_Printf (" # name            msglen overflow\n", LOG_GENERAL);
 		Com_Printf ("-- --------------- ------ --------\n", LOG_GENERAL);
 	}
+	else if (statusMethod == 4)
+	{
+		Com_Printf (" # name            req    0ms    1ms  2-3ms  4-7ms   8-15  16-31    32+\n", LOG_GENERAL);
+		Com_Printf ("-- --------------- --- ------ ------ ------ ------ ------ ------ ------\n", LOG_GENERAL);
+	}
 	else
 	{
 		Com_Printf ("num score ping name            lastmsg ip address            rate/pps ver\n", LOG_GENERAL);
@@ -2169,6 +2629,12 @@ static void SV_Status_f (void)
 			case 3:
 				Com_Printf ("%2i %-15s %-6d %.3f\n", LOG_GENERAL, i, cl->name, cl->netchan.message.buffsize, cl->commandMsecOverflowCount);
 				continue;
+			case 4:
+				Com_Printf ("%2i %-15s %3d", LOG_GENERAL, i, cl->name, (int)cl->settings[CLSET_PLAYERUPDATE_REQUESTS]);
+				for (j = 0; j < PLAYERUPDATE_BUCKETS; j++)
+					Com_Printf (" %6u", LOG_GENERAL, cl->player_update_latency[j]);
+				Com_Printf ("\n", LOG_GENERAL);
+				continue;
 			default:
 				break;
 		}
@@ -2195,7 +2661,7 @@ static void SV_Status_f (void)
 		
 		//r1: qport not so useful
 		{
-			float rateval = (float)cl->rate/1000.0f;
+			float rateval = (float)SV_ClientRate (cl)/1000.0f;
 			if (rateval < 10)
 				Com_Printf ("%.1fK/", LOG_GENERAL, rateval);
 			else
@@ -2221,6 +2687,11 @@ static void SV_Status_f (void)
 		total = svs.proto35BytesSaved + svs.proto35CompressionBytes + svs.r1q2OptimizedBytes + svs.r1q2CustomBytes + r1q2DeltaOptimizedBytes + svs.r1q2AttnBytes + r1q2UserCmdOptimizedBytes;
 
 		Com_Printf ("Total byte savings: %lu (%.2f MB)\n", LOG_GENERAL, total, (float)total / 1024.0 / 1024.0);
+		Com_Printf ("Status/info queries answered: %lu, replies rebuilt %lu times.\n", LOG_GENERAL, svs.statusReplies, svs.statusRebuilds);
+		if (svs.zstreamFrames)
+			Com_Printf ("Frame zstream: %lu frames (%lu referenced), %lu -> %lu bytes (%.1f%%), %.2f ms cpu (%.1f usec/frame).\n", LOG_GENERAL,
+				svs.zstreamFrames, svs.zstreamReferenced, svs.zstreamBytesIn, svs.zstreamBytesOut,
+				(float)svs.zstreamBytesOut * 100.0f / (float)svs.zstreamBytesIn, svs.zstreamTime, svs.zstreamTime * 1000.0 / svs.zstreamFrames);
 	}
 #endif
 }
@@ -2624,6 +3095,7 @@ void SV_InitOperatorCommands (void)
 
 	Cmd_AddCommand ("map", SV_Map_f);
 	Cmd_AddCommand ("demomap", SV_DemoMap_f);
+	Cmd_AddCommand ("demoseek", SV_DemoSeek_f);
 	Cmd_AddCommand ("gamemap", SV_GameMap_f);
 	Cmd_AddCommand ("setmaster", SV_SetMaster_f);
 
@@ -2644,6 +3116,10 @@ void SV_InitOperatorCommands (void)
 	Cmd_AddCommand ("addhole", SV_Addhole_f);
 	Cmd_AddCommand ("delhole", SV_Delhole_f);
 	Cmd_AddCommand ("listholes", SV_Listholes_f);
+	Cmd_AddCommand ("floodbench", SV_FloodBench_f);
+#ifndef DEDICATED_ONLY
+	Cmd_AddCommand ("ratetest", SV_RateTest_f);
+#endif
 
 	Cmd_AddCommand ("addcommandban", SV_AddCommandBan_f);
 	Cmd_AddCommand ("delcommandban", SV_DelCommandBan_f);
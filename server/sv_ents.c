@@ -983,21 +983,34 @@ static int SV_WritePlayerstateToClient (const client_frame_t /*@null@*/*from, cl
 	return extraflags;
 }
 
-void SV_SendPlayerUpdates (int msec_to_next_frame)
+/*
+==================
+SV_SendPlayerUpdates
+
+sends the position only updates R1Q2 clients ask for in between their
+frames. each client's updates are spread evenly over its own frame
+interval starting from when its last frame went out. everything due now or
+within PLAYERUPDATE_SLACK msec goes out in this pass, and how late each
+update was is kept per client for "status 4".
+
+returns msec until the next update is due, or -1 if none are.
+==================
+*/
+int SV_SendPlayerUpdates (void)
 {
 	client_t		*cl, *target;
 	client_frame_t	*frame;
 	entity_state_t	*ent;
-	int				framenum, i, interval;
-	unsigned		requested;
+	int				framenum, i, period, late, wait, next;
+	unsigned		requested, due;
 	sizebuf_t		buff;
 	byte			playerbuff[1024];
 	qboolean		wrote;
 
 	if (!sv_max_player_updates->intvalue)
-		return;
+		return -1;
 
-	framenum = sv.framenum + sv.randomframe;
+	next = -1;
 
 	SZ_Init (&buff, playerbuff, sizeof(playerbuff));
 	buff.allowoverflow = true;
@@ -1018,60 +1031,96 @@ void SV_SendPlayerUpdates (int msec_to_next_frame)
 		if (requested > sv_max_player_updates->intvalue)
 			requested = sv_max_player_updates->intvalue;
 
-		//due to timer inaccuracies this can happen
-		if (cl->player_updates_sent == requested)
+		if (cl->player_updates_sent >= requested)
 			continue;
 
-		requested++;
+		period = 1000 / cl->settings[CLSET_FPS];
+
+		due = cl->player_update_base + period * (cl->player_updates_sent + 1) / (requested + 1);
+		wait = (int)(due - svs.realtime);
 
-		interval = 100 / requested; 
-		if ((100 - msec_to_next_frame) / interval > cl->player_updates_sent)
+		if (wait > PLAYERUPDATE_SLACK)
 		{
-			cl->player_updates_sent = (100 - msec_to_next_frame) / interval;
+			if (next == -1 || wait < next)
+				next = wait;
+			continue;
+		}
+
+		//if we slept through several, only the most recent is worth sending
+		while (cl->player_updates_sent + 1 < requested)
+		{
+			unsigned	after;
 
-			Com_DPrintf ("sending update to %s (%d for %d)\n", cl->name, msec_to_next_frame, cl->player_updates_sent);
+			after = cl->player_update_base + period * (cl->player_updates_sent + 2) / (requested + 1);
+			if ((int)(after - svs.realtime) > PLAYERUPDATE_SLACK)
+				break;
+
+			due = after;
+			cl->player_updates_sent++;
+		}
 
-			buff.cursize = 0;
-			wrote = false;
+		cl->player_updates_sent++;
 
-			frame = &cl->frames[framenum & UPDATE_MASK];
+		late = (int)(svs.realtime - due);
+		for (i = 0; i < PLAYERUPDATE_BUCKETS - 1 && late > 0; i++)
+			late >>= 1;
+		cl->player_update_latency[i]++;
 
-			for (i = 0; i < frame->num_entities; i++)
+		if (cl->player_updates_sent < requested)
+		{
+			wait = (int)(cl->player_update_base + period * (cl->player_updates_sent + 1) / (requested + 1) - svs.realtime);
+			if (next == -1 || wait < next)
+				next = wait;
+		}
+
+		//same frame number the client's last frame was written with
+		framenum = sv.randomframe + sv.time / period;
+
+		buff.cursize = 0;
+		wrote = false;
+
+		frame = &cl->frames[framenum & UPDATE_MASK];
+
+		for (i = 0; i < frame->num_entities; i++)
+		{
+			ent = &svs.client_entities[(frame->first_entity+i)%svs.num_client_entities];
+			if (ent->number <= maxclients->intvalue)
 			{
-				ent = &svs.client_entities[(frame->first_entity+i)%svs.num_client_entities];
-				if (ent->number <= maxclients->intvalue)
+				target = svs.clients + ent->number - 1;
+				if (target != cl)
 				{
-					target = svs.clients + ent->number - 1;
-					if (target != cl)
+					if (!wrote)
 					{
-						if (!wrote)
-						{
-							MSG_BeginWriting (svc_playerupdate);
-							MSG_WriteLong (framenum);
-							wrote = true;
-						}
-						MSG_WritePos (target->edict->s.origin);
+						MSG_BeginWriting (svc_playerupdate);
+						MSG_WriteLong (framenum);
+						wrote = true;
 					}
+					MSG_WritePos (target->edict->s.origin);
 				}
 			}
+		}
 
-			if (wrote)
-				MSG_EndWriting (&buff);
+		if (wrote)
+			MSG_EndWriting (&buff);
 
-			if (buff.cursize && !buff.overflowed)
-			{
-				unsigned	real_sequence;
-
-				//im so very sorry... but we can't let the client know we've received their usercmd
-				//until we send out the playerstate to them, or cl prediction screws up since it
-				//acts on stuff we've never sent
-				real_sequence = cl->netchan.incoming_sequence;
-				cl->netchan.incoming_sequence = cl->last_incoming_sequence;
-				Netchan_Transmit (&cl->netchan, buff.cursize, buff.data);
-				cl->netchan.incoming_sequence = real_sequence;
-			}
+		if (buff.cursize && !buff.overflowed)
+		{
+			unsigned	real_sequence;
+
+			//im so very sorry... but we can't let the client know we've received their usercmd
+			//until we send out the playerstate to them, or cl prediction screws up since it
+			//acts on stuff we've never sent
+			real_sequence = cl->netchan.incoming_sequence;
+			cl->netchan.incoming_sequence = cl->last_incoming_sequence;
+			Netchan_Transmit (&cl->netchan, buff.cursize, buff.data);
+			cl->netchan.incoming_sequence = real_sequence;
 		}
 	}
+
+	if (next != -1 && next < 0)
+		next = 0;
+
+	return next;
 }
 
 /*
@@ -1107,6 +1156,11 @@ void SV_WriteFrameToClient (client_t *client, sizebuf_t *msg)
 		oldframe = NULL;
 		lastframe = -1;
 	}
+	else if (svs.next_client_entities - client->frames[client->lastframe & UPDATE_MASK].first_entity > svs.num_client_entities)
+	{	// r1: big frames since have overwritten the entities it had
+		oldframe = NULL;
+		lastframe = -1;
+	}
 	else
 	{	// we have a valid message to delta from
 		oldframe = &client->frames[client->lastframe & UPDATE_MASK];
@@ -1569,7 +1623,8 @@ void SV_BuildClientFrame (client_t *client)
 		//Com_Printf ("next will be %d, should be %d\n", 1 % svs.num_client_entities, svs.next_client_entities%svs.num_client_entities);
 
 		//r1: break out at 128 ents since the client renderer dll can only process 128 anyway...
-		if (++frame->num_entities > 128)
+		//clients that take fragmented packets get everything, prediction and sounds still use them
+		if (++frame->num_entities > 128 && !client->netchan.fragments)
 			break;
 	}
 }
@@ -531,7 +531,10 @@ fixed:
 	}
 
 	if (index != -1)
+	{
 		strcpy (sv.configstrings[index], val);
+		SV_InvalidateConnectCache ();
+	}
 
 	// send the update to everyone
 	if (sv.state != ss_loading)
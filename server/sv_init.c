@@ -100,6 +100,7 @@ int SV_FindIndex (const char *name, int start, int maxIndex, qboolean create)
 	}
 
 	strncpy (sv.configstrings[start+i], name, sizeof(sv.configstrings[i])-1);
+	SV_InvalidateConnectCache ();
 
 	if (sv.state != ss_loading)
 	{	// send the update to everyone
@@ -236,6 +237,9 @@ static void SV_SpawnServer (const char *server, const char *spawnpoint, server_s
 	if (sv.demofile)
 		fclose (sv.demofile);
 
+	if (sv.demoindex)
+		FS_FreeFile (sv.demoindex);
+
 	svs.spawncount++;		// any partially connected client will be
 							// restarted
 
@@ -468,7 +472,12 @@ void SV_InitGame (void)
 
 	svs.clients = Z_TagMalloc (sizeof(client_t)*maxclients->intvalue, TAGMALLOC_CLIENTS);
 
-	svs.num_client_entities = maxclients->intvalue*UPDATE_BACKUP*64;
+	//r1: fragmenting clients get frames of any size, leave room so the frames they
+	//delta from aren't overwritten right away
+	if (sv_netchan_fragment->intvalue)
+		svs.num_client_entities = maxclients->intvalue*UPDATE_BACKUP*256;
+	else
+		svs.num_client_entities = maxclients->intvalue*UPDATE_BACKUP*64;
 	svs.client_entities = Z_TagMalloc (sizeof(entity_state_t)*svs.num_client_entities, TAGMALLOC_CL_ENTS);
 
 	memset (svs.clients, 0, sizeof(client_t)*maxclients->intvalue);
@@ -0,0 +1,268 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sv_iptrie.c -- path compressed binary trie for IPv4 netblock lookups
+
+#include "server.h"
+
+/*
+=============================================================================
+
+IP TRIE
+
+The blackhole / whitehole / anticheat lists are walked for every packet
+from an address, which gets expensive with thousands of automatic
+blackholes during a flood. The lists are kept for listing and removing by
+index, but matching goes through one of these instead. Each node is a
+prefix; nodes without a value are only there to join two subtrees.
+Insert, remove and match are all bounded by the prefix length.
+
+=============================================================================
+*/
+
+#define	PREFIX_BIT(x,i)	(((x) >> (31 - (i))) & 1)
+
+static uint32 PrefixMask (int bits)
+{
+	if (bits <= 0)
+		return 0;
+
+	return 0xFFFFFFFFU << (32 - bits);
+}
+
+//number of leading set bits in a network order mask
+static int PrefixLength (uint32 network_mask)
+{
+	uint32	mask;
+	int		bits;
+
+	mask = NET_ntohl (network_mask);
+
+	for (bits = 0; bits < 32; bits++)
+	{
+		if (!PREFIX_BIT (mask, bits))
+			break;
+	}
+
+	return bits;
+}
+
+static iptrie_node_t *IPTrie_NewNode (const iptrie_t *t, uint32 prefix, int bits, void *value)
+{
+	iptrie_node_t	*n;
+
+	n = Z_TagMalloc (sizeof(*n), t->tag);
+	n->child[0] = n->child[1] = NULL;
+	n->prefix = prefix;
+	n->bits = bits;
+	n->value = value;
+
+	return n;
+}
+
+/*
+==================
+IPTrie_Insert
+
+Adds the block network_ip/network_mask. If the same prefix is already
+present the existing value is kept, callers have their own list for
+duplicates.
+==================
+*/
+void IPTrie_Insert (iptrie_t *t, uint32 network_ip, uint32 network_mask, void *value)
+{
+	iptrie_node_t	**link;
+	iptrie_node_t	*n, *glue;
+	uint32			prefix;
+	uint32			diff;
+	int				bits;
+	int				common;
+
+	bits = PrefixLength (network_mask);
+	prefix = NET_ntohl (network_ip) & PrefixMask (bits);
+
+	link = &t->root;
+
+	while ((n = *link))
+	{
+		//length of the prefix the two share
+		common = bits < n->bits ? bits : n->bits;
+		diff = prefix ^ n->prefix;
+		if (diff)
+		{
+			int		i;
+
+			for (i = 0; i < common; i++)
+			{
+				if (PREFIX_BIT (diff, i))
+					break;
+			}
+			common = i;
+		}
+
+		if (common == n->bits)
+		{
+			if (bits == n->bits)
+			{
+				if (!n->value)
+				{
+					n->value = value;
+					t->count++;
+				}
+				return;
+			}
+
+			link = &n->child[PREFIX_BIT (prefix, n->bits)];
+			continue;
+		}
+
+		if (common == bits)
+		{
+			//new prefix contains this node
+			glue = IPTrie_NewNode (t, prefix, bits, value);
+			glue->child[PREFIX_BIT (n->prefix, bits)] = n;
+			*link = glue;
+			t->count++;
+			return;
+		}
+
+		//split into a glue node with both underneath
+		glue = IPTrie_NewNode (t, prefix & PrefixMask (common), common, NULL);
+		glue->child[PREFIX_BIT (n->prefix, common)] = n;
+		glue->child[PREFIX_BIT (prefix, common)] = IPTrie_NewNode (t, prefix, bits, value);
+		*link = glue;
+		t->count++;
+		return;
+	}
+
+	*link = IPTrie_NewNode (t, prefix, bits, value);
+	t->count++;
+}
+
+/*
+==================
+IPTrie_Remove
+
+Removes the block if it is stored with value. Returns true if it was, in
+which case the caller may want to insert a duplicate in its place.
+==================
+*/
+qboolean IPTrie_Remove (iptrie_t *t, uint32 network_ip, uint32 network_mask, const void *value)
+{
+	iptrie_node_t	**link, **parentlink;
+	iptrie_node_t	*n, *parent;
+	uint32			prefix;
+	int				bits;
+
+	bits = PrefixLength (network_mask);
+	prefix = NET_ntohl (network_ip) & PrefixMask (bits);
+
+	parentlink = NULL;
+	link = &t->root;
+
+	while ((n = *link))
+	{
+		if (n->bits > bits || (prefix & PrefixMask (n->bits)) != n->prefix)
+			return false;
+
+		if (n->bits == bits)
+			break;
+
+		parentlink = link;
+		link = &n->child[PREFIX_BIT (prefix, n->bits)];
+	}
+
+	if (!n || n->value != value)
+		return false;
+
+	n->value = NULL;
+	t->count--;
+
+	if (n->child[0] && n->child[1])
+		return true;
+
+	//unlink it, and its parent if that was only joining it to a sibling
+	*link = n->child[0] ? n->child[0] : n->child[1];
+	Z_Free (n);
+
+	if (parentlink)
+	{
+		parent = *parentlink;
+		if (!parent->value && !(parent->child[0] && parent->child[1]))
+		{
+			*parentlink = parent->child[0] ? parent->child[0] : parent->child[1];
+			Z_Free (parent);
+		}
+	}
+
+	return true;
+}
+
+/*
+==================
+IPTrie_Match
+
+Returns the value of the longest prefix containing network_ip.
+==================
+*/
+void *IPTrie_Match (const iptrie_t *t, uint32 network_ip)
+{
+	const iptrie_node_t	*n;
+	void				*best;
+	uint32				ip;
+
+	ip = NET_ntohl (network_ip);
+	best = NULL;
+
+	for (n = t->root; n; n = n->child[PREFIX_BIT (ip, n->bits)])
+	{
+		if ((ip & PrefixMask (n->bits)) != n->prefix)
+			break;
+
+		if (n->value)
+			best = n->value;
+
+		if (n->bits == 32)
+			break;
+	}
+
+	return best;
+}
+
+static void IPTrie_FreeNode (iptrie_node_t *n)
+{
+	if (!n)
+		return;
+
+	IPTrie_FreeNode (n->child[0]);
+	IPTrie_FreeNode (n->child[1]);
+	Z_Free (n);
+}
+
+/*
+==================
+IPTrie_Clear
+==================
+*/
+void IPTrie_Clear (iptrie_t *t)
+{
+	IPTrie_FreeNode (t->root);
+	t->root = NULL;
+	t->count = 0;
+}
@@ -146,6 +146,14 @@ cvar_t	*sv_validate_playerskins;
 
 cvar_t	*sv_idlekick;
 cvar_t	*sv_packetentities_hack;
+cvar_t	*sv_zstream;
+cvar_t	*sv_zstream_minsize;
+cvar_t	*sv_zstream_dictionary;
+cvar_t	*sv_netchan_window;
+cvar_t	*sv_netchan_fragment;
+cvar_t	*sv_ratecontrol;
+cvar_t	*sv_ratecontrol_target;
+cvar_t	*sv_ratecontrol_max;
 cvar_t	*sv_entity_inuse_hack;
 
 cvar_t	*sv_force_reconnect;
@@ -219,6 +227,8 @@ cvar_t	*sv_anticheat_force_protocol35;
 
 netblock_t	anticheat_exceptions;
 netblock_t	anticheat_requirements;
+iptrie_t	anticheat_exception_trie = {TAGMALLOC_ANTICHEAT};
+iptrie_t	anticheat_requirement_trie = {TAGMALLOC_ANTICHEAT};
 #endif
 
 //r1: not needed
@@ -227,15 +237,18 @@ netblock_t	anticheat_requirements;
 time_t	server_start_time;
 
 blackhole_t			blackholes;
+iptrie_t			blackhole_trie = {TAGMALLOC_BLACKHOLE};
 varban_t			cvarbans;
 varban_t			userinfobans;
 bannedcommands_t	bannedcommands;
+struct rbtree		*bannedcommands_index;
 linkednamelist_t	nullcmds;
 linkednamelist_t	lrconcmds;
 linkedvaluelist_t	serveraliases;
 
 //i hate you snake
 netblock_t			blackhole_exceptions;
+iptrie_t			whitehole_trie = {TAGMALLOC_BLACKHOLE};
 
 unsigned			cheaternet_token;
 netadr_t			cheaternet_adr;
@@ -392,6 +405,16 @@ void SV_CleanClient (client_t *drop)
 		drop->lastlines = NULL;
 	}
 
+	//r1: free reliable window
+	Netchan_Shutdown (&drop->netchan);
+
+	//r1: free zpacket dictionaries
+	if (drop->zframes)
+	{
+		Z_Free (drop->zframes);
+		drop->zframes = NULL;
+	}
+
 	//r1: disconnected before cheatnet message could show?
 	if (drop->cheaternet_message)
 	{
@@ -674,6 +697,183 @@ static const char *SV_StatusString (void)
 	return status;
 }
 
+/*
+===============
+Status cache
+
+Server browsers hammer status and info, so the replies are kept ready to
+send and only rebuilt when something in them changes. Serverinfo changes
+are seen through serverinfo_modified_count, the per player stuff is
+checked once a frame by SV_CheckStatusCache.
+===============
+*/
+typedef struct statuscache_s
+{
+	qboolean	valid;
+	int			length;
+	char		data[MAX_MSGLEN - 4];
+} statuscache_t;
+
+typedef struct statusplayer_s
+{
+	int			shown;		// 0 = not listed, 1 = connected, 2 = spawning or in game
+	int			frags;
+	int			ping;
+	char		name[16];
+} statusplayer_t;
+
+static statuscache_t	statusCache;	// "print\n" + SV_StatusString
+static statuscache_t	infoCache;		// "info\n" + info line
+
+static statusplayer_t	statusPlayers[MAX_CLIENTS];
+static int				statusSettings[6];
+static uint32			statusServerinfoCount;
+static uint32			statusUptime;
+
+static void SV_InvalidateStatusCache (void)
+{
+	statusCache.valid = false;
+	infoCache.valid = false;
+}
+
+/*
+===============
+SV_CheckStatusCache
+
+Called once a frame after the game has run to see if anything shown in
+status or info replies has changed.
+===============
+*/
+static void SV_CheckStatusCache (void)
+{
+	int				i;
+	int				settings[6];
+	client_t		*cl;
+	statusplayer_t	*p;
+
+	if (!statusCache.valid && !infoCache.valid)
+		return;
+
+	if (serverinfo_modified_count != statusServerinfoCount)
+	{
+		SV_InvalidateStatusCache ();
+		return;
+	}
+
+	settings[0] = maxclients->intvalue;
+	settings[1] = sv_reserved_slots->intvalue;
+	settings[2] = sv_hideplayers->intvalue;
+	settings[3] = sv_uptime->intvalue;
+	settings[4] = server_port;
+	settings[5] = svs.spawncount;
+
+	if (memcmp (settings, statusSettings, sizeof(settings)))
+	{
+		SV_InvalidateStatusCache ();
+		return;
+	}
+
+	for (i = 0, cl = svs.clients, p = statusPlayers; i < maxclients->intvalue; i++, cl++, p++)
+	{
+		int		shown;
+
+		if (cl->state >= cs_spawning)
+			shown = 2;
+		else if (cl->state == cs_connected)
+			shown = 1;
+		else
+			shown = 0;
+
+		if (shown != p->shown)
+		{
+			SV_InvalidateStatusCache ();
+			return;
+		}
+
+		if (!shown)
+			continue;
+
+		if (cl->ping != p->ping || cl->edict->client->ps.stats[STAT_FRAGS] != p->frags || strcmp (cl->name, p->name))
+		{
+			SV_InvalidateStatusCache ();
+			return;
+		}
+	}
+}
+
+/*
+===============
+SV_SnapshotStatus
+
+Remembers what the cache is being built from.
+===============
+*/
+static void SV_SnapshotStatus (void)
+{
+	int				i;
+	client_t		*cl;
+	statusplayer_t	*p;
+
+	statusServerinfoCount = serverinfo_modified_count;
+
+	statusSettings[0] = maxclients->intvalue;
+	statusSettings[1] = sv_reserved_slots->intvalue;
+	statusSettings[2] = sv_hideplayers->intvalue;
+	statusSettings[3] = sv_uptime->intvalue;
+	statusSettings[4] = server_port;
+	statusSettings[5] = svs.spawncount;
+
+	for (i = 0, cl = svs.clients, p = statusPlayers; i < maxclients->intvalue; i++, cl++, p++)
+	{
+		if (cl->state >= cs_spawning)
+			p->shown = 2;
+		else if (cl->state == cs_connected)
+			p->shown = 1;
+		else
+			p->shown = 0;
+
+		if (!p->shown)
+			continue;
+
+		p->ping = cl->ping;
+		p->frags = cl->edict->client->ps.stats[STAT_FRAGS];
+		strcpy (p->name, cl->name);
+	}
+}
+
+/*
+===============
+SV_CachedStatus
+
+Returns "print\n" followed by the status string, rebuilding it if needed.
+===============
+*/
+static const statuscache_t *SV_CachedStatus (void)
+{
+	uint32	uptime;
+
+	//uptime is shown to the second
+	uptime = sv_uptime->intvalue ? (uint32)(time(NULL) - server_start_time) : 0;
+
+	if (!statusCache.valid || uptime != statusUptime)
+	{
+		if (!statusCache.valid && !infoCache.valid)
+			SV_SnapshotStatus ();
+
+		strcpy (statusCache.data, "print\n");
+		Q_strncpy (statusCache.data + 6, SV_StatusString(), sizeof(statusCache.data) - 7);
+		statusCache.length = (int)strlen (statusCache.data);
+		statusCache.valid = true;
+		statusUptime = uptime;
+
+#ifndef NPROFILE
+		svs.statusRebuilds++;
+#endif
+	}
+
+	return &statusCache;
+}
+
 static qboolean RateLimited (ratelimit_t *limit, int maxCount)
 {
 	int diff;
@@ -722,6 +922,11 @@ Responds with all the info that qplug or qspy can see
 */
 static void SVC_Status (void)
 {
+	const statuscache_t	*status;
+#ifndef DEDICATED_ONLY
+	unsigned int		start = 0;
+#endif
+
 	if (sv_hidestatus->intvalue)
 		return;
 
@@ -733,7 +938,22 @@ static void SVC_Status (void)
 		return;
 	}
 
-	Netchan_OutOfBandPrint (NS_SERVER, &net_from, "print\n%s", SV_StatusString());
+#ifndef DEDICATED_ONLY
+	if (host_speeds->intvalue)
+		start = Sys_Milliseconds ();
+#endif
+
+	status = SV_CachedStatus ();
+	Netchan_OutOfBand (NS_SERVER, &net_from, status->length, (byte *)status->data);
+
+#ifndef NPROFILE
+	svs.statusReplies++;
+#endif
+
+#ifndef DEDICATED_ONLY
+	if (host_speeds->intvalue)
+		time_status += Sys_Milliseconds () - start;
+#endif
 }
 
 /*
@@ -897,7 +1117,6 @@ The second parameter should be the current protocol version number.
 */
 static void SVC_Info (void)
 {
-	char	string[64];
 	int		i, count;
 	int		version;
 
@@ -912,18 +1131,33 @@ static void SVC_Info (void)
 		//    causing server <-> server info loops.
 		return;
 	}
-	else
+
+	if (!infoCache.valid)
 	{
+		if (!statusCache.valid)
+			SV_SnapshotStatus ();
+
 		count = 0;
 		for (i=0 ; i<maxclients->intvalue ; i++)
 			if (svs.clients[i].state >= cs_spawning)
 				count++;
 
-		Com_sprintf (string, sizeof(string), "%20s %8s %2i/%2i\n",
+		Com_sprintf (infoCache.data, sizeof(infoCache.data), "info\n%20s %8s %2i/%2i\n",
 			hostname->string, sv.name, count, maxclients->intvalue - sv_reserved_slots->intvalue);
+
+		infoCache.length = (int)strlen (infoCache.data);
+		infoCache.valid = true;
+
+#ifndef NPROFILE
+		svs.statusRebuilds++;
+#endif
 	}
 
-	Netchan_OutOfBandPrint (NS_SERVER, &net_from, "info\n%s", string);
+	Netchan_OutOfBand (NS_SERVER, &net_from, infoCache.length, (byte *)infoCache.data);
+
+#ifndef NPROFILE
+	svs.statusReplies++;
+#endif
 }
 
 /*
@@ -941,73 +1175,130 @@ static void SVC_Ping (void)
 
 /*
 =================
-SVC_GetChallenge
+Challenges
 
-Returns a challenge number that can be used
-in a subsequent client_connect command.
-We do this to prevent denial of service attacks that
-flood the server with invalid connection IPs.  With a
-challenge, they must give a valid IP address.
+A challenge is a keyed hash of the client's address and port, so there's no
+table to scan or for a getchallenge flood to push real players out of. The
+key is replaced every CHALLENGE_PERIOD ms and the previous one is still
+accepted, so a challenge is good for at least one full period.
 =================
 */
-static qboolean SV_ChallengeIsInUse (uint32 challenge)
-{
-	client_t	*cl;
+#define	CHALLENGE_PERIOD	30000
 
-	if (!challenge)
-		return true;
+static uint32	challengeSecrets[2][4];		// current, previous
+static uint32	challengeEpoch;
+static qboolean	challengeSecretsValid;
 
-	for (cl = svs.clients; cl < svs.clients + maxclients->intvalue; cl++)
+static void SV_NewChallengeSecret (uint32 *secret)
+{
+	uint32	entropy[8];
+	int		i;
+
+	//no portable source of real randomness here, so stir in everything
+	//we have along with the old secret.
+	for (i = 0; i < 4; i++)
 	{
-		if (cl->state == cs_free)
-			continue;
+		entropy[0] = secret[i];
+		entropy[1] = randomMT();
+		entropy[2] = Sys_Milliseconds();
+		entropy[3] = (uint32)time(NULL);
+		entropy[4] = curtime;
+		entropy[5] = *(uint32 *)net_from.ip ^ net_from.port;
+		entropy[6] = challengeSecrets[0][(i+1)&3] ^ challengeSecrets[1][(i+2)&3];
+		entropy[7] = i;
 
-		if (cl->challenge == challenge)
-			return true;
+		secret[i] = Com_BlockChecksum (entropy, sizeof(entropy));
 	}
-	return false;
 }
 
-static void SVC_GetChallenge (void)
+static void SV_RotateChallengeSecrets (void)
 {
-	int		i;
-	int		oldest = 0;
-	uint32	oldestTime = 0, diff;
+	uint32	epoch;
 
-	// see if we already have a challenge for this ip
-	for (i = 0 ; i < MAX_CHALLENGES ; i++)
-	{
-		if (NET_CompareBaseAdr (&net_from, &svs.challenges[i].adr))
-			break;
+	epoch = curtime / CHALLENGE_PERIOD;
 
-		diff = curtime - svs.challenges[i].time;
-		if (diff > oldestTime)
-		{
-			oldestTime = diff;
-			oldest = i;
-		}
-	}
+	if (challengeSecretsValid && epoch == challengeEpoch)
+		return;
 
-	if (i == MAX_CHALLENGES)
+	if (challengeSecretsValid && epoch == challengeEpoch + 1)
 	{
-		// overwrite the oldest
-		do
-		{
-			svs.challenges[oldest].challenge = randomMT()&0x7FFFFFFF;
-		} while (SV_ChallengeIsInUse (svs.challenges[oldest].challenge));
-		svs.challenges[oldest].adr = net_from;
-		svs.challenges[oldest].time = curtime;
-		i = oldest;
-	} else {
-		do
-		{
-			svs.challenges[i].challenge = randomMT()&0x7FFFFFFF;
-		} while (SV_ChallengeIsInUse (svs.challenges[i].challenge));
-		svs.challenges[i].time = curtime;
+		memcpy (challengeSecrets[1], challengeSecrets[0], sizeof(challengeSecrets[1]));
+	}
+	else
+	{
+		//first time or we've been idle, nothing outstanding is valid
+		SV_NewChallengeSecret (challengeSecrets[1]);
 	}
 
+	SV_NewChallengeSecret (challengeSecrets[0]);
+
+	challengeEpoch = epoch;
+	challengeSecretsValid = true;
+}
+
+static int32 SV_ChallengeForAddress (const netadr_t *adr, int which)
+{
+	byte	buff[sizeof(challengeSecrets[0]) + 6];
+	int32	challenge;
+
+	memcpy (buff, challengeSecrets[which], sizeof(challengeSecrets[0]));
+	memcpy (buff + sizeof(challengeSecrets[0]), adr->ip, 4);
+	memcpy (buff + sizeof(challengeSecrets[0]) + 4, &adr->port, 2);
+
+	challenge = Com_BlockChecksum (buff, sizeof(buff)) & 0x7FFFFFFF;
+
+	//zero means no challenge to old clients
+	if (!challenge)
+		challenge = 1;
+
+	return challenge;
+}
+
+/*
+=================
+SV_ConnectionChallenge
+
+The address challenge is the same for a client that reconnects from the
+same ip:port within a period, so mix in a nonce once it is accepted.
+This keeps anticheat and cheaternet replies meant for the earlier
+connection from matching the new one.
+=================
+*/
+static int32 SV_ConnectionChallenge (int32 challenge)
+{
+	static uint32	connections;
+	uint32			buff[4];
+
+	buff[0] = challenge;
+	buff[1] = svs.spawncount;
+	buff[2] = ++connections;
+	buff[3] = challengeSecrets[0][0];
+
+	challenge = Com_BlockChecksum (buff, sizeof(buff)) & 0x7FFFFFFF;
+
+	if (!challenge)
+		challenge = 1;
+
+	return challenge;
+}
+
+/*
+=================
+SVC_GetChallenge
+
+Returns a challenge number that can be used
+in a subsequent client_connect command.
+We do this to prevent denial of service attacks that
+flood the server with invalid connection IPs.  With a
+challenge, they must give a valid IP address.
+=================
+*/
+static void SVC_GetChallenge (void)
+{
+	SV_RotateChallengeSecrets ();
+
 	// send it back
-	Netchan_OutOfBandPrint (NS_SERVER, &net_from, "challenge %d p=34,35", svs.challenges[i].challenge);
+	Netchan_OutOfBandPrint (NS_SERVER, &net_from, "challenge %d p=34,35", SV_ChallengeForAddress (&net_from, 0));
 }
 
 #if 0
@@ -1165,6 +1456,8 @@ static void SVC_DirectConnect (void)
 
 	char		*pass;
 	const char	*ac;
+	const char	*rw;
+	const char	*nf;
 
 	char		saved_var[32];
 	char		saved_val[32];
@@ -1249,25 +1542,12 @@ static void SVC_DirectConnect (void)
 	// see if the challenge is valid
 	if (!NET_IsLocalHost (adr))
 	{
-		for (i=0 ; i<MAX_CHALLENGES ; i++)
-		{
-			if (svs.challenges[i].challenge && NET_CompareBaseAdr (adr, &svs.challenges[i].adr))
-			{
-				//r1: reset challenge
-				if (challenge == svs.challenges[i].challenge)
-				{
-					svs.challenges[i].challenge = 0;
-					break;
-				}
-				Com_DPrintf ("    bad challenge %i\n", challenge);
-				Netchan_OutOfBandPrint (NS_SERVER, adr, "print\nBad challenge.\n");
-				return;
-			}
-		}
-		if (i == MAX_CHALLENGES)
+		SV_RotateChallengeSecrets ();
+
+		if (challenge != SV_ChallengeForAddress (adr, 0) && challenge != SV_ChallengeForAddress (adr, 1))
 		{
-			Com_DPrintf ("    no challenge\n");
-			Netchan_OutOfBandPrint (NS_SERVER, adr, "print\nNo challenge for address.\n");
+			Com_DPrintf ("    bad challenge %i\n", challenge);
+			Netchan_OutOfBandPrint (NS_SERVER, adr, "print\nBad challenge.\n");
 			return;
 		}
 	}
@@ -1580,7 +1860,7 @@ gotnewcl:
 	
 	sv_client = newcl;
 
-	if (newcl->messageListData || newcl->versionString || newcl->downloadFileName || newcl->download || newcl->lastlines)
+	if (newcl->messageListData || newcl->versionString || newcl->downloadFileName || newcl->download || newcl->lastlines || newcl->zframes || newcl->netchan.window || newcl->netchan.fragments)
 	{
 		Com_Printf ("WARNING: Client %d never got cleaned up, possible memory leak.\n", LOG_SERVER|LOG_WARNING, (int)(newcl - svs.clients));
 		SV_CleanClient (newcl);
@@ -1598,7 +1878,7 @@ gotnewcl:
 	edictnum = (int)(newcl-svs.clients)+1;
 	ent = EDICT_NUM(edictnum);
 	newcl->edict = ent;
-	newcl->challenge = challenge; // save challenge for checksumming
+	newcl->challenge = SV_ConnectionChallenge (challenge); // save challenge for checksumming
 
 	reconnected = (!sv_force_reconnect->string[0] || saved_var[0] || NET_IsLANAddress(adr));
 
@@ -1642,6 +1922,28 @@ gotnewcl:
 	//moved netchan to here so userinfo changes can see remote address
 	Netchan_Setup (NS_SERVER, &newcl->netchan, adr, protocol, qport, msglen);
 
+	//r1: windowed reliables if the client can do it
+	if (protocol == PROTOCOL_R1Q2 && version >= MINOR_VERSION_R1Q2_NETCHAN_WINDOW && sv_netchan_window->intvalue)
+	{
+		Netchan_EnableWindow (&newcl->netchan);
+		rw = " rw=1";
+	}
+	else
+	{
+		rw = "";
+	}
+
+	//r1: and packets split over several datagrams, which lifts the entity limit
+	if (protocol == PROTOCOL_R1Q2 && version >= MINOR_VERSION_R1Q2_FRAGMENT && sv_netchan_fragment->intvalue)
+	{
+		Netchan_EnableFragments (&newcl->netchan);
+		nf = " nf=1";
+	}
+	else
+	{
+		nf = "";
+	}
+
 	// parse some info from the info strings
 	strcpy (newcl->userinfo, userinfo);
 
@@ -1653,39 +1955,22 @@ gotnewcl:
 	if (sv_require_anticheat->intvalue && reconnected && SV_AntiCheat_IsConnected())
 	{
 		uint32		network_ip;
-		netblock_t	*n;
 
 		ac = " ac=1";
 
 		network_ip = *(uint32 *)net_from.ip;
 
-		n = &anticheat_requirements;
-
 		newcl->anticheat_required = ANTICHEAT_NORMAL;
 
 		//r1: forced list
-		while (n->next)
-		{
-			n = n->next;
-			if ((network_ip & n->mask) == (n->ip & n->mask))
-			{
-				newcl->anticheat_required = ANTICHEAT_REQUIRED;
-				break;
-			}
-		}
-
-		n = &anticheat_exceptions;
+		if (IPTrie_Match (&anticheat_requirement_trie, network_ip))
+			newcl->anticheat_required = ANTICHEAT_REQUIRED;
 
 		//r1: exception list
-		while (n->next)
+		if (IPTrie_Match (&anticheat_exception_trie, network_ip))
 		{
-			n = n->next;
-			if ((network_ip & n->mask) == (n->ip & n->mask))
-			{
-				newcl->anticheat_required = ANTICHEAT_EXEMPT;
-				ac = "";
-				break;
-			}
+			newcl->anticheat_required = ANTICHEAT_EXEMPT;
+			ac = "";
 		}
 
 		if (ac[0])
@@ -1698,9 +1983,9 @@ gotnewcl:
 	// send the connect packet to the client
 	// r1: note we could ideally send this twice but it prints unsightly message on original client.
 	if (sv_downloadserver->string[0])
-		Netchan_OutOfBandPrint (NS_SERVER, adr, "client_connect dlserver=%s%s", sv_downloadserver->string, ac);
+		Netchan_OutOfBandPrint (NS_SERVER, adr, "client_connect dlserver=%s%s%s%s", sv_downloadserver->string, ac, rw, nf);
 	else
-		Netchan_OutOfBandPrint (NS_SERVER, adr, "client_connect%s", ac);
+		Netchan_OutOfBandPrint (NS_SERVER, adr, "client_connect%s%s%s", ac, rw, nf);
 
 	if (sv_connectmessage->modified)
 	{
@@ -1767,6 +2052,9 @@ uint32 CalcMask (int32 bits)
 	return 0xFFFFFFFF << (32 - bits);
 }
 
+//tail of the blackholes list so adding doesn't walk it
+static blackhole_t	*lastblackhole = &blackholes;
+
 void Blackhole (netadr_t *from, qboolean isAutomatic, int mask, int method, const char *fmt, ...)
 {
 	blackhole_t *temp;
@@ -1775,15 +2063,13 @@ void Blackhole (netadr_t *from, qboolean isAutomatic, int mask, int method, cons
 	if (isAutomatic && !sv_blackholes->intvalue)
 		return;
 
-	temp = &blackholes;
-
-	while (temp->next)
-		temp = temp->next;
+	temp = lastblackhole;
 
 	temp->next = Z_TagMalloc(sizeof(blackhole_t), TAGMALLOC_BLACKHOLE);
 	temp = temp->next;
 
 	temp->next = NULL;
+	lastblackhole = temp;
 
 	temp->ip = *(uint32 *)from->ip;
 	temp->mask = NET_htonl (CalcMask(mask));
@@ -1798,6 +2084,8 @@ void Blackhole (netadr_t *from, qboolean isAutomatic, int mask, int method, cons
 	//terminate
 	temp->reason[sizeof(temp->reason)-1] = 0;
 
+	IPTrie_Insert (&blackhole_trie, temp->ip, temp->mask, temp);
+
 	if (sv.state)
 		Com_Printf ("Added %s/%d to blackholes for %s.\n", LOG_SERVER|LOG_EXPLOIT, NET_inet_ntoa (temp->ip), mask, temp->reason);
 }
@@ -1828,6 +2116,22 @@ qboolean UnBlackhole (int index)
 	// just copy the next over, don't care if it's null
 	last->next = temp->next;
 
+	if (lastblackhole == temp)
+		lastblackhole = last;
+
+	//if there's another blackhole for the same block it takes over
+	if (IPTrie_Remove (&blackhole_trie, temp->ip, temp->mask, temp))
+	{
+		for (last = blackholes.next; last; last = last->next)
+		{
+			if (last->mask == temp->mask && (last->ip & last->mask) == (temp->ip & temp->mask))
+			{
+				IPTrie_Insert (&blackhole_trie, last->ip, last->mask, last);
+				break;
+			}
+		}
+	}
+
 	Z_Free (temp);
 
 	return true;
@@ -2045,45 +2349,27 @@ connectionless packets.
 */
 static void SV_ConnectionlessPacket (void)
 {
-	netblock_t	*whitehole = &blackhole_exceptions;
-	blackhole_t *blackhole = &blackholes;
+	blackhole_t *blackhole;
 	char		*s;
 	char		*c;
-	qboolean	whiteholed;
 	uint32		network_ip;
 
 	network_ip = *(uint32 *)net_from.ip;
 
-	whiteholed = false;
-
-	//r1: whiteholes (thanks WORM!)
-	while (whitehole->next)
+	//r1: ignore packets if IP is blackholed for abuse, unless whiteholed (thanks WORM!)
+	if (blackhole_trie.count && !IPTrie_Match (&whitehole_trie, network_ip))
 	{
-		whitehole = whitehole->next;
-		if ((network_ip & whitehole->mask) == (whitehole->ip & whitehole->mask))
+		blackhole = IPTrie_Match (&blackhole_trie, network_ip);
+		if (blackhole)
 		{
-			whiteholed = true;
-			break;
-		}
-	}
-
-	//r1: ignore packets if IP is blackholed for abuse
-	if (!whiteholed)
-	{
-		while (blackhole->next)
-		{
-			blackhole = blackhole->next;
-			if ((network_ip & blackhole->mask) == (blackhole->ip & blackhole->mask))
+			//do rate limiting in case there is some long-ish reason
+			if (blackhole->method == BLACKHOLE_MESSAGE)
 			{
-				//do rate limiting in case there is some long-ish reason
-				if (blackhole->method == BLACKHOLE_MESSAGE)
-				{
-					RateSample (&blackhole->ratelimit);
-					if (!RateLimited (&blackhole->ratelimit, 2))
-						Netchan_OutOfBandPrint (NS_SERVER, &net_from, "print\n%s\n", blackhole->reason);
-				}
-				return;
+				RateSample (&blackhole->ratelimit);
+				if (!RateLimited (&blackhole->ratelimit, 2))
+					Netchan_OutOfBandPrint (NS_SERVER, &net_from, "print\n%s\n", blackhole->reason);
 			}
+			return;
 		}
 	}
 
@@ -2820,7 +3106,7 @@ static void Master_Heartbeat (void)
 	svs.last_heartbeat = svs.realtime;
 
 	// send the same string that we would give for a status OOB command
-	string = SV_StatusString();
+	string = SV_CachedStatus()->data + 6;
 
 	// send to group master
 	for (i=0 ; i<MAX_MASTERS ; i++)
@@ -2883,8 +3169,10 @@ SV_Frame
 */
 void SV_Frame (int msec)
 {
+	int		next_update;
+
 #ifndef DEDICATED_ONLY
-	time_before_game = time_after_game = 0;
+	time_before_game = time_after_game = time_status = 0;
 #endif
 
 	// if server is not active, do nothing
@@ -2919,7 +3207,7 @@ void SV_Frame (int msec)
 		}
 
 		//r1: send extra packets now for player position updates
-		SV_SendPlayerUpdates (sv.time - svs.realtime);
+		next_update = SV_SendPlayerUpdates ();
 
 		//r1: execute commands now
 		if (dedicated->intvalue)
@@ -2929,10 +3217,13 @@ void SV_Frame (int msec)
 				return;
 		}
 
-		//r1: although it doesn't look like we should be sleeping for so long if we
-		//want to send player updates, keep in mind if no packets are received then
-		//there is nothing to update anyway.
-		NET_Sleep (sv.time - svs.realtime);
+		//r1: wake up for whichever comes first, the next frame or the next
+		//player update. updates interpolate with sv_interpolated_pmove so there
+		//is something new to send even if no packets came in.
+		if (next_update != -1 && next_update < (int)(sv.time - svs.realtime))
+			NET_Sleep (next_update);
+		else
+			NET_Sleep (sv.time - svs.realtime);
 		return;
 	}
 
@@ -2961,6 +3252,9 @@ void SV_Frame (int msec)
 	// check timeouts
 	SV_CheckTimeouts ();
 
+	// see if status replies need rebuilding
+	SV_CheckStatusCache ();
+
 	// send messages back to the clients that had packets read this frame
 	SV_SendClientMessages ();
 
@@ -3450,7 +3744,7 @@ void SV_Init (void)
 	sv_max_traces_per_frame->help = "Maximum amount of path traces permitted by the Game DLL per frame (100ms). Some mods get into infinite trace loops so this counter is a protection against that. Default 10000.\n";
 
 	//r1: rate limiting for status requests to prevent udp spoof DoS
-	sv_ratelimit_status = Cvar_Get ("sv_ratelimit_status", "15", 0);
+	sv_ratelimit_status = Cvar_Get ("sv_ratelimit_status", "40", 0);
 	sv_ratelimit_status->help = "Maximum number of status requests to reply to per second.\n";
 
 	//r1: allow new SVF_ ent flags? some mods mistakenly extend SVF_ for their own purposes.
@@ -3471,6 +3765,30 @@ void SV_Init (void)
 	sv_packetentities_hack = Cvar_Get ("sv_packetentities_hack", "0", 0);
 	sv_packetentities_hack->help = "Help to avoid SZ_Getspace: overflow and 'freezing' effects on the client by only sending partial amounts of packetentities. This will break delta state and may cause odd effects on the client. Default 0.\n0: Disabled\n1: Enabled, single pass (no attempt at compressing for protocol 35)\n2: Enabled, two pass (attempts to compress for protocol 35 clients)\n";
 
+	sv_zstream = Cvar_Get ("sv_zstream", "1", 0);
+	sv_zstream->help = "Compress frames to R1Q2 clients using the last frame they acknowledged as a dictionary. Much better ratio than sv_packetentities_hack alone on busy servers. Default 1.\n";
+
+	sv_zstream_minsize = Cvar_Get ("sv_zstream_minsize", "128", 0);
+	sv_zstream_minsize->help = "Frames smaller than this many bytes are sent uncompressed when sv_zstream is enabled. Default 128.\n";
+
+	sv_zstream_dictionary = Cvar_Get ("sv_zstream_dictionary", "1", 0);
+	sv_zstream_dictionary->help = "Prime sv_zstream compression with a preset dictionary of common frame bytes. Helps most when there is no acknowledged frame to reference. Default 1.\n";
+
+	sv_netchan_window = Cvar_Get ("sv_netchan_window", "1", 0);
+	sv_netchan_window->help = "Allow R1Q2 clients that support it to use a netchan with several reliable messages in flight at once. Helps high ping clients get configstrings, prints and so on quicker. Default 1.\n";
+
+	sv_netchan_fragment = Cvar_Get ("sv_netchan_fragment", "1", 0);
+	sv_netchan_fragment->help = "Allow R1Q2 clients that support it to receive packets split over several datagrams. Such clients get frames of any size instead of being limited to 128 entities. Default 1.\n";
+
+	sv_ratecontrol = Cvar_Get ("sv_ratecontrol", "0", 0);
+	sv_ratecontrol->help = "Lower each client's rate below its rate userinfo when its frame acks start getting delayed. Frames are dropped and compressed harder as the client runs out of bandwidth. The rate userinfo stays the upper limit. Cuts latency on congested links, but can cost throughput. Default 0.\n";
+
+	sv_ratecontrol_target = Cvar_Get ("sv_ratecontrol_target", "100", 0);
+	sv_ratecontrol_target->help = "Milliseconds of queueing delay sv_ratecontrol aims to keep on a client's link. Default 100.\n";
+
+	sv_ratecontrol_max = Cvar_Get ("sv_ratecontrol_max", "15000", 0);
+	sv_ratecontrol_max->help = "Highest rate in bytes/sec sv_ratecontrol will give a client. Default 15000.\n";
+
 	//r1: don't send ents that are marked !inuse?
 	sv_entity_inuse_hack = Cvar_Get ("sv_entity_inuse_hack", "0", 0);
 	sv_entity_inuse_hack->help = "Save network bandwidth by not sending entities that are marked as no longer in use. This only applies to buggy mods that do not mark entities as unused when they are no longer in use. Note that some mods may have problems with this if set to 1. Default 0.\n";
@@ -3735,9 +4053,14 @@ void SV_Shutdown (char *finalmsg, qboolean reconnect, qboolean crashing)
 	// free current level
 	if (sv.demofile)
 		fclose (sv.demofile);
+	if (sv.demoindex)
+		FS_FreeFile (sv.demoindex);
 	memset (&sv, 0, sizeof(sv));
 	Com_SetServerState (sv.state);
 
+	SV_FreeConnectCache ();
+	SV_InvalidateStatusCache ();
+
 	// free server static data
 	if (svs.clients)
 		Z_Free (svs.clients);
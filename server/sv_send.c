@@ -754,7 +754,7 @@ void SV_WriteReliableMessages (client_t *client, int buffSize)
 		return;
 
 	//if the reliable is free, let's fill it up
-	if (!client->netchan.reliable_length)
+	if (Netchan_CanReliable (&client->netchan))
 	{
 		messagelist_t	*message, *last;
 		
@@ -801,6 +801,65 @@ void SV_WriteReliableMessages (client_t *client, int buffSize)
 	}
 }
 
+#ifndef NO_ZLIB
+/*
+=======================
+SV_CompressZStreamFrame
+
+Compresses a svc_frame for a MINOR_VERSION_R1Q2_ZSTREAM client. The dictionary is
+the last referenced zpacket the client has acknowledged - netchan acks tell us
+exactly which packet arrived, so a lost packet just means we reference an older
+one (or none) rather than desyncing a running stream. The frame is remembered
+under the sequence it will be sent with so later frames can reference it.
+=======================
+*/
+static int SV_CompressZStreamFrame (client_t *client, const sizebuf_t *frame, byte *out, int outlen, int *flags, int *refdelta)
+{
+	byte			dict[MAX_ZFRAME*2];
+	const byte		*preset;
+	zframe_t		*ref, *current;
+	int				dictlen, presetlen, len, sequence;
+
+	if (!client->zframes)
+	{
+		client->zframes = Z_TagMalloc (sizeof(zframe_t) * ZFRAME_BACKUP, TAGMALLOC_CLIENT_ZFRAMES);
+		memset (client->zframes, 0, sizeof(zframe_t) * ZFRAME_BACKUP);
+	}
+
+	*flags = ZPACKET_REFERENCED;
+	*refdelta = 0;
+	dictlen = 0;
+
+	if (sv_zstream_dictionary->intvalue)
+	{
+		preset = ZLibFrameDictionary (&presetlen);
+		memcpy (dict, preset, presetlen);
+		dictlen = presetlen;
+		*flags |= ZPACKET_PRESET;
+	}
+
+	sequence = client->netchan.outgoing_sequence;
+
+	//the acked packet is the only one we know for sure the client has
+	ref = &client->zframes[client->netchan.incoming_acknowledged & ZFRAME_MASK];
+	if (ref->length && ref->sequence == client->netchan.incoming_acknowledged && sequence - ref->sequence < ZFRAME_BACKUP)
+	{
+		memcpy (dict + dictlen, ref->data, ref->length);
+		dictlen += ref->length;
+		*refdelta = sequence - ref->sequence;
+	}
+
+	len = ZLibCompressStream (dict, dictlen, frame->data, frame->cursize, out, outlen, client->ratecontrol.zlevel);
+
+	current = &client->zframes[sequence & ZFRAME_MASK];
+	current->sequence = sequence;
+	current->length = frame->cursize;
+	memcpy (current->data, frame->data, frame->cursize);
+
+	return len;
+}
+#endif
+
 /*
 =======================
 SV_SendClientDatagram
@@ -813,6 +872,14 @@ static qboolean SV_SendClientDatagram (client_t *client)
 	int				ret;
 	messagelist_t	*message, *last;
 
+	//r1: the frame is handed to the netchan in place rather than copied into msg
+	//fragmenting clients can take bigger frames, leaving room for the reliable and unreliable parts
+	byte			frame_buf[MAX_FRAGMENTED_MSGLEN - MAX_MSGLEN * 2];
+	byte			zpacket_buf[6 + 4096];
+	netvec_t		blocks[2];
+	int				numblocks, frame_length, frame_reserve;
+	qboolean		fragments;
+
 #ifndef NDEBUG
 	byte			*wanted;
 #endif
@@ -852,20 +919,25 @@ static qboolean SV_SendClientDatagram (client_t *client)
 		}
 	}
 
+	numblocks = 0;
+	frame_length = frame_reserve = 0;
+
+	//r1: the netchan can split up whatever doesn't fit in one datagram
+	fragments = (client->netchan.fragments != NULL);
+
 	//this will write an unreliable svc_frame to the message list
 	if (!client->nodata)
 	{
-		byte		frame_buf[4096];
 		sizebuf_t	frame;
 
 		SV_BuildClientFrame (client);
 
 		//we write svc_frame to it's own buffer to allow for compression
-		SZ_Init (&frame, frame_buf, sizeof(frame_buf));
+		SZ_Init (&frame, frame_buf, fragments ? sizeof(frame_buf) : MAX_MSGLEN);
 		frame.allowoverflow = true;
 
 		//adjust for packetentities hack
-		if (sv_packetentities_hack->intvalue == 1 || client->protocol == PROTOCOL_ORIGINAL)
+		if ((sv_packetentities_hack->intvalue == 1 && !fragments) || client->protocol == PROTOCOL_ORIGINAL)
 			frame.maxsize = msg.maxsize;
 
 #ifndef NO_ZLIB
@@ -879,30 +951,91 @@ retryframe:
 		//if frame overflowed, we're screwed either way :)
 		if (!frame.overflowed)
 		{
+			qboolean	zstream;
+
+			//r1: zstream clients get most frames compressed against the last one they acked
+			zstream = (sv_zstream->intvalue && client->protocol == PROTOCOL_R1Q2 && client->protocol_version >= MINOR_VERSION_R1Q2_ZSTREAM && frame.cursize <= MAX_ZFRAME);
+
+			//too big for a zpacket, the netchan will fragment it
+			if (frame.cursize > MAX_MSGLEN)
+			{
+				blocks[numblocks].data = frame_buf;
+				blocks[numblocks].length = frame.cursize;
+				numblocks++;
+			}
 			//try to fit it into one udp packet if at all possible
-			if (frame.cursize > msg.maxsize || frame.cursize > 1490)
+			else if (frame.cursize > msg.maxsize || frame.cursize > 1490 || (zstream && frame.cursize >= sv_zstream_minsize->intvalue))
 			{
 #ifndef NO_ZLIB
 				//r1q2 clients get compressed frame, normal clients get nothing
-				byte	compressed_frame[4096];
+				sizebuf_t	zpacket;
+				byte	*compressed_frame;
 				int		compressed_frame_len;
+				int		header_len;
+				int		zflags, zdelta;
+#ifndef NPROFILE
+				clock_t	start;
+
+				start = clock ();
+#endif
+
+				//compress straight after the largest possible header so the zpacket is contiguous
+				compressed_frame = zpacket_buf + 6;
+
+				if (zstream)
+				{
+					compressed_frame_len = SV_CompressZStreamFrame (client, &frame, compressed_frame, sizeof(zpacket_buf) - 6, &zflags, &zdelta);
+					header_len = 6;
+				}
+				else
+				{
+					compressed_frame_len = ZLibCompressStream (NULL, 0, frame_buf, frame.cursize, compressed_frame, sizeof(zpacket_buf) - 6, client->ratecontrol.zlevel);
+					header_len = 5;
+					zflags = zdelta = 0;
+				}
 
-				compressed_frame_len = ZLibCompressChunk (frame_buf, frame.cursize, compressed_frame, sizeof(compressed_frame), Z_DEFAULT_COMPRESSION, -15);
+#ifndef NPROFILE
+				if (zstream)
+				{
+					svs.zstreamTime += (double)(clock () - start) * 1000.0 / CLOCKS_PER_SEC;
+					svs.zstreamFrames++;
+					if (zdelta)
+						svs.zstreamReferenced++;
+					svs.zstreamBytesIn += frame.cursize;
+					svs.zstreamBytesOut += compressed_frame_len == -1 ? frame.cursize : compressed_frame_len;
+				}
+#endif
 
-				if (compressed_frame_len != -1 && compressed_frame_len <= msg.maxsize - 5)
+				if (compressed_frame_len != -1 && (compressed_frame_len <= msg.maxsize - header_len || fragments) && compressed_frame_len + header_len < frame.cursize)
 				{
 					Com_DPrintf ("SV_SendClientDatagram: svc_frame for %s: %d -> %d\n", client->name, frame.cursize, compressed_frame_len);
-					SZ_WriteByte (&msg, svc_zpacket);
-					SZ_WriteShort (&msg, compressed_frame_len);
-					SZ_WriteShort (&msg, frame.cursize);
-					SZ_Write (&msg, compressed_frame, compressed_frame_len);
+					SZ_Init (&zpacket, compressed_frame - header_len, header_len);
+					SZ_WriteByte (&zpacket, svc_zpacket | zflags);
+					if (zflags & ZPACKET_REFERENCED)
+						SZ_WriteByte (&zpacket, zdelta);
+					SZ_WriteShort (&zpacket, compressed_frame_len);
+					SZ_WriteShort (&zpacket, frame.cursize);
+
+					blocks[numblocks].data = zpacket.data;
+					blocks[numblocks].length = header_len + compressed_frame_len;
+					numblocks++;
 #ifndef NPROFILE
 					svs.proto35CompressionBytes += frame.cursize - compressed_frame_len;
 #endif
 				}
 				else
 				{
-					if (sv_packetentities_hack->intvalue == 2)
+					//client never sees this one, don't let anything reference it
+					if (zstream)
+						client->zframes[client->netchan.outgoing_sequence & ZFRAME_MASK].length = 0;
+
+					if ((frame.cursize <= msg.maxsize && frame.cursize <= 1490) || fragments)
+					{
+						blocks[numblocks].data = frame_buf;
+						blocks[numblocks].length = frame.cursize;
+						numblocks++;
+					}
+					else if (sv_packetentities_hack->intvalue == 2)
 					{
 						Com_DPrintf ("SV_SendClientDatagram: zlib svc_frame %d -> %d for %s still didn't fit, using msg.maxsize of %d\n", frame.cursize, compressed_frame_len, client->name, msg.maxsize);
 						SZ_Clear (&frame);
@@ -910,20 +1043,35 @@ retryframe:
 						goto retryframe;
 					}
 				}
+#else
+				if ((frame.cursize <= msg.maxsize && frame.cursize <= 1490) || fragments)
+				{
+					blocks[numblocks].data = frame_buf;
+					blocks[numblocks].length = frame.cursize;
+					numblocks++;
+				}
 #endif
 			}
 			else
 			{
-				//it fits as-is, write it out
-				SZ_Write (&msg, frame_buf, frame.cursize);
+				//it fits as-is, send it out
+				blocks[numblocks].data = frame_buf;
+				blocks[numblocks].length = frame.cursize;
+				numblocks++;
 			}
 		}
-	}
 
-	if (msg.overflowed)
-	{
-		Com_Printf ("WARNING: Message overflow for %s after frame. Shouldn't happen!!\n", LOG_SERVER|LOG_WARNING, client->name);
-		SZ_Clear (&msg);
+		if (numblocks)
+		{
+			//everything else has to fit in behind the frame
+			frame_length = blocks[0].length;
+
+			//unless the frame alone needs fragmenting, then the rest gets a datagram's worth
+			if (frame_length <= msg.maxsize)
+				frame_reserve = frame_length;
+
+			msg.maxsize -= frame_reserve;
+		}
 	}
 
 	//msg at this point now contains the svc_frame
@@ -1074,10 +1222,10 @@ retryframe:
 	//fit an svc_frame so we measure using hacks and frameSize. however we must commit to delivering
 	//one reliable message at least to avoid getting stuck on never sending large messages.
 
-	SV_WriteReliableMessages (client, client->netchan.message.buffsize - msg.cursize);
+	SV_WriteReliableMessages (client, client->netchan.message.buffsize - msg.cursize - frame_reserve);
 
 #ifndef NDEBUG
-	if (!client->netchan.reliable_length)
+	if (Netchan_CanReliable (&client->netchan))
 	{
 		message = client->msgListStart;
 		for (;;)
@@ -1098,7 +1246,11 @@ retryframe:
 #endif
 
 	// send the datagram
-	ret = Netchan_Transmit (&client->netchan, msg.cursize, msg.data);
+	blocks[numblocks].data = msg.data;
+	blocks[numblocks].length = msg.cursize;
+	numblocks++;
+
+	ret = Netchan_Transmitv (&client->netchan, blocks, numblocks);
 	if (ret == -1)
 	{
 		SV_KickClient (client, "connection reset by peer", NULL);
@@ -1108,7 +1260,7 @@ retryframe:
 	}
 
 	// record the size for rate estimation
-	client->message_size[sv.framenum % RATE_MESSAGES] = msg.cursize;
+	client->message_size[sv.framenum % RATE_MESSAGES] = frame_length + msg.cursize;
 
 	return true;
 }
@@ -1126,35 +1278,378 @@ static void SV_DemoCompleted (void)
 		fclose (sv.demofile);
 		sv.demofile = NULL;
 	}
+	if (sv.demoindex)
+	{
+		FS_FreeFile (sv.demoindex);
+		sv.demoindex = NULL;
+		sv.demoseek = NULL;
+	}
 	SV_Nextserver ();
 }
 
+/*
+==================
+SV_DemoIndexLong
+
+index data is only byte aligned
+==================
+*/
+static int SV_DemoIndexLong (const byte *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+}
+
+/*
+==================
+SV_LoadDemoIndex
+
+Loads the keyframes a client wrote while recording the demo. Every
+message is bounds checked here so seeking can trust them. A recording
+that was cut short can leave a partial keyframe at the end, anything
+from there on is dropped.
+==================
+*/
+void SV_LoadDemoIndex (const char *name)
+{
+	const ddemoindex_t		*header;
+	const ddemokeyframe_t	*key;
+	const byte				*p, *msg, *end, *keyend;
+	byte					*buff;
+	int						len, msglen, count;
+
+	len = FS_LoadFile (name, (void **)&buff);
+	if (!buff)
+		return;
+
+	header = (const ddemoindex_t *)buff;
+
+	if (len < sizeof(*header) || LittleLong (header->ident) != IDDEMOINDEXHEADER || LittleLong (header->version) != DEMOINDEX_VERSION)
+	{
+		Com_Printf ("WARNING: %s is not a demo index, ignored.\n", LOG_SERVER|LOG_WARNING, name);
+		FS_FreeFile (buff);
+		return;
+	}
+
+	count = 0;
+	end = buff + len;
+	p = buff + sizeof(*header);
+
+	while (p + sizeof(*key) <= end)
+	{
+		key = (const ddemokeyframe_t *)p;
+
+		len = LittleLong (key->length);
+		if (len <= 0 || len > end - p - sizeof(*key) || LittleLong (key->offset) < 0)
+			break;
+
+		msg = p + sizeof(*key);
+		keyend = msg + len;
+
+		while (msg < keyend)
+		{
+			if (keyend - msg < 4)
+				break;
+
+			msglen = SV_DemoIndexLong (msg);
+			msg += 4;
+
+			if (msglen <= 0 || msglen > MAX_FRAGMENTED_MSGLEN - MAX_MSGLEN || msglen > keyend - msg)
+				break;
+
+			msg += msglen;
+		}
+
+		if (msg != keyend)
+			break;
+
+		p = keyend;
+		count++;
+	}
+
+	if (!count)
+	{
+		Com_Printf ("WARNING: %s has no usable keyframes, ignored.\n", LOG_SERVER|LOG_WARNING, name);
+		FS_FreeFile (buff);
+		return;
+	}
+
+	sv.demoindex = buff;
+	sv.demoindexlen = p - buff;
+
+	Com_DPrintf ("SV_LoadDemoIndex: %d keyframes in %s\n", count, name);
+}
+
+/*
+==================
+SV_NextDemoKeyframe
+
+the keyframe after key, or the first one when key is NULL
+==================
+*/
+const ddemokeyframe_t *SV_NextDemoKeyframe (const ddemokeyframe_t *key)
+{
+	const byte	*p;
+
+	if (!sv.demoindex)
+		return NULL;
+
+	if (!key)
+		p = sv.demoindex + sizeof(ddemoindex_t);
+	else
+		p = (const byte *)(key + 1) + LittleLong (key->length);
+
+	if (p >= sv.demoindex + sv.demoindexlen)
+		return NULL;
+
+	return (const ddemokeyframe_t *)p;
+}
+
+/*
+==================
+SV_DemoTime
+
+Playback position in ms since the start of the demo. Only keyframes
+know their time, in between it is estimated from the file position.
+==================
+*/
+int SV_DemoTime (void)
+{
+	const ddemokeyframe_t	*key, *last, *next;
+	long					pos;
+	int						lastofs, nextofs;
+
+	if (!sv.demofile || !sv.demoindex)
+		return 0;
+
+	pos = ftell (sv.demofile) - sv.demostart;
+
+	last = NULL;
+	for (key = SV_NextDemoKeyframe (NULL); key; key = SV_NextDemoKeyframe (key))
+	{
+		if (LittleLong (key->offset) > pos)
+			break;
+		last = key;
+	}
+
+	if (!last)
+		return 0;
+
+	next = key;
+	if (!next)
+		return LittleLong (last->time);
+
+	lastofs = LittleLong (last->offset);
+	nextofs = LittleLong (next->offset);
+
+	return LittleLong (last->time) + (int)((double)(pos - lastofs) / (nextofs - lastofs) * (LittleLong (next->time) - LittleLong (last->time)));
+}
+
+/*
+==================
+SV_SendDemoKeyframe
+
+Jumps playback to a keyframe: every client gets the keyframe's state
+and playback carries on from the demo message that followed it when it
+was recorded. A client that can't take every message of the keyframe
+would be left with half a snapshot, so then nobody seeks.
+==================
+*/
+static void SV_SendDemoKeyframe (const ddemokeyframe_t *key)
+{
+	const byte	*msg, *end;
+	int			i, msglen;
+	client_t	*c;
+
+	msg = (const byte *)(key + 1);
+	end = msg + LittleLong (key->length);
+
+	for (; msg < end; msg += msglen)
+	{
+		msglen = SV_DemoIndexLong (msg);
+		msg += 4;
+
+		for (i=0, c = svs.clients ; i<maxclients->intvalue; i++, c++)
+		{
+			if (c->state == cs_free)
+				continue;
+
+			if (msglen > Netchan_UnreliableRoom (&c->netchan, false))
+			{
+				Com_Printf ("Can't seek, a %d byte keyframe message is too big for %s.\n", LOG_SERVER|LOG_WARNING, msglen, c->name);
+				return;
+			}
+		}
+	}
+
+	fseek (sv.demofile, sv.demostart + LittleLong (key->offset), SEEK_SET);
+
+	msg = (const byte *)(key + 1);
+
+	for (; msg < end; msg += msglen)
+	{
+		msglen = SV_DemoIndexLong (msg);
+		msg += 4;
+
+		for (i=0, c = svs.clients ; i<maxclients->intvalue; i++, c++)
+		{
+			if (c->state == cs_free)
+				continue;
+
+			//pending reliables wait for a packet with room for them
+			if (msglen <= Netchan_UnreliableRoom (&c->netchan, true))
+				SV_WriteReliableMessages (c, c->netchan.message.buffsize);
+
+			Netchan_Transmit (&c->netchan, msglen, msg);
+		}
+	}
+}
+
 
 /*
 =======================
-SV_RateDrop
+SV_ClientRate
 
-Returns true if the client is over its current
-bandwidth estimation and should not be sent another packet
+the rate the client is held to, its rate userinfo unless sv_ratecontrol
+is measuring what its link can really take. the rate userinfo is still
+the most it gets, so lowering it takes effect straight away.
 =======================
 */
-static qboolean SV_RateDrop (client_t *c)
+int SV_ClientRate (client_t *cl)
+{
+	if (!sv_ratecontrol->intvalue)
+		return cl->rate;
+
+	//start out from what the client claims
+	if (!cl->ratecontrol.rate || cl->ratecontrol.rate > cl->rate)
+		cl->ratecontrol.rate = cl->rate;
+
+	return cl->ratecontrol.rate;
+}
+
+/*
+=======================
+SV_RateControlSample
+
+feeds the latency of a newly acknowledged frame to the rate control. the
+lowest latency of the last two windows is taken as the link with nothing
+queued, anything above that is queueing delay. below the target the rate
+grows the more the emptier the queue is, above it the rate is cut once
+per round trip, harder the further the target was overshot.
+=======================
+*/
+void SV_RateControlSample (ratecontrol_t *rc, int latency, unsigned now)
+{
+	int		base, queue, target, over, maxrate;
+
+	if (latency <= 0 || !rc->rate)
+		return;
+
+	if (!rc->window_min || latency < rc->window_min)
+		rc->window_min = latency;
+
+	if (now - rc->window_start > RATECONTROL_WINDOW)
+	{
+		rc->last_min = rc->window_min;
+		rc->window_min = latency;
+		rc->window_start = now;
+	}
+
+	base = rc->window_min;
+	if (rc->last_min && rc->last_min < base)
+		base = rc->last_min;
+
+	if (!rc->latency)
+		rc->latency = latency;
+	else
+		rc->latency += (latency - rc->latency) / 4;
+
+	queue = rc->latency - base;
+
+	target = sv_ratecontrol_target->intvalue;
+	if (target < 1)
+		target = 1;
+
+	if (queue < target)
+	{
+		//only grow if we're actually using what we have
+		if (rc->used * 2 >= rc->rate)
+			rc->rate += rc->rate / 16 * (target - queue) / target + 32;
+	}
+	else if (now - rc->last_decrease > (unsigned)(base + target))
+	{
+		//cut at most in half, and only once per empty-queue round trip so
+		//the last cut has a chance to show before the next
+		over = queue - target;
+		rc->rate -= rc->rate * over / (over + target) / 2;
+		rc->last_decrease = now;
+	}
+
+	maxrate = sv_ratecontrol_max->intvalue;
+	if (maxrate < RATECONTROL_MIN)
+		maxrate = RATECONTROL_MIN;
+
+	if (rc->rate > maxrate)
+		rc->rate = maxrate;
+	else if (rc->rate < RATECONTROL_MIN)
+		rc->rate = RATECONTROL_MIN;
+}
+
+/*
+=======================
+SV_RateExceeded
+
+true if the last RATE_MESSAGES messages add up to more than rate. also
+picks how hard this client's frames get compressed: hard when it is
+close to its limit, fast when it has plenty of room.
+=======================
+*/
+qboolean SV_RateExceeded (ratecontrol_t *rc, const int *message_size, int rate)
 {
 	int		total;
 	int		i;
 
-	// never drop over the loopback
-	if (NET_IsLocalHost (&c->netchan.remote_address))
-		return false;
-
 	total = 0;
 
 	for (i = 0 ; i < RATE_MESSAGES ; i++)
 	{
-		total += c->message_size[i];
+		total += message_size[i];
 	}
 
-	if (total > c->rate)
+	rc->used = total;
+
+#ifndef NO_ZLIB
+	if (!sv_ratecontrol->intvalue)
+		rc->zlevel = Z_DEFAULT_COMPRESSION;
+	else if (total > rate / 4 * 3)
+		rc->zlevel = Z_BEST_COMPRESSION;
+	else if (total < rate / 4)
+		rc->zlevel = Z_BEST_SPEED;
+	else
+		rc->zlevel = Z_DEFAULT_COMPRESSION;
+#endif
+
+	return total > rate;
+}
+
+/*
+=======================
+SV_RateDrop
+
+Returns true if the client is over its current
+bandwidth estimation and should not be sent another packet
+=======================
+*/
+static qboolean SV_RateDrop (client_t *c)
+{
+	qboolean	exceeded;
+
+	exceeded = SV_RateExceeded (&c->ratecontrol, c->message_size, SV_ClientRate (c));
+
+	// never drop over the loopback
+	if (NET_IsLocalHost (&c->netchan.remote_address))
+		return false;
+
+	if (exceeded)
 	{
 		c->surpressCount++;
 		c->message_size[sv.framenum % RATE_MESSAGES] = 0;
@@ -1191,7 +1686,7 @@ void SV_SendClientMessages (void)
 	int			i;
 	client_t	*c;
 	int			msglen;
-	byte		msgbuf[MAX_MSGLEN];
+	byte		msgbuf[MAX_FRAGMENTED_MSGLEN - MAX_MSGLEN];
 	size_t		r;
 
 	msglen = 0;
@@ -1201,6 +1696,13 @@ void SV_SendClientMessages (void)
 	// read the next demo message if needed
 	if (sv.demofile && sv.state == ss_demo)
 	{
+		if (sv.demoseek)
+		{
+			SV_SendDemoKeyframe (sv.demoseek);
+			sv.demoseek = NULL;
+			return;
+		}
+
 		if (!sv_paused->intvalue)
 		{
 			// get the next message
@@ -1217,8 +1719,9 @@ void SV_SendClientMessages (void)
 				return;
 			}
 
-			if (msglen > MAX_MSGLEN)
-				Com_Error (ERR_DROP, "SV_SendClientMessages: msglen %d > MAX_MSGLEN (%d)", msglen, MAX_MSGLEN);
+			//r1: demos recorded over a fragmenting netchan can have bigger messages
+			if (msglen > MAX_FRAGMENTED_MSGLEN - MAX_MSGLEN)
+				Com_Error (ERR_DROP, "SV_SendClientMessages: msglen %d > %d", msglen, MAX_FRAGMENTED_MSGLEN - MAX_MSGLEN);
 			else if (msglen == 0)
 				Com_DPrintf ("WARNING: Demo file contains zero byte message at 0x%lx, ignored.\n", ftell (sv.demofile) - 4);
 			else
@@ -1248,13 +1751,26 @@ void SV_SendClientMessages (void)
 
 		c->last_incoming_sequence = c->netchan.incoming_sequence;
 		c->player_updates_sent = 0;
+		c->player_update_base = svs.realtime;
 
 		//r1: totally rewrote how reliable/datagram works. concept of overflow
 		//is now obsolete.
 
 		if (sv.state == ss_cinematic || sv.state == ss_demo || sv.state == ss_pic)
 		{
-			SV_WriteReliableMessages (c, c->netchan.message.buffsize);
+			//r1: demo frames recorded over a fragmenting netchan can be too big for
+			//this client, it misses the frame rather than taking the server down.
+			if (msglen > Netchan_UnreliableRoom (&c->netchan, false))
+			{
+				Com_DPrintf ("SV_SendClientMessages: %d byte demo message too big for %s, skipped.\n", msglen, c->name);
+				Netchan_Transmit (&c->netchan, 0, NULL);
+				continue;
+			}
+
+			//pending reliables wait for a packet with room for them
+			if (msglen <= Netchan_UnreliableRoom (&c->netchan, true))
+				SV_WriteReliableMessages (c, c->netchan.message.buffsize);
+
 			Netchan_Transmit (&c->netchan, msglen, msgbuf);
 		}
 		else if (c->state == cs_spawned)
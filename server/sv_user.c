@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // sv_user.c -- server code for moving users
 
 #include "server.h"
+#include "../qcommon/redblack.h"
 
 edict_t	*sv_player;
 
@@ -40,6 +41,8 @@ sv_client and sv_player will be valid.
 */
 
 static void SV_BaselinesMessage (qboolean userCmd);
+static void SV_WriteBaselines (int startPos);
+static void SV_WriteAllBaselines (void);
 
 /*
 ==================
@@ -56,6 +59,15 @@ static void SV_BeginDemoserver (void)
 
 	if (!sv.demofile)
 		Com_Error (ERR_HARD, "Couldn't open demo %s", name);
+
+	sv.demostart = ftell (sv.demofile);
+	sv.demoseek = NULL;
+
+	if (!sv.demoindex)
+	{
+		Com_sprintf (name, sizeof(name), "demos/%s.idx", sv.name);
+		SV_LoadDemoIndex (name);
+	}
 }
 
 /*
@@ -95,20 +107,235 @@ static void SV_CreateBaseline (client_t *cl)
 	}
 }
 
-static void SV_New_f (void);
-static void SV_AddConfigstrings (void)
+/*
+============================================================
+
+CONNECT STREAM CACHE
+
+The configstring and baseline streams are the same bytes for every client
+on a given map, protocol and packet size, so after a map change we build
+them (and do all the deflating) once and replay the messages to everyone
+else that connects.
+============================================================
+*/
+
+#define	MAX_CONNECT_CACHES	4
+
+typedef struct connectcache_s
 {
-	int		start;
-	int		wrote;
-	int		len;
+	qboolean	valid;
+	int			spawncount;
+	int			protocol;
+	int			protocol_version;
+	int			buffsize;
+	uint32		lastused;
+	int			nummessages;
+	int			cursize;
+	int			maxsize;
+	byte		*data;		// [short length][message] ...
+} connectcache_t;
 
-	if (sv_client->state != cs_spawning)
+static connectcache_t	configstringCache[MAX_CONNECT_CACHES];
+static connectcache_t	baselineCache[MAX_CONNECT_CACHES];
+
+//the lastlines the baseline caches were built from
+static entity_state_t	*baselineSnapshot;
+
+//when set, SV_ConnectMessage records into here instead of sending
+static connectcache_t	*recordingCache;
+
+static uint32			connectCacheSequence;
+
+/*
+==================
+SV_InvalidateConnectCache
+
+Called when a configstring changes.
+==================
+*/
+void SV_InvalidateConnectCache (void)
+{
+	int		i;
+
+	for (i = 0; i < MAX_CONNECT_CACHES; i++)
+		configstringCache[i].valid = false;
+}
+
+/*
+==================
+SV_FreeConnectCache
+==================
+*/
+void SV_FreeConnectCache (void)
+{
+	int		i;
+
+	for (i = 0; i < MAX_CONNECT_CACHES; i++)
 	{
-		//r1: dprintf to avoid console spam from idiot client
-		Com_Printf ("configstrings for %s not valid -- not spawning\n", LOG_SERVER|LOG_WARNING, sv_client->name);
+		if (configstringCache[i].data)
+			Z_Free (configstringCache[i].data);
+
+		if (baselineCache[i].data)
+			Z_Free (baselineCache[i].data);
+	}
+
+	memset (configstringCache, 0, sizeof(configstringCache));
+	memset (baselineCache, 0, sizeof(baselineCache));
+
+	if (baselineSnapshot)
+	{
+		Z_Free (baselineSnapshot);
+		baselineSnapshot = NULL;
+	}
+	recordingCache = NULL;
+}
+
+/*
+==================
+SV_FindConnectCache
+
+Returns the cache entry for sv_client's protocol variant, which may need
+building if it isn't valid. protocol_version only matters to baselines.
+==================
+*/
+static connectcache_t *SV_FindConnectCache (connectcache_t *caches, qboolean versioned)
+{
+	int				i;
+	connectcache_t	*c, *best;
+
+	best = NULL;
+
+	for (i = 0, c = caches; i < MAX_CONNECT_CACHES; i++, c++)
+	{
+		if (c->valid && c->spawncount == svs.spawncount && c->protocol == sv_client->protocol &&
+			c->buffsize == sv_client->netchan.message.buffsize &&
+			(!versioned || c->protocol_version == sv_client->protocol_version))
+		{
+			c->lastused = ++connectCacheSequence;
+			return c;
+		}
+
+		if (!best || (best->valid && (!c->valid || c->lastused < best->lastused)))
+			best = c;
+	}
+
+	best->valid = false;
+	best->spawncount = svs.spawncount;
+	best->protocol = sv_client->protocol;
+	best->protocol_version = sv_client->protocol_version;
+	best->buffsize = sv_client->netchan.message.buffsize;
+	best->lastused = ++connectCacheSequence;
+	best->nummessages = 0;
+	best->cursize = 0;
+
+	return best;
+}
+
+/*
+==================
+SV_ConnectMessage
+
+Sends the current message to sv_client reliably, or appends it to the
+cache being built.
+==================
+*/
+static void SV_ConnectMessage (void)
+{
+	connectcache_t	*c;
+	int				len;
+
+	c = recordingCache;
+	if (!c)
+	{
+		SV_AddMessage (sv_client, true);
 		return;
 	}
 
+	len = MSG_GetLength ();
+
+	if (c->cursize + len + 2 > c->maxsize)
+	{
+		byte	*newdata;
+		int		newsize;
+
+		newsize = c->maxsize ? c->maxsize * 2 : 0x4000;
+		while (newsize < c->cursize + len + 2)
+			newsize *= 2;
+
+		newdata = Z_TagMalloc (newsize, TAGMALLOC_CONNECTCACHE);
+		if (c->data)
+		{
+			memcpy (newdata, c->data, c->cursize);
+			Z_Free (c->data);
+		}
+
+		c->data = newdata;
+		c->maxsize = newsize;
+	}
+
+	c->data[c->cursize] = len & 0xff;
+	c->data[c->cursize+1] = (len >> 8) & 0xff;
+	memcpy (c->data + c->cursize + 2, MSG_GetRawMsg()->data, len);
+
+	c->cursize += len + 2;
+	c->nummessages++;
+
+	MSG_FreeData ();
+}
+
+/*
+==================
+SV_SendConnectCache
+
+Builds the cache with func if needed, then replays it to sv_client.
+==================
+*/
+static void SV_SendConnectCache (connectcache_t *c, void (*func)(void), const char *what)
+{
+	const byte	*p, *end;
+	int			len;
+
+	if (!c->valid)
+	{
+		recordingCache = c;
+		func ();
+		recordingCache = NULL;
+
+		c->valid = true;
+		Com_DPrintf ("SV_SendConnectCache: built %s for protocol %d/%d, %d messages in %d bytes\n", what, c->protocol, c->protocol_version, c->nummessages, c->cursize);
+	}
+
+	p = c->data;
+	end = c->data + c->cursize;
+
+	while (p < end)
+	{
+		len = p[0] + (p[1] << 8);
+		p += 2;
+
+		MSG_BeginWriting (p[0]);
+		MSG_Write (p + 1, len - 1);
+		SV_AddMessage (sv_client, true);
+
+		p += len;
+	}
+}
+
+static void SV_New_f (void);
+
+/*
+==================
+SV_WriteConfigstrings
+
+Writes the configstring stream for sv_client's protocol.
+==================
+*/
+static void SV_WriteConfigstrings (void)
+{
+	int		start;
+	int		wrote;
+	int		len;
+
 	start = 0;
 	wrote = 0;
 
@@ -132,7 +359,7 @@ plainStrings:
 				MSG_WriteShort (start);
 				MSG_Write (sv.configstrings[start], len);
 				MSG_Write ("\0", 1);
-				SV_AddMessage (sv_client, true);
+				SV_ConnectMessage ();
 
 				//we add in a stuffcmd every 500 bytes to ensure that old clients will transmit a
 				//netchan ack asap. uuuuuuugly...
@@ -141,7 +368,7 @@ plainStrings:
 				{
 					MSG_BeginWriting (svc_stufftext);
 					MSG_WriteString ("cmd \177n\n");
-					SV_AddMessage (sv_client, true);
+					SV_ConnectMessage ();
 					wrote = 0;
 				}
 			}
@@ -249,13 +476,25 @@ plainStrings:
 			MSG_WriteShort (z.total_out);
 			MSG_WriteShort (realBytes);
 			MSG_Write (compressedStringStream, z.total_out);
-			SV_AddMessage (sv_client, true);
+			SV_ConnectMessage ();
 #ifndef NPROFILE
 			svs.proto35CompressionBytes += realBytes - z.total_out;
 #endif
 		}
 	}
 #endif
+}
+
+static void SV_AddConfigstrings (void)
+{
+	if (sv_client->state != cs_spawning)
+	{
+		//r1: dprintf to avoid console spam from idiot client
+		Com_Printf ("configstrings for %s not valid -- not spawning\n", LOG_SERVER|LOG_WARNING, sv_client->name);
+		return;
+	}
+
+	SV_SendConnectCache (SV_FindConnectCache (configstringCache, false), SV_WriteConfigstrings, "configstrings");
 
 	// send next command
 
@@ -431,7 +670,7 @@ static void SV_New_f (void)
 			MSG_WriteString (va ("$%s $%s\n",  aliasConnect[realIndex], aliasJunk[serverIndex]));
 			SV_AddMessage (sv_client, true);
 
-			if (sv_client->netchan.reliable_length)
+			if (!Netchan_CanReliable (&sv_client->netchan))
 			{
 				//FIXME: why does this happen?
 				Com_Printf ("WARNING: Calling SV_WriteReliableMessages for %s but netchan already has %d bytes of data! This shouldn't happen.\n", LOG_SERVER|LOG_WARNING, sv_client->name, sv_client->netchan.reliable_length);
@@ -593,10 +832,6 @@ SV_Baselines_f
 static void SV_BaselinesMessage (qboolean userCmd)
 {
 	int				startPos;
-	int				start;
-	int				wrote;
-
-	entity_state_t	*base;
 
 	Com_DPrintf ("Baselines() from %s\n", sv_client->name);
 
@@ -632,6 +867,51 @@ static void SV_BaselinesMessage (qboolean userCmd)
 		return;
 	}
 
+	if (startPos == 0)
+	{
+		//the cache is only good for baselines taken from the same entity states
+		if (!baselineSnapshot)
+		{
+			baselineSnapshot = Z_TagMalloc (sizeof(entity_state_t) * MAX_EDICTS, TAGMALLOC_CONNECTCACHE);
+			memcpy (baselineSnapshot, sv_client->lastlines, sizeof(entity_state_t) * MAX_EDICTS);
+		}
+		else if (memcmp (baselineSnapshot, sv_client->lastlines, sizeof(entity_state_t) * MAX_EDICTS))
+		{
+			int		i;
+
+			for (i = 0; i < MAX_CONNECT_CACHES; i++)
+				baselineCache[i].valid = false;
+
+			memcpy (baselineSnapshot, sv_client->lastlines, sizeof(entity_state_t) * MAX_EDICTS);
+		}
+
+		SV_SendConnectCache (SV_FindConnectCache (baselineCache, true), SV_WriteAllBaselines, "baselines");
+	}
+	else
+	{
+		SV_WriteBaselines (startPos);
+	}
+
+	// send next command
+	MSG_BeginWriting (svc_stufftext);
+	MSG_WriteString (va("precache %i\n", svs.spawncount));
+	SV_AddMessage (sv_client, true);
+}
+
+/*
+==================
+SV_WriteBaselines
+
+Writes sv_client's baselines from startPos onwards.
+==================
+*/
+static void SV_WriteBaselines (int startPos)
+{
+	int				start;
+	int				wrote;
+
+	entity_state_t	*base;
+
 	start = startPos;
 	wrote = 0;
 
@@ -653,7 +933,7 @@ plainLines:
 				MSG_BeginWriting (svc_spawnbaseline);
 				SV_WriteDeltaEntity (&null_entity_state, base, true, true, sv_client->protocol, sv_client->protocol_version);
 				wrote += MSG_GetLength();
-				SV_AddMessage (sv_client, true);
+				SV_ConnectMessage ();
 
 				//we add in a stuffcmd every 500 bytes to ensure that old clients will transmit a
 				//netchan ack asap. uuuuuuugly...
@@ -661,7 +941,7 @@ plainLines:
 				{
 					MSG_BeginWriting (svc_stufftext);
 					MSG_WriteString ("cmd \177n\n");
-					SV_AddMessage (sv_client, true);
+					SV_ConnectMessage ();
 					wrote = 0;
 				}
 
@@ -763,18 +1043,18 @@ plainLines:
 			MSG_WriteShort (z.total_out);
 			MSG_WriteShort (realBytes);
 			MSG_Write (compressedLineStream, z.total_out);
-			SV_AddMessage (sv_client, true);
+			SV_ConnectMessage ();
 #ifndef NPROFILE
 			svs.proto35CompressionBytes += realBytes - z.total_out;
 #endif
 		}
 	}
 #endif
+}
 
-	// send next command
-	MSG_BeginWriting (svc_stufftext);
-	MSG_WriteString (va("precache %i\n", svs.spawncount));
-	SV_AddMessage (sv_client, true);
+static void SV_WriteAllBaselines (void)
+{
+	SV_WriteBaselines (0);
 }
 
 int SV_CountPlayers (void)
@@ -1807,90 +2087,77 @@ static void CvarBanDrop (const char *match, const banmatch_t *ban, const char *r
 	SV_DropClient (sv_client, (ban->blockmethod == CVARBAN_BLACKHOLE) ? false : true);
 }
 
+/*
+=====================
+VarBanMatch
+
+finds the first rule for var that result trips. the variable is looked up
+in the list's index and each rule was already parsed by AddVarBan, so all
+that's left per rule is the comparison itself.
+=====================
+*/
 const banmatch_t *VarBanMatch (varban_t *bans, const char *var, const char *result)
 {
-	banmatch_t			*match;
-	char				*matchvalue;
-	int					not;
-
-	while (bans->next)
-	{
-		bans = bans->next;
+	const banmatch_t	*match;
+	const void			**data;
+	qboolean			hit;
+	qboolean			haveint;
+	float				intresult;
 
-		if (!Q_stricmp (bans->varname, var))
-		{
-			match = &bans->match;
+	if (!bans->index)
+		return NULL;
 
-			while (match->next)
-			{
-				match = match->next;
+	data = rbfind (var, bans->index);
+	if (!data)
+		return NULL;
 
-				matchvalue = match->matchvalue;
+	bans = *(varban_t **)data;
 
-				not = 1;
+	haveint = false;
+	intresult = 0;
 
-				if (matchvalue[0] == '!')
-				{
-					not = 0;
-					matchvalue++;
-				}
+	for (match = bans->match.next; match; match = match->next)
+	{
+		if (match->op == BANMATCH_EXISTS)
+		{
+			if ((result[0] ? true : false) == match->want)
+				return match;
+			continue;
+		}
 
-				if (matchvalue[0] == '*')
-				{
-					if ((result[0] == 0 ? 0 : 1) == not)
-						return match;
-					continue;
-				}
-				else
-				{
-					if (!result[0])
-						continue;
-				}
+		if (!result[0])
+			continue;
 
-				if (matchvalue[1])
+		switch (match->op)
+		{
+			case BANMATCH_GREATER:
+			case BANMATCH_LESS:
+			case BANMATCH_EQUAL:
+				if (!haveint)
 				{
-					float intresult, matchint;
 					intresult = (float)atof(result);
-
-					matchint = (float)atof(matchvalue+1);
-
-					switch (matchvalue[0])
-					{
-						case '>':
-							if ((intresult > matchint) == not)
-								return match;
-							continue;
-
-						case '<':
-							if ((intresult < matchint) == not)
-								return match;
-							continue;
-						
-						case '=':
-							if ((intresult == matchint) == not)
-								return match;
-							continue;
-						
-						case '~':
-							if ((strstr (result, matchvalue + 1) == NULL ? 0 : 1) == not)
-								return match;
-							continue;
-						
-						case '#':
-							if (!Q_stricmp (matchvalue+1, result) ==  not)
-								return match;
-							continue;
-						default:
-							break;
-					}
+					haveint = true;
 				}
 
-				if (!Q_stricmp (matchvalue, result) ==  not)
-					return match;
-			}
+				if (match->op == BANMATCH_GREATER)
+					hit = intresult > match->number;
+				else if (match->op == BANMATCH_LESS)
+					hit = intresult < match->number;
+				else
+					hit = intresult == match->number;
+				break;
+
+			case BANMATCH_CONTAINS:
+				hit = strstr (result, match->value) ? true : false;
+				break;
 
-			return NULL;
+			default:
+				hit = !Q_stricmp (match->value, result);
+				break;
 		}
+
+		if (hit == match->want)
+			return match;
 	}
 
 	return NULL;
@@ -1949,15 +2216,14 @@ static void SV_CvarResult_f (void)
 	else
 	{
 		varban_t	*bans;
+		const void	**data;
 
 		if (!strcmp (Cmd_Argv(1), "version"))
 			return;
 
-		bans = &cvarbans;
-
-		while (bans->next)
+		if (cvarbans.index && (data = rbfind (Cmd_Argv(1), cvarbans.index)))
 		{
-			bans = bans->next;
+			bans = *(varban_t **)data;
 
 			if (!strcmp (Cmd_Argv(1), bans->varname))
 				return;
@@ -2330,30 +2596,41 @@ static void SV_ExecuteUserCommand (char *s)
 		}
 	}
 
-	for (x = bannedcommands.next; x; x = x->next)
+	x = NULL;
+
+	if (bannedcommands_index)
 	{
-		if (!strcmp (Cmd_Argv(0), x->name) || !strcmp (flattened, x->name))
-		{
-			if (x->logmethod == CMDBAN_LOG_MESSAGE)
-				Com_Printf ("SV_ExecuteUserCommand: %s tried to use '%s'\n", LOG_SERVER, sv_client->name, s);
+		const void	**data;
 
-			if (x->kickmethod == CMDBAN_MESSAGE)
-			{
-				SV_ClientPrintf (sv_client, PRINT_HIGH, "The '%s' command has been disabled by the server administrator.\n", x->name);
-			}
-			else if (x->kickmethod == CMDBAN_KICK)
-			{
-				Com_Printf ("Dropping %s, bancommand %s matched.\n", LOG_SERVER|LOG_DROP, sv_client->name, x->name);
-				SV_DropClient (sv_client, true);
-			}
-			else if (x->kickmethod == CMDBAN_BLACKHOLE)
-			{
-				Blackhole (&sv_client->netchan.remote_address, false, sv_blackhole_mask->intvalue, BLACKHOLE_SILENT, "bancommand '%s'", x->name);
-				SV_DropClient (sv_client, false);
-			}
+		data = rbfind (Cmd_Argv(0), bannedcommands_index);
+		if (!data)
+			data = rbfind (flattened, bannedcommands_index);
 
-			return;
+		if (data)
+			x = *(bannedcommands_t **)data;
+	}
+
+	if (x)
+	{
+		if (x->logmethod == CMDBAN_LOG_MESSAGE)
+			Com_Printf ("SV_ExecuteUserCommand: %s tried to use '%s'\n", LOG_SERVER, sv_client->name, s);
+
+		if (x->kickmethod == CMDBAN_MESSAGE)
+		{
+			SV_ClientPrintf (sv_client, PRINT_HIGH, "The '%s' command has been disabled by the server administrator.\n", x->name);
+		}
+		else if (x->kickmethod == CMDBAN_KICK)
+		{
+			Com_Printf ("Dropping %s, bancommand %s matched.\n", LOG_SERVER|LOG_DROP, sv_client->name, x->name);
+			SV_DropClient (sv_client, true);
 		}
+		else if (x->kickmethod == CMDBAN_BLACKHOLE)
+		{
+			Blackhole (&sv_client->netchan.remote_address, false, sv_blackhole_mask->intvalue, BLACKHOLE_SILENT, "bancommand '%s'", x->name);
+			SV_DropClient (sv_client, false);
+		}
+
+		return;
 	}
 
 	for (u=ucmds ; u->name ; u++)
@@ -2644,6 +2921,8 @@ void SV_RunMultiMoves (client_t *cl)
 			//FIXME: should we adjust for FPS latency?
 			cl->frame_latency[cl->lastframe&(LATENCY_COUNTS-1)] = 
 				svs.realtime - cl->frames[cl->lastframe & UPDATE_MASK].senttime;
+
+			SV_RateControlSample (&cl->ratecontrol, cl->frame_latency[cl->lastframe&(LATENCY_COUNTS-1)], svs.realtime);
 		}
 	}
 
@@ -2786,6 +3065,8 @@ void SV_ExecuteClientMessage (client_t *cl)
 					cl->frame_latency[cl->lastframe&(LATENCY_COUNTS-1)] = 
 						svs.realtime - cl->frames[cl->lastframe & UPDATE_MASK].senttime;
 
+					SV_RateControlSample (&cl->ratecontrol, cl->frame_latency[cl->lastframe&(LATENCY_COUNTS-1)], svs.realtime);
+
 					//if (cl->fps)
 					//	cl->frame_latency[cl->lastframe&(LATENCY_COUNTS-1)] -= 1000 / (cl->fps * 2);
 				}
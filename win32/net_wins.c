@@ -244,6 +244,40 @@ int NET_SendPacket (netsrc_t sock, int length, const void *data, netadr_t *to)
 	return 1;
 }
 
+/*
+====================
+NET_SendPacketv
+
+Winsock 1.1 has no gathered sendto, so the blocks are assembled once
+here. This is still one copy less than Netchan_Transmit used to do.
+====================
+*/
+int NET_SendPacketv (netsrc_t sock, const netvec_t *blocks, int numblocks, netadr_t *to)
+{
+	byte	buff[MAX_MSGLEN];
+	int		i, length;
+
+#ifndef DEDICATED_ONLY
+	if (to->type == NA_LOOPBACK)
+	{
+		NET_SendLoopPacketv (sock, blocks, numblocks);
+		return 0;
+	}
+#endif
+
+	length = 0;
+	for (i = 0; i < numblocks; i++)
+	{
+		if (length + blocks[i].length > (int)sizeof(buff))
+			Com_Error (ERR_FATAL, "NET_SendPacketv: %d byte datagram", length + blocks[i].length);
+
+		memcpy (buff + length, blocks[i].data, blocks[i].length);
+		length += blocks[i].length;
+	}
+
+	return NET_SendPacket (sock, length, buff, to);
+}
+
 
 //=============================================================================
 
@@ -253,8 +253,80 @@ unsigned int Sys_Milliseconds (void)
 
 	return curtime;
 }
+
+/*
+================
+Sys_Microseconds
+================
+*/
+uint64 Sys_Microseconds (void)
+{
+	static LARGE_INTEGER	freq;
+	LARGE_INTEGER			now;
+
+	if (!freq.QuadPart)
+		QueryPerformanceFrequency (&freq);
+
+	QueryPerformanceCounter (&now);
+
+	return (uint64)(now.QuadPart / freq.QuadPart) * 1000000 + (uint64)(now.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+}
 #endif
 
+void Sys_Sleep (int msec)
+{
+	Sleep (msec);
+}
+
+typedef struct
+{
+	HANDLE			handle;
+	threadfunc_t	func;
+	void			*param;
+} systhread_t;
+
+static DWORD WINAPI Sys_ThreadStart (LPVOID arg)
+{
+	systhread_t	*thread = arg;
+
+	thread->func (thread->param);
+	return 0;
+}
+
+void *Sys_CreateThread (threadfunc_t func, void *param)
+{
+	systhread_t	*thread;
+	DWORD		id;
+
+	thread = malloc (sizeof(*thread));
+	if (!thread)
+		return NULL;
+
+	thread->func = func;
+	thread->param = param;
+
+	thread->handle = CreateThread (NULL, 0, Sys_ThreadStart, thread, 0, &id);
+	if (!thread->handle)
+	{
+		free (thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+void Sys_WaitThread (void *thread)
+{
+	WaitForSingleObject (((systhread_t *)thread)->handle, INFINITE);
+	CloseHandle (((systhread_t *)thread)->handle);
+	free (thread);
+}
+
+void Sys_MemoryBarrier (void)
+{
+	MemoryBarrier ();
+}
+
 void Sys_Mkdir (char *path)
 {
 	_mkdir (path);
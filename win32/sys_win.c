@@ -988,11 +988,6 @@ void Sys_ConsoleOutput (const char *string)
 
 #endif
 
-void Sys_Sleep (int msec)
-{
-	Sleep (msec);
-}
-
 /*
 ================
 Sys_SendKeyEvents
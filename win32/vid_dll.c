@@ -30,6 +30,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 // Structure containing functions exported from refresh DLL
 refexport_t	re;
+PrefetchRegistration_t	R_PrefetchRegistration_fp;
 
 static HWND old_hwnd = 0;
 
@@ -737,6 +738,7 @@ void VID_FreeReflib (void)
 	if ( !FreeLibrary( reflib_library ) )
 		Com_Error( ERR_FATAL, "Reflib FreeLibrary failed" );
 	memset (&re, 0, sizeof(re));
+	R_PrefetchRegistration_fp = NULL;
 	reflib_library = NULL;
 	reflib_active  = false;
 	cl_hwnd = NULL;
@@ -837,6 +839,7 @@ qboolean VID_LoadRefresh( char *name, char *errstr )
 	rx.FS_FOpenFile = FS_FOpenFile;
 	rx.FS_FCloseFile = FS_FCloseFile;
 	rx.FS_Read = FS_Read;
+	rx.FS_ImageExtensions = FS_ImageExtensions;
 
 	rx.APIVersion = EXTENDED_API_VERSION;
 
@@ -865,6 +868,8 @@ qboolean VID_LoadRefresh( char *name, char *errstr )
 			Com_DPrintf ("done.\n");
 		}
 
+		R_PrefetchRegistration_fp = (PrefetchRegistration_t)GetProcAddress( reflib_library, "R_PrefetchRegistration" );
+
 		re = GetRefAPI( ri );
 
 		switch (re.api_version) {